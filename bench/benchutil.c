@@ -0,0 +1,438 @@
+/***************************************************************************
+*                Functions Shared by the LZW Benchmarks
+*
+*   File    : benchutil.c
+*   Purpose : Provides the synthetic input, corpus generator, timer and
+*             cycle counter used by the benchmark programs.
+*   Author  : The lzw library contributors
+*   Date    : October 17, 2026
+*
+****************************************************************************
+*
+* BENCH: Benchmarks for the Lempel-Ziv-Welch Encoding Library
+* Copyright (C) 2026 by
+* The lzw library contributors
+*
+* This file is part of the lzw library.
+*
+* The lzw library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The lzw library is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "benchutil.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define RECORD_SIZE     32          /* bytes in a CORPUS_BINARY record */
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+static size_t PutString(unsigned char *buf, const size_t size, size_t pos,
+    const char *str);
+static const char *Pick(const char *const words[], const size_t count,
+    unsigned long *seed);
+static unsigned long Random(unsigned long *seed);
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/****************************************************************************
+*   Function   : MakeSyntheticInput
+*   Description: This function writes a temporary file of words drawn
+*                from a small vocabulary with a fixed pseudo-random
+*                sequence, so every run sees the same data.
+*   Parameters : size - number of bytes to write
+*   Effects    : Temporary file is created
+*   Returned   : Open temporary file or NULL on error
+****************************************************************************/
+FILE *MakeSyntheticInput(const unsigned long size)
+{
+    static const char *words[] =
+    {
+        "lempel", "ziv", "welch", "dictionary", "code", "word", "the",
+        "of", "and", "block", "thread", "stream", "encode", "decode",
+        "1024", "0x7f", "error:", "info:", "\n", ", ", ". "
+    };
+    FILE *fp;
+    unsigned long written, seed;
+    const char *word;
+
+    fp = tmpfile();
+
+    if (NULL == fp)
+    {
+        return NULL;
+    }
+
+    seed = 12345;
+
+    for (written = 0; written < size; written += strlen(word))
+    {
+        seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+        word = words[(seed >> 16) % (sizeof(words) / sizeof(words[0]))];
+        fputs(word, fp);
+
+        if (0 == ((seed >> 8) & 0x07))
+        {
+            fputc(' ', fp);
+            written++;
+        }
+    }
+
+    return fp;
+}
+
+/****************************************************************************
+*   Function   : CorpusName
+*   Description: This function returns the name of a kind of corpus, as
+*                used in benchmark results.
+*   Parameters : corpus - kind of corpus
+*   Effects    : None
+*   Returned   : Name of the corpus
+****************************************************************************/
+const char *CorpusName(const corpus_t corpus)
+{
+    static const char *names[NUM_CORPORA] =
+    {
+        "text", "logs", "binary", "random", "repetitive", "small"
+    };
+
+    return names[corpus];
+}
+
+/****************************************************************************
+*   Function   : MakeCorpus
+*   Description: This function fills a buffer with data of one kind.
+*                Each kind starts from its own fixed seed and only uses
+*                integer arithmetic, so the data is the same on every run
+*                and platform, and results can be compared between them.
+*   Parameters : corpus - kind of data to make
+*                buf - buffer receiving the data
+*                size - number of bytes to make
+*   Effects    : buf is filled
+*   Returned   : None
+****************************************************************************/
+void MakeCorpus(const corpus_t corpus, unsigned char *buf, const size_t size)
+{
+    static const char *const words[] =
+    {
+        "the", "of", "and", "a", "to", "in", "is", "was", "that", "for",
+        "dictionary", "string", "code", "compression", "table", "entry",
+        "which", "each", "with", "when", "data", "value", "every", "new"
+    };
+    static const char *const levels[] =
+    {
+        "INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR"
+    };
+    static const char *const paths[] =
+    {
+        "/api/v1/users", "/api/v1/orders", "/static/app.js", "/login",
+        "/health", "/api/v2/search?q=lzw", "/index.html"
+    };
+    static const char *const events[] =
+    {
+        "\"click\"", "\"view\"", "\"purchase\"", "\"login\"",
+        "\"logout\""
+    };
+    char field[64];
+    unsigned long seed, n, i, a, b, c;
+    size_t pos, end;
+
+    seed = 1 + (unsigned long)corpus;
+    pos = 0;
+
+    while (pos < size)
+    {
+        switch (corpus)
+        {
+            case CORPUS_TEXT:
+                /* sentences of 4 to 19 words */
+                n = 4 + (Random(&seed) >> 16) % 16;
+
+                for (i = 0; i < n; i++)
+                {
+                    pos = PutString(buf, size, pos,
+                        Pick(words, sizeof(words) / sizeof(words[0]),
+                            &seed));
+                    pos = PutString(buf, size, pos,
+                        (i + 1 < n) ? " " : ".  ");
+                }
+
+                if (0 == (Random(&seed) >> 16) % 6)
+                {
+                    pos = PutString(buf, size, pos, "\n\n");
+                }
+                break;
+
+            case CORPUS_LOGS:
+                n = pos / 97;           /* a clock that only moves forward */
+                sprintf(field, "2026-10-17 %02lu:%02lu:%02lu.%03lu ",
+                    (n / 3600000UL) % 24, (n / 60000UL) % 60,
+                    (n / 1000UL) % 60, n % 1000);
+                pos = PutString(buf, size, pos, field);
+                pos = PutString(buf, size, pos,
+                    Pick(levels, sizeof(levels) / sizeof(levels[0]), &seed));
+                /* draws are sequenced so every compiler makes the same data */
+                a = (Random(&seed) >> 16) % 8;
+                b = (Random(&seed) >> 16) % 4;
+                c = (Random(&seed) >> 16) % 256;
+                sprintf(field, " [worker-%lu] 10.0.%lu.%lu GET ", a, b, c);
+                pos = PutString(buf, size, pos, field);
+                pos = PutString(buf, size, pos,
+                    Pick(paths, sizeof(paths) / sizeof(paths[0]), &seed));
+                a = (0 == (Random(&seed) >> 16) % 10) ? 404UL : 200UL;
+                b = (Random(&seed) >> 16) % 500;
+                c = Random(&seed);
+                sprintf(field, " %lu %lums id=%08lx\n", a, b, c);
+                pos = PutString(buf, size, pos, field);
+                break;
+
+            case CORPUS_BINARY:
+                /* id, slowly changing counters and flags, zero padding */
+                end = (pos + RECORD_SIZE < size) ? (pos + RECORD_SIZE) : size;
+                n = pos / RECORD_SIZE;
+
+                for (i = 0; pos < end; i++, pos++)
+                {
+                    if (i < 4)
+                    {
+                        buf[pos] = (unsigned char)(n >> (8 * i));
+                    }
+                    else if (i < 12)
+                    {
+                        buf[pos] = (unsigned char)
+                            ((n * (i - 3) + (Random(&seed) >> 28)) >>
+                            (8 * (i % 2)));
+                    }
+                    else if (i < 16)
+                    {
+                        buf[pos] = (unsigned char)(1 << (n % 8));
+                    }
+                    else
+                    {
+                        buf[pos] = 0;
+                    }
+                }
+                break;
+
+            case CORPUS_RANDOM:
+                buf[pos++] = (unsigned char)(Random(&seed) >> 16);
+                break;
+
+            case CORPUS_REPETITIVE:
+                /* one in 64 copies has a changed character */
+                pos = PutString(buf, size, pos,
+                    "all work and no play makes jack a dull boy. ");
+
+                if ((0 == (Random(&seed) >> 16) % 64) && (pos > 40))
+                {
+                    buf[pos - 1 - (seed >> 8) % 40] ^= 0x20;
+                }
+                break;
+
+            case CORPUS_SMALL:
+            default:
+                sprintf(field, "{\"user\":%lu,\"event\":",
+                    (Random(&seed) >> 16) % 100000);
+                pos = PutString(buf, size, pos, field);
+                pos = PutString(buf, size, pos,
+                    Pick(events, sizeof(events) / sizeof(events[0]), &seed));
+                a = Random(&seed);
+                sprintf(field, ",\"ms\":%lu,\"ok\":%s}\n", a % 100000,
+                    ((a >> 20) & 1) ? "true" : "false");
+                pos = PutString(buf, size, pos, field);
+                break;
+        }
+    }
+}
+
+/****************************************************************************
+*   Function   : PutString
+*   Description: This function copies a string into a buffer, stopping at
+*                the end of the buffer.
+*   Parameters : buf - buffer receiving the string
+*                size - number of bytes in buf
+*                pos - offset the string is copied to
+*                str - NUL terminated string
+*   Effects    : Up to size - pos bytes of str are copied to buf
+*   Returned   : Offset following the copied bytes
+****************************************************************************/
+static size_t PutString(unsigned char *buf, const size_t size, size_t pos,
+    const char *str)
+{
+    while ((pos < size) && ('\0' != *str))
+    {
+        buf[pos++] = (unsigned char)*str++;
+    }
+
+    return pos;
+}
+
+/****************************************************************************
+*   Function   : Pick
+*   Description: This function picks a pseudo-random entry from a list.
+*   Parameters : words - list of strings
+*                count - number of entries in words
+*                seed - generator state
+*   Effects    : seed is advanced
+*   Returned   : The chosen entry
+****************************************************************************/
+static const char *Pick(const char *const words[], const size_t count,
+    unsigned long *seed)
+{
+    return words[(Random(seed) >> 16) % count];
+}
+
+/****************************************************************************
+*   Function   : Random
+*   Description: This function advances the linear congruential generator
+*                MakeSyntheticInput uses, with 31 bits of state.
+*   Parameters : seed - generator state
+*   Effects    : seed is advanced
+*   Returned   : The new state
+****************************************************************************/
+static unsigned long Random(unsigned long *seed)
+{
+    *seed = (*seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+    return *seed;
+}
+
+/****************************************************************************
+*   Function   : Now
+*   Description: This function returns a monotonic time in seconds.
+*   Parameters : None
+*   Effects    : None
+*   Returned   : Current time in seconds
+****************************************************************************/
+double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+/****************************************************************************
+*   Function   : Cycles
+*   Description: This function reads the CPU's time stamp counter on x86,
+*                which counts at a constant rate close to the nominal
+*                clock, so differences give cycles per byte at that clock.
+*   Parameters : None
+*   Effects    : None
+*   Returned   : Counter value, or -1.0 where there is no counter
+****************************************************************************/
+double Cycles(void)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    unsigned int lo, hi;
+
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return (hi * 4294967296.0) + lo;
+#else
+    return -1.0;
+#endif
+}
+
+/****************************************************************************
+*   Function   : PeakRss
+*   Description: This function returns the most memory the process has
+*                had resident since it started or ResetPeakRss last
+*                succeeded.  Linux's VmHWM is used where it's available,
+*                since it's the value ResetPeakRss restarts, and
+*                getrusage's ru_maxrss otherwise.
+*   Parameters : None
+*   Effects    : None
+*   Returned   : Peak resident memory in KB, or -1 if it's unknown
+****************************************************************************/
+long PeakRss(void)
+{
+    FILE *fp;
+    char line[128];
+    long kb;
+    struct rusage usage;
+
+    fp = fopen("/proc/self/status", "r");
+
+    if (NULL != fp)
+    {
+        kb = -1;
+
+        while ((kb < 0) && (NULL != fgets(line, sizeof(line), fp)))
+        {
+            if (1 != sscanf(line, "VmHWM: %ld", &kb))
+            {
+                kb = -1;
+            }
+        }
+
+        fclose(fp);
+
+        if (kb >= 0)
+        {
+            return kb;
+        }
+    }
+
+    /* ru_maxrss is in kilobytes on Linux and the BSDs */
+    if (0 == getrusage(RUSAGE_SELF, &usage))
+    {
+        return usage.ru_maxrss;
+    }
+
+    return -1;
+}
+
+/****************************************************************************
+*   Function   : ResetPeakRss
+*   Description: This function restarts the peak reported by PeakRss at
+*                the memory resident now, so the peak of one test can be
+*                told from the tests before it.  Only Linux supports this.
+*   Parameters : None
+*   Effects    : The process' peak resident memory is reset
+*   Returned   : 0 for success, -1 if the peak can't be reset, in which
+*                case PeakRss keeps reporting the peak since the process
+*                started
+****************************************************************************/
+int ResetPeakRss(void)
+{
+    FILE *fp;
+    int result;
+
+    fp = fopen("/proc/self/clear_refs", "w");
+
+    if (NULL == fp)
+    {
+        return -1;
+    }
+
+    result = (EOF == fputs("5", fp)) ? -1 : 0;
+
+    if (0 != fclose(fp))
+    {
+        result = -1;
+    }
+
+    return result;
+}
@@ -0,0 +1,78 @@
+/***************************************************************************
+*           Header for Functions Shared by the LZW Benchmarks
+*
+*   File    : benchutil.h
+*   Purpose : Provides prototypes for the synthetic input, corpus
+*             generator, timer and cycle counter used by the benchmark
+*             programs.
+*   Author  : The lzw library contributors
+*   Date    : October 17, 2026
+*
+****************************************************************************
+*
+* BENCH: Benchmarks for the Lempel-Ziv-Welch Encoding Library
+* Copyright (C) 2026 by
+* The lzw library contributors
+*
+* This file is part of the lzw library.
+*
+* The lzw library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The lzw library is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+#ifndef _BENCHUTIL_H_
+#define _BENCHUTIL_H_
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdio.h>
+#include <stddef.h>
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* kinds of data made by MakeCorpus */
+typedef enum
+{
+    CORPUS_TEXT,                /* prose-like words and sentences */
+    CORPUS_LOGS,                /* timestamped server log lines */
+    CORPUS_BINARY,              /* fixed size records of binary fields */
+    CORPUS_RANDOM,              /* uniformly random bytes */
+    CORPUS_REPETITIVE,          /* one phrase repeated with rare changes */
+    CORPUS_SMALL,               /* short independent JSON-like messages */
+    NUM_CORPORA
+} corpus_t;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* temporary file of repeatable word-like data */
+FILE *MakeSyntheticInput(const unsigned long size);
+
+/* deterministic data of each kind, the same on every run and platform */
+const char *CorpusName(const corpus_t corpus);
+void MakeCorpus(const corpus_t corpus, unsigned char *buf, const size_t size);
+
+/* monotonic time in seconds */
+double Now(void);
+
+/* CPU time stamp counter, or a negative value where there isn't one */
+double Cycles(void);
+
+/* most memory the process has had resident, in KB, and restarting it */
+long PeakRss(void);
+int ResetPeakRss(void);
+
+#endif  /* ndef _BENCHUTIL_H_ */
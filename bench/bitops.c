@@ -0,0 +1,514 @@
+/***************************************************************************
+*                 Bit File Microbenchmark for LZW Library
+*
+*   File    : bitops.c
+*   Purpose : Measure the time per call of each bitfile library primitive
+*             on memory backed streams: single bits, characters (aligned
+*             and not), and BitFileGetBits/PutBits and
+*             BitFileGetBitsNum/PutBitsNum for every width from 1 to 32
+*             bits.  The LZW codecs read and write their code words with
+*             these, so this shows which bit I/O paths bound them.
+*   Author  : The lzw library contributors
+*   Date    : October 17, 2026
+*
+****************************************************************************
+*
+* BITOPS: Benchmark for the Lempel-Ziv-Welch Encoding Library
+* Copyright (C) 2026 by
+* The lzw library contributors
+*
+* This file is part of the lzw library.
+*
+* The lzw library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The lzw library is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#define _POSIX_C_SOURCE 200809L     /* fmemopen */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "optlist/optlist.h"
+#include "bitfile/bitfile.h"
+#include "benchutil.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define BUFFER_SIZE     (1UL << 22) /* bytes in the memory backed stream */
+#define DEFAULT_OPS     (1UL << 19) /* calls timed per primitive */
+#define REPEATS         3           /* runs per primitive, best is kept */
+#define MAX_WIDTH       32          /* widest code word tried */
+#define NUM_VALUES      256         /* distinct values written, cycled */
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* the primitives timed */
+typedef enum
+{
+    OP_PUT_BIT,
+    OP_GET_BIT,
+    OP_PUT_CHAR,
+    OP_GET_CHAR,
+    OP_PUT_CHAR_UNALIGNED,      /* PutChar after one bit */
+    OP_GET_CHAR_UNALIGNED,      /* GetChar after one bit */
+    OP_PUT_BITS,
+    OP_GET_BITS,
+    OP_PUT_BITS_NUM,
+    OP_GET_BITS_NUM,
+    NUM_OPS
+} op_t;
+
+/* values written and expected back, for one width */
+typedef struct
+{
+    unsigned int width;
+    unsigned char bytes[NUM_VALUES][4]; /* MSB first, left justified */
+    unsigned long nums[NUM_VALUES];     /* the same values as numbers */
+} values_t;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+static void MakeValues(values_t *values, const unsigned int width);
+static double TimeOp(const op_t op, const values_t *values,
+    unsigned char *buffer, const unsigned long ops);
+static int RunOp(const op_t op, const values_t *values, bit_file_t *bf,
+    const unsigned long ops);
+static int IsPut(const op_t op);
+static void PutResult(FILE *fpJson, int *first, const op_t op,
+    const unsigned int width, const double ns);
+
+/***************************************************************************
+*                            GLOBAL VARIABLES
+***************************************************************************/
+static const char *opNames[NUM_OPS] =
+{
+    "PutBit", "GetBit", "PutChar", "GetChar", "PutCharUnaligned",
+    "GetCharUnaligned", "PutBits", "GetBits", "PutBitsNum", "GetBitsNum"
+};
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/****************************************************************************
+*   Function   : main
+*   Description: This is the main function for this program.  It times
+*                the single bit and character primitives, then the multi
+*                bit primitives at each width, and prints ns per call.
+*                Every get is checked against the values that were put.
+*   Parameters : argc - number of parameters
+*                argv - parameter list
+*   Effects    : Writes a table of results to stdout, and JSON results to
+*                the -o file
+*   Returned   : EXIT_SUCCESS or EXIT_FAILURE
+****************************************************************************/
+int main(int argc, char *argv[])
+{
+    option_t *optList, *thisOpt;
+    FILE *fpJson;
+    unsigned char *buffer;
+    values_t values;
+    unsigned long ops;
+    unsigned int width;
+    double ns[NUM_OPS];
+    int op, first;
+
+    fpJson = NULL;
+    ops = DEFAULT_OPS;
+
+    optList = GetOptList(argc, argv, "n:o:h?");
+    thisOpt = optList;
+
+    while (thisOpt != NULL)
+    {
+        switch(thisOpt->option)
+        {
+            case 'n':       /* calls per primitive */
+                ops = strtoul(thisOpt->argument, NULL, 10);
+                break;
+
+            case 'o':       /* JSON results file */
+                if (NULL != fpJson)
+                {
+                    fclose(fpJson);
+                }
+
+                fpJson = fopen(thisOpt->argument, "w");
+
+                if (NULL == fpJson)
+                {
+                    perror("Opening results file");
+                    FreeOptList(optList);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'h':
+            case '?':
+                printf("Usage: %s <options>\n\n", FindFileName(argv[0]));
+                printf("options:\n");
+                printf("  -n <calls> : Calls timed per primitive ");
+                printf("(default %lu).\n", DEFAULT_OPS);
+                printf("  -o <filename> : Also write JSON results to a ");
+                printf("file.\n");
+                printf("  -h | ?  : Print out command line options.\n\n");
+                FreeOptList(optList);
+                return EXIT_SUCCESS;
+        }
+
+        optList = thisOpt->next;
+        free(thisOpt);
+        thisOpt = optList;
+    }
+
+    if (0 == ops)
+    {
+        fprintf(stderr, "Invalid number of calls.\n");
+        return EXIT_FAILURE;
+    }
+
+    buffer = malloc(BUFFER_SIZE + 1);
+
+    if (NULL == buffer)
+    {
+        perror("Allocating stream buffer");
+        return EXIT_FAILURE;
+    }
+
+    if (NULL != fpJson)
+    {
+        fprintf(fpJson, "{\n  \"version\": 1,\n  \"results\": [");
+    }
+
+    first = 1;
+
+    /* single bits and characters */
+    MakeValues(&values, 8);
+    printf("%-18s %10s\n", "primitive", "ns/call");
+
+    for (op = OP_PUT_BIT; op <= OP_GET_CHAR_UNALIGNED; op++)
+    {
+        ns[op] = TimeOp((op_t)op, &values, buffer, ops);
+
+        if (ns[op] < 0.0)
+        {
+            free(buffer);
+            return EXIT_FAILURE;
+        }
+
+        printf("%-18s %10.2f\n", opNames[op], ns[op]);
+        PutResult(fpJson, &first, (op_t)op,
+            ((OP_PUT_BIT == op) || (OP_GET_BIT == op)) ? 1 : 8, ns[op]);
+    }
+
+    /* multi bit primitives at every width */
+    printf("\n%6s %10s %10s %10s %10s   (ns/call)\n", "width",
+        opNames[OP_PUT_BITS], opNames[OP_GET_BITS], opNames[OP_PUT_BITS_NUM],
+        opNames[OP_GET_BITS_NUM]);
+
+    for (width = 1; width <= MAX_WIDTH; width++)
+    {
+        MakeValues(&values, width);
+        printf("%6u", width);
+
+        for (op = OP_PUT_BITS; op < NUM_OPS; op++)
+        {
+            ns[op] = TimeOp((op_t)op, &values, buffer, ops);
+
+            if (ns[op] < 0.0)
+            {
+                free(buffer);
+                return EXIT_FAILURE;
+            }
+
+            printf(" %10.2f", ns[op]);
+            PutResult(fpJson, &first, (op_t)op, width, ns[op]);
+        }
+
+        printf("\n");
+    }
+
+    free(buffer);
+
+    if (NULL != fpJson)
+    {
+        fprintf(fpJson, "\n  ]\n}\n");
+
+        if (ferror(fpJson) || (0 != fclose(fpJson)))
+        {
+            perror("Writing results");
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/****************************************************************************
+*   Function   : MakeValues
+*   Description: This function makes the values written at one width, as
+*                byte arrays for BitFilePutBits and as numbers for
+*                BitFilePutBitsNum.  Both hold the same bits.
+*   Parameters : values - receives the values
+*                width - bits in each value (1 to MAX_WIDTH)
+*   Effects    : values is filled
+*   Returned   : None
+****************************************************************************/
+static void MakeValues(values_t *values, const unsigned int width)
+{
+    unsigned long seed, num, left;
+    unsigned int i, b;
+
+    values->width = width;
+    seed = 12345;
+
+    for (i = 0; i < NUM_VALUES; i++)
+    {
+        seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+        num = (seed << 1) ^ (seed >> 15);
+        num &= (width < 32) ? ((1UL << width) - 1) : 0xFFFFFFFFUL;
+        values->nums[i] = num;
+
+        /* the same bits, most significant first and left justified */
+        left = num << (MAX_WIDTH - width);
+
+        for (b = 0; b < 4; b++)
+        {
+            values->bytes[i][b] =
+                (unsigned char)((left >> (8 * (3 - b))) & 0xFF);
+        }
+    }
+}
+
+/****************************************************************************
+*   Function   : TimeOp
+*   Description: This function times ops calls of a primitive on a memory
+*                backed bit file, keeping the fastest of REPEATS runs.
+*                Gets read back what the matching put wrote, so the put
+*                is run first (untimed) for them.
+*   Parameters : op - primitive to time
+*                values - values to put or expect
+*                buffer - BUFFER_SIZE + 1 bytes backing the stream
+*                ops - number of calls
+*   Effects    : buffer is overwritten
+*   Returned   : ns per call, or -1.0 on failure
+****************************************************************************/
+static double TimeOp(const op_t op, const values_t *values,
+    unsigned char *buffer, const unsigned long ops)
+{
+    FILE *fp;
+    bit_file_t *bf;
+    double start, elapsed, best;
+    unsigned long calls;
+    int r;
+
+    /* every call fits in the buffer */
+    calls = (BUFFER_SIZE * 8UL) / (values->width + 1);
+    calls = (ops < calls) ? ops : calls;
+    best = -1.0;
+
+    for (r = 0; r < REPEATS; r++)
+    {
+        if (!IsPut(op))
+        {
+            /* make the data to get with the matching put */
+            fp = fmemopen(buffer, BUFFER_SIZE + 1, "wb");
+            bf = (NULL == fp) ? NULL : MakeBitFile(fp, BF_WRITE);
+
+            if ((NULL == bf) || (0 != RunOp((op_t)(op - 1), values, bf,
+                calls)) || (0 != BitFileClose(bf)))
+            {
+                perror("Writing stream");
+                return -1.0;
+            }
+        }
+
+        fp = fmemopen(buffer, BUFFER_SIZE + 1, IsPut(op) ? "wb" : "rb");
+        bf = (NULL == fp) ? NULL :
+            MakeBitFile(fp, IsPut(op) ? BF_WRITE : BF_READ);
+
+        if (NULL == bf)
+        {
+            perror("Opening stream");
+            return -1.0;
+        }
+
+        start = Now();
+
+        if (0 != RunOp(op, values, bf, calls))
+        {
+            fprintf(stderr, "%s width %u: stream doesn't match\n",
+                opNames[op], values->width);
+            BitFileClose(bf);
+            return -1.0;
+        }
+
+        elapsed = Now() - start;
+        BitFileClose(bf);
+
+        if ((best < 0.0) || (elapsed < best))
+        {
+            best = elapsed;
+        }
+    }
+
+    return (best * 1e9) / calls;
+}
+
+/****************************************************************************
+*   Function   : RunOp
+*   Description: This function calls a primitive ops times, cycling
+*                through the values.  Gets check each value read.
+*   Parameters : op - primitive to call
+*                values - values to put or expect
+*                bf - open bit file
+*                ops - number of calls
+*   Effects    : bf is written or read
+*   Returned   : 0 for success, -1 for a failure or a mismatch
+****************************************************************************/
+static int RunOp(const op_t op, const values_t *values, bit_file_t *bf,
+    const unsigned long ops)
+{
+    unsigned char bytes[4];
+    unsigned long i, num;
+    unsigned int v, width, len;
+
+    width = values->width;
+    len = (width + 7) / 8;
+
+    /* the unaligned character tests start one bit into the stream */
+    if (((OP_PUT_CHAR_UNALIGNED == op) && (EOF == BitFilePutBit(1, bf))) ||
+        ((OP_GET_CHAR_UNALIGNED == op) && (1 != BitFileGetBit(bf))))
+    {
+        return -1;
+    }
+
+    for (i = 0; i < ops; i++)
+    {
+        v = (unsigned int)(i % NUM_VALUES);
+
+        switch (op)
+        {
+            case OP_PUT_BIT:
+                if (EOF == BitFilePutBit(values->bytes[v][0] >> 7, bf))
+                {
+                    return -1;
+                }
+                break;
+
+            case OP_GET_BIT:
+                if (BitFileGetBit(bf) != (values->bytes[v][0] >> 7))
+                {
+                    return -1;
+                }
+                break;
+
+            case OP_PUT_CHAR:
+            case OP_PUT_CHAR_UNALIGNED:
+                if (EOF == BitFilePutChar(values->bytes[v][0], bf))
+                {
+                    return -1;
+                }
+                break;
+
+            case OP_GET_CHAR:
+            case OP_GET_CHAR_UNALIGNED:
+                if (BitFileGetChar(bf) != values->bytes[v][0])
+                {
+                    return -1;
+                }
+                break;
+
+            case OP_PUT_BITS:
+                memcpy(bytes, values->bytes[v], len);
+
+                if (EOF == BitFilePutBits(bf, bytes, width))
+                {
+                    return -1;
+                }
+                break;
+
+            case OP_GET_BITS:
+                if ((EOF == BitFileGetBits(bf, bytes, width)) ||
+                    (0 != memcmp(bytes, values->bytes[v], len)))
+                {
+                    return -1;
+                }
+                break;
+
+            case OP_PUT_BITS_NUM:
+                num = values->nums[v];
+
+                if (EOF == BitFilePutBitsNum(bf, &num, width, sizeof(num)))
+                {
+                    return -1;
+                }
+                break;
+
+            case OP_GET_BITS_NUM:
+            default:
+                num = 0;
+
+                if ((EOF == BitFileGetBitsNum(bf, &num, width,
+                    sizeof(num))) || (num != values->nums[v]))
+                {
+                    return -1;
+                }
+                break;
+        }
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : IsPut
+*   Description: This function tells puts from gets.  Each get follows
+*                its put in op_t.
+*   Parameters : op - primitive
+*   Effects    : None
+*   Returned   : Non-zero if op writes
+****************************************************************************/
+static int IsPut(const op_t op)
+{
+    return (0 == (op % 2));
+}
+
+/****************************************************************************
+*   Function   : PutResult
+*   Description: This function writes one result to the JSON results.
+*   Parameters : fpJson - JSON results file, or NULL for none
+*                first - non-zero until the first result is written
+*                op - primitive timed
+*                width - bits per call
+*                ns - ns per call
+*   Effects    : A result is written to fpJson
+*   Returned   : None
+****************************************************************************/
+static void PutResult(FILE *fpJson, int *first, const op_t op,
+    const unsigned int width, const double ns)
+{
+    if (NULL != fpJson)
+    {
+        fprintf(fpJson, "%s\n    {\"primitive\": \"%s\", \"width\": %u, "
+            "\"ns_per_call\": %.3f}", *first ? "" : ",", opNames[op], width,
+            ns);
+        *first = 0;
+    }
+}
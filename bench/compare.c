@@ -0,0 +1,1251 @@
+/***************************************************************************
+*             Benchmark Regression Gate for LZW Library
+*
+*   File    : compare.c
+*   Purpose : Compare benchmark suite results with a baseline and fail if
+*             any test got slower (or compressed worse) by more than a
+*             threshold.  Speeds are compared relative to a reference
+*             kernel timed alongside each run, so baselines carry over
+*             between machines.  Slowdowns must also pass a one-sided
+*             Mann-Whitney test on the repeated runs, Holm corrected for
+*             the number of tests, so noise isn't reported as a regression.
+*   Author  : The lzw library contributors
+*   Date    : October 17, 2026
+*
+****************************************************************************
+*
+* COMPARE: Benchmark for the Lempel-Ziv-Welch Encoding Library
+* Copyright (C) 2026 by
+* The lzw library contributors
+*
+* This file is part of the lzw library.
+*
+* The lzw library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The lzw library is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "optlist/optlist.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define RESULTS_VERSION     2       /* layout of the suite's JSON results */
+#define MAX_NAME            256     /* longest corpus or engine name kept */
+#define MAX_RUNS            64      /* most runs of one test compared */
+#define MAX_DEPTH           32      /* deepest JSON nesting skipped */
+#define DEFAULT_THRESHOLD   10.0    /* percent change allowed */
+#define DEFAULT_ALPHA       0.05    /* significance level of all tests */
+#define DEFAULT_MIN_RUNS    7       /* fewest runs per side to be tested */
+
+#define EXIT_REGRESSION     1       /* a test got worse */
+#define EXIT_ERROR          2       /* the results couldn't be compared */
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* directions of a test */
+typedef enum
+{
+    DIR_ENCODE,
+    DIR_DECODE,
+    NUM_DIRS
+} direction_t;
+
+/* one corpus coded by one engine */
+typedef struct
+{
+    char corpus[MAX_NAME];
+    char engine[MAX_NAME];
+    double bytes;               /* size of the corpus */
+    double encoded;             /* size of the encoded corpus */
+    double runs[NUM_DIRS][MAX_RUNS];    /* MB/s of each run */
+    double relative[NUM_DIRS][MAX_RUNS];    /* each rate / the reference's */
+    unsigned int numRuns[NUM_DIRS];
+} result_t;
+
+/* every result of one suite run */
+typedef struct
+{
+    result_t *results;
+    size_t count;
+} results_t;
+
+/* one direction of one test in both sets of results */
+typedef struct
+{
+    const result_t *base;
+    const result_t *current;
+    direction_t dir;
+    double change;              /* percent change of the relative rate */
+    double p;                   /* one-sided Mann-Whitney p-value */
+    int testable;               /* enough runs to ever be significant */
+    int significant;            /* p survives the Holm correction */
+} comparison_t;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* reading suite results */
+static int LoadResults(const char *name, results_t *results);
+static int ParseResults(const char **p, results_t *results);
+static int ParseResult(const char **p, result_t *result);
+static int ParseRuns(const char **p, double *runs, unsigned int *count);
+static int MakeRelative(result_t *result, double refs[][MAX_RUNS],
+    const unsigned int *numRefs);
+static int ParseString(const char **p, char *str, const size_t size);
+static int ParseNumber(const char **p, double *value);
+static int SkipValue(const char **p, const unsigned int depth);
+static int Expect(const char **p, const char c);
+static void SkipSpace(const char **p);
+
+/* comparing them */
+static const result_t *FindResult(const results_t *results,
+    const result_t *match);
+static void CompareRuns(const result_t *base, const result_t *current,
+    const direction_t dir, comparison_t *comparison);
+static void HolmCorrect(comparison_t *comparisons, const size_t count,
+    const double alpha, const unsigned int minRuns);
+static int CompareP(const void *a, const void *b);
+static int PrintComparison(const comparison_t *comparison,
+    const double threshold);
+static double Median(const double *values, const unsigned int count);
+static int CompareDoubles(const void *a, const void *b);
+static double SlowerP(const double *base, const unsigned int numBase,
+    const double *current, const unsigned int numCurrent);
+static double SmallestP(const unsigned int numBase,
+    const unsigned int numCurrent);
+
+/***************************************************************************
+*                            GLOBAL VARIABLES
+***************************************************************************/
+static const char *dirNames[NUM_DIRS] = {"encode", "decode"};
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/****************************************************************************
+*   Function   : main
+*   Description: This is the main function for this program.  It reads a
+*                baseline and a current set of suite results and compares
+*                each test found in both.  A test regresses if its median
+*                encode or decode rate, relative to the reference kernel,
+*                drops by more than the threshold and the drop is
+*                significant after a Holm correction for the number of
+*                tests, or if its encoded size grows by more than the
+*                threshold.
+*   Parameters : argc - number of parameters
+*                argv - parameter list
+*   Effects    : A comparison of each test is written to stdout
+*   Returned   : EXIT_SUCCESS if nothing regressed, EXIT_REGRESSION if
+*                something did, and EXIT_ERROR if the results couldn't be
+*                read or compared, or have too few runs to be tested
+****************************************************************************/
+int main(int argc, char *argv[])
+{
+    option_t *optList, *thisOpt;
+    const char *baseName, *currentName;
+    results_t base, current;
+    const result_t *match;
+    comparison_t *comparisons;
+    double threshold, alpha, growth;
+    size_t i, regressions, compared, count, untestable;
+    unsigned int minRuns;
+    int dir, status;
+
+    baseName = "bench/baseline.json";
+    currentName = "bench/results.json";
+    threshold = DEFAULT_THRESHOLD;
+    alpha = DEFAULT_ALPHA;
+    minRuns = DEFAULT_MIN_RUNS;
+
+    optList = GetOptList(argc, argv, "a:b:c:n:t:h?");
+    thisOpt = optList;
+
+    while (thisOpt != NULL)
+    {
+        switch(thisOpt->option)
+        {
+            case 'a':       /* significance level */
+                alpha = atof(thisOpt->argument);
+                break;
+
+            case 'b':       /* baseline results */
+                baseName = thisOpt->argument;
+                break;
+
+            case 'c':       /* current results */
+                currentName = thisOpt->argument;
+                break;
+
+            case 'n':       /* fewest runs per side */
+                minRuns = (unsigned int)atoi(thisOpt->argument);
+                break;
+
+            case 't':       /* percent change allowed */
+                threshold = atof(thisOpt->argument);
+                break;
+
+            case 'h':
+            case '?':
+                printf("Usage: %s <options>\n\n", FindFileName(argv[0]));
+                printf("options:\n");
+                printf("  -b <filename> : Baseline results ");
+                printf("(default bench/baseline.json).\n");
+                printf("  -c <filename> : Current results ");
+                printf("(default bench/results.json).\n");
+                printf("  -t <percent> : Change allowed before failing ");
+                printf("(default %.1f).\n", DEFAULT_THRESHOLD);
+                printf("  -a <alpha> : Significance level of slowdowns, ");
+                printf("across all tests (default %.2f).\n",
+                    DEFAULT_ALPHA);
+                printf("  -n <runs> : Fewest runs of each test in each ");
+                printf("file (default %d).\n", DEFAULT_MIN_RUNS);
+                printf("  -h | ?  : Print out command line options.\n\n");
+                printf("Exits with %d if a test regressed and %d if the ",
+                    EXIT_REGRESSION, EXIT_ERROR);
+                printf("results can't be compared.\n");
+                FreeOptList(optList);
+                return EXIT_SUCCESS;
+        }
+
+        optList = thisOpt->next;
+        free(thisOpt);
+        thisOpt = optList;
+    }
+
+    if ((threshold < 0.0) || (alpha <= 0.0) || (alpha >= 1.0) ||
+        (minRuns < 2))
+    {
+        fprintf(stderr, "Invalid threshold, significance level or runs.\n");
+        return EXIT_ERROR;
+    }
+
+    if (0 != LoadResults(baseName, &base))
+    {
+        return EXIT_ERROR;
+    }
+
+    if (0 != LoadResults(currentName, &current))
+    {
+        free(base.results);
+        return EXIT_ERROR;
+    }
+
+    comparisons = malloc((NUM_DIRS * current.count + 1) *
+        sizeof(comparison_t));
+
+    if (NULL == comparisons)
+    {
+        perror("Allocating comparisons");
+        free(base.results);
+        free(current.results);
+        return EXIT_ERROR;
+    }
+
+    status = EXIT_SUCCESS;
+    count = 0;
+    compared = 0;
+
+    /* every test's p-value is needed before any can be judged */
+    for (i = 0; i < current.count; i++)
+    {
+        match = FindResult(&base, &current.results[i]);
+
+        if (NULL == match)
+        {
+            printf("%-12.12s %-9.9s not in the baseline\n",
+                current.results[i].corpus, current.results[i].engine);
+            continue;
+        }
+
+        if (match->bytes != current.results[i].bytes)
+        {
+            fprintf(stderr, "%s %s: the corpus size changed, make a new "
+                "baseline with the same suite options\n",
+                current.results[i].corpus, current.results[i].engine);
+            status = EXIT_ERROR;
+            continue;
+        }
+
+        compared++;
+
+        for (dir = 0; dir < NUM_DIRS; dir++)
+        {
+            CompareRuns(match, &current.results[i], (direction_t)dir,
+                &comparisons[count]);
+            count++;
+        }
+    }
+
+    HolmCorrect(comparisons, count, alpha, minRuns);
+
+    printf("%-12s %-9s %-6s %10s %10s %8s %8s  %s\n", "corpus", "engine",
+        "", "base MB/s", "now MB/s", "change", "p", "verdict");
+
+    regressions = 0;
+    untestable = 0;
+
+    for (i = 0; i < count; i++)
+    {
+        regressions += PrintComparison(&comparisons[i], threshold);
+        untestable += comparisons[i].testable ? 0 : 1;
+
+        if (DIR_DECODE != comparisons[i].dir)
+        {
+            continue;
+        }
+
+        /* the corpus is deterministic, so any size change is real */
+        match = comparisons[i].base;
+        growth = (0.0 == match->encoded) ? 0.0 :
+            (100.0 * ((comparisons[i].current->encoded / match->encoded) -
+            1.0));
+
+        if (growth > threshold)
+        {
+            printf("%-12.12s %-9.9s %-6s %10.0f %10.0f %+7.1f%% %8s  %s\n",
+                match->corpus, match->engine, "size", match->encoded,
+                comparisons[i].current->encoded, growth, "-", "LARGER");
+            regressions++;
+        }
+    }
+
+    for (i = 0; i < base.count; i++)
+    {
+        if (NULL == FindResult(&current, &base.results[i]))
+        {
+            printf("%-12.12s %-9.9s not in the current results\n",
+                base.results[i].corpus, base.results[i].engine);
+        }
+    }
+
+    printf("%lu test(s) compared, %lu regression(s) beyond %.1f%%\n",
+        (unsigned long)compared, (unsigned long)regressions, threshold);
+
+    if (0 != untestable)
+    {
+        fprintf(stderr, "%lu comparison(s) have too few runs to find a "
+            "slowdown among %lu at the %.2f level.  Make both files with "
+            "at least %u runs (more for more tests).\n",
+            (unsigned long)untestable, (unsigned long)count, alpha,
+            minRuns);
+        status = EXIT_ERROR;
+    }
+
+    if ((EXIT_SUCCESS == status) && (0 != regressions))
+    {
+        status = EXIT_REGRESSION;
+    }
+
+    free(comparisons);
+    free(base.results);
+    free(current.results);
+    return status;
+}
+
+/****************************************************************************
+*   Function   : LoadResults
+*   Description: This function reads a file of JSON results written by the
+*                benchmark suite.
+*   Parameters : name - name of the file
+*                results - receives the results
+*   Effects    : Memory is allocated for the results, which the caller
+*                frees.  Errors are reported on stderr.
+*   Returned   : 0 for success, -1 for failure
+****************************************************************************/
+static int LoadResults(const char *name, results_t *results)
+{
+    FILE *fp;
+    char *text;
+    const char *p;
+    long len;
+    int result;
+
+    results->results = NULL;
+    results->count = 0;
+    text = NULL;
+    fp = fopen(name, "rb");
+    result = -1;
+
+    if ((NULL != fp) && (0 == fseek(fp, 0, SEEK_END)) &&
+        ((len = ftell(fp)) >= 0) && (0 == fseek(fp, 0, SEEK_SET)) &&
+        (NULL != (text = malloc(len + 1))) &&
+        (fread(text, 1, len, fp) == (size_t)len))
+    {
+        text[len] = '\0';
+        p = text;
+        result = ParseResults(&p, results);
+
+        if (0 != result)
+        {
+            fprintf(stderr, "%s: not version %d suite results with every "
+                "run (byte %lu)\n", name, RESULTS_VERSION,
+                (unsigned long)(p - text));
+            free(results->results);
+            results->results = NULL;
+        }
+    }
+    else
+    {
+        perror(name);
+    }
+
+    if (NULL != fp)
+    {
+        fclose(fp);
+    }
+
+    free(text);
+    return result;
+}
+
+/****************************************************************************
+*   Function   : ParseResults
+*   Description: This function parses the top level object of suite
+*                results.  Members other than version and results are
+*                skipped, so later versions of the suite may add more.
+*   Parameters : p - pointer to the text, advanced past what is parsed
+*                results - receives the results
+*   Effects    : Memory is allocated for the results
+*   Returned   : 0 for success, -1 for failure
+****************************************************************************/
+static int ParseResults(const char **p, results_t *results)
+{
+    char key[MAX_NAME];
+    result_t *bigger;
+    double version;
+    size_t size;
+
+    version = 0.0;
+    size = 0;
+
+    if (0 != Expect(p, '{'))
+    {
+        return -1;
+    }
+
+    while ('}' != **p)
+    {
+        if ((0 != ParseString(p, key, sizeof(key))) ||
+            (0 != Expect(p, ':')))
+        {
+            return -1;
+        }
+
+        if (0 == strcmp(key, "version"))
+        {
+            if ((0 != ParseNumber(p, &version)) ||
+                (RESULTS_VERSION != version))
+            {
+                return -1;
+            }
+        }
+        else if (0 == strcmp(key, "results"))
+        {
+            if (0 != Expect(p, '['))
+            {
+                return -1;
+            }
+
+            while (']' != **p)
+            {
+                if (results->count == size)
+                {
+                    size = (0 == size) ? 32 : (2 * size);
+                    bigger = realloc(results->results,
+                        size * sizeof(result_t));
+
+                    if (NULL == bigger)
+                    {
+                        return -1;
+                    }
+
+                    results->results = bigger;
+                }
+
+                if (0 != ParseResult(p, &results->results[results->count]))
+                {
+                    return -1;
+                }
+
+                results->count++;
+
+                if ((',' == **p) && (0 != Expect(p, ',')))
+                {
+                    return -1;
+                }
+            }
+
+            if (0 != Expect(p, ']'))
+            {
+                return -1;
+            }
+        }
+        else if (0 != SkipValue(p, 0))
+        {
+            return -1;
+        }
+
+        if ((',' == **p) && (0 != Expect(p, ',')))
+        {
+            return -1;
+        }
+    }
+
+    return ((RESULTS_VERSION == version) ? Expect(p, '}') : -1);
+}
+
+/****************************************************************************
+*   Function   : ParseResult
+*   Description: This function parses one test's object from the results
+*                array, and finds the rate of each run relative to the
+*                reference kernel timed just before it.  Unknown members
+*                are skipped.
+*   Parameters : p - pointer to the text, advanced past what is parsed
+*                result - receives the test's result
+*   Effects    : None
+*   Returned   : 0 for success, -1 for failure or missing members
+****************************************************************************/
+static int ParseResult(const char **p, result_t *result)
+{
+    char key[MAX_NAME];
+    double refs[NUM_DIRS][MAX_RUNS];    /* MB/s of each reference run */
+    unsigned int numRefs[NUM_DIRS];
+    int status;
+
+    memset(result, 0, sizeof(result_t));
+    numRefs[DIR_ENCODE] = 0;
+    numRefs[DIR_DECODE] = 0;
+
+    if (0 != Expect(p, '{'))
+    {
+        return -1;
+    }
+
+    while ('}' != **p)
+    {
+        if ((0 != ParseString(p, key, sizeof(key))) ||
+            (0 != Expect(p, ':')))
+        {
+            return -1;
+        }
+
+        if (0 == strcmp(key, "corpus"))
+        {
+            status = ParseString(p, result->corpus, sizeof(result->corpus));
+        }
+        else if (0 == strcmp(key, "engine"))
+        {
+            status = ParseString(p, result->engine, sizeof(result->engine));
+        }
+        else if (0 == strcmp(key, "bytes"))
+        {
+            status = ParseNumber(p, &result->bytes);
+        }
+        else if (0 == strcmp(key, "encoded"))
+        {
+            status = ParseNumber(p, &result->encoded);
+        }
+        else if (0 == strcmp(key, "encode_runs"))
+        {
+            status = ParseRuns(p, result->runs[DIR_ENCODE],
+                &result->numRuns[DIR_ENCODE]);
+        }
+        else if (0 == strcmp(key, "decode_runs"))
+        {
+            status = ParseRuns(p, result->runs[DIR_DECODE],
+                &result->numRuns[DIR_DECODE]);
+        }
+        else if (0 == strcmp(key, "encode_ref_runs"))
+        {
+            status = ParseRuns(p, refs[DIR_ENCODE], &numRefs[DIR_ENCODE]);
+        }
+        else if (0 == strcmp(key, "decode_ref_runs"))
+        {
+            status = ParseRuns(p, refs[DIR_DECODE], &numRefs[DIR_DECODE]);
+        }
+        else
+        {
+            status = SkipValue(p, 0);
+        }
+
+        if ((0 != status) || ((',' == **p) && (0 != Expect(p, ','))))
+        {
+            return -1;
+        }
+    }
+
+    /* results from before the suite wrote every run can't be tested */
+    if (('\0' == result->corpus[0]) || ('\0' == result->engine[0]) ||
+        (0 == result->numRuns[DIR_ENCODE]) ||
+        (0 == result->numRuns[DIR_DECODE]) ||
+        (0 != MakeRelative(result, refs, numRefs)))
+    {
+        return -1;
+    }
+
+    return Expect(p, '}');
+}
+
+/****************************************************************************
+*   Function   : MakeRelative
+*   Description: This function divides the rate of each run of a test by
+*                the rate of the reference kernel timed just before it,
+*                which cancels how fast the machine was at the time.
+*   Parameters : result - result with its runs parsed
+*                refs - reference rates, indexed like result->runs
+*                numRefs - number of reference rates in each direction
+*   Effects    : result->relative is filled in
+*   Returned   : 0 for success, -1 if the references don't match the runs
+****************************************************************************/
+static int MakeRelative(result_t *result, double refs[][MAX_RUNS],
+    const unsigned int *numRefs)
+{
+    unsigned int dir, i;
+
+    for (dir = 0; dir < NUM_DIRS; dir++)
+    {
+        if (numRefs[dir] != result->numRuns[dir])
+        {
+            return -1;
+        }
+
+        for (i = 0; i < numRefs[dir]; i++)
+        {
+            if (refs[dir][i] <= 0.0)
+            {
+                return -1;
+            }
+
+            result->relative[dir][i] = result->runs[dir][i] / refs[dir][i];
+        }
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : ParseRuns
+*   Description: This function parses an array of the MB/s of each run.
+*   Parameters : p - pointer to the text, advanced past what is parsed
+*                runs - receives up to MAX_RUNS rates
+*                count - receives the number of rates
+*   Effects    : None
+*   Returned   : 0 for success, -1 for failure or too many runs
+****************************************************************************/
+static int ParseRuns(const char **p, double *runs, unsigned int *count)
+{
+    *count = 0;
+
+    if (0 != Expect(p, '['))
+    {
+        return -1;
+    }
+
+    while (']' != **p)
+    {
+        if ((MAX_RUNS == *count) || (0 != ParseNumber(p, &runs[*count])) ||
+            ((',' == **p) && (0 != Expect(p, ','))))
+        {
+            return -1;
+        }
+
+        (*count)++;
+    }
+
+    return Expect(p, ']');
+}
+
+/****************************************************************************
+*   Function   : ParseString
+*   Description: This function parses a JSON string.  Escaped characters
+*                outside of ASCII are kept as '?'.
+*   Parameters : p - pointer to the text, advanced past what is parsed
+*                str - receives the NUL terminated string, cut short if
+*                      it doesn't fit
+*                size - size of str
+*   Effects    : None
+*   Returned   : 0 for success, -1 for failure
+****************************************************************************/
+static int ParseString(const char **p, char *str, const size_t size)
+{
+    const char *s;
+    char hex[5];
+    unsigned long code;
+    size_t len;
+    char c;
+
+    SkipSpace(p);
+    s = *p;
+    len = 0;
+
+    if ('"' != *s)
+    {
+        return -1;
+    }
+
+    for (s++; '"' != *s; s++)
+    {
+        c = *s;
+
+        if ('\0' == c)
+        {
+            *p = s;
+            return -1;
+        }
+
+        if ('\\' == c)
+        {
+            s++;
+
+            switch (*s)
+            {
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'n': c = '\n'; break;
+                case 'r': c = '\r'; break;
+                case 't': c = '\t'; break;
+
+                case 'u':
+                    if (!isxdigit((unsigned char)s[1]) ||
+                        !isxdigit((unsigned char)s[2]) ||
+                        !isxdigit((unsigned char)s[3]) ||
+                        !isxdigit((unsigned char)s[4]))
+                    {
+                        *p = s;
+                        return -1;
+                    }
+
+                    memcpy(hex, s + 1, 4);
+                    hex[4] = '\0';
+                    code = strtoul(hex, NULL, 16);
+                    c = (code < 0x80) ? (char)code : '?';
+                    s += 4;
+                    break;
+
+                case '\0':
+                    *p = s;
+                    return -1;
+
+                default:            /* '"', '\\' and '/' */
+                    c = *s;
+                    break;
+            }
+        }
+
+        if (len + 1 < size)
+        {
+            str[len] = c;
+            len++;
+        }
+    }
+
+    str[len] = '\0';
+    *p = s + 1;
+    SkipSpace(p);
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : ParseNumber
+*   Description: This function parses a JSON number.
+*   Parameters : p - pointer to the text, advanced past what is parsed
+*                value - receives the number
+*   Effects    : None
+*   Returned   : 0 for success, -1 for failure
+****************************************************************************/
+static int ParseNumber(const char **p, double *value)
+{
+    char *end;
+
+    SkipSpace(p);
+
+    if (('-' != **p) && !isdigit((unsigned char)**p))
+    {
+        return -1;
+    }
+
+    *value = strtod(*p, &end);
+
+    if (end == *p)
+    {
+        return -1;
+    }
+
+    *p = end;
+    SkipSpace(p);
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : SkipValue
+*   Description: This function skips over any JSON value.
+*   Parameters : p - pointer to the text, advanced past the value
+*                depth - arrays and objects the value is inside of
+*   Effects    : None
+*   Returned   : 0 for success, -1 for failure
+****************************************************************************/
+static int SkipValue(const char **p, const unsigned int depth)
+{
+    char key[MAX_NAME];
+    double number;
+    char close;
+
+    SkipSpace(p);
+
+    if ('"' == **p)
+    {
+        return ParseString(p, key, sizeof(key));
+    }
+
+    if (('{' == **p) || ('[' == **p))
+    {
+        if (MAX_DEPTH == depth)
+        {
+            return -1;
+        }
+
+        close = ('{' == **p) ? '}' : ']';
+        (*p)++;
+        SkipSpace(p);
+
+        while (close != **p)
+        {
+            if (('}' == close) && ((0 != ParseString(p, key, sizeof(key))) ||
+                (0 != Expect(p, ':'))))
+            {
+                return -1;
+            }
+
+            if ((0 != SkipValue(p, depth + 1)) ||
+                ((',' == **p) && (0 != Expect(p, ','))))
+            {
+                return -1;
+            }
+        }
+
+        return Expect(p, close);
+    }
+
+    if (0 == strncmp(*p, "null", 4) || (0 == strncmp(*p, "true", 4)))
+    {
+        *p += 4;
+    }
+    else if (0 == strncmp(*p, "false", 5))
+    {
+        *p += 5;
+    }
+    else
+    {
+        return ParseNumber(p, &number);
+    }
+
+    SkipSpace(p);
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : Expect
+*   Description: This function consumes a punctuation character and the
+*                white space around it.
+*   Parameters : p - pointer to the text, advanced past what is parsed
+*                c - character expected next
+*   Effects    : None
+*   Returned   : 0 if c was next, otherwise -1
+****************************************************************************/
+static int Expect(const char **p, const char c)
+{
+    SkipSpace(p);
+
+    if (c != **p)
+    {
+        return -1;
+    }
+
+    (*p)++;
+    SkipSpace(p);
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : SkipSpace
+*   Description: This function skips white space.
+*   Parameters : p - pointer to the text, advanced past the white space
+*   Effects    : None
+*   Returned   : None
+****************************************************************************/
+static void SkipSpace(const char **p)
+{
+    while (isspace((unsigned char)**p))
+    {
+        (*p)++;
+    }
+}
+
+/****************************************************************************
+*   Function   : FindResult
+*   Description: This function finds the result for the same corpus and
+*                engine as another.
+*   Parameters : results - results to search
+*                match - result whose corpus and engine are wanted
+*   Effects    : None
+*   Returned   : The matching result or NULL if there isn't one
+****************************************************************************/
+static const result_t *FindResult(const results_t *results,
+    const result_t *match)
+{
+    size_t i;
+
+    for (i = 0; i < results->count; i++)
+    {
+        if ((0 == strcmp(results->results[i].corpus, match->corpus)) &&
+            (0 == strcmp(results->results[i].engine, match->engine)))
+        {
+            return &results->results[i];
+        }
+    }
+
+    return NULL;
+}
+
+/****************************************************************************
+*   Function   : CompareRuns
+*   Description: This function compares the runs of one direction of a
+*                test.  The change is that of the median rate relative to
+*                the reference kernel, and the p-value is a one-sided
+*                Mann-Whitney test of the relative rates being lower than
+*                the baseline's.  Whether that is significant depends on
+*                every other test, so HolmCorrect decides it.
+*   Parameters : base - baseline result
+*                current - current result of the same test
+*                dir - direction to compare
+*                comparison - receives the comparison
+*   Effects    : None
+*   Returned   : None
+****************************************************************************/
+static void CompareRuns(const result_t *base, const result_t *current,
+    const direction_t dir, comparison_t *comparison)
+{
+    double baseRate, currentRate;
+
+    baseRate = Median(base->relative[dir], base->numRuns[dir]);
+    currentRate = Median(current->relative[dir], current->numRuns[dir]);
+
+    comparison->base = base;
+    comparison->current = current;
+    comparison->dir = dir;
+    comparison->change = (0.0 == baseRate) ? 0.0 :
+        (100.0 * ((currentRate / baseRate) - 1.0));
+    comparison->p = SlowerP(base->relative[dir], base->numRuns[dir],
+        current->relative[dir], current->numRuns[dir]);
+    comparison->testable = 0;
+    comparison->significant = 0;
+}
+
+/****************************************************************************
+*   Function   : HolmCorrect
+*   Description: This function decides which comparisons are significant
+*                with Holm's step-down correction, so the chance of any
+*                false regression among all of them stays at alpha.  The
+*                p-values are taken from smallest to largest, and the kth
+*                is significant if it and every smaller one are below
+*                alpha / (count - k).  A comparison is only testable if
+*                both sides have at least minRuns runs and the smallest
+*                p-value those runs can give is below alpha / count;
+*                otherwise not even the largest slowdown could be found.
+*   Parameters : comparisons - every comparison made
+*                count - number of comparisons
+*                alpha - chance of any false regression allowed
+*                minRuns - fewest runs per side to be testable
+*   Effects    : The testable and significant flags are set
+*   Returned   : None
+****************************************************************************/
+static void HolmCorrect(comparison_t *comparisons, const size_t count,
+    const double alpha, const unsigned int minRuns)
+{
+    comparison_t **order;
+    unsigned int numBase, numCurrent;
+    size_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        numBase = comparisons[i].base->numRuns[comparisons[i].dir];
+        numCurrent = comparisons[i].current->numRuns[comparisons[i].dir];
+        comparisons[i].testable = (numBase >= minRuns) &&
+            (numCurrent >= minRuns) &&
+            (SmallestP(numBase, numCurrent) < (alpha / count));
+    }
+
+    order = malloc((count + 1) * sizeof(comparison_t *));
+
+    if (NULL == order)
+    {
+        /* Bonferroni needs no ordering and is never less strict */
+        for (i = 0; i < count; i++)
+        {
+            comparisons[i].significant = comparisons[i].testable &&
+                (comparisons[i].p < (alpha / count));
+        }
+
+        return;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        order[i] = &comparisons[i];
+    }
+
+    qsort(order, count, sizeof(comparison_t *), CompareP);
+
+    for (i = 0; (i < count) && (order[i]->p < (alpha / (count - i))); i++)
+    {
+        order[i]->significant = order[i]->testable;
+    }
+
+    free(order);
+}
+
+/****************************************************************************
+*   Function   : CompareP
+*   Description: This function orders pointers to comparisons by p-value
+*                for qsort.
+*   Parameters : a - pointer to a comparison pointer
+*                b - pointer to a comparison pointer
+*   Effects    : None
+*   Returned   : Negative, zero or positive as a's p-value is less than,
+*                equal to or greater than b's
+****************************************************************************/
+static int CompareP(const void *a, const void *b)
+{
+    return CompareDoubles(&(*(comparison_t *const *)a)->p,
+        &(*(comparison_t *const *)b)->p);
+}
+
+/****************************************************************************
+*   Function   : PrintComparison
+*   Description: This function prints one comparison with the median MB/s
+*                of each side, and judges it.  It has regressed if its
+*                relative rate fell by more than threshold percent and the
+*                drop is significant.
+*   Parameters : comparison - comparison made by CompareRuns and judged
+*                             by HolmCorrect
+*                threshold - percent drop allowed
+*   Effects    : A line is written to stdout
+*   Returned   : Non-zero if the test regressed
+****************************************************************************/
+static int PrintComparison(const comparison_t *comparison,
+    const double threshold)
+{
+    const result_t *base, *current;
+    const char *verdict;
+    direction_t dir;
+    int regressed;
+
+    base = comparison->base;
+    current = comparison->current;
+    dir = comparison->dir;
+    regressed = (comparison->change < -threshold) &&
+        comparison->significant;
+
+    if (!comparison->testable)
+    {
+        verdict = "too few runs to test";
+    }
+    else if (regressed)
+    {
+        verdict = "SLOWER";
+    }
+    else if (comparison->change > threshold)
+    {
+        verdict = "faster";
+    }
+    else
+    {
+        verdict = "ok";
+    }
+
+    printf("%-12.12s %-9.9s %-6s %10.3f %10.3f %+7.1f%% %8.4f  %s\n",
+        current->corpus, current->engine, dirNames[dir],
+        Median(base->runs[dir], base->numRuns[dir]),
+        Median(current->runs[dir], current->numRuns[dir]),
+        comparison->change, comparison->p, verdict);
+    return regressed;
+}
+
+/****************************************************************************
+*   Function   : Median
+*   Description: This function finds the median of a set of values.
+*   Parameters : values - the values
+*                count - number of values (1 to MAX_RUNS)
+*   Effects    : None
+*   Returned   : The median
+****************************************************************************/
+static double Median(const double *values, const unsigned int count)
+{
+    double sorted[MAX_RUNS];
+
+    memcpy(sorted, values, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), CompareDoubles);
+
+    if (0 == (count % 2))
+    {
+        return (sorted[(count / 2) - 1] + sorted[count / 2]) / 2.0;
+    }
+
+    return sorted[count / 2];
+}
+
+/****************************************************************************
+*   Function   : CompareDoubles
+*   Description: This function orders doubles for qsort.
+*   Parameters : a - pointer to a double
+*                b - pointer to a double
+*   Effects    : None
+*   Returned   : Negative, zero or positive as *a is less than, equal to
+*                or greater than *b
+****************************************************************************/
+static int CompareDoubles(const void *a, const void *b)
+{
+    double x, y;
+
+    x = *(const double *)a;
+    y = *(const double *)b;
+    return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+/****************************************************************************
+*   Function   : SlowerP
+*   Description: This function makes a one-sided Mann-Whitney U test of
+*                whether the current rates are lower than the baseline's.
+*                U counts the (baseline, current) pairs where the baseline
+*                run was faster, with ties counting half.  The p-value is
+*                the chance of a U at least that large if both sets of
+*                runs came from the same distribution, found exactly: the
+*                number of orderings of the runs with each U is a
+*                coefficient of the Gaussian binomial coefficient
+*                [n + m choose n], built up as the product over i of
+*                (1 - q^(m + i)) / (1 - q^i).  Ties are rounded in favor of
+*                no regression.
+*   Parameters : base - baseline rates
+*                numBase - number of baseline rates
+*                current - current rates
+*                numCurrent - number of current rates
+*   Effects    : None
+*   Returned   : The p-value, 1.0 if either set is empty or on failure
+****************************************************************************/
+static double SlowerP(const double *base, const unsigned int numBase,
+    const double *current, const unsigned int numCurrent)
+{
+    double *counts, total, tail;
+    unsigned long u2, k, maxU, size, step;
+    unsigned int i, j;
+
+    if ((0 == numBase) || (0 == numCurrent))
+    {
+        return 1.0;
+    }
+
+    /* twice U, so ties are whole numbers */
+    u2 = 0;
+
+    for (i = 0; i < numBase; i++)
+    {
+        for (j = 0; j < numCurrent; j++)
+        {
+            u2 += (base[i] > current[j]) ? 2 : ((base[i] == current[j]) ?
+                1 : 0);
+        }
+    }
+
+    /* the product's partial terms run past the final degree */
+    maxU = (unsigned long)numBase * numCurrent;
+    size = maxU + numBase + numCurrent + 1;
+    counts = calloc(size, sizeof(double));
+
+    if (NULL == counts)
+    {
+        return 1.0;
+    }
+
+    counts[0] = 1.0;
+
+    for (i = 1; i <= numBase; i++)
+    {
+        /* multiply by 1 - q^(numCurrent + i) */
+        step = numCurrent + i;
+
+        for (k = size - 1; k >= step; k--)
+        {
+            counts[k] -= counts[k - step];
+        }
+
+        /* divide by 1 - q^i */
+        for (k = i; k < size; k++)
+        {
+            counts[k] += counts[k - i];
+        }
+    }
+
+    total = 0.0;
+    tail = 0.0;
+
+    for (k = 0; k <= maxU; k++)
+    {
+        total += counts[k];
+
+        if (k >= (u2 / 2))
+        {
+            tail += counts[k];
+        }
+    }
+
+    free(counts);
+    return (total > 0.0) ? (tail / total) : 1.0;
+}
+
+/****************************************************************************
+*   Function   : SmallestP
+*   Description: This function finds the smallest p-value SlowerP can
+*                give for a number of runs, which is when every current
+*                run is slower than every baseline run: one ordering out
+*                of n + m choose n.
+*   Parameters : numBase - number of baseline rates
+*                numCurrent - number of current rates
+*   Effects    : None
+*   Returned   : The smallest possible p-value
+****************************************************************************/
+static double SmallestP(const unsigned int numBase,
+    const unsigned int numCurrent)
+{
+    double orderings;
+    unsigned int i;
+
+    /* n + m choose n, built up one factor at a time */
+    orderings = 1.0;
+
+    for (i = 1; i <= numBase; i++)
+    {
+        orderings = (orderings * (numCurrent + i)) / i;
+    }
+
+    return 1.0 / orderings;
+}
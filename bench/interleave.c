@@ -0,0 +1,380 @@
+/***************************************************************************
+*             Interleaved Encoding Benchmark for LZW Library
+*
+*   File    : interleave.c
+*   Purpose : Measure the single thread throughput of LZWEncodeInterleaved
+*             as the number of buffers encoded in lockstep grows, and
+*             check that its output matches LZWEncodeBuffer.
+*   Author  : The lzw library contributors
+*   Date    : October 17, 2026
+*
+****************************************************************************
+*
+* INTERLEAVE: Benchmark for the Lempel-Ziv-Welch Encoding Library
+* Copyright (C) 2026 by
+* The lzw library contributors
+*
+* This file is part of the lzw library.
+*
+* The lzw library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The lzw library is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "optlist/optlist.h"
+#include "lzw.h"
+#include "benchutil.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define DEFAULT_MB      4           /* size of synthetic input */
+#define DEFAULT_BLOCK   (1UL << 18) /* bytes in each buffer */
+#define REPEATS         3           /* runs per lane count, best is kept */
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+static unsigned char *ReadInput(FILE *fp, size_t *len);
+static double EncodeAll(lzw_encoder_t *encoders[], const unsigned int lanes,
+    const unsigned char *in, const size_t inLen, const size_t blockSize,
+    unsigned char *out, size_t *outLen);
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/****************************************************************************
+*   Function   : main
+*   Description: This is the main function for this program.  It encodes
+*                the input a block at a time with LZWEncodeBuffer, then
+*                with LZWEncodeInterleaved using 1, 2, 4, ... lanes, and
+*                reports the throughput and speedup of each.
+*   Parameters : argc - number of parameters
+*                argv - parameter list
+*   Effects    : Writes a table of results to stdout
+*   Returned   : EXIT_SUCCESS or EXIT_FAILURE
+****************************************************************************/
+int main(int argc, char *argv[])
+{
+    option_t *optList, *thisOpt;
+    FILE *fpIn;
+    lzw_encoder_t *encoders[LZW_MAX_INTERLEAVE];
+    unsigned char *in, *expected, *out;
+    size_t inLen, outSize, expectedLen, outLen, blockSize;
+    unsigned long size;
+    unsigned int lanes, maxLanes, i;
+    double best, elapsed, single;
+    int status, r;
+
+    fpIn = NULL;
+    size = DEFAULT_MB;
+    blockSize = DEFAULT_BLOCK;
+    maxLanes = LZW_MAX_INTERLEAVE;
+
+    optList = GetOptList(argc, argv, "i:m:s:n:h?");
+    thisOpt = optList;
+
+    while (thisOpt != NULL)
+    {
+        switch(thisOpt->option)
+        {
+            case 'i':       /* input file name */
+                fpIn = fopen(thisOpt->argument, "rb");
+
+                if (NULL == fpIn)
+                {
+                    perror("Opening input file");
+                    FreeOptList(optList);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'm':       /* size of synthetic input */
+                size = strtoul(thisOpt->argument, NULL, 10);
+                break;
+
+            case 's':       /* block size */
+                blockSize = strtoul(thisOpt->argument, NULL, 10);
+                break;
+
+            case 'n':       /* largest number of lanes */
+                maxLanes = (unsigned int)atoi(thisOpt->argument);
+                break;
+
+            case 'h':
+            case '?':
+                printf("Usage: %s <options>\n\n", FindFileName(argv[0]));
+                printf("options:\n");
+                printf("  -i <filename> : Input file (default synthetic).\n");
+                printf("  -m <MB> : Size of synthetic input.\n");
+                printf("  -s <bytes> : Block size.\n");
+                printf("  -n <lanes> : Largest number of lanes to try ");
+                printf("(max %d).\n", LZW_MAX_INTERLEAVE);
+                printf("  -h | ?  : Print out command line options.\n\n");
+                FreeOptList(optList);
+                return EXIT_SUCCESS;
+        }
+
+        optList = thisOpt->next;
+        free(thisOpt);
+        thisOpt = optList;
+    }
+
+    if ((0 == maxLanes) || (maxLanes > LZW_MAX_INTERLEAVE) ||
+        (0 == blockSize))
+    {
+        fprintf(stderr, "Invalid lane count or block size.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (NULL == fpIn)
+    {
+        fpIn = MakeSyntheticInput(size << 20);
+
+        if (NULL == fpIn)
+        {
+            perror("Making synthetic input");
+            return EXIT_FAILURE;
+        }
+    }
+
+    in = ReadInput(fpIn, &inLen);
+    fclose(fpIn);
+
+    if ((NULL == in) || (0 == inLen))
+    {
+        fprintf(stderr, "Input is empty or couldn't be read.\n");
+        free(in);
+        return EXIT_FAILURE;
+    }
+
+    /* room for every block's bound */
+    outSize = ((inLen / blockSize) + 1) * LZWEncodeBound(blockSize);
+    expected = malloc(outSize);
+    out = malloc(outSize);
+    status = EXIT_SUCCESS;
+
+    for (i = 0; i < maxLanes; i++)
+    {
+        encoders[i] = LZWMakeEncoder();
+
+        if (NULL == encoders[i])
+        {
+            status = EXIT_FAILURE;
+        }
+    }
+
+    if ((NULL == expected) || (NULL == out) || (EXIT_SUCCESS != status))
+    {
+        perror("Allocating buffers");
+        maxLanes = (EXIT_SUCCESS != status) ? i : maxLanes;
+        status = EXIT_FAILURE;
+    }
+
+    if (EXIT_SUCCESS == status)
+    {
+        printf("block size %lu, input %lu bytes\n",
+            (unsigned long)blockSize, (unsigned long)inLen);
+        printf("%8s %10s %10s %8s\n", "lanes", "seconds", "MB/s",
+            "speedup");
+
+        /* lanes == 0 is one buffer at a time with LZWEncodeBuffer */
+        single = 0.0;
+        expectedLen = 0;
+        lanes = 0;
+
+        while (lanes <= maxLanes)
+        {
+            best = 0.0;
+
+            for (r = 0; r < REPEATS; r++)
+            {
+                elapsed = EncodeAll(encoders, lanes, in, inLen, blockSize,
+                    (0 == lanes) ? expected : out,
+                    (0 == lanes) ? &expectedLen : &outLen);
+
+                if (elapsed < 0.0)
+                {
+                    perror("Encoding");
+                    status = EXIT_FAILURE;
+                    break;
+                }
+
+                if ((0 == r) || (elapsed < best))
+                {
+                    best = elapsed;
+                }
+            }
+
+            if (EXIT_SUCCESS != status)
+            {
+                break;
+            }
+
+            if ((0 != lanes) && ((outLen != expectedLen) ||
+                (0 != memcmp(out, expected, outLen))))
+            {
+                fprintf(stderr, "%u lanes: output differs from "
+                    "LZWEncodeBuffer\n", lanes);
+                status = EXIT_FAILURE;
+                break;
+            }
+
+            if (0 == lanes)
+            {
+                single = best;
+                printf("%8s", "buffer");
+            }
+            else
+            {
+                printf("%8u", lanes);
+            }
+
+            printf(" %10.3f %10.1f %8.2f\n", best,
+                (inLen / 1048576.0) / best, single / best);
+
+            if (lanes == maxLanes)
+            {
+                break;
+            }
+
+            /* double the lanes, but always finish with the largest count */
+            lanes = (0 == lanes) ? 1 : (lanes * 2);
+
+            if (lanes > maxLanes)
+            {
+                lanes = maxLanes;
+            }
+        }
+    }
+
+    for (i = 0; i < maxLanes; i++)
+    {
+        LZWFreeEncoder(encoders[i]);
+    }
+
+    free(in);
+    free(expected);
+    free(out);
+    return status;
+}
+
+/****************************************************************************
+*   Function   : ReadInput
+*   Description: This function reads an entire file into memory.
+*   Parameters : fp - file to read
+*                len - receives the number of bytes read
+*   Effects    : Memory is allocated for the file's contents
+*   Returned   : Pointer to the contents or NULL on error
+****************************************************************************/
+static unsigned char *ReadInput(FILE *fp, size_t *len)
+{
+    unsigned char *buf;
+    long size;
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    rewind(fp);
+
+    if (size < 0)
+    {
+        return NULL;
+    }
+
+    buf = malloc((size_t)size + 1);
+
+    if (NULL != buf)
+    {
+        *len = fread(buf, 1, (size_t)size, fp);
+    }
+
+    return buf;
+}
+
+/****************************************************************************
+*   Function   : EncodeAll
+*   Description: This function encodes the input one block at a time, or
+*                lanes blocks at a time with LZWEncodeInterleaved, and
+*                concatenates the encoded blocks.
+*   Parameters : encoders - at least lanes encoders (1 when lanes is 0)
+*                lanes - blocks encoded together, 0 for LZWEncodeBuffer
+*                in - data to encode
+*                inLen - number of bytes in in
+*                blockSize - bytes in each block
+*                out - receives the encoded blocks
+*                outLen - receives the total encoded length
+*   Effects    : out is filled
+*   Returned   : Elapsed seconds, or -1.0 on error
+****************************************************************************/
+static double EncodeAll(lzw_encoder_t *encoders[], const unsigned int lanes,
+    const unsigned char *in, const size_t inLen, const size_t blockSize,
+    unsigned char *out, size_t *outLen)
+{
+    lzw_buffer_t buffers[LZW_MAX_INTERLEAVE];
+    size_t pos, len;
+    unsigned int n;
+    double start;
+
+    start = Now();
+    pos = 0;
+    *outLen = 0;
+
+    while (pos < inLen)
+    {
+        /* gather the next group of blocks */
+        for (n = 0; (n < ((0 == lanes) ? 1 : lanes)) && (pos < inLen); n++)
+        {
+            len = ((inLen - pos) < blockSize) ? (inLen - pos) : blockSize;
+            buffers[n].in = in + pos;
+            buffers[n].inLen = len;
+            buffers[n].out = out + *outLen;
+            buffers[n].outSize = LZWEncodeBound(len);
+            pos += len;
+
+            /* the encoded size isn't known yet, keep each block's bound */
+            *outLen += buffers[n].outSize;
+        }
+
+        if (0 == lanes)
+        {
+            if (0 != LZWEncodeBuffer(encoders[0], buffers[0].in,
+                buffers[0].inLen, buffers[0].out, buffers[0].outSize,
+                &buffers[0].outLen))
+            {
+                return -1.0;
+            }
+        }
+        else if (0 != LZWEncodeInterleaved(encoders, buffers, n))
+        {
+            return -1.0;
+        }
+
+        /* pack the encoded blocks together */
+        *outLen = buffers[0].out - out;
+
+        for (len = 0; len < n; len++)
+        {
+            memmove(out + *outLen, buffers[len].out, buffers[len].outLen);
+            *outLen += buffers[len].outLen;
+        }
+    }
+
+    return Now() - start;
+}
@@ -0,0 +1,221 @@
+/***************************************************************************
+*              Thread Count Scaling Benchmark for LZW Library
+*
+*   File    : scaling.c
+*   Purpose : Measure how the throughput of LZWEncodeFileParallel scales
+*             with the number of worker threads.
+*   Author  : The lzw library contributors
+*   Date    : October 17, 2026
+*
+****************************************************************************
+*
+* SCALING: Benchmark for the Lempel-Ziv-Welch Encoding Library
+* Copyright (C) 2026 by
+* The lzw library contributors
+*
+* This file is part of the lzw library.
+*
+* The lzw library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The lzw library is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "optlist/optlist.h"
+#include "lzw.h"
+#include "benchutil.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define DEFAULT_MB      16      /* size of synthetic input */
+#define REPEATS         3       /* runs per thread count, best is kept */
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/****************************************************************************
+*   Function   : main
+*   Description: This is the main function for this program.  It encodes
+*                the same input with 1, 2, 4, ... threads and reports the
+*                throughput and speedup over a single thread for each.
+*   Parameters : argc - number of parameters
+*                argv - parameter list
+*   Effects    : Writes a table of results to stdout
+*   Returned   : EXIT_SUCCESS or EXIT_FAILURE
+****************************************************************************/
+int main(int argc, char *argv[])
+{
+    option_t *optList, *thisOpt;
+    FILE *fpIn, *fpOut;
+    lzw_params_t params;
+    unsigned int threads, maxThreads;
+    unsigned long size;
+    double start, best, elapsed, single;
+    long inLen, outLen;
+    int i;
+
+    fpIn = NULL;
+    maxThreads = (unsigned int)sysconf(_SC_NPROCESSORS_ONLN);
+    size = DEFAULT_MB;
+    LZWDefaultParams(&params);
+
+    optList = GetOptList(argc, argv, "i:t:m:s:h?");
+    thisOpt = optList;
+
+    while (thisOpt != NULL)
+    {
+        switch(thisOpt->option)
+        {
+            case 'i':       /* input file name */
+                fpIn = fopen(thisOpt->argument, "rb");
+
+                if (NULL == fpIn)
+                {
+                    perror("Opening input file");
+                    FreeOptList(optList);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 't':       /* largest thread count */
+                maxThreads = (unsigned int)atoi(thisOpt->argument);
+                break;
+
+            case 'm':       /* size of synthetic input */
+                size = strtoul(thisOpt->argument, NULL, 10);
+                break;
+
+            case 's':       /* block size */
+                params.blockSize = strtoul(thisOpt->argument, NULL, 10);
+                break;
+
+            case 'h':
+            case '?':
+                printf("Usage: %s <options>\n\n", FindFileName(argv[0]));
+                printf("options:\n");
+                printf("  -i <filename> : Input file (default synthetic).\n");
+                printf("  -m <MB> : Size of synthetic input.\n");
+                printf("  -t <n> : Largest number of threads to try.\n");
+                printf("  -s <bytes> : Block size (default automatic).\n");
+                printf("  -h | ?  : Print out command line options.\n\n");
+                FreeOptList(optList);
+                return EXIT_SUCCESS;
+        }
+
+        optList = thisOpt->next;
+        free(thisOpt);
+        thisOpt = optList;
+    }
+
+    if (NULL == fpIn)
+    {
+        fpIn = MakeSyntheticInput(size << 20);
+
+        if (NULL == fpIn)
+        {
+            perror("Making synthetic input");
+            return EXIT_FAILURE;
+        }
+    }
+
+    fpOut = tmpfile();
+
+    if (NULL == fpOut)
+    {
+        perror("Opening output file");
+        fclose(fpIn);
+        return EXIT_FAILURE;
+    }
+
+    fseek(fpIn, 0, SEEK_END);
+    inLen = ftell(fpIn);
+    single = 0.0;
+
+    /* every row codes the same blocks, so only the threads change */
+    if (0 == params.blockSize)
+    {
+        params.blockSize = LZWAutoBlockSize(maxThreads, (size_t)inLen);
+    }
+
+    printf("input %ld bytes, block %lu bytes\n", inLen,
+        (unsigned long)params.blockSize);
+    printf("%8s %10s %10s %8s %8s\n",
+        "threads", "seconds", "MB/s", "speedup", "ratio");
+
+    threads = 1;
+
+    while (threads <= maxThreads)
+    {
+        params.threads = threads;
+        best = 0.0;
+        outLen = 0;
+
+        for (i = 0; i < REPEATS; i++)
+        {
+            rewind(fpIn);
+            rewind(fpOut);
+            start = Now();
+
+            if (0 != LZWEncodeFileParallel(fpIn, fpOut, &params))
+            {
+                perror("Encoding");
+                fclose(fpIn);
+                fclose(fpOut);
+                return EXIT_FAILURE;
+            }
+
+            fflush(fpOut);
+            elapsed = Now() - start;
+            outLen = ftell(fpOut);
+
+            if ((0 == i) || (elapsed < best))
+            {
+                best = elapsed;
+            }
+        }
+
+        if (1 == threads)
+        {
+            single = best;
+        }
+
+        printf("%8u %10.3f %10.1f %8.2f %8.3f\n", threads, best,
+            (inLen / 1048576.0) / best, single / best,
+            (double)outLen / inLen);
+
+        if (threads == maxThreads)
+        {
+            break;
+        }
+
+        /* double the threads, but always finish with the largest count */
+        threads *= 2;
+
+        if (threads > maxThreads)
+        {
+            threads = maxThreads;
+        }
+    }
+
+    fclose(fpIn);
+    fclose(fpOut);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,963 @@
+/***************************************************************************
+*                   Benchmark Suite for LZW Library
+*
+*   File    : suite.c
+*   Purpose : Measure the encoding and decoding throughput, cycles per
+*             byte and compression ratio of each of the library's coding
+*             engines on a deterministic corpus of several kinds of data,
+*             and on any real files given, and report the results as JSON
+*             so runs can be compared by machine.
+*   Author  : The lzw library contributors
+*   Date    : October 17, 2026
+*
+****************************************************************************
+*
+* SUITE: Benchmark for the Lempel-Ziv-Welch Encoding Library
+* Copyright (C) 2026 by
+* The lzw library contributors
+*
+* This file is part of the lzw library.
+*
+* The lzw library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The lzw library is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#define _POSIX_C_SOURCE 200809L     /* fmemopen */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "optlist/optlist.h"
+#include "lzw.h"
+#include "benchutil.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define DEFAULT_MB      1           /* bytes of each synthetic corpus */
+#define DEFAULT_REPEATS 3           /* runs of each test, best is kept */
+#define MESSAGE_SIZE    256         /* bytes coded at a time by messages */
+#define RESULTS_VERSION 2           /* layout of the JSON results */
+#define REFERENCE_BYTES (1UL << 22) /* bytes run through the reference */
+#define REFERENCE_TABLE (1UL << 16) /* entries in its lookup table */
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* codes in into out, setting outLen.  returns 0 for success. */
+typedef int (*code_t)(const unsigned char *in, const size_t inLen,
+    unsigned char *out, const size_t outSize, size_t *outLen);
+
+/* a way of encoding and decoding data.  add new engines to engines[]. */
+typedef struct
+{
+    const char *name;
+    code_t encode;
+    code_t decode;
+} engine_t;
+
+/* best run of one direction of one test */
+typedef struct
+{
+    double seconds;
+    double cycles;              /* negative without a cycle counter */
+    size_t outLen;
+} timing_t;
+
+/* a corpus to code */
+typedef struct
+{
+    const char *name;
+    unsigned char *data;
+    size_t len;
+} input_t;
+
+/* one corpus coded by one engine, and its runs so far */
+typedef struct
+{
+    const input_t *input;
+    const engine_t *engine;
+    timing_t encoding;          /* fastest encode */
+    timing_t decoding;          /* fastest decode */
+    double *runs;               /* seconds of each encode, then decode */
+    double *refs;               /* seconds of the reference before each */
+    size_t peakBytes;           /* most bytes the library held in a run */
+    long peakRss;               /* most KB resident in a run, -1 unknown */
+} test_t;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+static int RunRound(test_t *test, const unsigned int round,
+    const unsigned int repeats);
+static int TimeCoding(code_t code, const unsigned char *in,
+    const size_t inLen, unsigned char *out, const size_t outSize,
+    const unsigned int round, timing_t *best, double *seconds,
+    double *ref);
+static void PutResult(FILE *fpJson, const test_t *test,
+    const unsigned int repeats, const int first);
+static double TimeReference(const unsigned char *in, const size_t inLen);
+static void PutJsonString(FILE *fp, const char *str);
+static void PutRuns(FILE *fp, const char *name, const double *runs,
+    const unsigned int repeats, const double mb);
+static void PutPerByte(FILE *fp, const char *name, const double cycles,
+    const size_t len);
+static unsigned char *ReadFile(const char *name, size_t *len);
+
+/* engines */
+static int CodeStreams(int (*code)(FILE *fpIn, FILE *fpOut),
+    const unsigned char *in, const size_t inLen, unsigned char *out,
+    const size_t outSize, size_t *outLen);
+static int EncodeFile(const unsigned char *in, const size_t inLen,
+    unsigned char *out, const size_t outSize, size_t *outLen);
+static int DecodeFile(const unsigned char *in, const size_t inLen,
+    unsigned char *out, const size_t outSize, size_t *outLen);
+static int EncodeBuffer(const unsigned char *in, const size_t inLen,
+    unsigned char *out, const size_t outSize, size_t *outLen);
+static int DecodeBuffer(const unsigned char *in, const size_t inLen,
+    unsigned char *out, const size_t outSize, size_t *outLen);
+static int EncodeParallel(FILE *fpIn, FILE *fpOut);
+static int DecodeParallel(FILE *fpIn, FILE *fpOut);
+static int EncodeBlocks(const unsigned char *in, const size_t inLen,
+    unsigned char *out, const size_t outSize, size_t *outLen);
+static int DecodeBlocks(const unsigned char *in, const size_t inLen,
+    unsigned char *out, const size_t outSize, size_t *outLen);
+static int EncodeMessages(const unsigned char *in, const size_t inLen,
+    unsigned char *out, const size_t outSize, size_t *outLen);
+static int DecodeMessages(const unsigned char *in, const size_t inLen,
+    unsigned char *out, const size_t outSize, size_t *outLen);
+
+/***************************************************************************
+*                            GLOBAL VARIABLES
+***************************************************************************/
+static const engine_t engines[] =
+{
+    {"file", EncodeFile, DecodeFile},           /* LZWEncodeFile */
+    {"buffer", EncodeBuffer, DecodeBuffer},     /* LZWEncodeBuffer */
+    {"blocks", EncodeBlocks, DecodeBlocks},     /* LZWEncodeFileParallel */
+    {"messages", EncodeMessages, DecodeMessages}    /* small buffers */
+};
+
+#define NUM_ENGINES     (sizeof(engines) / sizeof(engines[0]))
+
+/* contexts reused by every run, as a long running program would */
+static lzw_encoder_t *encoder = NULL;
+static lzw_decoder_t *decoder = NULL;
+
+/* lookups of the reference kernel, and where its result goes so it can't
+ * be optimized away */
+static unsigned int referenceTable[REFERENCE_TABLE];
+static volatile unsigned int referenceSink;
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/****************************************************************************
+*   Function   : main
+*   Description: This is the main function for this program.  It makes
+*                each kind of synthetic corpus and reads any real files,
+*                then encodes and decodes each of them with each engine,
+*                checking that the data survives, and writes the results.
+*   Parameters : argc - number of parameters
+*                argv - parameter list
+*   Effects    : Writes JSON results to stdout or the -o file, and a
+*                readable summary to stderr
+*   Returned   : EXIT_SUCCESS or EXIT_FAILURE
+****************************************************************************/
+int main(int argc, char *argv[])
+{
+    option_t *optList, *thisOpt;
+    FILE *fpJson;
+    const char **files;         /* real files added to the corpus */
+    const char *only;           /* the one engine to run, or NULL */
+    input_t *inputs;            /* the synthetic corpora, then real files */
+    test_t *tests;
+    size_t numFiles, numInputs, numTests, i, e;
+    unsigned long size;
+    unsigned int repeats, round;
+    int status;
+
+    fpJson = stdout;
+    only = NULL;
+    size = DEFAULT_MB;
+    repeats = DEFAULT_REPEATS;
+    numFiles = 0;
+    files = malloc(argc * sizeof(char *));
+
+    if (NULL == files)
+    {
+        perror("Allocating file list");
+        return EXIT_FAILURE;
+    }
+
+    optList = GetOptList(argc, argv, "e:i:m:o:r:h?");
+    thisOpt = optList;
+
+    while (thisOpt != NULL)
+    {
+        switch(thisOpt->option)
+        {
+            case 'e':       /* engine to run */
+                only = thisOpt->argument;
+                break;
+
+            case 'i':       /* real file */
+                files[numFiles] = thisOpt->argument;
+                numFiles++;
+                break;
+
+            case 'm':       /* size of each synthetic corpus */
+                size = strtoul(thisOpt->argument, NULL, 10);
+                break;
+
+            case 'o':       /* JSON results file */
+                if (fpJson != stdout)
+                {
+                    fclose(fpJson);
+                }
+
+                fpJson = fopen(thisOpt->argument, "w");
+
+                if (NULL == fpJson)
+                {
+                    perror("Opening results file");
+                    FreeOptList(optList);
+                    free(files);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 'r':       /* runs of each test */
+                repeats = (unsigned int)atoi(thisOpt->argument);
+                break;
+
+            case 'h':
+            case '?':
+                printf("Usage: %s <options>\n\n", FindFileName(argv[0]));
+                printf("options:\n");
+                printf("  -e <engine> : Only run one engine (");
+
+                for (e = 0; e < NUM_ENGINES; e++)
+                {
+                    printf("%s%s", engines[e].name,
+                        (e + 1 < NUM_ENGINES) ? ", " : ").\n");
+                }
+
+                printf("  -i <filename> : Add a real file to the corpus ");
+                printf("(may be repeated).\n");
+                printf("  -m <MB> : Size of each synthetic corpus ");
+                printf("(default %d).\n", DEFAULT_MB);
+                printf("  -o <filename> : Write JSON results to a file ");
+                printf("(default stdout).\n");
+                printf("  -r <runs> : Runs of each test, best is kept ");
+                printf("(default %d).\n", DEFAULT_REPEATS);
+                printf("  -h | ?  : Print out command line options.\n\n");
+                FreeOptList(optList);
+                free(files);
+                return EXIT_SUCCESS;
+        }
+
+        optList = thisOpt->next;
+        free(thisOpt);
+        thisOpt = optList;
+    }
+
+    if ((0 == size) || (0 == repeats))
+    {
+        fprintf(stderr, "Invalid corpus size or number of runs.\n");
+        free(files);
+        return EXIT_FAILURE;
+    }
+
+    encoder = LZWMakeEncoder();
+    decoder = LZWMakeDecoder();
+    numInputs = NUM_CORPORA + numFiles;
+    inputs = calloc(numInputs, sizeof(input_t));
+    tests = calloc(numInputs * NUM_ENGINES, sizeof(test_t));
+
+    if ((NULL == encoder) || (NULL == decoder) || (NULL == inputs) ||
+        (NULL == tests))
+    {
+        perror("Making coding contexts");
+        free(files);
+        return EXIT_FAILURE;
+    }
+
+    status = EXIT_SUCCESS;
+    numTests = 0;
+
+    for (i = 0; (i < numInputs) && (EXIT_SUCCESS == status); i++)
+    {
+        if (i < NUM_CORPORA)
+        {
+            inputs[i].name = CorpusName((corpus_t)i);
+            inputs[i].len = size << 20;
+            inputs[i].data = malloc(inputs[i].len);
+
+            if (NULL != inputs[i].data)
+            {
+                MakeCorpus((corpus_t)i, inputs[i].data, inputs[i].len);
+            }
+        }
+        else
+        {
+            inputs[i].name = FindFileName(files[i - NUM_CORPORA]);
+            inputs[i].data = ReadFile(files[i - NUM_CORPORA],
+                &inputs[i].len);
+        }
+
+        if ((NULL == inputs[i].data) || (0 == inputs[i].len))
+        {
+            fprintf(stderr, "%s: can't be read or is empty\n",
+                (i < NUM_CORPORA) ? inputs[i].name :
+                files[i - NUM_CORPORA]);
+            status = EXIT_FAILURE;
+        }
+
+        for (e = 0; (e < NUM_ENGINES) && (EXIT_SUCCESS == status); e++)
+        {
+            if ((NULL != only) && (0 != strcmp(only, engines[e].name)))
+            {
+                continue;
+            }
+
+            tests[numTests].input = &inputs[i];
+            tests[numTests].engine = &engines[e];
+            tests[numTests].peakRss = -1;
+            tests[numTests].runs = malloc(2 * repeats * sizeof(double));
+            tests[numTests].refs = malloc(2 * repeats * sizeof(double));
+            numTests++;
+
+            if ((NULL == tests[numTests - 1].runs) ||
+                (NULL == tests[numTests - 1].refs))
+            {
+                perror("Allocating runs");
+                status = EXIT_FAILURE;
+            }
+        }
+    }
+
+    /* each round runs every test once, so a machine that speeds up or
+     * slows down during the suite affects every test's runs alike */
+    for (round = 0; (round < repeats) && (EXIT_SUCCESS == status); round++)
+    {
+        fprintf(stderr, "round %u of %u\n", round + 1, repeats);
+
+        for (i = 0; (i < numTests) && (EXIT_SUCCESS == status); i++)
+        {
+            if (0 != RunRound(&tests[i], round, repeats))
+            {
+                status = EXIT_FAILURE;
+            }
+        }
+    }
+
+    if (EXIT_SUCCESS == status)
+    {
+        fprintf(fpJson, "{\n  \"version\": %d,\n  \"repeats\": %u,\n",
+            RESULTS_VERSION, repeats);
+        fprintf(fpJson, "  \"cycles\": %s,\n  \"results\": [",
+            (Cycles() < 0.0) ? "null" : "\"tsc\"");
+        fprintf(stderr, "%-12s %-9s %10s %7s %9s %9s %8s %8s %8s %8s\n",
+            "corpus", "engine", "bytes", "ratio", "enc MB/s", "dec MB/s",
+            "enc c/B", "dec c/B", "lib KB", "RSS KB");
+
+        for (i = 0; i < numTests; i++)
+        {
+            PutResult(fpJson, &tests[i], repeats, (0 == i));
+        }
+
+        fprintf(fpJson, "\n  ]\n}\n");
+    }
+
+    if (ferror(fpJson) ||
+        ((fpJson == stdout) ? fflush(fpJson) : fclose(fpJson)))
+    {
+        perror("Writing results");
+        status = EXIT_FAILURE;
+    }
+
+    for (i = 0; i < numTests; i++)
+    {
+        free(tests[i].runs);
+        free(tests[i].refs);
+    }
+
+    for (i = 0; i < numInputs; i++)
+    {
+        free(inputs[i].data);
+    }
+
+    free(tests);
+    free(inputs);
+    LZWFreeEncoder(encoder);
+    LZWFreeDecoder(decoder);
+    free(files);
+    return status;
+}
+
+/****************************************************************************
+*   Function   : RunRound
+*   Description: This function encodes and decodes a test's corpus once,
+*                checks that the decoded data matches, and records the
+*                rates, keeping the fastest run of each direction.  The
+*                reference kernel is timed just before each run, so that
+*                bench/compare can judge the runs relative to how fast the
+*                machine was at the time.  The most bytes the library held
+*                and the process' peak resident memory are kept too.
+*   Parameters : test - test to run
+*                round - index of this run
+*                repeats - number of runs of each test
+*   Effects    : test's results are updated and errors reported on stderr
+*   Returned   : 0 for success, -1 for failure
+****************************************************************************/
+static int RunRound(test_t *test, const unsigned int round,
+    const unsigned int repeats)
+{
+    const unsigned char *in;
+    unsigned char *coded, *decoded;
+    size_t inLen, codedSize;
+    lzw_memory_t memory;        /* library memory held during the run */
+    long rss;                   /* peak resident KB during the run */
+    int result;
+
+    in = test->input->data;
+    inLen = test->input->len;
+
+    /* the contexts reused by every test stay counted in both peaks */
+    LZWResetMemoryPeaks();
+    (void)ResetPeakRss();
+
+    /* block prefixes and message lengths make room for a little more */
+    codedSize = (2 * LZWEncodeBound(inLen)) + (1UL << 16);
+    coded = malloc(codedSize);
+
+    /* fmemopen keeps the last byte of its buffer for a NUL */
+    decoded = malloc(inLen + 1);
+    result = -1;
+
+    if ((NULL == coded) || (NULL == decoded))
+    {
+        perror("Allocating buffers");
+    }
+    else if (0 != TimeCoding(test->engine->encode, in, inLen, coded,
+        codedSize, round, &test->encoding, &test->runs[round],
+        &test->refs[round]))
+    {
+        perror("Encoding");
+    }
+    else if ((0 != TimeCoding(test->engine->decode, coded,
+        test->encoding.outLen, decoded, inLen + 1, round, &test->decoding,
+        &test->runs[repeats + round], &test->refs[repeats + round])) ||
+        (test->decoding.outLen != inLen) ||
+        (0 != memcmp(in, decoded, inLen)))
+    {
+        fprintf(stderr, "%s %s: decoded data doesn't match\n",
+            test->input->name, test->engine->name);
+    }
+    else
+    {
+        result = 0;
+    }
+
+    LZWMemoryUsage(&memory);
+    rss = PeakRss();
+    free(coded);
+    free(decoded);
+
+    if (memory.total.peak > test->peakBytes)
+    {
+        test->peakBytes = memory.total.peak;
+    }
+
+    if (rss > test->peakRss)
+    {
+        test->peakRss = rss;
+    }
+
+    return result;
+}
+
+/****************************************************************************
+*   Function   : PutResult
+*   Description: This function writes a test's results as one line of the
+*                JSON results array, with the rate of every run and of the
+*                reference before it, for bench/compare's tests, and a
+*                summary line to stderr.
+*   Parameters : fpJson - file receiving the JSON results
+*                test - test whose runs are done
+*                repeats - number of runs of each direction
+*                first - non-zero for the first result written
+*   Effects    : A result is written to fpJson and a summary to stderr
+*   Returned   : None
+****************************************************************************/
+static void PutResult(FILE *fpJson, const test_t *test,
+    const unsigned int repeats, const int first)
+{
+    const timing_t *encoding, *decoding;
+    size_t inLen;
+    double mb;
+
+    encoding = &test->encoding;
+    decoding = &test->decoding;
+    inLen = test->input->len;
+    mb = inLen / 1048576.0;
+
+    fprintf(fpJson, "%s\n    {\"corpus\": ", first ? "" : ",");
+    PutJsonString(fpJson, test->input->name);
+    fprintf(fpJson, ", \"engine\": ");
+    PutJsonString(fpJson, test->engine->name);
+    fprintf(fpJson, ", \"bytes\": %lu, \"encoded\": %lu, \"ratio\": %.4f, "
+        "\"encode_mbps\": %.2f, \"decode_mbps\": %.2f",
+        (unsigned long)inLen, (unsigned long)encoding->outLen,
+        (double)encoding->outLen / inLen, mb / encoding->seconds,
+        mb / decoding->seconds);
+    PutPerByte(fpJson, "encode_cpb", encoding->cycles, inLen);
+    PutPerByte(fpJson, "decode_cpb", decoding->cycles, inLen);
+    PutRuns(fpJson, "encode_runs", test->runs, repeats, mb);
+    PutRuns(fpJson, "decode_runs", test->runs + repeats, repeats, mb);
+    PutRuns(fpJson, "encode_ref_runs", test->refs, repeats,
+        REFERENCE_BYTES / 1048576.0);
+    PutRuns(fpJson, "decode_ref_runs", test->refs + repeats, repeats,
+        REFERENCE_BYTES / 1048576.0);
+    fprintf(fpJson, ", \"peak_kb\": %lu, \"peak_rss_kb\": ",
+        (unsigned long)((test->peakBytes + 1023) >> 10));
+
+    if (test->peakRss < 0)
+    {
+        fprintf(fpJson, "null");
+    }
+    else
+    {
+        fprintf(fpJson, "%ld", test->peakRss);
+    }
+
+    fprintf(fpJson, "}");
+
+    fprintf(stderr, "%-12.12s %-9s %10lu %6.1f%% %9.2f %9.2f %8.1f %8.1f "
+        "%8lu %8ld\n",
+        test->input->name, test->engine->name, (unsigned long)inLen,
+        100.0 * encoding->outLen / inLen, mb / encoding->seconds,
+        mb / decoding->seconds,
+        (encoding->cycles < 0.0) ? 0.0 : (encoding->cycles / inLen),
+        (decoding->cycles < 0.0) ? 0.0 : (decoding->cycles / inLen),
+        (unsigned long)((test->peakBytes + 1023) >> 10), test->peakRss);
+}
+
+/****************************************************************************
+*   Function   : TimeCoding
+*   Description: This function runs a coding function once and keeps the
+*                run if it's the fastest so far, which is the least
+*                disturbed by the rest of the system.  The reference
+*                kernel is timed just before the run.
+*   Parameters : code - encoding or decoding function
+*                in - data to code
+*                inLen - number of bytes in in
+*                out - buffer receiving the coded data
+*                outSize - size of out
+*                round - index of this run, 0 for the first
+*                best - the fastest run, replaced if this one is faster
+*                seconds - receives the seconds taken by this run
+*                ref - receives the seconds the reference kernel took
+*   Effects    : out holds the coded data
+*   Returned   : 0 for success, -1 for failure
+****************************************************************************/
+static int TimeCoding(code_t code, const unsigned char *in,
+    const size_t inLen, unsigned char *out, const size_t outSize,
+    const unsigned int round, timing_t *best, double *seconds,
+    double *ref)
+{
+    double start, cycles;
+    size_t outLen;
+
+    *ref = TimeReference(in, inLen);
+    cycles = Cycles();
+    start = Now();
+
+    if (0 != code(in, inLen, out, outSize, &outLen))
+    {
+        return -1;
+    }
+
+    *seconds = Now() - start;
+    cycles = (cycles < 0.0) ? cycles : (Cycles() - cycles);
+
+    if ((0 == round) || (*seconds < best->seconds))
+    {
+        best->seconds = *seconds;
+        best->cycles = cycles;
+    }
+
+    /* a later run's output is checked by its caller, so keep its length */
+    best->outLen = outLen;
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : TimeReference
+*   Description: This function times a reference kernel that does work
+*                like the codecs': a chain of dependent lookups in a
+*                table bigger than the L1 cache, driven by the bytes being
+*                coded.  Rates relative to it change much less from one
+*                machine, or one moment, to the next than MB/s do.
+*   Parameters : in - data driving the lookups
+*                inLen - number of bytes in in (not 0)
+*   Effects    : referenceTable is filled the first time
+*   Returned   : Seconds taken to run REFERENCE_BYTES through the kernel
+****************************************************************************/
+static double TimeReference(const unsigned char *in, const size_t inLen)
+{
+    static unsigned long seed = 0;
+    unsigned int h;
+    size_t i, len, done;
+    double start;
+
+    if (0 == seed)
+    {
+        for (i = 0; i < REFERENCE_TABLE; i++)
+        {
+            seed = (seed * 1103515245UL) + 12345UL;
+            referenceTable[i] = (unsigned int)(seed >> 8);
+        }
+    }
+
+    h = 0;
+    start = Now();
+
+    for (done = 0; done < REFERENCE_BYTES; done += len)
+    {
+        len = (inLen < REFERENCE_BYTES - done) ? inLen :
+            (REFERENCE_BYTES - done);
+
+        for (i = 0; i < len; i++)
+        {
+            h = referenceTable[(h ^ in[i]) & (REFERENCE_TABLE - 1)];
+        }
+    }
+
+    referenceSink = h;
+    return Now() - start;
+}
+
+/****************************************************************************
+*   Function   : PutJsonString
+*   Description: This function writes a string as a quoted JSON string.
+*   Parameters : fp - file to write to
+*                str - NUL terminated string
+*   Effects    : The string is written to fp
+*   Returned   : None
+****************************************************************************/
+static void PutJsonString(FILE *fp, const char *str)
+{
+    fputc('"', fp);
+
+    for (; '\0' != *str; str++)
+    {
+        if (('"' == *str) || ('\\' == *str))
+        {
+            fprintf(fp, "\\%c", *str);
+        }
+        else if ((unsigned char)*str < ' ')
+        {
+            fprintf(fp, "\\u%04x", (unsigned int)(unsigned char)*str);
+        }
+        else
+        {
+            fputc(*str, fp);
+        }
+    }
+
+    fputc('"', fp);
+}
+
+/****************************************************************************
+*   Function   : PutPerByte
+*   Description: This function writes a cycles per byte member of a JSON
+*                result, which is null without a cycle counter.
+*   Parameters : fp - file to write to
+*                name - member name
+*                cycles - cycles counted, negative if none were
+*                len - bytes coded
+*   Effects    : The member is written to fp
+*   Returned   : None
+****************************************************************************/
+static void PutPerByte(FILE *fp, const char *name, const double cycles,
+    const size_t len)
+{
+    if (cycles < 0.0)
+    {
+        fprintf(fp, ", \"%s\": null", name);
+    }
+    else
+    {
+        fprintf(fp, ", \"%s\": %.2f", name, cycles / len);
+    }
+}
+
+/****************************************************************************
+*   Function   : PutRuns
+*   Description: This function writes the MB/s of each run as a JSON
+*                array member of a result.
+*   Parameters : fp - file to write to
+*                name - member name
+*                runs - seconds taken by each run
+*                repeats - number of runs
+*                mb - MB coded by each run
+*   Effects    : The member is written to fp
+*   Returned   : None
+****************************************************************************/
+static void PutRuns(FILE *fp, const char *name, const double *runs,
+    const unsigned int repeats, const double mb)
+{
+    unsigned int r;
+
+    fprintf(fp, ", \"%s\": [", name);
+
+    for (r = 0; r < repeats; r++)
+    {
+        fprintf(fp, "%s%.4f", (0 == r) ? "" : ", ", mb / runs[r]);
+    }
+
+    fprintf(fp, "]");
+}
+
+/****************************************************************************
+*   Function   : ReadFile
+*   Description: This function reads an entire file into memory.
+*   Parameters : name - name of the file
+*                len - receives the number of bytes read
+*   Effects    : Memory is allocated for the file's contents
+*   Returned   : Pointer to the contents or NULL on error
+****************************************************************************/
+static unsigned char *ReadFile(const char *name, size_t *len)
+{
+    FILE *fp;
+    unsigned char *buf;
+    long size;
+
+    fp = fopen(name, "rb");
+
+    if (NULL == fp)
+    {
+        return NULL;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    rewind(fp);
+    buf = (size < 0) ? NULL : malloc((size_t)size + 1);
+
+    if (NULL != buf)
+    {
+        *len = fread(buf, 1, (size_t)size, fp);
+    }
+
+    fclose(fp);
+    return buf;
+}
+
+/****************************************************************************
+*   Function   : CodeStreams
+*   Description: This function runs a FILE based coding function on
+*                memory, through fmemopen streams, so the file engines are
+*                measured without disk I/O.
+*   Parameters : code - function coding one FILE to another
+*                in - data to code
+*                inLen - number of bytes in in
+*                out - buffer receiving the coded data
+*                outSize - size of out
+*                outLen - receives the number of bytes written to out
+*   Effects    : out holds the coded data
+*   Returned   : 0 for success, -1 for failure
+****************************************************************************/
+static int CodeStreams(int (*code)(FILE *fpIn, FILE *fpOut),
+    const unsigned char *in, const size_t inLen, unsigned char *out,
+    const size_t outSize, size_t *outLen)
+{
+    FILE *fpIn, *fpOut;
+    long len;
+    int result;
+
+    fpIn = fmemopen((void *)in, inLen, "rb");
+    fpOut = fmemopen(out, outSize, "wb");
+    result = -1;
+
+    if ((NULL != fpIn) && (NULL != fpOut) && (0 == code(fpIn, fpOut)) &&
+        (0 == fflush(fpOut)) && ((len = ftell(fpOut)) >= 0))
+    {
+        *outLen = (size_t)len;
+        result = 0;
+    }
+
+    if (NULL != fpIn)
+    {
+        fclose(fpIn);
+    }
+
+    if (NULL != fpOut)
+    {
+        fclose(fpOut);
+    }
+
+    return result;
+}
+
+/****************************************************************************
+*   Function   : EncodeFile / DecodeFile
+*   Description: These functions are the file engine: a single stream
+*                coded with LZWEncodeFile and LZWDecodeFile.
+*   Parameters : in, inLen, out, outSize, outLen - as for code_t
+*   Effects    : out holds the coded data
+*   Returned   : 0 for success, -1 for failure
+****************************************************************************/
+static int EncodeFile(const unsigned char *in, const size_t inLen,
+    unsigned char *out, const size_t outSize, size_t *outLen)
+{
+    return CodeStreams(LZWEncodeFile, in, inLen, out, outSize, outLen);
+}
+
+static int DecodeFile(const unsigned char *in, const size_t inLen,
+    unsigned char *out, const size_t outSize, size_t *outLen)
+{
+    return CodeStreams(LZWDecodeFile, in, inLen, out, outSize, outLen);
+}
+
+/****************************************************************************
+*   Function   : EncodeBuffer / DecodeBuffer
+*   Description: These functions are the buffer engine: a single stream
+*                coded in memory with LZWEncodeBuffer and LZWDecodeBuffer.
+*   Parameters : in, inLen, out, outSize, outLen - as for code_t
+*   Effects    : out holds the coded data
+*   Returned   : 0 for success, -1 for failure
+****************************************************************************/
+static int EncodeBuffer(const unsigned char *in, const size_t inLen,
+    unsigned char *out, const size_t outSize, size_t *outLen)
+{
+    return LZWEncodeBuffer(encoder, in, inLen, out, outSize, outLen);
+}
+
+static int DecodeBuffer(const unsigned char *in, const size_t inLen,
+    unsigned char *out, const size_t outSize, size_t *outLen)
+{
+    return LZWDecodeBuffer(decoder, in, inLen, out, outSize, outLen);
+}
+
+/****************************************************************************
+*   Function   : EncodeBlocks / DecodeBlocks
+*   Description: These functions are the blocks engine: a block stream
+*                coded with LZWEncodeFileParallel and LZWDecodeFileParallel
+*                using the default parameters.
+*   Parameters : in, inLen, out, outSize, outLen - as for code_t
+*   Effects    : out holds the coded data
+*   Returned   : 0 for success, -1 for failure
+****************************************************************************/
+static int EncodeParallel(FILE *fpIn, FILE *fpOut)
+{
+    return LZWEncodeFileParallel(fpIn, fpOut, NULL);
+}
+
+static int DecodeParallel(FILE *fpIn, FILE *fpOut)
+{
+    return LZWDecodeFileParallel(fpIn, fpOut, NULL);
+}
+
+static int EncodeBlocks(const unsigned char *in, const size_t inLen,
+    unsigned char *out, const size_t outSize, size_t *outLen)
+{
+    return CodeStreams(EncodeParallel, in, inLen, out, outSize, outLen);
+}
+
+static int DecodeBlocks(const unsigned char *in, const size_t inLen,
+    unsigned char *out, const size_t outSize, size_t *outLen)
+{
+    return CodeStreams(DecodeParallel, in, inLen, out, outSize, outLen);
+}
+
+/****************************************************************************
+*   Function   : EncodeMessages
+*   Description: This function is the messages engine's encoder.  Each
+*                MESSAGE_SIZE bytes are encoded as their own stream with
+*                LZWEncodeBuffer, reusing one encoder, the way a server
+*                compresses small independent messages.  Each stream is
+*                prefixed by its 4 byte length.
+*   Parameters : in, inLen, out, outSize, outLen - as for code_t
+*   Effects    : out holds the coded messages
+*   Returned   : 0 for success, -1 for failure
+****************************************************************************/
+static int EncodeMessages(const unsigned char *in, const size_t inLen,
+    unsigned char *out, const size_t outSize, size_t *outLen)
+{
+    size_t pos, len, coded;
+
+    *outLen = 0;
+
+    for (pos = 0; pos < inLen; pos += len)
+    {
+        len = ((inLen - pos) < MESSAGE_SIZE) ? (inLen - pos) : MESSAGE_SIZE;
+
+        if ((*outLen + 4 > outSize) ||
+            (0 != LZWEncodeBuffer(encoder, in + pos, len, out + *outLen + 4,
+            outSize - *outLen - 4, &coded)))
+        {
+            return -1;
+        }
+
+        out[*outLen] = (unsigned char)(coded & 0xFF);
+        out[*outLen + 1] = (unsigned char)((coded >> 8) & 0xFF);
+        out[*outLen + 2] = (unsigned char)((coded >> 16) & 0xFF);
+        out[*outLen + 3] = (unsigned char)((coded >> 24) & 0xFF);
+        *outLen += 4 + coded;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : DecodeMessages
+*   Description: This function is the messages engine's decoder.  Each
+*                length prefixed stream is decoded with LZWDecodeBuffer,
+*                reusing one decoder.
+*   Parameters : in, inLen, out, outSize, outLen - as for code_t
+*   Effects    : out holds the decoded messages
+*   Returned   : 0 for success, -1 for failure
+****************************************************************************/
+static int DecodeMessages(const unsigned char *in, const size_t inLen,
+    unsigned char *out, const size_t outSize, size_t *outLen)
+{
+    size_t pos, coded, len, room;
+
+    *outLen = 0;
+
+    for (pos = 0; pos + 4 <= inLen; pos += 4 + coded)
+    {
+        coded = (size_t)in[pos] | ((size_t)in[pos + 1] << 8) |
+            ((size_t)in[pos + 2] << 16) | ((size_t)in[pos + 3] << 24);
+        room = outSize - *outLen;
+
+        if ((coded > inLen - pos - 4) ||
+            (0 != LZWDecodeBuffer(decoder, in + pos + 4, coded,
+            out + *outLen, (room < MESSAGE_SIZE) ? room : MESSAGE_SIZE,
+            &len)))
+        {
+            return -1;
+        }
+
+        *outLen += len;
+    }
+
+    return 0;
+}
@@ -0,0 +1,283 @@
+/***************************************************************************
+*                Block Size Tuning Benchmark for LZW Library
+*
+*   File    : tune.c
+*   Purpose : Measure the encoding time and compression ratio of
+*             LZWEncodeFileParallel over a range of block sizes, find the
+*             block sizes on the Pareto frontier of the two, and check
+*             whether the block size picked by LZWAutoBlockSize is one of
+*             them.
+*   Author  : The lzw library contributors
+*   Date    : October 17, 2026
+*
+****************************************************************************
+*
+* TUNE: Benchmark for the Lempel-Ziv-Welch Encoding Library
+* Copyright (C) 2026 by
+* The lzw library contributors
+*
+* This file is part of the lzw library.
+*
+* The lzw library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The lzw library is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "optlist/optlist.h"
+#include "lzw.h"
+#include "benchutil.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define DEFAULT_MB      2               /* size of synthetic input */
+#define REPEATS         2               /* runs per block size, best kept */
+#define MIN_BLOCK       (1UL << 14)     /* smallest block size tried */
+#define MAX_BLOCK       (1UL << 23)     /* largest block size tried */
+#define MAX_POINTS      16              /* room for every size tried */
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* result of encoding with one block size */
+typedef struct
+{
+    size_t blockSize;
+    double seconds;             /* best of REPEATS runs */
+    long outLen;                /* encoded bytes */
+} point_t;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+static int IsDominated(const point_t points[], const unsigned int count,
+    const unsigned int p);
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/****************************************************************************
+*   Function   : main
+*   Description: This is the main function for this program.  It encodes
+*                the same input with block sizes from MIN_BLOCK to
+*                MAX_BLOCK, doubling each time, and reports the time and
+*                ratio of each.  Block sizes that no other size beats in
+*                both time and ratio are marked as on the Pareto frontier,
+*                and the automatic block size is marked.
+*   Parameters : argc - number of parameters
+*                argv - parameter list
+*   Effects    : Writes a table of results to stdout
+*   Returned   : EXIT_SUCCESS or EXIT_FAILURE
+****************************************************************************/
+int main(int argc, char *argv[])
+{
+    option_t *optList, *thisOpt;
+    FILE *fpIn, *fpOut;
+    lzw_params_t params;
+    point_t points[MAX_POINTS];
+    unsigned int count, p, autoPoint;
+    unsigned long size;
+    size_t blockSize, autoSize;
+    double start, elapsed;
+    long inLen;
+    int i;
+
+    fpIn = NULL;
+    size = DEFAULT_MB;
+    LZWDefaultParams(&params);
+
+    optList = GetOptList(argc, argv, "i:t:m:h?");
+    thisOpt = optList;
+
+    while (thisOpt != NULL)
+    {
+        switch(thisOpt->option)
+        {
+            case 'i':       /* input file name */
+                fpIn = fopen(thisOpt->argument, "rb");
+
+                if (NULL == fpIn)
+                {
+                    perror("Opening input file");
+                    FreeOptList(optList);
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            case 't':       /* number of threads */
+                params.threads = (unsigned int)atoi(thisOpt->argument);
+                break;
+
+            case 'm':       /* size of synthetic input */
+                size = strtoul(thisOpt->argument, NULL, 10);
+                break;
+
+            case 'h':
+            case '?':
+                printf("Usage: %s <options>\n\n", FindFileName(argv[0]));
+                printf("options:\n");
+                printf("  -i <filename> : Input file (default synthetic).\n");
+                printf("  -m <MB> : Size of synthetic input.\n");
+                printf("  -t <n> : Number of threads (default all cores).\n");
+                printf("  -h | ?  : Print out command line options.\n\n");
+                FreeOptList(optList);
+                return EXIT_SUCCESS;
+        }
+
+        optList = thisOpt->next;
+        free(thisOpt);
+        thisOpt = optList;
+    }
+
+    if (NULL == fpIn)
+    {
+        fpIn = MakeSyntheticInput(size << 20);
+
+        if (NULL == fpIn)
+        {
+            perror("Making synthetic input");
+            return EXIT_FAILURE;
+        }
+    }
+
+    fpOut = tmpfile();
+
+    if (NULL == fpOut)
+    {
+        perror("Opening output file");
+        fclose(fpIn);
+        return EXIT_FAILURE;
+    }
+
+    fseek(fpIn, 0, SEEK_END);
+    inLen = ftell(fpIn);
+    autoSize = LZWAutoBlockSize(params.threads, (size_t)inLen);
+    count = 0;
+    autoPoint = MAX_POINTS;
+
+    printf("input %ld bytes, automatic block size %lu\n", inLen,
+        (unsigned long)autoSize);
+    printf("%10s %10s %10s %8s\n", "block", "seconds", "MB/s", "ratio");
+
+    for (blockSize = MIN_BLOCK; blockSize <= MAX_BLOCK; blockSize *= 2)
+    {
+        params.blockSize = blockSize;
+        points[count].blockSize = blockSize;
+        points[count].seconds = 0.0;
+
+        for (i = 0; i < REPEATS; i++)
+        {
+            rewind(fpIn);
+            rewind(fpOut);
+            start = Now();
+
+            if (0 != LZWEncodeFileParallel(fpIn, fpOut, &params))
+            {
+                perror("Encoding");
+                fclose(fpIn);
+                fclose(fpOut);
+                return EXIT_FAILURE;
+            }
+
+            fflush(fpOut);
+            elapsed = Now() - start;
+            points[count].outLen = ftell(fpOut);
+
+            if ((0 == i) || (elapsed < points[count].seconds))
+            {
+                points[count].seconds = elapsed;
+            }
+        }
+
+        printf("%10lu %10.3f %10.1f %8.3f\n", (unsigned long)blockSize,
+            points[count].seconds,
+            (inLen / 1048576.0) / points[count].seconds,
+            (double)points[count].outLen / inLen);
+
+        if (blockSize == autoSize)
+        {
+            autoPoint = count;
+        }
+
+        count++;
+    }
+
+    /* report the frontier once every point is known */
+    printf("\nPareto frontier (no size is both faster and smaller):\n");
+
+    for (p = 0; p < count; p++)
+    {
+        if (!IsDominated(points, count, p))
+        {
+            printf("%10lu%s\n", (unsigned long)points[p].blockSize,
+                (p == autoPoint) ? " <- automatic" : "");
+        }
+    }
+
+    if (MAX_POINTS == autoPoint)
+    {
+        printf("automatic block size %lu was not measured\n",
+            (unsigned long)autoSize);
+    }
+    else if (IsDominated(points, count, autoPoint))
+    {
+        printf("automatic block size %lu is NOT on the frontier\n",
+            (unsigned long)autoSize);
+    }
+    else
+    {
+        printf("automatic block size %lu is on the frontier\n",
+            (unsigned long)autoSize);
+    }
+
+    fclose(fpIn);
+    fclose(fpOut);
+    return EXIT_SUCCESS;
+}
+
+/****************************************************************************
+*   Function   : IsDominated
+*   Description: This function determines if another block size was at
+*                least as fast and at least as small as a given one, and
+*                strictly better in one of the two.
+*   Parameters : points - measured block sizes
+*                count - number of entries in points
+*                p - index of the point to check
+*   Effects    : None
+*   Returned   : Non-zero if points[p] is dominated, otherwise 0
+****************************************************************************/
+static int IsDominated(const point_t points[], const unsigned int count,
+    const unsigned int p)
+{
+    unsigned int q;
+
+    for (q = 0; q < count; q++)
+    {
+        if ((q != p) &&
+            (points[q].seconds <= points[p].seconds) &&
+            (points[q].outLen <= points[p].outLen) &&
+            ((points[q].seconds < points[p].seconds) ||
+            (points[q].outLen < points[p].outLen)))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -33,9 +33,155 @@
 #ifndef _LZW_H_
 #define _LZW_H_
 
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdio.h>
+#include <stddef.h>
+
 /***************************************************************************
 *                                CONSTANTS
 ***************************************************************************/
+#define LZW_DEFAULT_SAMPLE_SIZE (1UL << 20) /* bytes trained on by default */
+#define LZW_MAX_INTERLEAVE      8           /* buffers encoded in lockstep */
+#define LZW_PROGRESS_STEP       (16UL << 20) /* bytes between reports */
+#define LZW_MAX_LINE            (64UL << 10) /* longest line held by search */
+#define LZW_STATS_DEPTHS        32          /* search histogram buckets */
+#define LZW_STATS_WIDTHS        33          /* code word widths counted */
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* opaque encoder context holding a dictionary that may be reused */
+typedef struct lzw_encoder_t lzw_encoder_t;
+
+/* opaque decoder context holding a dictionary that may be reused */
+typedef struct lzw_decoder_t lzw_decoder_t;
+
+/* opaque frozen dictionary that may be shared by any number of threads */
+typedef struct lzw_dictionary_t lzw_dictionary_t;
+
+/* reports the bytes read and written so far by a long job */
+typedef void (*lzw_progress_t)(void *arg, const size_t bytesIn,
+    const size_t bytesOut);
+
+/* parameters for the block-parallel engine */
+typedef struct
+{
+    unsigned int threads;       /* worker threads, 0 = one per online core */
+    size_t blockSize;           /* uncompressed bytes/block, 0 = automatic */
+    unsigned int maxInFlight;   /* blocks held in memory, 0 = 2 x threads */
+    size_t sampleSize;          /* bytes for frozen dictionary, 0 = none */
+    lzw_dictionary_t *dictionary;   /* shared dictionary, NULL = none */
+    int pinThreads;             /* non-zero pins each worker to a core */
+    lzw_progress_t progress;    /* called as work is written, NULL = none */
+    void *progressArg;          /* passed to progress */
+    size_t progressStep;        /* input bytes between calls, 0 = default */
+} lzw_params_t;
+
+/* a buffer to encode and the buffer receiving its encoded data */
+typedef struct
+{
+    const unsigned char *in;    /* data to encode */
+    size_t inLen;               /* number of bytes in in */
+    unsigned char *out;         /* buffer receiving the encoded data */
+    size_t outSize;             /* size of out */
+    size_t outLen;              /* set to the number of bytes written */
+} lzw_buffer_t;
+
+/* one file of a batch */
+typedef struct
+{
+    const char *inName;         /* file to encode or decode */
+    const char *outName;        /* file to write, or archive member name */
+    int error;                  /* set to 0 or errno value for this file */
+} lzw_batch_item_t;
+
+/* opaque archive opened for looking up and extracting members */
+typedef struct lzw_archive_t lzw_archive_t;
+
+/* a member of an archive */
+typedef struct
+{
+    const char *name;           /* valid until the archive is next used */
+    size_t size;                /* decoded size in bytes */
+    size_t codedSize;           /* bytes used in the archive */
+} lzw_member_t;
+
+/* kinds of encoded files */
+typedef enum
+{
+    LZW_FORMAT_SINGLE,          /* one stream, as written by LZWEncodeFile */
+    LZW_FORMAT_BLOCKS,          /* block stream */
+    LZW_FORMAT_ARCHIVE          /* archive of many files */
+} lzw_format_t;
+
+/* an encoded file described from its metadata by LZWInspectFile */
+typedef struct
+{
+    lzw_format_t format;
+    size_t rawSize;             /* decoded size, 0 for a single stream */
+    size_t codedSize;           /* bytes in the encoded file */
+    size_t blockSize;           /* nominal block size, 0 if none */
+    size_t blocks;              /* blocks in a block stream */
+    size_t storedBlocks;        /* blocks stored instead of encoded */
+    size_t members;             /* members of an archive */
+    size_t sampleLen;           /* dictionary sample held in the file */
+    int needsDictionary;        /* a shared dictionary file is needed */
+    unsigned long dictionaryId; /* id of the file's dictionary */
+} lzw_info_t;
+
+/* what a context saw while coding its last stream.  only gathered when
+ * the library is built with LZW_STATS defined. */
+typedef struct
+{
+    size_t bytes;               /* uncompressed bytes coded */
+    size_t fullAt;              /* bytes coded when the dictionary filled,
+                                 * 0 if it never did */
+    unsigned long codes;        /* code words, including escapes */
+    unsigned long escapes;      /* code word width increase markers */
+    unsigned long widths[LZW_STATS_WIDTHS]; /* code words of each width */
+
+    /* encoder dictionary searches.  bucket 0 of the histograms counts 0
+     * nodes and bucket b counts 2^(b - 1) through 2^b - 1 nodes. */
+    unsigned long hits;         /* searches finding their string */
+    unsigned long misses;       /* searches not finding it */
+    unsigned long nodes;        /* tree nodes visited by all searches */
+    unsigned long probes[LZW_STATS_DEPTHS]; /* searches by nodes visited */
+    unsigned long depths[LZW_STATS_DEPTHS]; /* strings added by depth */
+
+    /* decoder */
+    unsigned long kwkwk;        /* codes used before they were defined */
+} lzw_stats_t;
+
+/* bytes in use now and the most that were in use at once */
+typedef struct
+{
+    size_t current;
+    size_t peak;
+} lzw_usage_t;
+
+/* memory used by the library or by one codec context */
+typedef struct
+{
+    lzw_usage_t dictionary;     /* dictionary tables */
+    lzw_usage_t io;             /* buffers and stacks of data being coded */
+    lzw_usage_t total;          /* both kinds together */
+    size_t reserved;            /* bytes allocated, of which pages are only
+                                 * touched as they are used */
+} lzw_memory_t;
+
+/* receives decoded data from LZWDecodeChunk.  returns 0 to continue. */
+typedef int (*lzw_sink_t)(void *arg, const unsigned char *data,
+    const size_t len);
+
+/* opaque set of patterns searched for by LZWSearchFile */
+typedef struct lzw_matcher_t lzw_matcher_t;
+
+/* receives a line found by LZWSearchFile (without its newline) and the
+ * line's offset in the decoded data.  returns 0 to continue. */
+typedef int (*lzw_match_t)(void *arg, const size_t offset,
+    const unsigned char *line, const size_t len);
 
 /***************************************************************************
 *                               PROTOTYPES
@@ -43,7 +189,152 @@
  /* encode inFile */
 int LZWEncodeFile(FILE *fpIn, FILE *fpOut);
 
+/* encoder contexts for encoding memory buffers */
+lzw_encoder_t *LZWMakeEncoder(void);
+void LZWFreeEncoder(lzw_encoder_t *encoder);
+
+/* statistics of the last stream encoded (LZW_STATS builds only) */
+int LZWEncoderStats(const lzw_encoder_t *encoder, lzw_stats_t *stats);
+
+/* dictionary memory used by an encoder since it was made */
+int LZWEncoderMemory(const lzw_encoder_t *encoder, lzw_memory_t *memory);
+
+/* largest possible encoded size of inLen bytes */
+size_t LZWEncodeBound(const size_t inLen);
+
+/* encode in as a single stream identical to LZWEncodeFile output */
+int LZWEncodeBuffer(lzw_encoder_t *encoder, const unsigned char *in,
+    const size_t inLen, unsigned char *out, const size_t outSize,
+    size_t *outLen);
+
+/* guess if encoding in would make it smaller, without encoding all of it */
+int LZWIsCompressible(lzw_encoder_t *encoder, const unsigned char *in,
+    const size_t inLen);
+
+/* encode several buffers on one thread, overlapping dictionary lookups */
+int LZWEncodeInterleaved(lzw_encoder_t *encoders[], lzw_buffer_t buffers[],
+    const unsigned int count);
+
+/* encode a single stream one chunk at a time */
+void LZWEncodeStart(lzw_encoder_t *encoder);
+int LZWEncodeChunk(lzw_encoder_t *encoder, const unsigned char *in,
+    const size_t inLen, unsigned char *out, const size_t outSize,
+    size_t *outLen);
+int LZWEncodeEnd(lzw_encoder_t *encoder, unsigned char *out,
+    const size_t outSize, size_t *outLen);
+
+/* frozen dictionaries built from a sample and shared read-only */
+lzw_dictionary_t *LZWMakeDictionary(const unsigned char *sample,
+    const size_t sampleLen);
+void LZWFreeDictionary(lzw_dictionary_t *dictionary);
+unsigned long LZWDictionaryId(const lzw_dictionary_t *dictionary);
+
+/* dictionary files holding a dictionary shared by many streams */
+int LZWWriteDictionary(const lzw_dictionary_t *dictionary, FILE *fpOut);
+lzw_dictionary_t *LZWReadDictionary(FILE *fpIn);
+
+/* build a dictionary from samples of many files, reading them in parallel */
+lzw_dictionary_t *LZWTrainDictionary(const char *const names[],
+    const size_t count, const lzw_params_t *params);
+
+/* encode in with fixed length codes from a frozen dictionary */
+int LZWEncodeFrozen(const lzw_dictionary_t *dictionary,
+    const unsigned char *in, const size_t inLen, unsigned char *out,
+    const size_t outSize, size_t *outLen);
+
+/* encode a single stream with overlapped reading, encoding and writing */
+int LZWEncodeFilePipelined(FILE *fpIn, FILE *fpOut);
+
+/* encode like LZWEncodeFilePipelined, decoding and checking the output
+ * on another thread as it is written */
+int LZWEncodeFileVerified(FILE *fpIn, FILE *fpOut);
+
+/* encode many files into block streams with work-stealing threads */
+int LZWEncodeBatch(lzw_batch_item_t *items, const size_t count,
+    const lzw_params_t *params);
+
+/* fill params with default values */
+void LZWDefaultParams(lzw_params_t *params);
+
+/* block size used when lzw_params_t blockSize is 0 */
+size_t LZWAutoBlockSize(const unsigned int threads, const size_t inLen);
+
+/* encode inFile as independent blocks using a pool of threads */
+int LZWEncodeFileParallel(FILE *fpIn, FILE *fpOut,
+    const lzw_params_t *params);
+
 /* decode inFile*/
 int LZWDecodeFile(FILE *fpIn, FILE *fpOut);
 
+/* decoder contexts for decoding memory buffers */
+lzw_decoder_t *LZWMakeDecoder(void);
+void LZWFreeDecoder(lzw_decoder_t *decoder);
+
+/* statistics of the last stream decoded (LZW_STATS builds only) */
+int LZWDecoderStats(const lzw_decoder_t *decoder, lzw_stats_t *stats);
+
+/* dictionary and stack memory used by a decoder since it was made */
+int LZWDecoderMemory(const lzw_decoder_t *decoder, lzw_memory_t *memory);
+
+/* decode a single stream such as one made by LZWEncodeBuffer */
+int LZWDecodeBuffer(lzw_decoder_t *decoder, const unsigned char *in,
+    const size_t inLen, unsigned char *out, const size_t outSize,
+    size_t *outLen);
+
+/* decode a single stream one chunk at a time */
+void LZWDecodeStart(lzw_decoder_t *decoder);
+int LZWDecodeChunk(lzw_decoder_t *decoder, const unsigned char *in,
+    const size_t inLen, lzw_sink_t sink, void *arg);
+
+/* decode data made by LZWEncodeFrozen with the same dictionary */
+int LZWDecodeFrozen(const lzw_dictionary_t *dictionary,
+    const unsigned char *in, const size_t inLen, unsigned char *out,
+    const size_t outSize, size_t *outLen);
+
+/* decode a block stream made by LZWEncodeFileParallel using many threads */
+int LZWDecodeFileParallel(FILE *fpIn, FILE *fpOut,
+    const lzw_params_t *params);
+
+/* decode a block stream (using many threads) or a single stream, passing
+ * the decoded data to sink in order */
+int LZWDecodeFileToSink(FILE *fpIn, lzw_sink_t sink, void *arg,
+    const lzw_params_t *params);
+
+/* decode a stream made by LZWEncodeFile, using many threads once the
+ * stream's dictionary is full */
+int LZWDecodeFileSpeculative(FILE *fpIn, FILE *fpOut,
+    const lzw_params_t *params);
+
+/* decode many files, one file per thread at a time */
+int LZWDecodeBatch(lzw_batch_item_t *items, const size_t count,
+    const lzw_params_t *params);
+
+/* describe an encoded file from its headers, without decoding it */
+int LZWInspectFile(FILE *fpIn, lzw_info_t *info);
+
+/* search encoded files for lines holding any of a set of patterns */
+lzw_matcher_t *LZWMakeMatcher(const char *const patterns[],
+    const size_t count);
+void LZWFreeMatcher(lzw_matcher_t *matcher);
+int LZWSearchFile(FILE *fpIn, const lzw_matcher_t *matcher,
+    lzw_match_t match, void *arg, const lzw_params_t *params);
+
+/* pack many files into one archive with a directory of its members */
+int LZWWriteArchive(FILE *fpOut, lzw_batch_item_t *items,
+    const size_t count, const lzw_params_t *params);
+
+/* look up and extract single members of an archive */
+lzw_archive_t *LZWOpenArchive(FILE *fpIn);
+void LZWCloseArchive(lzw_archive_t *archive);
+size_t LZWArchiveCount(const lzw_archive_t *archive);
+int LZWArchiveMember(lzw_archive_t *archive, const size_t index,
+    lzw_member_t *member);
+int LZWFindMember(lzw_archive_t *archive, const char *name, size_t *index);
+int LZWExtractMember(lzw_archive_t *archive, const size_t index,
+    FILE *fpOut);
+
+/* memory held by the whole library, for sizing memory limits */
+void LZWMemoryUsage(lzw_memory_t *memory);
+void LZWResetMemoryPeaks(void);
+
 #endif  /* ndef _LZW_H_ */
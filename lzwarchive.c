@@ -0,0 +1,1389 @@
+/***************************************************************************
+*                 Lempel-Ziv-Welch Archive Functions
+*
+*   File    : lzwarchive.c
+*   Purpose : Provides functions that pack many files into one archive and
+*             extract them again.  Members are encoded independently, their
+*             blocks on a pool of threads, optionally with a dictionary
+*             stored once in the archive, and are followed by a directory
+*             with a hash of the member names, so one member can be found
+*             and extracted without reading the rest of the archive.
+*   Author  : The lzw library contributors
+*   Date    : October 17, 2026
+*
+****************************************************************************
+*
+* LZW: An ANSI C Lempel-Ziv-Welch Encoding/Decoding Routines
+* Copyright (C) 2026 by
+* The lzw library contributors
+*
+* This file is part of the lzw library.
+*
+* The lzw library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The lzw library is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "lzw.h"
+#include "lzwlocal.h"
+#include "lzwpool.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define FNV_OFFSET      2166136261UL    /* FNV-1a 32 bit offset basis */
+#define FNV_PRIME       16777619UL      /* FNV-1a 32 bit prime */
+#define MAX_MEMBERS     0x3FFFFFFFUL    /* keeps the hash slots in 32 bits */
+#define MAX_NAMES       0xFFFFFFFFUL    /* largest names section */
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* state shared by the jobs encoding an archive's blocks */
+typedef struct
+{
+    pthread_mutex_t lock;       /* protects each block's done flag */
+    pthread_cond_t done;        /* signaled when a block is encoded */
+    const lzw_dictionary_t *dictionary; /* archive's dictionary or NULL */
+} writer_t;
+
+/* one block of a member in flight */
+typedef struct
+{
+    lzw_job_t job;              /* job encoding this block (must be first) */
+    writer_t *writer;           /* state shared by all blocks */
+    unsigned char *in;          /* block data to be encoded */
+    size_t inLen;               /* bytes in in, 0 ends the member */
+    unsigned char *out;         /* prefixed encoded block */
+    size_t outLen;              /* bytes used in out */
+    size_t item;                /* index of the file the block is from */
+    int error;                  /* errno value if reading or encoding failed */
+    int done;                   /* set once the block is encoded */
+} member_block_t;
+
+/* reads the files being packed in order, a block at a time */
+typedef struct
+{
+    lzw_batch_item_t *items;    /* files to pack */
+    size_t count;               /* number of entries in items */
+    size_t next;                /* item being read */
+    FILE *fpIn;                 /* its file, NULL until it's opened */
+    size_t blockSize;           /* uncompressed bytes in each block */
+} member_reader_t;
+
+/* the directory being built as members are written */
+typedef struct
+{
+    unsigned char *entries;     /* directory entries */
+    size_t members;             /* entries used */
+    char *names;                /* names section */
+    unsigned long namesLen;     /* bytes in names */
+} directory_t;
+
+/* a directory entry */
+typedef struct
+{
+    off_t offset;               /* offset of the member's first block */
+    off_t size;                 /* decoded size */
+    off_t codedSize;            /* bytes used by the member's blocks */
+    unsigned long nameOffset;   /* offset in the names section */
+    unsigned long nameLen;      /* bytes in the name */
+} entry_t;
+
+struct lzw_archive_t
+{
+    int fd;                     /* archive file, read with pread() */
+    off_t base;                 /* offset of the archive in the file */
+    size_t blockSize;           /* largest decoded block */
+    unsigned char flags;        /* ARCHIVE_FLAG_ values */
+    lzw_dictionary_t *dictionary;   /* archive's dictionary or NULL */
+    size_t count;               /* number of members */
+    unsigned long slots;        /* number of hash slots */
+    unsigned long namesLen;     /* bytes in the names section */
+    off_t directory;            /* offset of the directory */
+    lzw_decoder_t *decoder;     /* decodes blocks without a dictionary */
+    unsigned char *in;          /* one encoded block */
+    unsigned char *out;         /* one decoded block */
+    char *name;                 /* name of the member last looked at */
+    size_t nameSize;            /* size of name */
+};
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+static int ReadMemberBlock(member_reader_t *reader, member_block_t *block);
+static void EncodeBlockJob(lzw_job_t *job, lzw_worker_t *worker);
+static void WaitForBlock(member_block_t *block);
+static int AddEntry(directory_t *directory, const char *name,
+    const off_t offset, const off_t size, const off_t codedSize);
+static int WriteArchiveHeader(FILE *fpOut, const size_t blockSize,
+    const lzw_dictionary_t *dictionary, off_t *pos);
+static int WriteDirectory(FILE *fpOut, const unsigned char *entries,
+    const size_t count, const char *names, const unsigned long namesLen,
+    const off_t pos);
+
+static int ReadLayout(lzw_archive_t *archive, FILE *fpIn);
+static int ReadEntry(lzw_archive_t *archive, const size_t index,
+    entry_t *entry);
+static int ReadName(lzw_archive_t *archive, const entry_t *entry);
+static int ReadAt(const int fd, void *buf, const size_t len,
+    const off_t offset);
+static unsigned long HashName(const char *name, const size_t len);
+static void PutOffset(unsigned char *p, const off_t value);
+static off_t GetOffset(const unsigned char *p);
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : LZWWriteArchive
+*   Description: This routine packs many files into one archive.  Members
+*                are read a block at a time, in the order they are listed,
+*                and the blocks are encoded by a pool of threads and
+*                written in the order they were read, as
+*                LZWEncodeFileParallel does, so at most params->maxInFlight
+*                blocks are held in memory however large the files are.
+*                Only each member's offset and sizes are kept for the
+*                directory, which is written at the end.  If
+*                params->dictionary is set it is stored in the archive and
+*                used for every member; otherwise, if params->sampleSize is
+*                set, a dictionary is trained on the files with
+*                LZWTrainDictionary and stored.  Files that can't be read
+*                are left out of the directory, though blocks already
+*                written for a file that fails part way stay in the
+*                archive.  params->progress is called as blocks are
+*                written, each time at least progressStep more input bytes
+*                are packed.
+*   Parameters : fpOut - file receiving the archive
+*                items - files to pack.  inName is the file to read and
+*                        outName the name of its member (NULL uses inName).
+*                        Each entry's error is set to 0 or the errno value
+*                        for its failure.
+*                count - number of entries in items
+*                params - block-parallel parameters (NULL for defaults).
+*                         threads is the number of blocks encoded at once.
+*   Effects    : The archive is written to fpOut
+*   Returned   : 0 if every file was packed, otherwise -1 with errno set
+*                to the first failure.
+***************************************************************************/
+int LZWWriteArchive(FILE *fpOut, lzw_batch_item_t *items,
+    const size_t count, const lzw_params_t *params)
+{
+    lzw_params_t valid;         /* params with defaults filled in */
+    lzw_dictionary_t *trained;
+    const char **inNames;
+    writer_t writer;
+    member_reader_t reader;
+    directory_t directory;
+    member_block_t *blocks;     /* ring of blocks in flight */
+    member_block_t *block;
+    lzw_pool_t *pool;
+    const char *name;
+    unsigned long nextRead;     /* sequence number of next block read */
+    unsigned long nextWrite;    /* sequence number of next block written */
+    size_t i, bytesIn, nextReport;  /* input packed, for progress */
+    off_t pos, memberPos, memberSize;   /* member being written */
+    int result, error, more, memberError;
+
+    /* validate arguments */
+    if ((NULL == fpOut) || ((NULL == items) && (0 != count)))
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if ((count > MAX_MEMBERS) || (0 != LZWValidateParams(params, &valid, 0)))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    writer.dictionary = valid.dictionary;
+    trained = NULL;
+
+    if ((NULL == valid.dictionary) && (0 != valid.sampleSize) &&
+        (0 != count))
+    {
+        /* train one dictionary for all of the members */
+        inNames = malloc(count * sizeof(char *));
+
+        if (NULL == inNames)
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+
+        for (i = 0; i < count; i++)
+        {
+            inNames[i] = items[i].inName;
+        }
+
+        trained = LZWTrainDictionary(inNames, count, &valid);
+        free(inNames);
+
+        if (NULL == trained)
+        {
+            return -1;
+        }
+
+        writer.dictionary = trained;
+    }
+
+    blocks = calloc(valid.maxInFlight, sizeof(member_block_t));
+    directory.entries =
+        malloc(((0 == count) ? 1 : count) * ARCHIVE_ENTRY_LEN);
+    directory.members = 0;
+    directory.names = NULL;
+    directory.namesLen = 0;
+    result = ((NULL == blocks) || (NULL == directory.entries)) ? -1 : 0;
+
+    for (i = 0; (0 == result) && (i < valid.maxInFlight); i++)
+    {
+        blocks[i].job.run = EncodeBlockJob;
+        blocks[i].writer = &writer;
+        blocks[i].in = LZWAlloc(LZW_MEM_IO, valid.blockSize);
+        blocks[i].out = LZWAlloc(LZW_MEM_IO,
+            BLOCK_PREFIX_LEN + LZWEncodeBound(valid.blockSize));
+
+        if ((NULL == blocks[i].in) || (NULL == blocks[i].out))
+        {
+            result = -1;
+        }
+    }
+
+    pool = NULL;
+
+    if ((0 != result) ||
+        (NULL == (pool = LZWMakePool(valid.threads, valid.pinThreads))))
+    {
+        for (i = 0; (NULL != blocks) && (i < valid.maxInFlight); i++)
+        {
+            LZWRelease(blocks[i].in);
+            LZWRelease(blocks[i].out);
+        }
+
+        free(blocks);
+        free(directory.entries);
+        LZWFreeDictionary(trained);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        items[i].error = 0;
+    }
+
+    reader.items = items;
+    reader.count = count;
+    reader.next = 0;
+    reader.fpIn = NULL;
+    reader.blockSize = valid.blockSize;
+
+    pthread_mutex_init(&writer.lock, NULL);
+    pthread_cond_init(&writer.done, NULL);
+    result = WriteArchiveHeader(fpOut, valid.blockSize, writer.dictionary,
+        &pos);
+    nextRead = 0;
+    nextWrite = 0;
+    more = 1;
+    memberPos = pos;
+    memberSize = 0;
+    memberError = 0;
+    bytesIn = 0;
+    nextReport = valid.progressStep;
+
+    while (0 == result)
+    {
+        /* keep every free slot busy with the next block of the members */
+        while (more && ((nextRead - nextWrite) < valid.maxInFlight))
+        {
+            block = &blocks[nextRead % valid.maxInFlight];
+            more = ReadMemberBlock(&reader, block);
+
+            if (!more)
+            {
+                break;
+            }
+
+            /* the block that ends a member has nothing to encode */
+            block->done = (0 == block->inLen);
+
+            if (!block->done)
+            {
+                LZWPoolSubmit(pool, &block->job);
+            }
+
+            nextRead++;
+        }
+
+        if (nextWrite == nextRead)
+        {
+            break;          /* every member has been written */
+        }
+
+        /* write the oldest block once it's been encoded */
+        block = &blocks[nextWrite % valid.maxInFlight];
+        WaitForBlock(block);
+        nextWrite++;
+
+        if (0 == memberError)
+        {
+            memberError = block->error;
+        }
+
+        if (0 != block->inLen)
+        {
+            if (0 != memberError)
+            {
+                continue;   /* the member will be left out */
+            }
+
+            if (block->outLen != fwrite(block->out, 1, block->outLen, fpOut))
+            {
+                result = -1;
+                break;
+            }
+
+            pos += block->outLen;
+            memberSize += block->inLen;
+            bytesIn += block->inLen;
+
+            if ((NULL != valid.progress) && (bytesIn >= nextReport))
+            {
+                valid.progress(valid.progressArg, bytesIn, (size_t)pos);
+                nextReport = bytesIn + valid.progressStep;
+            }
+
+            continue;
+        }
+
+        /* the member is complete, so its directory entry can be made */
+        if (0 != memberError)
+        {
+            /* leave the file out and carry on with the rest */
+            items[block->item].error = memberError;
+        }
+        else
+        {
+            name = (NULL == items[block->item].outName) ?
+                items[block->item].inName : items[block->item].outName;
+            result = AddEntry(&directory, name, memberPos, memberSize,
+                pos - memberPos);
+        }
+
+        memberPos = pos;
+        memberSize = 0;
+        memberError = 0;
+    }
+
+    if (0 == result)
+    {
+        result = WriteDirectory(fpOut, directory.entries, directory.members,
+            directory.names, directory.namesLen, pos);
+    }
+
+    if ((0 == result) && (NULL != valid.progress))
+    {
+        valid.progress(valid.progressArg, bytesIn, (size_t)pos);
+    }
+
+    error = (0 == result) ? 0 : errno;
+
+    for (i = 0; (0 == error) && (i < count); i++)
+    {
+        error = items[i].error;
+    }
+
+    /* waits for any blocks still being encoded */
+    LZWFreePool(pool);
+
+    if (NULL != reader.fpIn)
+    {
+        fclose(reader.fpIn);
+    }
+
+    for (i = 0; i < valid.maxInFlight; i++)
+    {
+        LZWRelease(blocks[i].in);
+        LZWRelease(blocks[i].out);
+    }
+
+    pthread_cond_destroy(&writer.done);
+    pthread_mutex_destroy(&writer.lock);
+    free(directory.names);
+    free(directory.entries);
+    free(blocks);
+    LZWFreeDictionary(trained);
+
+    if (0 != error)
+    {
+        errno = error;
+        return -1;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : ReadMemberBlock
+*   Description: This routine reads the next block of the files being
+*                packed.  Each file's blocks are followed by an empty
+*                block that ends its member, even if the file is empty.
+*                Files that can't be opened are skipped, with their
+*                item's error set.
+*   Parameters : reader - files being read
+*                block - block receiving the data
+*   Effects    : Up to reader->blockSize bytes are read into block->in,
+*                and block->error is set if the file can't be read
+*   Returned   : 1 if a block was read, 0 once every file has been read.
+***************************************************************************/
+static int ReadMemberBlock(member_reader_t *reader, member_block_t *block)
+{
+    lzw_batch_item_t *item;
+
+    while (NULL == reader->fpIn)
+    {
+        if (reader->next == reader->count)
+        {
+            return 0;
+        }
+
+        item = &reader->items[reader->next];
+        reader->fpIn = fopen(item->inName, "rb");
+
+        if (NULL == reader->fpIn)
+        {
+            item->error = (0 == errno) ? EIO : errno;
+            reader->next++;
+        }
+    }
+
+    block->item = reader->next;
+    block->error = 0;
+    block->outLen = 0;
+    block->inLen = fread(block->in, 1, reader->blockSize, reader->fpIn);
+
+    if (0 == block->inLen)
+    {
+        if (ferror(reader->fpIn))
+        {
+            block->error = (0 == errno) ? EIO : errno;
+        }
+
+        fclose(reader->fpIn);
+        reader->fpIn = NULL;
+        reader->next++;
+    }
+
+    return 1;
+}
+
+/***************************************************************************
+*   Function   : EncodeBlockJob
+*   Description: This routine is run by a pool worker.  It encodes one
+*                block of a member with LZWEncodeBlock and wakes the thread
+*                writing the archive.
+*   Parameters : job - job embedded in a member_block_t
+*                worker - worker running the job
+*   Effects    : The block's output is filled and its error is set
+*   Returned   : None
+***************************************************************************/
+static void EncodeBlockJob(lzw_job_t *job, lzw_worker_t *worker)
+{
+    member_block_t *block;
+    writer_t *writer;
+    lzw_encoder_t *encoder;
+
+    block = (member_block_t *)job;
+    writer = block->writer;
+    encoder = LZWWorkerEncoder(worker);
+
+    if (NULL == encoder)
+    {
+        block->error = ENOMEM;
+    }
+    else if (0 != LZWEncodeBlock(encoder, writer->dictionary, block->in,
+        block->inLen, block->out, &block->outLen))
+    {
+        block->error = (0 == errno) ? EIO : errno;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    block->done = 1;
+    pthread_cond_broadcast(&writer->done);
+    pthread_mutex_unlock(&writer->lock);
+}
+
+/***************************************************************************
+*   Function   : WaitForBlock
+*   Description: This routine blocks until a worker has finished encoding
+*                a block.
+*   Parameters : block - block to wait on
+*   Effects    : None
+*   Returned   : None
+***************************************************************************/
+static void WaitForBlock(member_block_t *block)
+{
+    writer_t *writer = block->writer;
+
+    pthread_mutex_lock(&writer->lock);
+
+    while (!block->done)
+    {
+        pthread_cond_wait(&writer->done, &writer->lock);
+    }
+
+    pthread_mutex_unlock(&writer->lock);
+}
+
+/***************************************************************************
+*   Function   : AddEntry
+*   Description: This routine adds a member that has been written to the
+*                directory, and its name to the names section.
+*   Parameters : directory - directory being built, with room for the entry
+*                name - member's name
+*                offset - offset of the member's first block
+*                size - decoded size of the member
+*                codedSize - bytes used by the member's blocks
+*   Effects    : An entry is added to directory
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+static int AddEntry(directory_t *directory, const char *name,
+    const off_t offset, const off_t size, const off_t codedSize)
+{
+    unsigned char *entry;
+    unsigned long nameLen;
+    char *grown;
+
+    nameLen = strlen(name);
+
+    if (nameLen > (MAX_NAMES - directory->namesLen))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    grown = realloc(directory->names, directory->namesLen + nameLen + 1);
+
+    if (NULL == grown)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    directory->names = grown;
+    memcpy(directory->names + directory->namesLen, name, nameLen);
+
+    entry = directory->entries + (directory->members * ARCHIVE_ENTRY_LEN);
+    PutOffset(entry, offset);
+    PutOffset(entry + 8, size);
+    PutOffset(entry + 16, codedSize);
+    PUT_LE32(entry + 24, directory->namesLen);
+    PUT_LE32(entry + 28, nameLen);
+    directory->namesLen += nameLen;
+    directory->members++;
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : WriteArchiveHeader
+*   Description: This routine writes the header that starts an archive,
+*                followed by the archive's dictionary if it has one.  The
+*                dictionary is written to memory first to learn its size.
+*   Parameters : fpOut - file receiving the archive
+*                blockSize - nominal number of bytes in each block
+*                dictionary - dictionary used by every member or NULL
+*                pos - receives the number of bytes written
+*   Effects    : The header is written to fpOut
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+static int WriteArchiveHeader(FILE *fpOut, const size_t blockSize,
+    const lzw_dictionary_t *dictionary, off_t *pos)
+{
+    unsigned char header[ARCHIVE_HEADER_LEN];
+    FILE *fpDict;
+    char *dict;
+    size_t dictLen;
+    int result;
+
+    memcpy(header, ARCHIVE_MAGIC, BLOCK_MAGIC_LEN);
+    header[4] = ARCHIVE_VERSION;
+    header[5] = (NULL == dictionary) ? 0 : ARCHIVE_FLAG_SHARED;
+    header[6] = 0;              /* reserved */
+    header[7] = 0;
+    PUT_LE32(header + 8, blockSize);
+
+    if (fwrite(header, 1, ARCHIVE_HEADER_LEN, fpOut) != ARCHIVE_HEADER_LEN)
+    {
+        return -1;
+    }
+
+    *pos = ARCHIVE_HEADER_LEN;
+
+    if (NULL == dictionary)
+    {
+        return 0;
+    }
+
+    dict = NULL;
+    dictLen = 0;
+    fpDict = open_memstream(&dict, &dictLen);
+
+    if (NULL == fpDict)
+    {
+        return -1;
+    }
+
+    result = LZWWriteDictionary(dictionary, fpDict);
+
+    if ((0 != fclose(fpDict)) || (NULL == dict))
+    {
+        result = -1;
+    }
+
+    if ((0 == result) && (fwrite(dict, 1, dictLen, fpOut) != dictLen))
+    {
+        result = -1;
+    }
+
+    free(dict);
+    *pos += dictLen;
+    return result;
+}
+
+/***************************************************************************
+*   Function   : WriteDirectory
+*   Description: This routine writes the directory, the hash of member
+*                names, the names and the trailer that end an archive.
+*                The hash has at least twice as many slots as there are
+*                members, so probes stay short.
+*   Parameters : fpOut - file receiving the archive
+*                entries - directory entries for count members
+*                count - number of members
+*                names - the members' names
+*                namesLen - bytes in names
+*                pos - offset of the directory
+*   Effects    : The end of the archive is written to fpOut
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+static int WriteDirectory(FILE *fpOut, const unsigned char *entries,
+    const size_t count, const char *names, const unsigned long namesLen,
+    const off_t pos)
+{
+    unsigned char trailer[ARCHIVE_TRAILER_LEN];
+    unsigned char *hash;
+    unsigned long slots, slot;
+    size_t i;
+
+    for (slots = 1; slots < (2 * count); slots <<= 1)
+    {
+        /* find the power of 2 */
+    }
+
+    hash = calloc(slots, 4);
+
+    if (NULL == hash)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        slot = HashName(names + GET_LE32(entries + (i * ARCHIVE_ENTRY_LEN) +
+            24), GET_LE32(entries + (i * ARCHIVE_ENTRY_LEN) + 28));
+        slot &= (slots - 1);
+
+        while (0 != GET_LE32(hash + (slot * 4)))
+        {
+            slot = (slot + 1) & (slots - 1);
+        }
+
+        PUT_LE32(hash + (slot * 4), i + 1);
+    }
+
+    PutOffset(trailer, pos);
+    PUT_LE32(trailer + 8, (unsigned long)count);
+    PUT_LE32(trailer + 12, slots);
+    PUT_LE32(trailer + 16, namesLen);
+    memcpy(trailer + 20, ARCHIVE_MAGIC, BLOCK_MAGIC_LEN);
+
+    if ((fwrite(entries, ARCHIVE_ENTRY_LEN, count, fpOut) != count) ||
+        (fwrite(hash, 4, slots, fpOut) != slots) ||
+        (fwrite(names, 1, namesLen, fpOut) != namesLen) ||
+        (fwrite(trailer, 1, ARCHIVE_TRAILER_LEN, fpOut) !=
+        ARCHIVE_TRAILER_LEN))
+    {
+        free(hash);
+        return -1;
+    }
+
+    free(hash);
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : LZWOpenArchive
+*   Description: This routine opens an archive written by LZWWriteArchive
+*                for lookups and extraction.  Only the header, trailer and
+*                dictionary are read; the directory is read an entry at a
+*                time as it is used.
+*   Parameters : fpIn - seekable file holding the archive, starting at its
+*                       current position and ending at the end of the file.
+*                       It must stay open until the archive is closed.
+*   Effects    : Memory is allocated for the archive
+*   Returned   : Pointer to the archive or NULL on error.  errno is set to
+*                EILSEQ if fpIn doesn't hold a valid archive.
+***************************************************************************/
+lzw_archive_t *LZWOpenArchive(FILE *fpIn)
+{
+    lzw_archive_t *archive;
+
+    if (NULL == fpIn)
+    {
+        errno = ENOENT;
+        return NULL;
+    }
+
+    archive = calloc(1, sizeof(lzw_archive_t));
+
+    if (NULL == archive)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if (0 != ReadLayout(archive, fpIn))
+    {
+        free(archive);
+        return NULL;
+    }
+
+    if (archive->flags & ARCHIVE_FLAG_SHARED)
+    {
+        if (0 != fseeko(fpIn, archive->base + ARCHIVE_HEADER_LEN, SEEK_SET))
+        {
+            free(archive);
+            return NULL;
+        }
+
+        archive->dictionary = LZWReadDictionary(fpIn);
+
+        if (NULL == archive->dictionary)
+        {
+            free(archive);
+            return NULL;
+        }
+    }
+
+    archive->decoder = LZWMakeDecoder();
+    archive->in = LZWAlloc(LZW_MEM_IO, LZWEncodeBound(archive->blockSize));
+    archive->out = LZWAlloc(LZW_MEM_IO, archive->blockSize);
+
+    if ((NULL == archive->decoder) || (NULL == archive->in) ||
+        (NULL == archive->out))
+    {
+        LZWCloseArchive(archive);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return archive;
+}
+
+/***************************************************************************
+*   Function   : LZWCloseArchive
+*   Description: This routine frees an archive opened by LZWOpenArchive.
+*                The archive's file is not closed.
+*   Parameters : archive - archive to free (may be NULL)
+*   Effects    : Memory used by the archive is freed
+*   Returned   : None
+***************************************************************************/
+void LZWCloseArchive(lzw_archive_t *archive)
+{
+    if (NULL == archive)
+    {
+        return;
+    }
+
+    LZWFreeDictionary(archive->dictionary);
+    LZWFreeDecoder(archive->decoder);
+    LZWRelease(archive->in);
+    LZWRelease(archive->out);
+    free(archive->name);
+    free(archive);
+}
+
+/***************************************************************************
+*   Function   : LZWArchiveCount
+*   Description: This routine returns the number of members in an archive.
+*   Parameters : archive - open archive
+*   Effects    : None
+*   Returned   : Number of members
+***************************************************************************/
+size_t LZWArchiveCount(const lzw_archive_t *archive)
+{
+    return (NULL == archive) ? 0 : archive->count;
+}
+
+/***************************************************************************
+*   Function   : LZWArchiveMember
+*   Description: This routine describes a member of an archive.
+*   Parameters : archive - open archive
+*                index - index of the member, 0 .. count - 1
+*                member - receives the member's name and sizes.  The name
+*                         is valid until the archive is next used.
+*   Effects    : The member's directory entry and name are read
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+int LZWArchiveMember(lzw_archive_t *archive, const size_t index,
+    lzw_member_t *member)
+{
+    entry_t entry;
+
+    if ((NULL == archive) || (NULL == member))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((0 != ReadEntry(archive, index, &entry)) ||
+        (0 != ReadName(archive, &entry)))
+    {
+        return -1;
+    }
+
+    member->name = archive->name;
+    member->size = (size_t)entry.size;
+    member->codedSize = (size_t)entry.codedSize;
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : LZWFindMember
+*   Description: This routine looks up a member of an archive by name.  The
+*                name's slot in the hash is read, then the entries and
+*                names of the members in it and the slots after it, until
+*                the name or an empty slot is found.
+*   Parameters : archive - open archive
+*                name - name of the member
+*                index - receives the index of the first member with that
+*                        name
+*   Effects    : None
+*   Returned   : 0 for success, -1 for failure.  errno is set to ENOENT if
+*                the archive has no member with that name.
+***************************************************************************/
+int LZWFindMember(lzw_archive_t *archive, const char *name, size_t *index)
+{
+    unsigned char value[4];
+    unsigned long slot, probes, found;
+    size_t len;
+    entry_t entry;
+
+    if ((NULL == archive) || (NULL == name) || (NULL == index))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    len = strlen(name);
+    slot = HashName(name, len) & (archive->slots - 1);
+
+    for (probes = 0; probes < archive->slots; probes++)
+    {
+        if (0 != ReadAt(archive->fd, value, 4, archive->base +
+            archive->directory + (off_t)(archive->count * ARCHIVE_ENTRY_LEN) +
+            (off_t)(slot * 4)))
+        {
+            return -1;
+        }
+
+        found = GET_LE32(value);
+
+        if (0 == found)
+        {
+            break;
+        }
+
+        if ((0 != ReadEntry(archive, found - 1, &entry)) ||
+            ((entry.nameLen == len) && (0 != ReadName(archive, &entry))))
+        {
+            return -1;
+        }
+
+        if ((entry.nameLen == len) && (0 == memcmp(archive->name, name, len)))
+        {
+            *index = found - 1;
+            return 0;
+        }
+
+        slot = (slot + 1) & (archive->slots - 1);
+    }
+
+    errno = ENOENT;
+    return -1;
+}
+
+/***************************************************************************
+*   Function   : LZWExtractMember
+*   Description: This routine decodes one member of an archive, reading
+*                only that member's blocks.
+*   Parameters : archive - open archive
+*                index - index of the member, 0 .. count - 1
+*                fpOut - file receiving the decoded member
+*   Effects    : The member is decoded and written to fpOut
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+int LZWExtractMember(lzw_archive_t *archive, const size_t index,
+    FILE *fpOut)
+{
+    unsigned char prefix[BLOCK_PREFIX_LEN];
+    const unsigned char *data;
+    entry_t entry;
+    off_t pos, end, remaining;
+    size_t rawLen, codedLen, outLen;
+    int stored, result;
+
+    if ((NULL == archive) || (NULL == fpOut))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (0 != ReadEntry(archive, index, &entry))
+    {
+        return -1;
+    }
+
+    pos = archive->base + entry.offset;
+    end = pos + entry.codedSize;
+    remaining = entry.size;
+
+    while (remaining > 0)
+    {
+        if ((end - pos) < BLOCK_PREFIX_LEN)
+        {
+            errno = EILSEQ;
+            return -1;
+        }
+
+        if (0 != ReadAt(archive->fd, prefix, BLOCK_PREFIX_LEN, pos))
+        {
+            return -1;
+        }
+
+        rawLen = GET_LE32(prefix);
+        codedLen = GET_LE32(prefix + 4);
+        stored = (0 != (codedLen & BLOCK_STORED));
+        codedLen &= ~BLOCK_STORED;
+        pos += BLOCK_PREFIX_LEN;
+
+        if ((0 == rawLen) || (rawLen > archive->blockSize) ||
+            ((off_t)rawLen > remaining) ||
+            (codedLen > LZWEncodeBound(archive->blockSize)) ||
+            ((off_t)codedLen > (end - pos)) ||
+            (stored && (codedLen != rawLen)))
+        {
+            errno = EILSEQ;
+            return -1;
+        }
+
+        if (0 != ReadAt(archive->fd, archive->in, codedLen, pos))
+        {
+            return -1;
+        }
+
+        data = archive->out;
+        outLen = rawLen;
+        result = 0;
+
+        if (stored)
+        {
+            data = archive->in;
+        }
+        else if (NULL != archive->dictionary)
+        {
+            result = LZWDecodeFrozen(archive->dictionary, archive->in,
+                codedLen, archive->out, rawLen, &outLen);
+        }
+        else
+        {
+            result = LZWDecodeBuffer(archive->decoder, archive->in,
+                codedLen, archive->out, rawLen, &outLen);
+        }
+
+        if ((0 != result) || (outLen != rawLen))
+        {
+            errno = EILSEQ;
+            return -1;
+        }
+
+        if (fwrite(data, 1, rawLen, fpOut) != rawLen)
+        {
+            return -1;
+        }
+
+        pos += codedLen;
+        remaining -= rawLen;
+    }
+
+    if (pos != end)
+    {
+        /* the blocks don't match the directory */
+        errno = EILSEQ;
+        return -1;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : LZWInspectArchive
+*   Description: This routine describes an archive from its header,
+*                trailer and directory, without decoding or building its
+*                dictionary.  Reading the directory costs one pass over
+*                ARCHIVE_ENTRY_LEN bytes per member.
+*   Parameters : fpIn - seekable file holding the archive, as for
+*                       LZWOpenArchive
+*                info - receives the description
+*   Effects    : info is filled in
+*   Returned   : 0 for success, -1 for failure.  errno is set to EILSEQ if
+*                fpIn doesn't hold a valid archive.
+***************************************************************************/
+int LZWInspectArchive(FILE *fpIn, lzw_info_t *info)
+{
+    lzw_archive_t archive;
+    unsigned char buf[ARCHIVE_ENTRY_LEN * 64];
+    unsigned char dict[DICT_HEADER_LEN + 4];
+    size_t i, n, j;
+
+    memset(&archive, 0, sizeof(archive));
+    memset(info, 0, sizeof(lzw_info_t));
+
+    if (0 != ReadLayout(&archive, fpIn))
+    {
+        return -1;
+    }
+
+    info->format = LZW_FORMAT_ARCHIVE;
+    info->blockSize = archive.blockSize;
+    info->members = archive.count;
+    info->codedSize = (size_t)(archive.directory +
+        (off_t)(archive.count * ARCHIVE_ENTRY_LEN) +
+        (off_t)(archive.slots * 4) + (off_t)archive.namesLen +
+        ARCHIVE_TRAILER_LEN);
+
+    if (archive.flags & ARCHIVE_FLAG_SHARED)
+    {
+        /* the dictionary file's id and sample length */
+        if (0 != ReadAt(archive.fd, dict, sizeof(dict),
+            archive.base + ARCHIVE_HEADER_LEN))
+        {
+            return -1;
+        }
+
+        info->dictionaryId = GET_LE32(dict + 8);
+        info->sampleLen = GET_LE32(dict + DICT_HEADER_LEN);
+    }
+
+    for (i = 0; i < archive.count; i += n)
+    {
+        n = archive.count - i;
+        n = (n < 64) ? n : 64;
+
+        if (0 != ReadAt(archive.fd, buf, n * ARCHIVE_ENTRY_LEN,
+            archive.base + archive.directory +
+            (off_t)(i * ARCHIVE_ENTRY_LEN)))
+        {
+            return -1;
+        }
+
+        for (j = 0; j < n; j++)
+        {
+            info->rawSize += (size_t)GetOffset(buf +
+                (j * ARCHIVE_ENTRY_LEN) + 8);
+        }
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : ReadLayout
+*   Description: This routine reads an archive's header and trailer and
+*                checks that its sections exactly fill the rest of the
+*                file.
+*   Parameters : archive - receives the file, offsets and section sizes
+*                fpIn - seekable file holding the archive, starting at its
+*                       current position
+*   Effects    : archive's layout fields are set
+*   Returned   : 0 for success, -1 for failure.  errno is set to EILSEQ if
+*                fpIn doesn't hold a valid archive.
+***************************************************************************/
+static int ReadLayout(lzw_archive_t *archive, FILE *fpIn)
+{
+    unsigned char header[ARCHIVE_HEADER_LEN];
+    unsigned char trailer[ARCHIVE_TRAILER_LEN];
+    struct stat info;
+    off_t end;
+
+    archive->fd = fileno(fpIn);
+    archive->base = ftello(fpIn);
+
+    if ((archive->base < 0) || (0 != fstat(archive->fd, &info)) ||
+        (0 != ReadAt(archive->fd, header, ARCHIVE_HEADER_LEN,
+        archive->base)) ||
+        (info.st_size < (archive->base + ARCHIVE_HEADER_LEN +
+        ARCHIVE_TRAILER_LEN)) ||
+        (0 != ReadAt(archive->fd, trailer, ARCHIVE_TRAILER_LEN,
+        info.st_size - ARCHIVE_TRAILER_LEN)))
+    {
+        return -1;
+    }
+
+    archive->blockSize = GET_LE32(header + 8);
+    archive->flags = header[5];
+    archive->directory = GetOffset(trailer);
+    archive->count = GET_LE32(trailer + 8);
+    archive->slots = GET_LE32(trailer + 12);
+    archive->namesLen = GET_LE32(trailer + 16);
+    end = archive->directory + (off_t)(archive->count * ARCHIVE_ENTRY_LEN) +
+        (off_t)(archive->slots * 4) + (off_t)archive->namesLen +
+        ARCHIVE_TRAILER_LEN;
+
+    /* the sections must exactly fill the file */
+    if ((0 != memcmp(header, ARCHIVE_MAGIC, BLOCK_MAGIC_LEN)) ||
+        (ARCHIVE_VERSION != header[4]) ||
+        (0 != (archive->flags & ~ARCHIVE_FLAG_SHARED)) ||
+        (0 != memcmp(trailer + 20, ARCHIVE_MAGIC, BLOCK_MAGIC_LEN)) ||
+        (0 == archive->blockSize) || (archive->blockSize > BLOCK_MAX_SIZE) ||
+        (archive->count > MAX_MEMBERS) ||
+        (0 == archive->slots) || (archive->slots < archive->count) ||
+        (0 != (archive->slots & (archive->slots - 1))) ||
+        (archive->directory < ARCHIVE_HEADER_LEN) ||
+        (end != (info.st_size - archive->base)))
+    {
+        errno = EILSEQ;
+        return -1;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : ReadEntry
+*   Description: This routine reads and checks a member's directory entry.
+*   Parameters : archive - open archive
+*                index - index of the member
+*                entry - receives the entry
+*   Effects    : None
+*   Returned   : 0 for success, -1 for failure.  errno is set to ENOENT for
+*                an index past the last member and EILSEQ for an entry that
+*                lies outside the archive.
+***************************************************************************/
+static int ReadEntry(lzw_archive_t *archive, const size_t index,
+    entry_t *entry)
+{
+    unsigned char buf[ARCHIVE_ENTRY_LEN];
+
+    if (index >= archive->count)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (0 != ReadAt(archive->fd, buf, ARCHIVE_ENTRY_LEN, archive->base +
+        archive->directory + (off_t)(index * ARCHIVE_ENTRY_LEN)))
+    {
+        return -1;
+    }
+
+    entry->offset = GetOffset(buf);
+    entry->size = GetOffset(buf + 8);
+    entry->codedSize = GetOffset(buf + 16);
+    entry->nameOffset = GET_LE32(buf + 24);
+    entry->nameLen = GET_LE32(buf + 28);
+
+    if ((entry->offset < ARCHIVE_HEADER_LEN) || (entry->size < 0) ||
+        (entry->codedSize < 0) ||
+        (entry->codedSize > (archive->directory - entry->offset)) ||
+        (entry->nameOffset > archive->namesLen) ||
+        (entry->nameLen > (archive->namesLen - entry->nameOffset)))
+    {
+        errno = EILSEQ;
+        return -1;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : ReadName
+*   Description: This routine reads a member's name into the archive's name
+*                buffer and NUL terminates it.
+*   Parameters : archive - open archive
+*                entry - the member's directory entry
+*   Effects    : archive->name holds the name
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+static int ReadName(lzw_archive_t *archive, const entry_t *entry)
+{
+    char *grown;
+
+    if (archive->nameSize <= entry->nameLen)
+    {
+        grown = realloc(archive->name, entry->nameLen + 1);
+
+        if (NULL == grown)
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+
+        archive->name = grown;
+        archive->nameSize = entry->nameLen + 1;
+    }
+
+    if (0 != ReadAt(archive->fd, archive->name, entry->nameLen,
+        archive->base + archive->directory +
+        (off_t)(archive->count * ARCHIVE_ENTRY_LEN) +
+        (off_t)(archive->slots * 4) + (off_t)entry->nameOffset))
+    {
+        return -1;
+    }
+
+    archive->name[entry->nameLen] = '\0';
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : ReadAt
+*   Description: This routine reads len bytes at an offset in a file,
+*                retrying short reads.
+*   Parameters : fd - file to read
+*                buf - receives the data
+*                len - number of bytes to read
+*                offset - offset to read from
+*   Effects    : buf is filled
+*   Returned   : 0 for success, -1 for failure.  errno is set to EILSEQ if
+*                the file ends first.
+***************************************************************************/
+static int ReadAt(const int fd, void *buf, const size_t len,
+    const off_t offset)
+{
+    size_t done;
+    ssize_t result;
+
+    done = 0;
+
+    while (done < len)
+    {
+        result = pread(fd, (unsigned char *)buf + done, len - done,
+            offset + (off_t)done);
+
+        if (result < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+
+            return -1;
+        }
+
+        if (0 == result)
+        {
+            errno = EILSEQ;     /* truncated archive */
+            return -1;
+        }
+
+        done += (size_t)result;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : HashName
+*   Description: This routine computes the 32 bit FNV-1a hash of a member
+*                name.
+*   Parameters : name - the name (need not be NUL terminated)
+*                len - bytes in name
+*   Effects    : None
+*   Returned   : The hash
+***************************************************************************/
+static unsigned long HashName(const char *name, const size_t len)
+{
+    unsigned long hash;
+    size_t i;
+
+    hash = FNV_OFFSET;
+
+    for (i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)name[i];
+        hash = (hash * FNV_PRIME) & 0xFFFFFFFFUL;
+    }
+
+    return hash;
+}
+
+/***************************************************************************
+*   Function   : PutOffset
+*   Description: This routine writes a file offset or size as a 64 bit
+*                little endian value.
+*   Parameters : p - receives 8 bytes
+*                value - value to write
+*   Effects    : p is filled
+*   Returned   : None
+***************************************************************************/
+static void PutOffset(unsigned char *p, const off_t value)
+{
+    PUT_LE32(p, (unsigned long)(value & 0xFFFFFFFFUL));
+
+    /* two shifts keep this valid where off_t has 32 bits */
+    PUT_LE32(p + 4, (unsigned long)((value >> 16) >> 16));
+}
+
+/***************************************************************************
+*   Function   : GetOffset
+*   Description: This routine reads a 64 bit little endian file offset or
+*                size.
+*   Parameters : p - 8 bytes holding the value
+*   Effects    : None
+*   Returned   : The value
+***************************************************************************/
+static off_t GetOffset(const unsigned char *p)
+{
+    return (off_t)GET_LE32(p) | (((off_t)GET_LE32(p + 4) << 16) << 16);
+}
@@ -0,0 +1,1279 @@
+/***************************************************************************
+*                 Lempel-Ziv-Welch Batch Encoding Functions
+*
+*   File    : lzwbatch.c
+*   Purpose : Provides a function that encodes a batch of files into block
+*             streams using a work-stealing pool of threads.  Files that
+*             fit in a single block are encoded whole, larger files are
+*             split into blocks, and idle threads steal unstarted files or
+*             the remaining blocks of a file that another thread is
+*             encoding.  Also provides a function that trains a shared
+*             dictionary from samples of a batch of files, and one that
+*             decodes a batch of files on a pool of threads.
+*   Author  : The lzw library contributors
+*   Date    : October 17, 2026
+*
+****************************************************************************
+*
+* LZW: An ANSI C Lempel-Ziv-Welch Encoding/Decoding Routines
+* Copyright (C) 2026 by
+* The lzw library contributors
+*
+* This file is part of the lzw library.
+*
+* The lzw library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The lzw library is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "lzw.h"
+#include "lzwlocal.h"
+#include "lzwpool.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+/***************************************************************************
+* Tasks are ranges that are split lazily: a thread running a range pushes
+* everything after the first entry back onto its deque before working on
+* the first entry.  A deque never holds more than one range of files and
+* one range of blocks from the file being split.  A range of blocks that
+* would run too far ahead of its file's writer is parked in the file, and
+* the worker that writes the block it waits on pushes it back; that worker
+* holds no other range of blocks, because the file's only range is parked.
+***************************************************************************/
+#define DEQUE_SIZE      2
+
+/* pieces sampled from each file, spread evenly across the file */
+#define SAMPLE_PIECES   4
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* a file larger than one block that is being encoded a block at a time */
+typedef struct
+{
+    lzw_batch_item_t *item;     /* batch entry for this file */
+    int fdIn;                   /* file being encoded */
+    FILE *fpOut;                /* block stream being written */
+    off_t size;                 /* bytes in the input file */
+    size_t numBlocks;           /* blocks in the input file */
+    size_t window;              /* blocks started ahead of nextWrite */
+
+    pthread_mutex_t lock;       /* protects everything below */
+    size_t nextWrite;           /* index of the next block to write */
+    size_t completed;           /* blocks encoded (or failed) so far */
+    size_t parked;              /* first block of a parked range, or 0 */
+    unsigned char **waiting;    /* ring of blocks waiting to be written */
+    size_t *waitingLen;         /* lengths of the waiting blocks */
+    int error;                  /* errno value of the first failure */
+} split_file_t;
+
+typedef enum
+{
+    TASK_FILES,                 /* encode files first through last - 1 */
+    TASK_BLOCKS                 /* encode blocks first through last - 1 */
+} task_kind_t;
+
+typedef struct
+{
+    task_kind_t kind;
+    split_file_t *file;         /* file being split (TASK_BLOCKS only) */
+    size_t first;               /* first file or block in the range */
+    size_t last;                /* one past the last file or block */
+} task_t;
+
+/* tasks owned by a thread.  tasks[0] is the oldest. */
+typedef struct
+{
+    pthread_mutex_t lock;       /* protects tasks and count */
+    task_t tasks[DEQUE_SIZE];
+    unsigned int count;
+} deque_t;
+
+struct batch_t;
+
+/* a thread and the buffers it uses */
+typedef struct
+{
+    struct batch_t *batch;      /* batch being encoded */
+    unsigned int id;            /* 0 .. threads - 1 */
+    pthread_t thread;           /* thread 0 is the calling thread */
+    deque_t deque;              /* tasks other threads may steal */
+    lzw_encoder_t *encoder;     /* this thread's encoder */
+    unsigned char *in;          /* one block of input */
+    unsigned char *out;         /* one prefixed block of encoded output */
+} batch_worker_t;
+
+/* state shared by all threads */
+typedef struct batch_t
+{
+    lzw_batch_item_t *items;    /* files to encode */
+    size_t blockSize;           /* uncompressed bytes in each block */
+    unsigned int threads;       /* number of workers */
+    unsigned int window;        /* blocks of a file started ahead of its
+                                   next block to write */
+    batch_worker_t *workers;    /* array of workers */
+    unsigned long outstanding;  /* tasks queued or running (atomic) */
+    lzw_dictionary_t *dictionary;   /* shared dictionary or NULL */
+    int pin;                    /* pin threads other than the caller */
+} batch_t;
+
+/* one file being sampled by LZWTrainDictionary */
+typedef struct
+{
+    lzw_job_t job;              /* job sampling this file (must be first) */
+    const char *name;           /* file to sample */
+    unsigned char *buf;         /* receives the file's samples */
+    size_t size;                /* bytes available in buf */
+    size_t len;                 /* bytes sampled */
+} sample_job_t;
+
+/* one file being decoded by LZWDecodeBatch */
+typedef struct
+{
+    lzw_job_t job;              /* job decoding this file (must be first) */
+    lzw_batch_item_t *item;     /* batch entry for this file */
+    const lzw_params_t *params; /* validated parameters for the batch */
+} decode_job_t;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+static void *WorkerMain(void *arg);
+static void PushTask(batch_worker_t *worker, const task_t *task);
+static int PopTask(batch_worker_t *worker, task_t *task);
+static int StealTask(batch_worker_t *worker, task_t *task);
+static void RunTask(batch_worker_t *worker, const task_t *task);
+
+static void EncodeFile(batch_worker_t *worker, lzw_batch_item_t *item);
+static int EncodeWholeFile(batch_worker_t *worker, lzw_batch_item_t *item,
+    const int fdIn, const size_t size);
+static split_file_t *SplitFile(batch_worker_t *worker,
+    lzw_batch_item_t *item, const int fdIn, const off_t size);
+static void EncodeFileBlock(batch_worker_t *worker, split_file_t *file,
+    const size_t block);
+static int ParkBlocks(split_file_t *file, const size_t first);
+static void FinishFileBlock(batch_worker_t *worker, split_file_t *file,
+    const size_t block, const unsigned char *out, const size_t outLen,
+    const int error);
+static void CloseSplitFile(split_file_t *file);
+
+static int EncodeBlock(batch_worker_t *worker, const size_t inLen,
+    size_t *outLen);
+static int ReadFully(const int fd, unsigned char *buf, const size_t len,
+    const off_t offset);
+
+static void SampleFileJob(lzw_job_t *job, lzw_worker_t *worker);
+static void DecodeFileJob(lzw_job_t *job, lzw_worker_t *worker);
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : LZWEncodeBatch
+*   Description: This routine encodes each file in a batch into a block
+*                stream, using a pool of threads with work stealing.  Each
+*                thread starts with an equal share of the files.  A file
+*                that fits in one block is encoded whole by one thread.
+*                A larger file is encoded a block at a time, and threads
+*                that run out of work steal its remaining blocks, so a
+*                single large file doesn't leave the other threads idle.
+*                Blocks are written in order, and each output is identical
+*                to the output of LZWEncodeFileParallel with the same block
+*                size.
+*   Parameters : items - array of files to encode.  Each entry's error
+*                        is set to 0 or the errno value for its failure.
+*                count - number of entries in items
+*                params - block-parallel parameters (NULL for defaults).
+*                         No file has more than maxInFlight encoded
+*                         blocks started ahead of its next block to be
+*                         written.  sampleSize is not used.  If
+*                         dictionary is set, every file is encoded with
+*                         that shared dictionary.  If pinThreads is set,
+*                         every thread but the calling thread is pinned
+*                         to its own core.
+*   Effects    : Each input file is encoded and written to its output file
+*   Returned   : 0 if every file was encoded, otherwise -1 with errno set
+*                to the error of the first file that failed.
+***************************************************************************/
+int LZWEncodeBatch(lzw_batch_item_t *items, const size_t count,
+    const lzw_params_t *params)
+{
+    lzw_params_t valid;         /* params with defaults filled in */
+    batch_t batch;
+    batch_worker_t *worker;
+    task_t task;
+    unsigned int i, started;
+    size_t f;
+    int result;
+
+    /* validate arguments */
+    if ((NULL == items) && (0 != count))
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (0 != LZWValidateParams(params, &valid, 0))
+    {
+        return -1;
+    }
+
+    batch.items = items;
+    batch.blockSize = valid.blockSize;
+    batch.threads = valid.threads;
+    batch.window = valid.maxInFlight;
+    batch.outstanding = 0;
+    batch.dictionary = valid.dictionary;
+    batch.pin = valid.pinThreads;
+    batch.workers = calloc(valid.threads, sizeof(batch_worker_t));
+
+    if (NULL == batch.workers)
+    {
+        return -1;
+    }
+
+    result = 0;
+
+    for (i = 0; i < valid.threads; i++)
+    {
+        worker = &batch.workers[i];
+        worker->batch = &batch;
+        worker->id = i;
+        pthread_mutex_init(&worker->deque.lock, NULL);
+        worker->deque.count = 0;
+        worker->encoder = LZWMakeEncoder();
+        worker->in = LZWAlloc(LZW_MEM_IO, valid.blockSize);
+        worker->out = LZWAlloc(LZW_MEM_IO, BLOCK_PREFIX_LEN +
+            LZWEncodeBound(valid.blockSize));
+
+        if ((NULL == worker->encoder) || (NULL == worker->in) ||
+            (NULL == worker->out))
+        {
+            result = -1;
+        }
+
+        /* give each thread an equal share of the files */
+        task.kind = TASK_FILES;
+        task.file = NULL;
+        task.first = (count / valid.threads) * i;
+        task.last = (count / valid.threads) * (i + 1);
+
+        if (i == valid.threads - 1)
+        {
+            task.last = count;
+        }
+
+        if (task.first < task.last)
+        {
+            PushTask(worker, &task);
+        }
+    }
+
+    if (0 == result)
+    {
+        /* this thread is worker 0 */
+        for (started = 1; started < valid.threads; started++)
+        {
+            result = pthread_create(&batch.workers[started].thread, NULL,
+                WorkerMain, &batch.workers[started]);
+
+            if (0 != result)
+            {
+                /* the threads that did start steal the unstarted shares */
+                break;
+            }
+        }
+
+        WorkerMain(&batch.workers[0]);
+
+        for (i = 1; i < started; i++)
+        {
+            pthread_join(batch.workers[i].thread, NULL);
+        }
+
+        result = 0;
+    }
+    else
+    {
+        errno = ENOMEM;
+    }
+
+    for (i = 0; i < valid.threads; i++)
+    {
+        worker = &batch.workers[i];
+        LZWFreeEncoder(worker->encoder);
+        LZWRelease(worker->in);
+        LZWRelease(worker->out);
+        pthread_mutex_destroy(&worker->deque.lock);
+    }
+
+    free(batch.workers);
+
+    if (0 != result)
+    {
+        return -1;
+    }
+
+    for (f = 0; f < count; f++)
+    {
+        if (0 != items[f].error)
+        {
+            errno = items[f].error;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : LZWTrainDictionary
+*   Description: This routine builds a frozen dictionary for a set of
+*                similar files, so that they may be encoded independently
+*                (and in parallel) with close to the ratio of encoding them
+*                as one stream.  Each file contributes an equal share of
+*                the sample, taken from SAMPLE_PIECES places spread evenly
+*                across the file.  Files are read in parallel on a pool of
+*                threads, and their samples are joined in the order the
+*                files are listed, so the same files always train the same
+*                dictionary.  Files that can't be read are skipped; the
+*                error is reported when they are encoded.
+*   Parameters : names - names of the files to sample
+*                count - number of entries in names
+*                params - block-parallel parameters (NULL for defaults).
+*                         sampleSize is the total size of the sample
+*                         (0 = LZW_DEFAULT_SAMPLE_SIZE).
+*   Effects    : Memory is allocated for the dictionary
+*   Returned   : Pointer to the new dictionary or NULL on error.  errno will
+*                be set on an error.
+***************************************************************************/
+lzw_dictionary_t *LZWTrainDictionary(const char *const names[],
+    const size_t count, const lzw_params_t *params)
+{
+    lzw_params_t valid;         /* params with defaults filled in */
+    lzw_dictionary_t *dictionary;
+    lzw_pool_t *pool;
+    sample_job_t *jobs;
+    unsigned char *sample;
+    size_t sampleSize, share, sampleLen, i;
+
+    /* validate arguments */
+    if ((NULL == names) && (0 != count))
+    {
+        errno = ENOENT;
+        return NULL;
+    }
+
+    if (0 != LZWValidateParams(params, &valid, 0))
+    {
+        return NULL;
+    }
+
+    sampleSize = (0 == valid.sampleSize) ? LZW_DEFAULT_SAMPLE_SIZE :
+        valid.sampleSize;
+    share = (0 == count) ? 0 : (sampleSize / count);
+
+    if ((0 == share) && (0 != count))
+    {
+        share = 1;              /* more files than sample bytes */
+    }
+
+    jobs = calloc((0 == count) ? 1 : count, sizeof(sample_job_t));
+    sample = LZWAlloc(LZW_MEM_IO, (share * count) + 1);
+    pool = NULL;
+
+    if ((NULL == jobs) || (NULL == sample) ||
+        (NULL == (pool = LZWMakePool(valid.threads, valid.pinThreads))))
+    {
+        free(jobs);
+        LZWRelease(sample);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        jobs[i].job.run = SampleFileJob;
+        jobs[i].name = names[i];
+        jobs[i].buf = sample + (i * share);
+        jobs[i].size = share;
+        LZWPoolSubmit(pool, &jobs[i].job);
+    }
+
+    /* waits for every file to be sampled */
+    LZWFreePool(pool);
+
+    /* close the gaps left by files smaller than their share */
+    sampleLen = 0;
+
+    for (i = 0; i < count; i++)
+    {
+        memmove(sample + sampleLen, jobs[i].buf, jobs[i].len);
+        sampleLen += jobs[i].len;
+    }
+
+    dictionary = LZWMakeDictionary(sample, sampleLen);
+    LZWRelease(sample);
+    free(jobs);
+    return dictionary;
+}
+
+/***************************************************************************
+*   Function   : SampleFileJob
+*   Description: This routine is run by a pool worker.  It reads a file's
+*                share of a training sample.  A file no larger than its
+*                share is used whole, otherwise SAMPLE_PIECES pieces are
+*                read from evenly spaced offsets, the last ending at the
+*                end of the file.
+*   Parameters : job - job embedded in a sample_job_t
+*                worker - worker running the job (unused)
+*   Effects    : The job's buffer is filled and its length set.  The length
+*                is 0 if the file can't be read.
+*   Returned   : None
+***************************************************************************/
+static void SampleFileJob(lzw_job_t *job, lzw_worker_t *worker)
+{
+    sample_job_t *sampleJob;
+    struct stat info;
+    size_t pieceLen, len;
+    off_t stride, offset;
+    unsigned int i;
+    int fd;
+
+    (void)worker;
+    sampleJob = (sample_job_t *)job;
+    sampleJob->len = 0;
+    fd = open(sampleJob->name, O_RDONLY);
+
+    if (fd < 0)
+    {
+        return;
+    }
+
+    if ((0 == fstat(fd, &info)) && S_ISREG(info.st_mode))
+    {
+        if (info.st_size <= (off_t)sampleJob->size)
+        {
+            len = (size_t)info.st_size;
+
+            if (0 == ReadFully(fd, sampleJob->buf, len, 0))
+            {
+                sampleJob->len = len;
+            }
+        }
+        else
+        {
+            pieceLen = sampleJob->size / SAMPLE_PIECES;
+            stride = info.st_size / SAMPLE_PIECES;
+
+            for (i = 0; i < SAMPLE_PIECES; i++)
+            {
+                /* the last piece also takes the remainder of the share */
+                len = (SAMPLE_PIECES - 1 == i) ?
+                    (sampleJob->size - sampleJob->len) : pieceLen;
+
+                offset = (SAMPLE_PIECES - 1 == i) ?
+                    (info.st_size - (off_t)len) : ((off_t)i * stride);
+
+                if (0 != ReadFully(fd, sampleJob->buf + sampleJob->len, len,
+                    offset))
+                {
+                    break;
+                }
+
+                sampleJob->len += len;
+            }
+        }
+    }
+
+    close(fd);
+}
+
+/***************************************************************************
+*   Function   : LZWDecodeBatch
+*   Description: This routine decodes each file in a batch, using a pool
+*                of threads that each decode one file at a time.  Block
+*                streams and single streams may be mixed; each file is
+*                decoded the way its header calls for.  Files are handed
+*                to threads in the order they are listed, so a batch that
+*                lists its largest files first finishes soonest.
+*   Parameters : items - array of files to decode.  Each entry's error
+*                        is set to 0 or the errno value for its failure.
+*                count - number of entries in items
+*                params - block-parallel parameters (NULL for defaults).
+*                         threads is the number of files decoded at once.
+*                         dictionary must be set to decode files encoded
+*                         with a shared dictionary.  If pinThreads is set,
+*                         every thread is pinned to its own core.
+*   Effects    : Each input file is decoded and written to its output file
+*   Returned   : 0 if every file was decoded, otherwise -1 with errno set
+*                to the error of the first file that failed.
+***************************************************************************/
+int LZWDecodeBatch(lzw_batch_item_t *items, const size_t count,
+    const lzw_params_t *params)
+{
+    lzw_params_t valid;         /* params with defaults filled in */
+    lzw_pool_t *pool;
+    decode_job_t *jobs;
+    size_t i;
+
+    /* validate arguments */
+    if ((NULL == items) && (0 != count))
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (0 != LZWValidateParams(params, &valid, 0))
+    {
+        return -1;
+    }
+
+    jobs = calloc((0 == count) ? 1 : count, sizeof(decode_job_t));
+    pool = NULL;
+
+    if ((NULL == jobs) ||
+        (NULL == (pool = LZWMakePool(valid.threads, valid.pinThreads))))
+    {
+        free(jobs);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        jobs[i].job.run = DecodeFileJob;
+        jobs[i].item = &items[i];
+        jobs[i].params = &valid;
+        LZWPoolSubmit(pool, &jobs[i].job);
+    }
+
+    /* waits for every file to be decoded */
+    LZWFreePool(pool);
+    free(jobs);
+
+    for (i = 0; i < count; i++)
+    {
+        if (0 != items[i].error)
+        {
+            errno = items[i].error;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : DecodeFileJob
+*   Description: This routine is run by a pool worker.  It decodes one
+*                file of a batch with LZWDecodeFileOnWorker, on the
+*                worker's own decoder, since the pool's other workers are
+*                already busy with other files.
+*   Parameters : job - job embedded in a decode_job_t
+*                worker - worker running the job
+*   Effects    : The file is decoded and the item's error is set
+*   Returned   : None
+***************************************************************************/
+static void DecodeFileJob(lzw_job_t *job, lzw_worker_t *worker)
+{
+    decode_job_t *decodeJob;
+    lzw_batch_item_t *item;
+    FILE *fpIn, *fpOut;
+
+    decodeJob = (decode_job_t *)job;
+    item = decodeJob->item;
+    item->error = 0;
+    fpOut = NULL;
+    fpIn = fopen(item->inName, "rb");
+
+    if ((NULL == fpIn) || (NULL == (fpOut = fopen(item->outName, "wb"))))
+    {
+        item->error = errno;
+
+        if (NULL != fpIn)
+        {
+            fclose(fpIn);
+        }
+
+        return;
+    }
+
+    if (0 != LZWDecodeFileOnWorker(fpIn, fpOut, worker, decodeJob->params))
+    {
+        item->error = (0 == errno) ? EILSEQ : errno;
+    }
+
+    fclose(fpIn);
+
+    if ((0 != fclose(fpOut)) && (0 == item->error))
+    {
+        item->error = errno;
+    }
+}
+
+/***************************************************************************
+*   Function   : WorkerMain
+*   Description: This is the thread function for batch workers.  It runs
+*                tasks from its own deque, newest first, and steals the
+*                oldest task from another worker when its deque is empty.
+*                It returns once no tasks are queued or running.  Pinned
+*                workers bind themselves to a core first, so their
+*                buffers and dictionary pages are first touched there.
+*                Worker 0 is the caller's thread and is never pinned.
+*   Parameters : arg - pointer to this thread's batch_worker_t
+*   Effects    : Runs tasks
+*   Returned   : NULL
+***************************************************************************/
+static void *WorkerMain(void *arg)
+{
+    batch_worker_t *worker;
+    task_t task;
+
+    worker = (batch_worker_t *)arg;
+
+    if (worker->batch->pin && (0 != worker->id))
+    {
+        /* a hint: workers that can't be pinned still run tasks */
+        LZWPinThread(worker->id);
+    }
+
+    while (1)
+    {
+        if (PopTask(worker, &task) || StealTask(worker, &task))
+        {
+            RunTask(worker, &task);
+            ATOMIC_SUB(&worker->batch->outstanding, 1);
+        }
+        else if (0 == ATOMIC_LOAD(&worker->batch->outstanding))
+        {
+            break;
+        }
+        else
+        {
+            /* another thread may still push work */
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+/***************************************************************************
+*   Function   : PushTask
+*   Description: This routine adds a task to the newest end of a worker's
+*                deque.
+*   Parameters : worker - worker owning the deque
+*                task - task to add
+*   Effects    : task is copied to the deque
+*   Returned   : None
+***************************************************************************/
+static void PushTask(batch_worker_t *worker, const task_t *task)
+{
+    deque_t *deque;
+
+    deque = &worker->deque;
+    ATOMIC_ADD(&worker->batch->outstanding, 1);
+
+    pthread_mutex_lock(&deque->lock);
+    deque->tasks[deque->count] = *task;
+    deque->count++;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+/***************************************************************************
+*   Function   : PopTask
+*   Description: This routine removes the newest task from a worker's own
+*                deque, so a worker finishes splitting a file before it
+*                starts on another.
+*   Parameters : worker - worker owning the deque
+*                task - receives the task
+*   Effects    : task is removed from the deque
+*   Returned   : 1 if a task was removed, 0 if the deque was empty.
+***************************************************************************/
+static int PopTask(batch_worker_t *worker, task_t *task)
+{
+    deque_t *deque;
+    int found;
+
+    deque = &worker->deque;
+    found = 0;
+
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->count > 0)
+    {
+        deque->count--;
+        *task = deque->tasks[deque->count];
+        found = 1;
+    }
+
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+/***************************************************************************
+*   Function   : StealTask
+*   Description: This routine removes the oldest task from the deque of
+*                another worker.  Files that haven't been started are
+*                stolen before the blocks of a file that has.
+*   Parameters : worker - worker looking for work
+*                task - receives the task
+*   Effects    : task is removed from another worker's deque
+*   Returned   : 1 if a task was stolen, 0 if every deque was empty.
+***************************************************************************/
+static int StealTask(batch_worker_t *worker, task_t *task)
+{
+    batch_t *batch;
+    deque_t *deque;
+    unsigned int i;
+    int found;
+
+    batch = worker->batch;
+    found = 0;
+
+    for (i = 1; (i < batch->threads) && !found; i++)
+    {
+        deque = &batch->workers[(worker->id + i) % batch->threads].deque;
+
+        pthread_mutex_lock(&deque->lock);
+
+        if (deque->count > 0)
+        {
+            *task = deque->tasks[0];
+            deque->count--;
+            memmove(&deque->tasks[0], &deque->tasks[1],
+                deque->count * sizeof(task_t));
+            found = 1;
+        }
+
+        pthread_mutex_unlock(&deque->lock);
+    }
+
+    return found;
+}
+
+/***************************************************************************
+*   Function   : RunTask
+*   Description: This routine runs the first file or block of a task's
+*                range after pushing the rest of the range where idle
+*                workers may steal it.  A range of blocks that is too far
+*                ahead of its file's writer is parked instead, leaving the
+*                worker free to take other files' work.
+*   Parameters : worker - worker running the task
+*                task - task to run
+*   Effects    : A file or block is encoded
+*   Returned   : None
+***************************************************************************/
+static void RunTask(batch_worker_t *worker, const task_t *task)
+{
+    task_t rest;
+
+    if ((TASK_BLOCKS == task->kind) && ParkBlocks(task->file, task->first))
+    {
+        /* FinishFileBlock pushes the range again when the window moves */
+        return;
+    }
+
+    if (task->last - task->first > 1)
+    {
+        rest = *task;
+        rest.first++;
+        PushTask(worker, &rest);
+    }
+
+    if (TASK_FILES == task->kind)
+    {
+        EncodeFile(worker, &worker->batch->items[task->first]);
+    }
+    else
+    {
+        EncodeFileBlock(worker, task->file, task->first);
+    }
+}
+
+/***************************************************************************
+*   Function   : EncodeFile
+*   Description: This routine starts encoding a file.  Files that fit in a
+*                single block are encoded completely.  Larger files are
+*                split, and their first block is encoded.
+*   Parameters : worker - worker encoding the file
+*                item - batch entry for the file
+*   Effects    : item's output file is written and item->error is set, or
+*                the file's remaining blocks are pushed to worker's deque.
+*   Returned   : None
+***************************************************************************/
+static void EncodeFile(batch_worker_t *worker, lzw_batch_item_t *item)
+{
+    split_file_t *file;
+    struct stat info;
+    task_t rest;
+    int fdIn;
+
+    item->error = 0;
+    fdIn = open(item->inName, O_RDONLY);
+
+    if (fdIn < 0)
+    {
+        item->error = errno;
+        return;
+    }
+
+    if (0 != fstat(fdIn, &info))
+    {
+        item->error = errno;
+        close(fdIn);
+        return;
+    }
+
+    if (info.st_size <= (off_t)worker->batch->blockSize)
+    {
+        if (0 != EncodeWholeFile(worker, item, fdIn, (size_t)info.st_size))
+        {
+            item->error = (0 == errno) ? EIO : errno;
+        }
+
+        close(fdIn);
+        return;
+    }
+
+    file = SplitFile(worker, item, fdIn, info.st_size);
+
+    if (NULL == file)
+    {
+        item->error = (0 == errno) ? EIO : errno;
+        close(fdIn);
+        return;
+    }
+
+    rest.kind = TASK_BLOCKS;
+    rest.file = file;
+    rest.first = 0;
+    rest.last = file->numBlocks;
+    RunTask(worker, &rest);
+}
+
+/***************************************************************************
+*   Function   : EncodeWholeFile
+*   Description: This routine encodes a file that fits in one block.
+*   Parameters : worker - worker encoding the file
+*                item - batch entry for the file
+*                fdIn - open input file
+*                size - bytes in the input file (<= block size)
+*   Effects    : item's output file is written
+*   Returned   : 0 for success, -1 for failure.
+***************************************************************************/
+static int EncodeWholeFile(batch_worker_t *worker, lzw_batch_item_t *item,
+    const int fdIn, const size_t size)
+{
+    FILE *fpOut;
+    size_t outLen;
+    int result;
+
+    if (0 != ReadFully(fdIn, worker->in, size, 0))
+    {
+        return -1;
+    }
+
+    fpOut = fopen(item->outName, "wb");
+
+    if (NULL == fpOut)
+    {
+        return -1;
+    }
+
+    result = LZWWriteStreamHeader(fpOut, worker->batch->blockSize,
+        (NULL == worker->batch->dictionary) ? 0 : BLOCK_FLAG_SHARED,
+        worker->batch->dictionary);
+
+    if ((0 == result) && (size > 0))
+    {
+        result = EncodeBlock(worker, size, &outLen);
+
+        if ((0 == result) &&
+            (fwrite(worker->out, 1, outLen, fpOut) != outLen))
+        {
+            result = -1;
+        }
+    }
+
+    if (0 == result)
+    {
+        result = LZWWriteStreamEnd(fpOut);
+    }
+
+    if ((0 != fclose(fpOut)) && (0 == result))
+    {
+        result = -1;
+    }
+
+    return result;
+}
+
+/***************************************************************************
+*   Function   : SplitFile
+*   Description: This routine creates the state for a file that will be
+*                encoded a block at a time and writes its stream header.
+*   Parameters : worker - worker starting the file
+*                item - batch entry for the file
+*                fdIn - open input file
+*                size - bytes in the input file (> block size)
+*   Effects    : item's output file is created
+*   Returned   : Pointer to the new state, or NULL for failure.
+***************************************************************************/
+static split_file_t *SplitFile(batch_worker_t *worker,
+    lzw_batch_item_t *item, const int fdIn, const off_t size)
+{
+    split_file_t *file;
+    size_t blockSize;
+
+    blockSize = worker->batch->blockSize;
+    file = malloc(sizeof(split_file_t));
+
+    if (NULL == file)
+    {
+        return NULL;
+    }
+
+    file->item = item;
+    file->fdIn = fdIn;
+    file->size = size;
+    file->numBlocks = (size_t)((size + blockSize - 1) / blockSize);
+    file->window = worker->batch->window;
+
+    if (file->window > file->numBlocks)
+    {
+        file->window = file->numBlocks;
+    }
+
+    file->nextWrite = 0;
+    file->completed = 0;
+    file->parked = 0;
+    file->error = 0;
+    file->waiting = calloc(file->window, sizeof(unsigned char *));
+    file->waitingLen = calloc(file->window, sizeof(size_t));
+    file->fpOut = fopen(item->outName, "wb");
+
+    if ((NULL == file->waiting) || (NULL == file->waitingLen) ||
+        (NULL == file->fpOut) ||
+        (0 != LZWWriteStreamHeader(file->fpOut, blockSize,
+            (NULL == worker->batch->dictionary) ? 0 : BLOCK_FLAG_SHARED,
+            worker->batch->dictionary)))
+    {
+        if (NULL != file->fpOut)
+        {
+            fclose(file->fpOut);
+        }
+
+        free(file->waiting);
+        free(file->waitingLen);
+        free(file);
+        return NULL;
+    }
+
+    pthread_mutex_init(&file->lock, NULL);
+    return file;
+}
+
+/***************************************************************************
+*   Function   : EncodeFileBlock
+*   Description: This routine reads and encodes one block of a split file.
+*   Parameters : worker - worker encoding the block
+*                file - file containing the block
+*                block - index of the block in the file
+*   Effects    : The block is written or queued to be written in order
+*   Returned   : None
+***************************************************************************/
+static void EncodeFileBlock(batch_worker_t *worker, split_file_t *file,
+    const size_t block)
+{
+    size_t blockSize, inLen, outLen;
+    off_t offset;
+    int error;
+
+    blockSize = worker->batch->blockSize;
+    offset = (off_t)block * (off_t)blockSize;
+    inLen = blockSize;
+
+    if (file->size - offset < (off_t)blockSize)
+    {
+        inLen = (size_t)(file->size - offset);
+    }
+
+    outLen = 0;
+    error = ATOMIC_LOAD(&file->error);     /* don't waste time on failures */
+
+    if ((0 == error) &&
+        ((0 != ReadFully(file->fdIn, worker->in, inLen, offset)) ||
+        (0 != EncodeBlock(worker, inLen, &outLen))))
+    {
+        error = (0 == errno) ? EIO : errno;
+    }
+
+    FinishFileBlock(worker, file, block, worker->out, outLen, error);
+}
+
+/***************************************************************************
+*   Function   : ParkBlocks
+*   Description: This routine parks a file's remaining range of blocks if
+*                its first block is a full window ahead of the next block
+*                to be written.  Blocks of a file that has failed are never
+*                parked; they are skipped without being encoded.
+*   Parameters : file - file containing the blocks
+*                first - first block of the range (the rest of the file)
+*   Effects    : file->parked may be set
+*   Returned   : 1 if the range was parked, 0 if it may run.
+***************************************************************************/
+static int ParkBlocks(split_file_t *file, const size_t first)
+{
+    int parked;
+
+    pthread_mutex_lock(&file->lock);
+    parked = (0 == file->error) && (first - file->nextWrite >= file->window);
+
+    if (parked)
+    {
+        /* block 0 is never parked, so 0 means no range is parked */
+        file->parked = first;
+    }
+
+    pthread_mutex_unlock(&file->lock);
+    return parked;
+}
+
+/***************************************************************************
+*   Function   : FinishFileBlock
+*   Description: This routine writes an encoded block if it is the next
+*                block of its file, followed by any blocks that were
+*                waiting on it.  Otherwise a copy of the block is kept
+*                until the blocks before it have been written.  A parked
+*                range of blocks is pushed to worker's deque once it fits
+*                in the window.  The worker that finishes a file's last
+*                block closes the file.
+*   Parameters : worker - worker that encoded the block
+*                file - file containing the block
+*                block - index of the block in the file
+*                out - prefixed encoded block
+*                outLen - bytes in out
+*                error - 0 or errno value if encoding the block failed
+*   Effects    : Blocks may be written to the output file
+*   Returned   : None
+***************************************************************************/
+static void FinishFileBlock(batch_worker_t *worker, split_file_t *file,
+    const size_t block, const unsigned char *out, const size_t outLen,
+    const int error)
+{
+    unsigned char **waiting;
+    task_t rest;
+    int last, unpark;
+
+    pthread_mutex_lock(&file->lock);
+
+    if ((0 != error) && (0 == file->error))
+    {
+        ATOMIC_STORE(&file->error, error);
+    }
+
+    if (0 == file->error)
+    {
+        if (block == file->nextWrite)
+        {
+            if (fwrite(out, 1, outLen, file->fpOut) != outLen)
+            {
+                ATOMIC_STORE(&file->error, (0 == errno) ? EIO : errno);
+            }
+
+            file->nextWrite++;
+
+            /* blocks in the window have distinct slots in the ring */
+            waiting = &file->waiting[file->nextWrite % file->window];
+
+            while ((0 == file->error) &&
+                (file->nextWrite < file->numBlocks) && (NULL != *waiting))
+            {
+                if (fwrite(*waiting, 1,
+                    file->waitingLen[file->nextWrite % file->window],
+                    file->fpOut) !=
+                    file->waitingLen[file->nextWrite % file->window])
+                {
+                    ATOMIC_STORE(&file->error, (0 == errno) ? EIO : errno);
+                }
+
+                LZWRelease(*waiting);
+                *waiting = NULL;
+                file->nextWrite++;
+                waiting = &file->waiting[file->nextWrite % file->window];
+            }
+        }
+        else
+        {
+            waiting = &file->waiting[block % file->window];
+            *waiting = LZWAlloc(LZW_MEM_IO, outLen);
+
+            if (NULL == *waiting)
+            {
+                ATOMIC_STORE(&file->error, ENOMEM);
+            }
+            else
+            {
+                memcpy(*waiting, out, outLen);
+                file->waitingLen[block % file->window] = outLen;
+            }
+        }
+    }
+
+    /* a failed file's blocks are skipped, so its range may always run */
+    unpark = (0 != file->parked) && ((0 != file->error) ||
+        (file->parked - file->nextWrite < file->window));
+
+    if (unpark)
+    {
+        rest.kind = TASK_BLOCKS;
+        rest.file = file;
+        rest.first = file->parked;
+        rest.last = file->numBlocks;
+        file->parked = 0;
+    }
+
+    file->completed++;
+    last = (file->completed == file->numBlocks);
+    pthread_mutex_unlock(&file->lock);
+
+    if (unpark)
+    {
+        /* the parked range's blocks aren't finished, so last is 0 */
+        PushTask(worker, &rest);
+    }
+
+    if (last)
+    {
+        /* no other task refers to this file */
+        CloseSplitFile(file);
+    }
+}
+
+/***************************************************************************
+*   Function   : CloseSplitFile
+*   Description: This routine ends the block stream of a split file,
+*                records its result, and frees its state.
+*   Parameters : file - file whose blocks have all been finished
+*   Effects    : Files are closed and file is freed
+*   Returned   : None
+***************************************************************************/
+static void CloseSplitFile(split_file_t *file)
+{
+    size_t i;
+
+    if ((0 == file->error) && (0 != LZWWriteStreamEnd(file->fpOut)))
+    {
+        file->error = (0 == errno) ? EIO : errno;
+    }
+
+    if ((0 != fclose(file->fpOut)) && (0 == file->error))
+    {
+        file->error = (0 == errno) ? EIO : errno;
+    }
+
+    close(file->fdIn);
+    file->item->error = file->error;
+
+    for (i = 0; i < file->window; i++)
+    {
+        /* blocks left waiting after a failure */
+        LZWRelease(file->waiting[i]);
+    }
+
+    pthread_mutex_destroy(&file->lock);
+    free(file->waiting);
+    free(file->waitingLen);
+    free(file);
+}
+
+/***************************************************************************
+*   Function   : EncodeBlock
+*   Description: This routine encodes (or stores) a worker's input buffer
+*                into its output buffer as a prefixed block.
+*   Parameters : worker - worker owning the buffers
+*                inLen - bytes of input (> 0)
+*                outLen - receives the bytes of prefixed output
+*   Effects    : worker's output buffer is filled
+*   Returned   : 0 for success, -1 for failure.
+***************************************************************************/
+static int EncodeBlock(batch_worker_t *worker, const size_t inLen,
+    size_t *outLen)
+{
+    return LZWEncodeBlock(worker->encoder, worker->batch->dictionary,
+        worker->in, inLen, worker->out, outLen);
+}
+
+/***************************************************************************
+*   Function   : ReadFully
+*   Description: This routine reads len bytes from a position in a file.
+*   Parameters : fd - file to read
+*                buf - receives the data
+*                len - number of bytes to read
+*                offset - position of the first byte
+*   Effects    : buf is filled
+*   Returned   : 0 for success, -1 for failure.  errno is set to EIO if
+*                the file ended early (it changed after it was sized).
+***************************************************************************/
+static int ReadFully(const int fd, unsigned char *buf, const size_t len,
+    const off_t offset)
+{
+    size_t total;
+    ssize_t got;
+
+    total = 0;
+
+    while (total < len)
+    {
+        got = pread(fd, buf + total, len - total, offset + (off_t)total);
+
+        if (got < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+
+            return -1;
+        }
+
+        if (0 == got)
+        {
+            errno = EIO;
+            return -1;
+        }
+
+        total += (size_t)got;
+    }
+
+    return 0;
+}
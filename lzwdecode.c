@@ -34,6 +34,8 @@
 *                             INCLUDED FILES
 ***************************************************************************/
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include "lzw.h"
 #include "lzwlocal.h"
@@ -48,28 +50,80 @@ typedef struct
     unsigned int prefixCode;    /* code for remaining chars in string */
 } decode_dictionary_t;
 
+/* decoder context */
+struct lzw_decoder_t
+{
+    /* dictionary of string the code word is the dictionary index */
+    decode_dictionary_t *dictionary;
+    unsigned char *stack;       /* decoded strings are built backwards */
+    unsigned int nextCode;      /* value of next code */
+    unsigned int peakCode;      /* highest nextCode of earlier streams */
+    unsigned int stackLow;      /* lowest start of a string in stack */
+
+    /* state of a stream decoded a chunk at a time */
+    unsigned int lastCode;      /* last code decoded or NO_CODE */
+    unsigned char c;            /* first character of last string */
+    unsigned char codeLen;      /* length of code words now */
+    unsigned long bits;         /* bits of a partial code word */
+    unsigned int bitCount;      /* number of bits in bits */
+
+#ifdef LZW_STATS
+    lzw_stats_t stats;          /* statistics of the current stream */
+#endif
+};
+
+/* bit reader for decoding from memory (same bit order as bitfile) */
+typedef struct
+{
+    const unsigned char *buffer;    /* encoded input */
+    size_t size;                    /* size of buffer */
+    size_t count;                   /* number of bytes read from buffer */
+    unsigned long bits;             /* bits waiting to be read */
+    unsigned int bitCount;          /* number of bits in bits */
+} bit_buffer_t;
+
 /***************************************************************************
 *                                CONSTANTS
 ***************************************************************************/
+#define STACK_SIZE      MAX_CODES   /* longer than the longest string */
+#define NO_CODE         MAX_CODES   /* no code has been decoded yet */
 
 /***************************************************************************
 *                                  MACROS
 ***************************************************************************/
+/* statistics gathering, compiled out unless LZW_STATS is defined */
+#ifdef LZW_STATS
+#define STATS_RESET(decoder)    memset(&(decoder)->stats, 0,                \
+                                    sizeof((decoder)->stats))
+#define STATS_CODE(decoder, len)    ((decoder)->stats.codes++,              \
+                                    (decoder)->stats.widths[(len)]++)
+#define STATS_ESCAPE(decoder)   ((decoder)->stats.escapes++)
+#define STATS_KWKWK(decoder)    ((decoder)->stats.kwkwk++)
+#define STATS_BYTES(decoder, n) ((decoder)->stats.bytes += (n))
+#define STATS_FULL(decoder)     ((decoder)->stats.fullAt =                  \
+                                    (decoder)->stats.bytes)
+#else
+#define STATS_RESET(decoder)        ((void)0)
+#define STATS_CODE(decoder, len)    ((void)0)
+#define STATS_ESCAPE(decoder)       ((void)0)
+#define STATS_KWKWK(decoder)        ((void)0)
+#define STATS_BYTES(decoder, n)     ((void)0)
+#define STATS_FULL(decoder)         ((void)0)
+#endif
 
 /***************************************************************************
 *                            GLOBAL VARIABLES
 ***************************************************************************/
 
-/* dictionary of string the code word is the dictionary index */
-static decode_dictionary_t dictionary[(MAX_CODES - FIRST_CODE)];
-
 /***************************************************************************
 *                               PROTOTYPES
 ***************************************************************************/
-static unsigned char DecodeRecursive(unsigned int code, FILE *fpOut);
+static unsigned int DecodeString(lzw_decoder_t *decoder, unsigned int code);
+static void EmptyDictionary(lzw_decoder_t *decoder);
 
 /* read encoded data */
 static int GetCodeWord(bit_file_t *bfpIn, const unsigned char codeLen);
+static int BufferGetCodeWord(bit_buffer_t *in, const unsigned char codeLen);
 
 /***************************************************************************
 *                                FUNCTIONS
@@ -90,12 +144,14 @@ static int GetCodeWord(bit_file_t *bfpIn, const unsigned char codeLen);
 int LZWDecodeFile(FILE *fpIn, FILE *fpOut)
 {
     bit_file_t *bfpIn;                  /* encoded input */
+    lzw_decoder_t *decoder;             /* dictionary and next code */
 
-    unsigned int nextCode;              /* value of next code */
     unsigned int lastCode;              /* last decoded code word */
     unsigned int code;                  /* code word to decode */
     unsigned char currentCodeLen;       /* length of code words now */
     unsigned char c;                    /* last decoded character */
+    unsigned int start;                 /* start of string in stack */
+    int result;
 
     /* validate arguments */
     if ((NULL == fpIn) || (NULL == fpOut))
@@ -104,23 +160,39 @@ int LZWDecodeFile(FILE *fpIn, FILE *fpOut)
         return -1;
     }
 
+    decoder = LZWMakeDecoder();
+
+    if (NULL == decoder)
+    {
+        perror("Making Dictionary");
+        return -1;
+    }
+
     /* convert input file to bitfile */
     bfpIn = MakeBitFile(fpIn, BF_READ);
 
     if (NULL == bfpIn)
     {
         perror("Making Input File a BitFile");
+        LZWFreeDecoder(decoder);
         return -1;
     }
 
     /* start MIN_CODE_LEN bit code words */
     currentCodeLen = MIN_CODE_LEN;
-
-    /* initialize for decoding */
-    nextCode = FIRST_CODE;  /* code for next (first) string */
+    result = 0;
 
     /* first code from file must be a character.  use it for initial values */
     lastCode = GetCodeWord(bfpIn, currentCodeLen);
+
+    if (EOF == (int)lastCode)
+    {
+        /* empty file */
+        BitFileToFILE(bfpIn);
+        LZWFreeDecoder(decoder);
+        return 0;
+    }
+
     c = lastCode;
     fputc(lastCode, fpOut);
 
@@ -136,12 +208,14 @@ int LZWDecodeFile(FILE *fpIn, FILE *fpOut)
             code = GetCodeWord(bfpIn, currentCodeLen);
         }
 
-        if (code < nextCode)
+        if (code < decoder->nextCode)
         {
             /* we have a known code.  decode it */
-            c = DecodeRecursive(code, fpOut);
+            start = DecodeString(decoder, code);
+            c = decoder->stack[start];
+            fwrite(decoder->stack + start, 1, STACK_SIZE - start, fpOut);
         }
-        else
+        else if (code == decoder->nextCode)
         {
             /***************************************************************
             * We got a code that's not in our dictionary.  This must be due
@@ -152,16 +226,27 @@ int LZWDecodeFile(FILE *fpIn, FILE *fpOut)
             unsigned char tmp;
 
             tmp = c;
-            c = DecodeRecursive(lastCode, fpOut);
+            start = DecodeString(decoder, lastCode);
+            c = decoder->stack[start];
+            fwrite(decoder->stack + start, 1, STACK_SIZE - start, fpOut);
             fputc(tmp, fpOut);
         }
+        else
+        {
+            /* code can't be in the dictionary.  this isn't LZW data. */
+            errno = EILSEQ;
+            result = -1;
+            break;
+        }
 
         /* if room, add new code to the dictionary */
-        if (nextCode < MAX_CODES)
+        if (decoder->nextCode < MAX_CODES)
         {
-            dictionary[nextCode - FIRST_CODE].prefixCode = lastCode;
-            dictionary[nextCode - FIRST_CODE].suffixChar = c;
-            nextCode++;
+            decoder->dictionary[decoder->nextCode - FIRST_CODE].prefixCode =
+                lastCode;
+            decoder->dictionary[decoder->nextCode - FIRST_CODE].suffixChar =
+                c;
+            decoder->nextCode++;
         }
 
         /* save character and code for use in unknown code word case */
@@ -170,44 +255,810 @@ int LZWDecodeFile(FILE *fpIn, FILE *fpOut)
 
     /* we've decoded everything, free bitfile structure */
     BitFileToFILE(bfpIn);
+    LZWFreeDecoder(decoder);
+
+    return result;
+}
+
+/***************************************************************************
+*   Function   : LZWMakeDecoder
+*   Description: This routine allocates a decoder context with an empty
+*                dictionary.  The context may be used for any number of
+*                calls to LZWDecodeBuffer, but only by one thread at a time.
+*   Parameters : None
+*   Effects    : Memory for a full dictionary is allocated.
+*   Returned   : Pointer to the new decoder or NULL on error.  errno will be
+*                set on an error.
+***************************************************************************/
+lzw_decoder_t *LZWMakeDecoder(void)
+{
+    lzw_decoder_t *decoder;
+
+    decoder = malloc(sizeof(lzw_decoder_t));
+
+    if (NULL == decoder)
+    {
+        return NULL;
+    }
+
+    decoder->dictionary = LZWAlloc(LZW_MEM_DICTIONARY,
+        (MAX_CODES - FIRST_CODE) * sizeof(decode_dictionary_t));
+    decoder->stack = LZWAlloc(LZW_MEM_IO, STACK_SIZE);
+
+    if ((NULL == decoder->dictionary) || (NULL == decoder->stack))
+    {
+        LZWFreeDecoder(decoder);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    decoder->nextCode = FIRST_CODE;
+    decoder->peakCode = FIRST_CODE;
+    decoder->stackLow = STACK_SIZE;
+    LZWDecodeStart(decoder);
+    return decoder;
+}
+
+/***************************************************************************
+*   Function   : LZWFreeDecoder
+*   Description: This routine frees a decoder context and its dictionary.
+*   Parameters : decoder - context allocated by LZWMakeDecoder (may be NULL)
+*   Effects    : All memory used by decoder is freed.
+*   Returned   : None
+***************************************************************************/
+void LZWFreeDecoder(lzw_decoder_t *decoder)
+{
+    if (NULL != decoder)
+    {
+        LZWRelease(decoder->dictionary);
+        LZWRelease(decoder->stack);
+        free(decoder);
+    }
+}
+
+/***************************************************************************
+*   Function   : LZWDecoderStats
+*   Description: This routine returns what a decoder saw while decoding
+*                its current or last stream: code words of each width,
+*                width increase escapes, codes used before they were
+*                defined (the KwKwK case), and where the dictionary
+*                filled.  The statistics are reset when a stream starts.
+*                They are only gathered if the library was built with
+*                LZW_STATS defined.
+*   Parameters : decoder - decoder context from LZWMakeDecoder
+*                stats - receives the statistics
+*   Effects    : None
+*   Returned   : 0 for success, -1 for failure.  errno will be set to
+*                ENOSYS if the library was built without LZW_STATS.
+***************************************************************************/
+int LZWDecoderStats(const lzw_decoder_t *decoder, lzw_stats_t *stats)
+{
+    if ((NULL == decoder) || (NULL == stats))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+#ifdef LZW_STATS
+    *stats = decoder->stats;
+    return 0;
+#else
+    memset(stats, 0, sizeof(lzw_stats_t));
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/***************************************************************************
+*   Function   : LZWDecoderMemory
+*   Description: This routine returns the memory used by a decoder: the
+*                bytes holding its current stream's strings and the most
+*                that any stream it decoded has used, and the deepest its
+*                stack got building the longest string.  The dictionary and
+*                stack are allocated for their largest sizes, but only the
+*                pages that are used are touched, so the peaks are what the
+*                decoder adds to a process' memory.
+*   Parameters : decoder - decoder context from LZWMakeDecoder
+*                memory - receives the decoder's memory use
+*   Effects    : None
+*   Returned   : 0 for success, -1 for failure.  errno will be set on
+*                failure.
+***************************************************************************/
+int LZWDecoderMemory(const lzw_decoder_t *decoder, lzw_memory_t *memory)
+{
+    unsigned int peakCode;
+
+    if ((NULL == decoder) || (NULL == memory))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    peakCode = (decoder->nextCode > decoder->peakCode) ?
+        decoder->nextCode : decoder->peakCode;
+
+    memory->dictionary.current =
+        (decoder->nextCode - FIRST_CODE) * sizeof(decode_dictionary_t);
+    memory->dictionary.peak =
+        (peakCode - FIRST_CODE) * sizeof(decode_dictionary_t);
+    memory->io.current = STACK_SIZE - decoder->stackLow;
+    memory->io.peak = memory->io.current;
+    memory->total.current =
+        memory->dictionary.current + memory->io.current;
+    memory->total.peak = memory->dictionary.peak + memory->io.peak;
+    memory->reserved =
+        ((MAX_CODES - FIRST_CODE) * sizeof(decode_dictionary_t)) +
+        STACK_SIZE;
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : LZWDecodeBuffer
+*   Description: This routine decodes a memory buffer containing a single
+*                LZW stream, such as one produced by LZWEncodeBuffer.
+*   Parameters : decoder - decoder context from LZWMakeDecoder
+*                in - data to decode
+*                inLen - number of bytes in in
+*                out - buffer receiving the decoded data
+*                outSize - size of out
+*                outLen - set to the number of bytes written to out
+*   Effects    : in is decoded into out.  The decoder's dictionary is
+*                replaced.
+*   Returned   : 0 for success, -1 for failure.  errno will be set to
+*                ENOBUFS if out is too small and EILSEQ if in isn't a valid
+*                LZW stream.
+***************************************************************************/
+int LZWDecodeBuffer(lzw_decoder_t *decoder, const unsigned char *in,
+    const size_t inLen, unsigned char *out, const size_t outSize,
+    size_t *outLen)
+{
+    bit_buffer_t bitBuffer;             /* encoded input */
+    unsigned int lastCode;              /* last decoded code word */
+    unsigned int code;                  /* code word to decode */
+    unsigned char currentCodeLen;       /* length of code words now */
+    unsigned char c;                    /* last decoded character */
+    unsigned int start;                 /* start of string in stack */
+    size_t len;                         /* length of decoded string */
+    size_t count;                       /* bytes written to out */
+
+    /* validate arguments */
+    if ((NULL == decoder) || (NULL == in) || (NULL == out) ||
+        (NULL == outLen))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    bitBuffer.buffer = in;
+    bitBuffer.size = inLen;
+    bitBuffer.count = 0;
+    bitBuffer.bits = 0;
+    bitBuffer.bitCount = 0;
+
+    /* start with an empty dictionary and MIN_CODE_LEN bit code words */
+    EmptyDictionary(decoder);
+    currentCodeLen = MIN_CODE_LEN;
+    count = 0;
+    *outLen = 0;
+    STATS_RESET(decoder);
+
+    /* first code must be a character.  use it for initial values */
+    lastCode = BufferGetCodeWord(&bitBuffer, currentCodeLen);
+
+    if (EOF == (int)lastCode)
+    {
+        return 0;           /* empty stream */
+    }
+
+    STATS_CODE(decoder, currentCodeLen);
+
+    if (lastCode >= FIRST_CODE)
+    {
+        errno = EILSEQ;
+        return -1;
+    }
+
+    if (0 == outSize)
+    {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    c = lastCode;
+    out[count] = c;
+    count++;
+    STATS_BYTES(decoder, 1);
+
+    /* decode rest of stream */
+    while ((int)(code = BufferGetCodeWord(&bitBuffer, currentCodeLen)) !=
+        EOF)
+    {
+        STATS_CODE(decoder, currentCodeLen);
+
+        /* look for code length increase marker */
+        while (((CURRENT_MAX_CODES(currentCodeLen) - 1) == code) &&
+            (currentCodeLen < MAX_CODE_LEN))
+        {
+            STATS_ESCAPE(decoder);
+            currentCodeLen++;
+            code = BufferGetCodeWord(&bitBuffer, currentCodeLen);
+            STATS_CODE(decoder, currentCodeLen);
+        }
+
+        if ((EOF == (int)code) || (code > decoder->nextCode))
+        {
+            /* truncated or not an LZW stream */
+            errno = EILSEQ;
+            return -1;
+        }
+
+        /* decode the code, or the last code for string + char + string */
+        start = DecodeString(decoder,
+            (code < decoder->nextCode) ? code : lastCode);
+        len = STACK_SIZE - start;
+
+        if ((count + len + ((code == decoder->nextCode) ? 1 : 0)) > outSize)
+        {
+            errno = ENOBUFS;
+            return -1;
+        }
+
+        memcpy(out + count, decoder->stack + start, len);
+        count += len;
+        STATS_BYTES(decoder, len);
+
+        if (code == decoder->nextCode)
+        {
+            /* string + char + string: last string + its 1st character */
+            out[count] = c;
+            count++;
+            STATS_KWKWK(decoder);
+            STATS_BYTES(decoder, 1);
+        }
+
+        c = decoder->stack[start];
+
+        /* if room, add new code to the dictionary */
+        if (decoder->nextCode < MAX_CODES)
+        {
+            decoder->dictionary[decoder->nextCode - FIRST_CODE].prefixCode =
+                lastCode;
+            decoder->dictionary[decoder->nextCode - FIRST_CODE].suffixChar =
+                c;
+            decoder->nextCode++;
+
+            if (MAX_CODES == decoder->nextCode)
+            {
+                STATS_FULL(decoder);
+            }
+        }
+
+        /* save code for use in unknown code word case */
+        lastCode = code;
+    }
+
+    *outLen = count;
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : LZWDecodeStart
+*   Description: This routine starts decoding a new LZW stream one chunk at
+*                a time with LZWDecodeChunk.
+*   Parameters : decoder - decoder context from LZWMakeDecoder
+*   Effects    : The decoder's dictionary is emptied.
+*   Returned   : None
+***************************************************************************/
+void LZWDecodeStart(lzw_decoder_t *decoder)
+{
+    EmptyDictionary(decoder);
+    decoder->lastCode = NO_CODE;
+    decoder->c = 0;
+    decoder->codeLen = MIN_CODE_LEN;
+    decoder->bits = 0;
+    decoder->bitCount = 0;
+    STATS_RESET(decoder);
+}
+
+/***************************************************************************
+*   Function   : LZWDecodeChunk
+*   Description: This routine decodes the next chunk of a stream started by
+*                LZWDecodeStart.  Chunks may be any size and may split code
+*                words; the bits of a partial code word are held by the
+*                decoder until the next chunk.  Decoded strings are passed
+*                to sink as they are decoded, so no output buffer is
+*                needed however much a chunk expands.
+*   Parameters : decoder - decoder context from LZWMakeDecoder
+*                in - encoded data
+*                inLen - number of bytes in in
+*                sink - function receiving each decoded string.  It returns
+*                       0 to continue or non-zero to stop decoding.
+*                arg - passed to sink
+*   Effects    : in is decoded and passed to sink.  The stream may not be
+*                continued after a failure.
+*   Returned   : 0 for success, -1 for failure.  errno will be set to
+*                EILSEQ if in isn't part of a valid LZW stream, or left as
+*                sink set it if sink stopped decoding.
+***************************************************************************/
+int LZWDecodeChunk(lzw_decoder_t *decoder, const unsigned char *in,
+    const size_t inLen, lzw_sink_t sink, void *arg)
+{
+    bit_buffer_t bitBuffer;             /* encoded input */
+    unsigned int code;                  /* code word to decode */
+    unsigned int start;                 /* start of string in stack */
+    int result;
+
+    /* validate arguments */
+    if ((NULL == decoder) || ((NULL == in) && (0 != inLen)) ||
+        (NULL == sink))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    bitBuffer.buffer = in;
+    bitBuffer.size = inLen;
+    bitBuffer.count = 0;
+    bitBuffer.bits = decoder->bits;
+    bitBuffer.bitCount = decoder->bitCount;
+    result = 0;
+
+    while ((0 == result) && ((int)(code = BufferGetCodeWord(&bitBuffer,
+        decoder->codeLen)) != EOF))
+    {
+        STATS_CODE(decoder, decoder->codeLen);
+
+        if (NO_CODE == decoder->lastCode)
+        {
+            /* first code must be a character */
+            if (code >= FIRST_CODE)
+            {
+                errno = EILSEQ;
+                result = -1;
+                break;
+            }
+
+            decoder->c = code;
+            decoder->lastCode = code;
+            STATS_BYTES(decoder, 1);
+            result = sink(arg, &decoder->c, 1);
+            continue;
+        }
+
+        /* look for code length increase marker */
+        if (((CURRENT_MAX_CODES(decoder->codeLen) - 1) == code) &&
+            (decoder->codeLen < MAX_CODE_LEN))
+        {
+            STATS_ESCAPE(decoder);
+            decoder->codeLen++;
+            continue;
+        }
+
+        if (code > decoder->nextCode)
+        {
+            errno = EILSEQ;
+            result = -1;
+            break;
+        }
+
+        /* decode the code, or the last code for string + char + string */
+        start = DecodeString(decoder,
+            (code < decoder->nextCode) ? code : decoder->lastCode);
+        result = sink(arg, decoder->stack + start, STACK_SIZE - start);
+        STATS_BYTES(decoder, STACK_SIZE - start);
+
+        if ((0 == result) && (code == decoder->nextCode))
+        {
+            /* string + char + string: last string + its 1st character */
+            result = sink(arg, &decoder->c, 1);
+            STATS_KWKWK(decoder);
+            STATS_BYTES(decoder, 1);
+        }
+
+        decoder->c = decoder->stack[start];
+
+        /* if room, add new code to the dictionary */
+        if (decoder->nextCode < MAX_CODES)
+        {
+            decoder->dictionary[decoder->nextCode - FIRST_CODE].prefixCode =
+                decoder->lastCode;
+            decoder->dictionary[decoder->nextCode - FIRST_CODE].suffixChar =
+                decoder->c;
+            decoder->nextCode++;
+
+            if (MAX_CODES == decoder->nextCode)
+            {
+                STATS_FULL(decoder);
+            }
+        }
+
+        /* save code for use in unknown code word case */
+        decoder->lastCode = code;
+    }
+
+    decoder->bits = bitBuffer.bits;
+    decoder->bitCount = bitBuffer.bitCount;
+    return (0 == result) ? 0 : -1;
+}
+
+/***************************************************************************
+*   Function   : LZWDecodeFrozen
+*   Description: This routine decodes a memory buffer encoded by
+*                LZWEncodeFrozen.  Strings are looked up in the frozen
+*                dictionary and copied to out back to front, so the
+*                dictionary is only read and may be shared by any number
+*                of threads.
+*   Parameters : dictionary - dictionary the data was encoded with
+*                in - data to decode
+*                inLen - number of bytes in in
+*                out - buffer receiving the decoded data
+*                outSize - size of out
+*                outLen - set to the number of bytes written to out
+*   Effects    : in is decoded into out.
+*   Returned   : 0 for success, -1 for failure.  errno will be set to
+*                ENOBUFS if out is too small and EILSEQ if in contains a
+*                code that isn't in the dictionary.
+***************************************************************************/
+int LZWDecodeFrozen(const lzw_dictionary_t *dictionary,
+    const unsigned char *in, const size_t inLen, unsigned char *out,
+    const size_t outSize, size_t *outLen)
+{
+    /* validate arguments */
+    if ((NULL == dictionary) || ((NULL == in) && (0 != inLen)) ||
+        ((NULL == out) && (0 != outSize)) || (NULL == outLen))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return LZWDecodeFrozenBits(dictionary, in, inLen, 0, 0, out, outSize,
+        outLen);
+}
 
+/***************************************************************************
+*   Function   : LZWDecodeFrozenBits
+*   Description: This routine decodes fixed length codes from a frozen
+*                dictionary, starting part way into the first byte of in.
+*                If out is NULL, nothing is written and only the decoded
+*                length is computed.
+*   Parameters : dictionary - dictionary the data was encoded with
+*                in - data to decode
+*                inLen - number of bytes in in
+*                skipBits - number of bits of in[0] that precede the first
+*                           code (0 - 7)
+*                numCodes - number of codes to decode, 0 to decode to the
+*                           end of in
+*                out - buffer receiving the decoded data (may be NULL)
+*                outSize - size of out
+*                outLen - set to the number of bytes decoded
+*   Effects    : in is decoded into out.
+*   Returned   : 0 for success, -1 for failure.  errno will be set to
+*                ENOBUFS if out is too small and EILSEQ if in contains a
+*                code that isn't in the dictionary or ends before numCodes
+*                codes.
+***************************************************************************/
+int LZWDecodeFrozenBits(const lzw_dictionary_t *dictionary,
+    const unsigned char *in, const size_t inLen,
+    const unsigned int skipBits, const unsigned long numCodes,
+    unsigned char *out, const size_t outSize, size_t *outLen)
+{
+    bit_buffer_t bitBuffer;             /* encoded input */
+    unsigned char *p;                   /* end of string being copied */
+    unsigned int length;                /* length of string */
+    unsigned long decoded;              /* number of codes decoded */
+    int code;                           /* code word to decode */
+    size_t count;                       /* bytes written to out */
+
+    bitBuffer.buffer = in;
+    bitBuffer.size = inLen;
+    bitBuffer.count = 0;
+    bitBuffer.bits = 0;
+    bitBuffer.bitCount = 0;
+
+    if ((0 != skipBits) && (0 != inLen))
+    {
+        /* keep only the bits after skipBits */
+        bitBuffer.bits = in[0] & ((1U << (CHAR_BIT - skipBits)) - 1);
+        bitBuffer.bitCount = CHAR_BIT - skipBits;
+        bitBuffer.count = 1;
+    }
+
+    count = 0;
+
+    for (decoded = 0; (0 == numCodes) || (decoded < numCodes); decoded++)
+    {
+        code = BufferGetCodeWord(&bitBuffer, dictionary->codeLen);
+
+        if (EOF == code)
+        {
+            if (0 != numCodes)
+            {
+                errno = EILSEQ;     /* fewer codes than expected */
+                return -1;
+            }
+
+            break;
+        }
+
+        if ((unsigned int)code >= dictionary->numCodes)
+        {
+            errno = EILSEQ;
+            return -1;
+        }
+
+        length = (code < FIRST_CODE) ? 1 :
+            dictionary->length[code - FIRST_CODE];
+
+        if (NULL == out)
+        {
+            count += length;        /* only measuring */
+            continue;
+        }
+
+        if (length > (outSize - count))
+        {
+            errno = ENOBUFS;
+            return -1;
+        }
+
+        /* follow the prefixes, writing the string from its end */
+        p = out + count + length - 1;
+
+        while (code >= FIRST_CODE)
+        {
+            *p = dictionary->suffix[code - FIRST_CODE];
+            code = (int)dictionary->prefix[code - FIRST_CODE];
+            p--;
+        }
+
+        *p = (unsigned char)code;
+        count += length;
+    }
+
+    *outLen = count;
     return 0;
 }
 
 /***************************************************************************
-*   Function   : DecodeRecursive
+*   Function   : LZWDecodeUntilFrozen
+*   Description: This routine decodes a single LZW stream from memory,
+*                writing it to a file, until the stream ends or the
+*                decoder's dictionary can no longer change.  That happens
+*                once the dictionary is full and code words have reached
+*                MAX_CODE_LEN bits.  From then on every code word is the
+*                same length and no strings are added, so the rest of the
+*                stream may be decoded in pieces with LZWFreezeDecoder and
+*                LZWDecodeFrozenBits.
+*   Parameters : decoder - decoder context from LZWMakeDecoder
+*                in - stream to decode
+*                inLen - number of bytes in in
+*                fpOut - file receiving the decoded data
+*                bitsUsed - set to the number of bits of in decoded
+*   Effects    : The start of in is decoded to fpOut.  The decoder's
+*                dictionary is replaced.
+*   Returned   : 1 if the dictionary was frozen before the end of in, 0 if
+*                all of in was decoded, and -1 for failure.  errno will be
+*                set to EILSEQ if in isn't a valid LZW stream.
+***************************************************************************/
+int LZWDecodeUntilFrozen(lzw_decoder_t *decoder, const unsigned char *in,
+    const size_t inLen, FILE *fpOut, size_t *bitsUsed)
+{
+    bit_buffer_t bitBuffer;             /* encoded input */
+    unsigned int lastCode;              /* last decoded code word */
+    unsigned int code;                  /* code word to decode */
+    unsigned char currentCodeLen;       /* length of code words now */
+    unsigned char c;                    /* last decoded character */
+    unsigned int start;                 /* start of string in stack */
+    size_t len;                         /* length of decoded string */
+    int result;
+
+    bitBuffer.buffer = in;
+    bitBuffer.size = inLen;
+    bitBuffer.count = 0;
+    bitBuffer.bits = 0;
+    bitBuffer.bitCount = 0;
+
+    EmptyDictionary(decoder);
+    currentCodeLen = MIN_CODE_LEN;
+    *bitsUsed = 0;
+
+    /* first code must be a character.  use it for initial values */
+    lastCode = BufferGetCodeWord(&bitBuffer, currentCodeLen);
+
+    if (EOF == (int)lastCode)
+    {
+        return 0;           /* empty stream */
+    }
+
+    if (lastCode >= FIRST_CODE)
+    {
+        errno = EILSEQ;
+        return -1;
+    }
+
+    c = lastCode;
+
+    if (EOF == fputc(c, fpOut))
+    {
+        return -1;
+    }
+
+    result = 0;
+
+    while (1)
+    {
+        if ((MAX_CODES == decoder->nextCode) &&
+            (MAX_CODE_LEN == currentCodeLen))
+        {
+            /* nothing can change from here on */
+            result = 1;
+            break;
+        }
+
+        code = BufferGetCodeWord(&bitBuffer, currentCodeLen);
+
+        if (EOF == (int)code)
+        {
+            break;
+        }
+
+        /* look for code length increase marker */
+        while (((CURRENT_MAX_CODES(currentCodeLen) - 1) == code) &&
+            (currentCodeLen < MAX_CODE_LEN))
+        {
+            currentCodeLen++;
+            code = BufferGetCodeWord(&bitBuffer, currentCodeLen);
+        }
+
+        if ((EOF == (int)code) || (code > decoder->nextCode))
+        {
+            /* truncated or not an LZW stream */
+            errno = EILSEQ;
+            return -1;
+        }
+
+        /* decode the code, or the last code for string + char + string */
+        start = DecodeString(decoder,
+            (code < decoder->nextCode) ? code : lastCode);
+        len = STACK_SIZE - start;
+
+        if (fwrite(decoder->stack + start, 1, len, fpOut) != len)
+        {
+            return -1;
+        }
+
+        if ((code == decoder->nextCode) && (EOF == fputc(c, fpOut)))
+        {
+            return -1;
+        }
+
+        c = decoder->stack[start];
+
+        /* if room, add new code to the dictionary */
+        if (decoder->nextCode < MAX_CODES)
+        {
+            decoder->dictionary[decoder->nextCode - FIRST_CODE].prefixCode =
+                lastCode;
+            decoder->dictionary[decoder->nextCode - FIRST_CODE].suffixChar =
+                c;
+            decoder->nextCode++;
+        }
+
+        lastCode = code;
+    }
+
+    *bitsUsed = (bitBuffer.count * CHAR_BIT) - bitBuffer.bitCount;
+    return result;
+}
+
+/***************************************************************************
+*   Function   : LZWFreezeDecoder
+*   Description: This routine copies a decoder's dictionary into a frozen
+*                dictionary that LZWDecodeFrozenBits can share between
+*                threads.  Code words are MAX_CODE_LEN bits long.  The
+*                frozen dictionary may only be used for decoding.
+*   Parameters : decoder - decoder whose dictionary is copied
+*   Effects    : Memory is allocated for the dictionary
+*   Returned   : Pointer to the new dictionary or NULL on error.  errno will
+*                be set on an error.
+***************************************************************************/
+lzw_dictionary_t *LZWFreezeDecoder(const lzw_decoder_t *decoder)
+{
+    lzw_dictionary_t *dictionary;
+    unsigned int i, prefix, numStrings;
+
+    dictionary = calloc(1, sizeof(lzw_dictionary_t));
+
+    if (NULL == dictionary)
+    {
+        return NULL;
+    }
+
+    numStrings = decoder->nextCode - FIRST_CODE;
+    dictionary->numCodes = decoder->nextCode;
+    dictionary->codeLen = MAX_CODE_LEN;
+    dictionary->prefix = LZWAlloc(LZW_MEM_DICTIONARY,
+        (numStrings + 1) * sizeof(unsigned int));
+    dictionary->suffix = LZWAlloc(LZW_MEM_DICTIONARY, numStrings + 1);
+    dictionary->length = LZWAlloc(LZW_MEM_DICTIONARY,
+        (numStrings + 1) * sizeof(unsigned int));
+
+    if ((NULL == dictionary->prefix) || (NULL == dictionary->suffix) ||
+        (NULL == dictionary->length))
+    {
+        LZWFreeDictionary(dictionary);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    for (i = 0; i < numStrings; i++)
+    {
+        /* a string's prefix always has a lower code than the string */
+        prefix = decoder->dictionary[i].prefixCode;
+        dictionary->prefix[i] = prefix;
+        dictionary->suffix[i] = decoder->dictionary[i].suffixChar;
+        dictionary->length[i] = (prefix < FIRST_CODE) ? 2 :
+            (dictionary->length[prefix - FIRST_CODE] + 1);
+    }
+
+    return dictionary;
+}
+
+/***************************************************************************
+*   Function   : DecodeString
 *   Description: This function uses the dictionary to decode a code word
-*                into the string it represents and write it to the output
-*                file.  The string is actually built in reverse order and
-*                recursion is used to write it out in the correct order.
-*   Parameters : code - the code word to decode
-*                fpOut - the file that the decoded code word is written to
-*   Effects    : Decoded code word is written to a file
-*   Returned   : The first character in the decoded string
+*                into the string it represents.  The string is built in
+*                reverse order, ending at the top of the decoder's stack.
+*   Parameters : decoder - decoder context containing the dictionary
+*                code - the code word to decode (< decoder->nextCode)
+*   Effects    : Decoded string is written to the end of decoder->stack
+*   Returned   : Index of the first character of the decoded string in
+*                decoder->stack.  The string ends at STACK_SIZE.
 ***************************************************************************/
-static unsigned char DecodeRecursive(unsigned int code, FILE *fpOut)
+static unsigned int DecodeString(lzw_decoder_t *decoder, unsigned int code)
 {
-    unsigned char c;
-    unsigned char firstChar;
+    unsigned int start;
 
-    if (code >= FIRST_CODE)
+    start = STACK_SIZE;
+
+    while (code >= FIRST_CODE)
     {
         /* code word is string + c */
-        c = dictionary[code - FIRST_CODE].suffixChar;
-        code = dictionary[code - FIRST_CODE].prefixCode;
+        start--;
+        decoder->stack[start] =
+            decoder->dictionary[code - FIRST_CODE].suffixChar;
+        code = decoder->dictionary[code - FIRST_CODE].prefixCode;
+    }
 
-        /* evaluate new code word for remaining string */
-        firstChar = DecodeRecursive(code, fpOut);
+    /* code word is just c */
+    start--;
+    decoder->stack[start] = code;
+
+    if (start < decoder->stackLow)
+    {
+        decoder->stackLow = start;
     }
-    else
+
+    return start;
+}
+
+/***************************************************************************
+*   Function   : EmptyDictionary
+*   Description: This function empties a decoder's dictionary for a new
+*                stream, remembering how full it got for LZWDecoderMemory.
+*   Parameters : decoder - decoder context from LZWMakeDecoder
+*   Effects    : decoder->nextCode is reset and decoder->peakCode may be
+*                raised.
+*   Returned   : None
+***************************************************************************/
+static void EmptyDictionary(lzw_decoder_t *decoder)
+{
+    if (decoder->nextCode > decoder->peakCode)
     {
-        /* code word is just c */
-        c = code;
-        firstChar = code;
+        decoder->peakCode = decoder->nextCode;
     }
 
-    fputc(c, fpOut);
-    return firstChar;
+    decoder->nextCode = FIRST_CODE;
 }
 
 /***************************************************************************
@@ -240,3 +1091,54 @@ static int GetCodeWord(bit_file_t *bfpIn, const unsigned char codeLen)
 
     return code;
 }
+
+/***************************************************************************
+*   Function   : BufferGetCodeWord
+*   Description: This function reads and returns a code word from an
+*                encoded memory buffer.  Bits are read in the same order as
+*                GetCodeWord; the least significant byte first, followed by
+*                the next byte and the remaining bits.
+*   Parameters : in - bit buffer containing the encoded data
+*                codeLen - number of bits in code word (> CHAR_BIT)
+*   Effects    : code word is read from encoded input
+*   Returned   : The next code word in the encoded data.  EOF if the end
+*                of the buffer has been reached.
+***************************************************************************/
+static int BufferGetCodeWord(bit_buffer_t *in, const unsigned char codeLen)
+{
+    unsigned long value;
+    unsigned int code;
+
+    while (in->bitCount < codeLen)
+    {
+        if (in->count == in->size)
+        {
+            return EOF;     /* only padding is left */
+        }
+
+        in->bits = (in->bits << CHAR_BIT) | in->buffer[in->count];
+        in->count++;
+        in->bitCount += CHAR_BIT;
+    }
+
+    in->bitCount -= codeLen;
+    value = (in->bits >> in->bitCount) & ((1UL << codeLen) - 1);
+
+    /* undo the byte order used to write the code word */
+    if (codeLen >= (2 * CHAR_BIT))
+    {
+        code = (unsigned int)(value >> (codeLen - CHAR_BIT)) |
+            ((unsigned int)((value >> (codeLen - (2 * CHAR_BIT))) & 0xFF) <<
+                CHAR_BIT) |
+            ((unsigned int)(value &
+                ((1UL << (codeLen - (2 * CHAR_BIT))) - 1)) << (2 * CHAR_BIT));
+    }
+    else
+    {
+        code = (unsigned int)(value >> (codeLen - CHAR_BIT)) |
+            ((unsigned int)(value & ((1UL << (codeLen - CHAR_BIT)) - 1)) <<
+                CHAR_BIT);
+    }
+
+    return (int)code;
+}
@@ -35,6 +35,7 @@
 ***************************************************************************/
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include "lzw.h"
 #include "lzwlocal.h"
@@ -43,25 +44,106 @@
 /***************************************************************************
 *                            TYPE DEFINITIONS
 ***************************************************************************/
-/* node in dictionary tree */
-typedef struct dict_node_t
+/* node in dictionary tree.  nodes are stored by code word. */
+typedef struct
 {
-    unsigned int codeWord;      /* code word for this entry */
-    unsigned char suffixChar;   /* last char in encoded string */
-    unsigned int prefixCode;    /* code for remaining chars in string */
+    unsigned int key;           /* key made from prefix code + suffix char */
 
-    /* pointer to child nodes */
-    struct dict_node_t *left;   /* child with < key */
-    struct dict_node_t *right;  /* child with >= key */
+    /* code words of child nodes (0 for none, no string has code 0) */
+    unsigned int left;          /* child with < key */
+    unsigned int right;         /* child with >= key */
 } dict_node_t;
 
+/* encoder context */
+struct lzw_encoder_t
+{
+    dict_node_t *dictionary;    /* nodes for codes FIRST_CODE and above */
+    unsigned int nextCode;      /* next available code index */
+    unsigned int peakCode;      /* highest nextCode of earlier streams */
+
+    /* state of a stream encoded in chunks */
+    unsigned int code;          /* code for current string or NO_STRING */
+    unsigned char codeLen;      /* length of the current code */
+    unsigned long bits;         /* bits waiting to be written */
+    unsigned int bitCount;      /* number of bits in bits */
+
+#ifdef LZW_STATS
+    lzw_stats_t stats;          /* statistics of the current stream */
+    unsigned int probes;        /* nodes visited by the current search */
+#endif
+};
+
+/* bit writer for encoding to memory (same bit order as bitfile) */
+typedef struct
+{
+    unsigned char *buffer;      /* encoded output */
+    size_t size;                /* size of buffer */
+    size_t count;               /* number of bytes written to buffer */
+    unsigned long bits;         /* bits waiting to be written */
+    unsigned int bitCount;      /* number of bits in bits */
+
+#ifdef LZW_STATS
+    lzw_stats_t *stats;         /* counts code words written, or NULL */
+#endif
+} bit_buffer_t;
+
+/* one buffer being encoded by LZWEncodeInterleaved */
+typedef struct
+{
+    lzw_encoder_t *encoder;     /* encoder for this buffer */
+    const unsigned char *in;    /* data to encode */
+    size_t inLen;               /* number of bytes in in */
+    size_t next;                /* index of the next character of in */
+    bit_buffer_t bitBuffer;     /* encoded output */
+    unsigned int key;           /* key of the string being searched for */
+    unsigned int node;          /* node to visit next (NO_NODE if none) */
+    unsigned char c;            /* character appended to the string */
+} lane_t;
+
 /***************************************************************************
 *                                CONSTANTS
 ***************************************************************************/
+#define NO_NODE     0           /* code used for missing tree nodes */
+#define NO_STRING   MAX_CODES   /* code before the first character */
+
+/* compressibility sniffing (see LZWIsCompressible) */
+#define SNIFF_MIN_LEN       256         /* shorter inputs are just tried */
+#define SNIFF_ENTROPY_LIMIT 7.0         /* bits/byte always worth trying */
+#define SNIFF_TRIAL_LEN     (1 << 14)   /* bytes encoded by the trial */
+#define SNIFF_LOG_BITS      16          /* fraction bits found by Log2 */
 
 /***************************************************************************
 *                                  MACROS
 ***************************************************************************/
+#define NODE(encoder, code)     ((encoder)->dictionary[(code) - FIRST_CODE])
+
+/* statistics gathering, compiled out unless LZW_STATS is defined */
+#ifdef LZW_STATS
+#define STATS_PROBE(encoder)        ((encoder)->probes++)
+#define STATS_SEARCH(encoder, hit)  CountSearch((encoder), (hit))
+#define STATS_FIRST(encoder)        ((encoder)->stats.bytes++)
+#define STATS_OUTPUT(out, s)        ((out)->stats = (s))
+#define STATS_CODE(out, len)        do {                                    \
+                                        if (NULL != (out)->stats)           \
+                                        {                                   \
+                                            (out)->stats->codes++;          \
+                                            (out)->stats->widths[(len)]++;  \
+                                        }                                   \
+                                    } while (0)
+#define STATS_ESCAPE(out)           do {                                    \
+                                        if (NULL != (out)->stats)           \
+                                        {                                   \
+                                            (out)->stats->escapes++;        \
+                                        }                                   \
+                                    } while (0)
+#else
+#define STATS_PROBE(encoder)        ((void)0)
+#define STATS_SEARCH(encoder, hit)  ((void)0)
+#define STATS_FIRST(encoder)        ((void)0)
+#define STATS_OUTPUT(out, s)        ((void)0)
+#define STATS_CODE(out, len)        ((void)0)
+#define STATS_ESCAPE(out)           ((void)0)
+#endif
 
 /***************************************************************************
 *                            GLOBAL VARIABLES
@@ -71,14 +153,11 @@ typedef struct dict_node_t
 *                               PROTOTYPES
 ***************************************************************************/
 
-/* dictionary tree node create/free */
-static dict_node_t *MakeNode(const unsigned int codeWord,
-    const unsigned int prefixCode, const unsigned char suffixChar);
-static void FreeTree(dict_node_t *node);
-
-/* searches tree for matching dictionary entry */
-static dict_node_t *FindDictionaryEntry(dict_node_t *root,
-    const int unsigned prefixCode, const unsigned char c);
+/* dictionary tree node search/insert */
+static unsigned int FindDictionaryEntry(lzw_encoder_t *encoder,
+    const unsigned int key);
+static void AddDictionaryEntry(lzw_encoder_t *encoder,
+    const unsigned int parent, const unsigned int key);
 
 /* makes key from prefix code and character */
 static unsigned int MakeKey(const unsigned int prefixCode,
@@ -87,6 +166,28 @@ static unsigned int MakeKey(const unsigned int prefixCode,
 /* write encoded data */
 static int PutCodeWord(bit_file_t *bfpOut, int code,
     const unsigned char codeLen);
+static int BufferPutCodeWord(bit_buffer_t *out, const unsigned int code,
+    const unsigned char codeLen);
+static int BufferPutString(bit_buffer_t *out, const unsigned int code,
+    unsigned char *codeLen);
+
+/* frozen dictionary lookup */
+static unsigned long FrozenSlot(const lzw_dictionary_t *dictionary,
+    const unsigned int prefix, const unsigned char suffix);
+static unsigned int FindFrozenEntry(const lzw_dictionary_t *dictionary,
+    const unsigned int prefix, const unsigned char suffix);
+static double Log2(double x);
+static unsigned long SampleId(const unsigned char *sample,
+    const size_t sampleLen);
+
+/* interleaved encoding of several buffers */
+static int StartLaneSearch(lane_t *lane);
+static int StepLane(lane_t *lane);
+
+#ifdef LZW_STATS
+/* statistics gathering */
+static void CountSearch(lzw_encoder_t *encoder, const int hit);
+#endif
 
 /***************************************************************************
 *                                FUNCTIONS
@@ -107,15 +208,14 @@ static int PutCodeWord(bit_file_t *bfpOut, int code,
 int LZWEncodeFile(FILE *fpIn, FILE *fpOut)
 {
     bit_file_t *bfpOut;                 /* encoded output */
+    lzw_encoder_t *encoder;             /* dictionary and next code */
 
     unsigned int code;                  /* code for current string */
     unsigned char currentCodeLen;       /* length of the current code */
-    unsigned int nextCode;              /* next available code index */
+    unsigned int key;                   /* key for code + c */
+    unsigned int node;                  /* node of dictionary tree */
     int c;                              /* character to add to string */
 
-    dict_node_t *dictRoot;              /* root of dictionary tree */
-    dict_node_t *node;                  /* node of dictionary tree */
-
     /* validate arguments */
     if ((NULL == fpIn) || (NULL == fpOut))
     {
@@ -123,98 +223,62 @@ int LZWEncodeFile(FILE *fpIn, FILE *fpOut)
         return -1;
     }
 
+    /* dictionary starts out empty */
+    encoder = LZWMakeEncoder();
+
+    if (NULL == encoder)
+    {
+        perror("Making Dictionary");
+        return -1;
+    }
+
     /* convert output file to bitfile */
     bfpOut = MakeBitFile(fpOut, BF_WRITE);
 
     if (NULL == bfpOut)
     {
         perror("Making Output File a BitFile");
+        LZWFreeEncoder(encoder);
         return -1;
     }
 
-    /* initialize dictionary as empty */
-    dictRoot = NULL;
-
     /* start MIN_CODE_LEN bit code words */
     currentCodeLen = MIN_CODE_LEN;
 
-    nextCode = FIRST_CODE;  /* code for next (first) string */
-
     /* now start the actual encoding process */
 
     c = fgetc(fpIn);
 
     if (EOF == c)
     {
-        return -1;      /* empty file */
+        /* empty file encodes to empty file */
+        BitFileToFILE(bfpOut);
+        LZWFreeEncoder(encoder);
+        return 0;
     }
     else
     {
         code = c;       /* start with code string = first character */
     }
 
-    /* create a tree root from 1st 2 character string */
-    if ((c = fgetc(fpIn)) != EOF)
-    {
-        /* special case for NULL root */
-        dictRoot = MakeNode(nextCode, code, c);
-
-        if (NULL == dictRoot)
-        {
-            perror("Making Dictionary Root");
-            BitFileToFILE(bfpOut);
-            return -1;
-        }
-        
-        nextCode++;
-
-        /* write code for 1st char */
-        PutCodeWord(bfpOut, code, currentCodeLen);
-
-        /* new code is just 2nd char */
-        code = c;
-    }
-
     /* now encode normally */
     while ((c = fgetc(fpIn)) != EOF)
     {
         /* look for code + c in the dictionary */
-        node = FindDictionaryEntry(dictRoot, code, c);
+        key = MakeKey(code, c);
+        node = FindDictionaryEntry(encoder, key);
 
-        if ((node->prefixCode == code) &&
-            (node->suffixChar == c))
+        if ((NO_NODE != node) && (NODE(encoder, node).key == key))
         {
             /* code + c is in the dictionary, make it's code the new code */
-            code = node->codeWord;
+            code = node;
         }
         else
         {
             /* code + c is not in the dictionary, add it if there's room */
-            if (nextCode < MAX_CODES)
+            if (encoder->nextCode < MAX_CODES)
             {
-                dict_node_t *tmp;
-
-                tmp = MakeNode(nextCode, code, c);
-
-                if (NULL == dictRoot)
-                {
-                    perror("Making Dictionary Node");
-                    FreeTree(dictRoot);
-                    BitFileToFILE(bfpOut);
-                    return -1;
-                }
-
-                nextCode++;
-
-                if (MakeKey(code, c) <
-                    MakeKey(node->prefixCode, node->suffixChar))
-                {
-                    node->left = tmp;
-                }
-                else
-                {
-                    node->right = tmp;
-                }
+                AddDictionaryEntry(encoder, node, key);
             }
             else
             {
@@ -246,182 +310,1169 @@ int LZWEncodeFile(FILE *fpIn, FILE *fpOut)
     BitFileToFILE(bfpOut);
 
     /* free the dictionary */
-    FreeTree(dictRoot);
+    LZWFreeEncoder(encoder);
 
     return 0;
 }
 
 /***************************************************************************
-*   Function   : MakeKey
-*   Description: This routine creates a simple key from a prefix code and
-*                an appended character.  The key may be used to establish
-*                an order when building/searching a dictionary tree.
-*   Parameters : prefixCode - code for all but the last character of a
-*                             string.
-*                suffixChar - the last character of a string
+*   Function   : LZWMakeEncoder
+*   Description: This routine allocates an encoder context with an empty
+*                dictionary.  The context may be used for any number of
+*                calls to LZWEncodeBuffer, but only by one thread at a time.
+*   Parameters : None
+*   Effects    : Memory for a full dictionary is allocated.  Pages are only
+*                touched as the dictionary grows.
+*   Returned   : Pointer to the new encoder or NULL on error.  errno will be
+*                set on an error.
+***************************************************************************/
+lzw_encoder_t *LZWMakeEncoder(void)
+{
+    lzw_encoder_t *encoder;
+
+    encoder = malloc(sizeof(lzw_encoder_t));
+
+    if (NULL == encoder)
+    {
+        return NULL;
+    }
+
+    encoder->dictionary = LZWAlloc(LZW_MEM_DICTIONARY,
+        (MAX_CODES - FIRST_CODE) * sizeof(dict_node_t));
+
+    if (NULL == encoder->dictionary)
+    {
+        free(encoder);
+        return NULL;
+    }
+
+    encoder->nextCode = FIRST_CODE;
+    encoder->peakCode = FIRST_CODE;
+    LZWEncodeStart(encoder);
+    return encoder;
+}
+
+/***************************************************************************
+*   Function   : LZWFreeEncoder
+*   Description: This routine frees an encoder context and its dictionary.
+*   Parameters : encoder - context allocated by LZWMakeEncoder (may be NULL)
+*   Effects    : All memory used by encoder is freed.
+*   Returned   : None
+***************************************************************************/
+void LZWFreeEncoder(lzw_encoder_t *encoder)
+{
+    if (NULL != encoder)
+    {
+        LZWRelease(encoder->dictionary);
+        free(encoder);
+    }
+}
+
+/***************************************************************************
+*   Function   : LZWEncoderStats
+*   Description: This routine returns what an encoder saw while encoding
+*                its current or last stream: dictionary search lengths and
+*                hit rates, the depth of each string added to the
+*                dictionary tree, code words of each width, and where the
+*                dictionary filled.  The statistics are reset when a stream
+*                starts.  They are only gathered if the library was built
+*                with LZW_STATS defined, so they cost nothing otherwise.
+*   Parameters : encoder - encoder context from LZWMakeEncoder
+*                stats - receives the statistics
 *   Effects    : None
-*   Returned   : Key built from string represented as a prefix + char.  Key
-*                format is {ms nibble of c} + prefix + {ls nibble of c}
+*   Returned   : 0 for success, -1 for failure.  errno will be set to
+*                ENOSYS if the library was built without LZW_STATS.
 ***************************************************************************/
-static unsigned int MakeKey(const unsigned int prefixCode,
-    const unsigned char suffixChar)
+int LZWEncoderStats(const lzw_encoder_t *encoder, lzw_stats_t *stats)
 {
-    unsigned int key;
+    if ((NULL == encoder) || (NULL == stats))
+    {
+        errno = EINVAL;
+        return -1;
+    }
 
-    /* position ms nibble */
-    key = suffixChar & 0xF0;
-    key <<= MAX_CODE_LEN;
+#ifdef LZW_STATS
+    *stats = encoder->stats;
+    return 0;
+#else
+    memset(stats, 0, sizeof(lzw_stats_t));
+    errno = ENOSYS;
+    return -1;
+#endif
+}
 
-    /* include prefix code */
-    key |= (prefixCode << 4);
+/***************************************************************************
+*   Function   : LZWEncoderMemory
+*   Description: This routine returns the dictionary memory used by an
+*                encoder: the bytes holding its current stream's strings
+*                and the most that any stream it encoded has used.  The
+*                dictionary is allocated for the largest number of
+*                strings, but only the pages holding strings are touched,
+*                so the peak is what the encoder adds to a process' memory.
+*   Parameters : encoder - encoder context from LZWMakeEncoder
+*                memory - receives the encoder's memory use
+*   Effects    : None
+*   Returned   : 0 for success, -1 for failure.  errno will be set on
+*                failure.
+***************************************************************************/
+int LZWEncoderMemory(const lzw_encoder_t *encoder, lzw_memory_t *memory)
+{
+    unsigned int peakCode;
 
-    /* inclulde ls nibble */
-    key |= (suffixChar & 0x0F);
+    if ((NULL == encoder) || (NULL == memory))
+    {
+        errno = EINVAL;
+        return -1;
+    }
 
-    return key;
+    peakCode = (encoder->nextCode > encoder->peakCode) ?
+        encoder->nextCode : encoder->peakCode;
+
+    memory->dictionary.current =
+        (encoder->nextCode - FIRST_CODE) * sizeof(dict_node_t);
+    memory->dictionary.peak = (peakCode - FIRST_CODE) * sizeof(dict_node_t);
+    memory->io.current = 0;
+    memory->io.peak = 0;
+    memory->total = memory->dictionary;
+    memory->reserved = (MAX_CODES - FIRST_CODE) * sizeof(dict_node_t);
+    return 0;
 }
 
 /***************************************************************************
-*   Function   : MakeNode
-*   Description: This routine creates and initializes a dictionary entry
-*                for a string and the code word that encodes it.
-*   Parameters : codeWord - code word used to encode the string prefixCode +
-*                           suffixChar
-*                prefixCode - code for all but the last character of a
-*                             string.
-*                suffixChar - the last character of a string
-*   Effects    : Node is allocated for new dictionary entry
-*   Returned   : Pointer to newly allocated node or NULL on error.
-*                errno will be set on an error.
+*   Function   : LZWEncodeBound
+*   Description: This routine returns the largest number of bytes that
+*                LZWEncodeBuffer may produce for an input of inLen bytes.
+*   Parameters : inLen - number of bytes to be encoded
+*   Effects    : None
+*   Returned   : Maximum size of the encoded data.
+***************************************************************************/
+size_t LZWEncodeBound(const size_t inLen)
+{
+    /* one code per byte plus every code length increase marker, plus room
+     * for the partial code word check made by BufferPutCodeWord */
+    return ((((inLen + (MAX_CODE_LEN - MIN_CODE_LEN + 1)) * MAX_CODE_LEN) +
+        (CHAR_BIT - 1)) / CHAR_BIT) + sizeof(unsigned int);
+}
+
+/***************************************************************************
+*   Function   : LZWEncodeBuffer
+*   Description: This routine encodes a memory buffer as a single LZW
+*                stream starting with an empty dictionary.  The output is
+*                bit for bit the same as LZWEncodeFile would produce for the
+*                same data.
+*   Parameters : encoder - encoder context from LZWMakeEncoder
+*                in - data to encode
+*                inLen - number of bytes in in
+*                out - buffer receiving the encoded data
+*                outSize - size of out.  LZWEncodeBound(inLen) is enough.
+*                outLen - set to the number of bytes written to out
+*   Effects    : in is encoded into out.  The encoder's dictionary is
+*                replaced.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+int LZWEncodeBuffer(lzw_encoder_t *encoder, const unsigned char *in,
+    const size_t inLen, unsigned char *out, const size_t outSize,
+    size_t *outLen)
+{
+    size_t chunkLen, endLen;
+
+    if (NULL == encoder)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    LZWEncodeStart(encoder);
+
+    if (0 != LZWEncodeChunk(encoder, in, inLen, out, outSize, &chunkLen))
+    {
+        return -1;
+    }
+
+    if (0 != LZWEncodeEnd(encoder, out + chunkLen, outSize - chunkLen,
+        &endLen))
+    {
+        return -1;
+    }
+
+    *outLen = chunkLen + endLen;
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : LZWIsCompressible
+*   Description: This routine makes a quick guess at whether encoding a
+*                buffer will make it smaller.  Data with an order-0
+*                entropy below SNIFF_ENTROPY_LIMIT bits per byte is worth
+*                encoding.  Otherwise SNIFF_TRIAL_LEN bytes from the middle
+*                of the buffer are encoded, and the buffer is worth
+*                encoding only if they shrink.  Compressed, encrypted and
+*                random data fail both tests at a small fraction of the
+*                cost of encoding all of it.
+*   Parameters : encoder - encoder context used for the trial encoding
+*                in - data that may be encoded
+*                inLen - number of bytes in in
+*   Effects    : The encoder's dictionary is replaced.
+*   Returned   : 1 if in is worth encoding, 0 if it should be stored, -1
+*                for failure.  errno will be set in the event of a failure.
 ***************************************************************************/
-static dict_node_t *MakeNode(const unsigned int codeWord,
-    const unsigned int prefixCode, const unsigned char suffixChar)
+int LZWIsCompressible(lzw_encoder_t *encoder, const unsigned char *in,
+    const size_t inLen)
 {
-    dict_node_t *node;
+    unsigned long counts[UCHAR_MAX + 1];
+    unsigned char *trial;
+    size_t i, trialLen, codedLen;
+    double entropy;
+    int result;
+
+    /* validate arguments */
+    if ((NULL == encoder) || ((NULL == in) && (0 != inLen)))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (inLen < SNIFF_MIN_LEN)
+    {
+        return 1;
+    }
+
+    /* entropy = log2(n) - sum(count * log2(count)) / n */
+    memset(counts, 0, sizeof(counts));
+
+    for (i = 0; i < inLen; i++)
+    {
+        counts[in[i]]++;
+    }
+
+    entropy = 0.0;
+
+    for (i = 0; i <= UCHAR_MAX; i++)
+    {
+        if (0 != counts[i])
+        {
+            entropy += counts[i] * Log2((double)counts[i]);
+        }
+    }
+
+    entropy = Log2((double)inLen) - (entropy / inLen);
+
+    if (entropy < SNIFF_ENTROPY_LIMIT)
+    {
+        return 1;
+    }
+
+    /* let a trial from the middle decide */
+    trialLen = (inLen < SNIFF_TRIAL_LEN) ? inLen : SNIFF_TRIAL_LEN;
+    trial = LZWAlloc(LZW_MEM_IO, LZWEncodeBound(trialLen));
 
-    node = malloc(sizeof(dict_node_t));
+    if (NULL == trial)
+    {
+        return -1;
+    }
+
+    result = LZWEncodeBuffer(encoder, in + ((inLen - trialLen) / 2),
+        trialLen, trial, LZWEncodeBound(trialLen), &codedLen);
+    LZWRelease(trial);
 
-    if (NULL != node)
+    if (0 != result)
     {
-        node->codeWord = codeWord;
-        node->prefixCode = prefixCode;
-        node->suffixChar = suffixChar;
+        return -1;
+    }
+
+    return (codedLen < trialLen) ? 1 : 0;
+}
 
-        node->left = NULL;
-        node->right = NULL;
+/***************************************************************************
+*   Function   : LZWEncodeStart
+*   Description: This routine starts a new LZW stream that will be encoded
+*                one chunk at a time with LZWEncodeChunk and completed with
+*                LZWEncodeEnd.
+*   Parameters : encoder - encoder context from LZWMakeEncoder
+*   Effects    : The encoder's dictionary is emptied.
+*   Returned   : None
+***************************************************************************/
+void LZWEncodeStart(lzw_encoder_t *encoder)
+{
+    if (encoder->nextCode > encoder->peakCode)
+    {
+        encoder->peakCode = encoder->nextCode;
     }
 
-    return node;
+    encoder->nextCode = FIRST_CODE;
+    encoder->code = NO_STRING;
+    encoder->codeLen = MIN_CODE_LEN;
+    encoder->bits = 0;
+    encoder->bitCount = 0;
+
+#ifdef LZW_STATS
+    memset(&encoder->stats, 0, sizeof(encoder->stats));
+    encoder->probes = 0;
+#endif
 }
 
 /***************************************************************************
-*   Function   : FreeTree
-*   Description: This routine will free all nodes of a tree rooted at the
-*                node past as a parameter.
-*   Parameters : node - root of tree to free
-*   Effects    : frees allocated tree node from initial parameter down.
-*   Returned   : none
+*   Function   : LZWEncodeChunk
+*   Description: This routine encodes the next chunk of a stream started by
+*                LZWEncodeStart.  Chunks may be any size, and the stream
+*                is the same no matter how the input is divided.  The last
+*                string of a chunk and any partial byte are held by the
+*                encoder until the next chunk or LZWEncodeEnd.
+*   Parameters : encoder - encoder context from LZWMakeEncoder
+*                in - data to encode
+*                inLen - number of bytes in in
+*                out - buffer receiving the encoded data
+*                outSize - size of out.  LZWEncodeBound(inLen) is enough.
+*                outLen - set to the number of bytes written to out
+*   Effects    : in is encoded into out.  The stream may not be continued
+*                after a failure.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
 ***************************************************************************/
-static void FreeTree(dict_node_t *node)
+int LZWEncodeChunk(lzw_encoder_t *encoder, const unsigned char *in,
+    const size_t inLen, unsigned char *out, const size_t outSize,
+    size_t *outLen)
 {
-    if (NULL == node)
+    bit_buffer_t bitBuffer;             /* encoded output */
+    unsigned int code;                  /* code for current string */
+    unsigned char currentCodeLen;       /* length of the current code */
+    unsigned int key;                   /* key for code + c */
+    unsigned int node;                  /* node of dictionary tree */
+    unsigned char c;                    /* character to add to string */
+    size_t i;
+
+    /* validate arguments */
+    if ((NULL == encoder) || ((NULL == in) && (0 != inLen)) ||
+        (NULL == out) || (NULL == outLen))
     {
-        /* nothing to free */
-        return;
+        errno = EINVAL;
+        return -1;
     }
 
-    /* free left branch */
-    if (node->left != NULL)
+    bitBuffer.buffer = out;
+    bitBuffer.size = outSize;
+    bitBuffer.count = 0;
+    bitBuffer.bits = encoder->bits;
+    bitBuffer.bitCount = encoder->bitCount;
+    STATS_OUTPUT(&bitBuffer, &encoder->stats);
+
+    currentCodeLen = encoder->codeLen;
+    code = encoder->code;
+    i = 0;
+
+    if ((NO_STRING == code) && (0 != inLen))
     {
-        FreeTree(node->left);
+        code = in[0];       /* start with code string = first character */
+        i = 1;
+        STATS_FIRST(encoder);
     }
 
-    /* free right branch */
-    if (node->right != NULL)
+    for (/* i set above */; i < inLen; i++)
     {
-        FreeTree(node->right);
+        c = in[i];
+
+        /* look for code + c in the dictionary */
+        key = MakeKey(code, c);
+        node = FindDictionaryEntry(encoder, key);
+
+        if ((NO_NODE != node) && (NODE(encoder, node).key == key))
+        {
+            /* code + c is in the dictionary, make it's code the new code */
+            STATS_SEARCH(encoder, 1);
+            code = node;
+            continue;
+        }
+
+        /* code + c is not in the dictionary, add it if there's room */
+        STATS_SEARCH(encoder, 0);
+
+        if (encoder->nextCode < MAX_CODES)
+        {
+            AddDictionaryEntry(encoder, node, key);
+        }
+
+        /* write out code for the string before c was added */
+        if (BufferPutString(&bitBuffer, code, &currentCodeLen) < 0)
+        {
+            return -1;
+        }
+
+        /* new code is just c */
+        code = c;
     }
 
-    /* free root */
-    free(node);
+    encoder->code = code;
+    encoder->codeLen = currentCodeLen;
+    encoder->bits = bitBuffer.bits;
+    encoder->bitCount = bitBuffer.bitCount;
+
+    *outLen = bitBuffer.count;
+    return 0;
 }
 
 /***************************************************************************
-*   Function   : FindDictionaryEntry
-*   Description: This routine searches the dictionary tree for an entry
-*                with a matching string (prefix code + suffix character).
-*                If one isn't found, the parent node for that string is
-*                returned.
-*   Parameters : prefixCode - code for the prefix of string
-*                c - last character in string
-*   Effects    : None
-*   Returned   : If string is in dictionary, pointer to node containing
-*                string, otherwise pointer to suitable parent node.  NULL
-*                is returned for an empty tree.
+*   Function   : LZWEncodeEnd
+*   Description: This routine completes a stream encoded with
+*                LZWEncodeChunk by writing the code for the last string and
+*                padding the final byte with zeros.
+*   Parameters : encoder - encoder context from LZWMakeEncoder
+*                out - buffer receiving the encoded data
+*                outSize - size of out.  LZWEncodeBound(0) is enough.
+*                outLen - set to the number of bytes written to out
+*   Effects    : The rest of the stream is written to out.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
 ***************************************************************************/
-static dict_node_t *FindDictionaryEntry(dict_node_t *root,
-    const int unsigned prefixCode, const unsigned char c)
+int LZWEncodeEnd(lzw_encoder_t *encoder, unsigned char *out,
+    const size_t outSize, size_t *outLen)
 {
-    unsigned int searchKey, key;
+    bit_buffer_t bitBuffer;             /* encoded output */
 
-    if (NULL == root)
+    /* validate arguments */
+    if ((NULL == encoder) || (NULL == out) || (NULL == outLen))
     {
-        return NULL;
+        errno = EINVAL;
+        return -1;
     }
 
-    searchKey = MakeKey(prefixCode, c);     /* key of string to find */
+    bitBuffer.buffer = out;
+    bitBuffer.size = outSize;
+    bitBuffer.count = 0;
+    bitBuffer.bits = encoder->bits;
+    bitBuffer.bitCount = encoder->bitCount;
+    STATS_OUTPUT(&bitBuffer, &encoder->stats);
 
-    while (1)
+    /* no more input.  write out last of the code. */
+    if ((NO_STRING != encoder->code) &&
+        (BufferPutCodeWord(&bitBuffer, encoder->code, encoder->codeLen) < 0))
+    {
+        return -1;
+    }
+
+    /* write out any unwritten bits, padded with zeros */
+    if (0 != bitBuffer.bitCount)
+    {
+        out[bitBuffer.count] = (unsigned char)
+            ((bitBuffer.bits << (CHAR_BIT - bitBuffer.bitCount)) & 0xFF);
+        bitBuffer.count++;
+    }
+
+    encoder->code = NO_STRING;
+    encoder->bits = 0;
+    encoder->bitCount = 0;
+
+    *outLen = bitBuffer.count;
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : LZWEncodeInterleaved
+*   Description: This routine encodes up to LZW_MAX_INTERLEAVE memory
+*                buffers, each as its own LZW stream, on the calling
+*                thread.  Searching a dictionary tree is a chain of
+*                dependent loads, so rather than finishing one buffer at a
+*                time, this routine visits one tree node from each buffer
+*                in turn and prefetches the next node each buffer will
+*                visit.  The cache misses of the different buffers then
+*                overlap.  Each buffer's output is bit for bit the same as
+*                LZWEncodeBuffer would produce.
+*   Parameters : encoders - array of count encoder contexts, one for each
+*                           buffer
+*                buffers - array of count buffers.  in, inLen, out, and
+*                          outSize are supplied by the caller, outLen is
+*                          set to the number of bytes written to out.
+*                          LZWEncodeBound(inLen) is enough for outSize.
+*                count - number of buffers (1 to LZW_MAX_INTERLEAVE)
+*   Effects    : Each buffer's in is encoded into its out.  The encoders'
+*                dictionaries are replaced.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+int LZWEncodeInterleaved(lzw_encoder_t *encoders[], lzw_buffer_t buffers[],
+    const unsigned int count)
+{
+    lane_t lanes[LZW_MAX_INTERLEAVE];
+    unsigned int active[LZW_MAX_INTERLEAVE];    /* lanes still searching */
+    unsigned int numActive;
+    unsigned int i;
+    size_t endLen;
+    int result;
+
+    /* validate arguments */
+    if ((NULL == encoders) || (NULL == buffers) || (0 == count) ||
+        (count > LZW_MAX_INTERLEAVE))
     {
-        /* key of current node */
-        key = MakeKey(root->prefixCode, root->suffixChar);
+        errno = EINVAL;
+        return -1;
+    }
+
+    numActive = 0;
 
-        if (key == searchKey)
+    for (i = 0; i < count; i++)
+    {
+        if ((NULL == encoders[i]) || (NULL == buffers[i].out) ||
+            ((NULL == buffers[i].in) && (0 != buffers[i].inLen)))
         {
-            /* current node contains string */
-            return root;
+            errno = EINVAL;
+            return -1;
         }
-        else if (searchKey < key)
+
+        lanes[i].encoder = encoders[i];
+        lanes[i].in = buffers[i].in;
+        lanes[i].inLen = buffers[i].inLen;
+        lanes[i].bitBuffer.buffer = buffers[i].out;
+        lanes[i].bitBuffer.size = buffers[i].outSize;
+        lanes[i].bitBuffer.count = 0;
+        lanes[i].bitBuffer.bits = 0;
+        lanes[i].bitBuffer.bitCount = 0;
+        LZWEncodeStart(encoders[i]);
+        STATS_OUTPUT(&lanes[i].bitBuffer, &encoders[i]->stats);
+
+        if (0 != buffers[i].inLen)
         {
-            if (NULL != root->left)
-            {
-                /* check left branch for string */
-                root = root->left;
-            }
-            else
+            /* start with code string = first character */
+            encoders[i]->code = buffers[i].in[0];
+            lanes[i].next = 1;
+            STATS_FIRST(encoders[i]);
+
+            if (StartLaneSearch(&lanes[i]))
             {
-                /* string isn't in tree, it can be added as a left child */
-                return root;
+                active[numActive] = i;
+                numActive++;
             }
         }
-        else
+    }
+
+    /* advance each lane by one tree node until every lane is done */
+    while (numActive > 0)
+    {
+        i = 0;
+
+        while (i < numActive)
         {
-            if (NULL != root->right)
+            result = StepLane(&lanes[active[i]]);
+
+            if (result < 0)
             {
-                /* check right branch for string */
-                root = root->right;
+                return -1;
+            }
+            else if (0 == result)
+            {
+                /* lane is out of input, replace it with the last lane */
+                numActive--;
+                active[i] = active[numActive];
             }
             else
             {
-                /* string isn't in tree, it can be added as a right child */
-                return root;
+                i++;
             }
         }
     }
+
+    for (i = 0; i < count; i++)
+    {
+        /* hand the partial byte back to the encoder to finish the stream */
+        encoders[i]->bits = lanes[i].bitBuffer.bits;
+        encoders[i]->bitCount = lanes[i].bitBuffer.bitCount;
+
+        if (0 != LZWEncodeEnd(encoders[i],
+            buffers[i].out + lanes[i].bitBuffer.count,
+            buffers[i].outSize - lanes[i].bitBuffer.count, &endLen))
+        {
+            return -1;
+        }
+
+        buffers[i].outLen = lanes[i].bitBuffer.count + endLen;
+    }
+
+    return 0;
 }
 
 /***************************************************************************
-*   Function   : PutCodeWord
-*   Description: This function writes a code word from to an encoded file.
-*                In order to deal with endian issue the code word is
-*                written least significant byte followed by the remaining
-*                bits.
-*   Parameters : bfpOut - bit file containing the encoded data
-*                code - code word to add to the encoded data
-*                codeLen - length of the code word
-*   Effects    : code word is written to the encoded output
-*   Returned   : EOF for failure, ENOTSUP unsupported architecture,
-*                otherwise the number of bits written.  If an error occurs
+*   Function   : LZWMakeDictionary
+*   Description: This routine builds a frozen dictionary holding the
+*                strings that LZW encoding would add while encoding a
+*                sample.  Once made, the dictionary is never changed, so
+*                any number of threads may encode and decode with it at the
+*                same time without locking.  Rebuilding from the same sample
+*                always produces the same dictionary.
+*   Parameters : sample - data representative of what will be encoded
+*                sampleLen - number of bytes in sample
+*   Effects    : Memory is allocated for the dictionary
+*   Returned   : Pointer to the new dictionary or NULL on error.  errno will
+*                be set on an error.
+***************************************************************************/
+lzw_dictionary_t *LZWMakeDictionary(const unsigned char *sample,
+    const size_t sampleLen)
+{
+    lzw_dictionary_t *dictionary;
+    unsigned long slots;
+    unsigned int code, found, index;
+    size_t i;
+
+    if ((NULL == sample) && (0 != sampleLen))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    dictionary = malloc(sizeof(lzw_dictionary_t));
+
+    if (NULL == dictionary)
+    {
+        return NULL;
+    }
+
+    /* at most one string per sample byte, with a hash at most half full */
+    for (slots = 2; (slots / 2) < (MAX_CODES - FIRST_CODE); slots *= 2)
+    {
+        if ((slots / 2) > sampleLen)
+        {
+            break;
+        }
+    }
+
+    dictionary->numCodes = FIRST_CODE;
+    dictionary->hashMask = slots - 1;
+    dictionary->sample = LZWAlloc(LZW_MEM_DICTIONARY, sampleLen + 1);
+    dictionary->sampleLen = sampleLen;
+    dictionary->id = SampleId(sample, sampleLen);
+    dictionary->prefix = LZWAlloc(LZW_MEM_DICTIONARY,
+        (MAX_CODES - FIRST_CODE) * sizeof(unsigned int));
+    dictionary->suffix = LZWAlloc(LZW_MEM_DICTIONARY,
+        MAX_CODES - FIRST_CODE);
+    dictionary->length = LZWAlloc(LZW_MEM_DICTIONARY,
+        (MAX_CODES - FIRST_CODE) * sizeof(unsigned int));
+    dictionary->hash = LZWAllocZeroed(LZW_MEM_DICTIONARY,
+        slots * sizeof(unsigned int));
+
+    if ((NULL == dictionary->prefix) || (NULL == dictionary->suffix) ||
+        (NULL == dictionary->length) || (NULL == dictionary->hash) ||
+        (NULL == dictionary->sample))
+    {
+        LZWFreeDictionary(dictionary);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    /* kept so the dictionary can be written to a dictionary file */
+    if (0 != sampleLen)
+    {
+        memcpy(dictionary->sample, sample, sampleLen);
+    }
+
+    /* encode the sample, keeping the strings and discarding the codes */
+    code = (0 == sampleLen) ? 0 : sample[0];
+
+    for (i = 1; i < sampleLen; i++)
+    {
+        found = FindFrozenEntry(dictionary, code, sample[i]);
+
+        if (NO_NODE != found)
+        {
+            code = found;
+            continue;
+        }
+
+        if (dictionary->numCodes < MAX_CODES)
+        {
+            index = dictionary->numCodes - FIRST_CODE;
+            dictionary->prefix[index] = code;
+            dictionary->suffix[index] = sample[i];
+            dictionary->length[index] = (code < FIRST_CODE) ? 2 :
+                (dictionary->length[code - FIRST_CODE] + 1);
+            dictionary->hash[FrozenSlot(dictionary, code, sample[i])] =
+                dictionary->numCodes;
+            dictionary->numCodes++;
+        }
+
+        code = sample[i];
+    }
+
+    /* every code fits in the same number of bits */
+    dictionary->codeLen = MIN_CODE_LEN;
+
+    while (CURRENT_MAX_CODES(dictionary->codeLen) < dictionary->numCodes)
+    {
+        dictionary->codeLen++;
+    }
+
+    return dictionary;
+}
+
+/***************************************************************************
+*   Function   : LZWFreeDictionary
+*   Description: This routine frees a frozen dictionary.
+*   Parameters : dictionary - dictionary made by LZWMakeDictionary (may be
+*                             NULL)
+*   Effects    : All memory used by dictionary is freed.
+*   Returned   : None
+***************************************************************************/
+void LZWFreeDictionary(lzw_dictionary_t *dictionary)
+{
+    if (NULL != dictionary)
+    {
+        LZWRelease(dictionary->prefix);
+        LZWRelease(dictionary->suffix);
+        LZWRelease(dictionary->length);
+        LZWRelease(dictionary->hash);
+        LZWRelease(dictionary->sample);
+        free(dictionary);
+    }
+}
+
+/***************************************************************************
+*   Function   : LZWDictionaryId
+*   Description: This routine returns the id of a frozen dictionary.  The
+*                id is a hash of the dictionary's sample, and is stored in
+*                streams encoded with a shared dictionary so that they
+*                can't be decoded with a different one.
+*   Parameters : dictionary - dictionary made by LZWMakeDictionary
+*   Effects    : None
+*   Returned   : 32 bit dictionary id
+***************************************************************************/
+unsigned long LZWDictionaryId(const lzw_dictionary_t *dictionary)
+{
+    return (NULL == dictionary) ? 0 : dictionary->id;
+}
+
+/***************************************************************************
+*   Function   : LZWEncodeFrozen
+*   Description: This routine encodes a memory buffer using only the
+*                strings in a frozen dictionary.  The longest string in the
+*                dictionary is matched at each position and its code is
+*                written using the dictionary's fixed code word length.
+*                Nothing is added to the dictionary, so any number of
+*                threads may use it at once.
+*   Parameters : dictionary - dictionary made by LZWMakeDictionary
+*                in - data to encode
+*                inLen - number of bytes in in
+*                out - buffer receiving the encoded data
+*                outSize - size of out.  LZWEncodeBound(inLen) is enough.
+*                outLen - set to the number of bytes written to out
+*   Effects    : in is encoded into out.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+int LZWEncodeFrozen(const lzw_dictionary_t *dictionary,
+    const unsigned char *in, const size_t inLen, unsigned char *out,
+    const size_t outSize, size_t *outLen)
+{
+    bit_buffer_t bitBuffer;             /* encoded output */
+    unsigned int code;                  /* code for current string */
+    unsigned int found;                 /* code for current string + c */
+    size_t i;
+
+    /* validate arguments */
+    if ((NULL == dictionary) || ((NULL == in) && (0 != inLen)) ||
+        (NULL == out) || (NULL == outLen))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    bitBuffer.buffer = out;
+    bitBuffer.size = outSize;
+    bitBuffer.count = 0;
+    bitBuffer.bits = 0;
+    bitBuffer.bitCount = 0;
+    STATS_OUTPUT(&bitBuffer, NULL);
+
+    if (0 != inLen)
+    {
+        code = in[0];
+
+        for (i = 1; i < inLen; i++)
+        {
+            found = FindFrozenEntry(dictionary, code, in[i]);
+
+            if (NO_NODE != found)
+            {
+                code = found;
+                continue;
+            }
+
+            if (BufferPutCodeWord(&bitBuffer, code, dictionary->codeLen) < 0)
+            {
+                return -1;
+            }
+
+            code = in[i];
+        }
+
+        if (BufferPutCodeWord(&bitBuffer, code, dictionary->codeLen) < 0)
+        {
+            return -1;
+        }
+    }
+
+    /* write out any unwritten bits, padded with zeros */
+    if (0 != bitBuffer.bitCount)
+    {
+        out[bitBuffer.count] = (unsigned char)
+            ((bitBuffer.bits << (CHAR_BIT - bitBuffer.bitCount)) & 0xFF);
+        bitBuffer.count++;
+    }
+
+    *outLen = bitBuffer.count;
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : StartLaneSearch
+*   Description: This routine takes the next character of a lane's input
+*                and prepares to search the lane's dictionary for the
+*                current string plus that character.  The root of the tree
+*                is prefetched.
+*   Parameters : lane - lane to advance
+*   Effects    : lane's key, node, and character are set
+*   Returned   : 1 if a search was started, 0 if the lane is out of input.
+***************************************************************************/
+static int StartLaneSearch(lane_t *lane)
+{
+    lzw_encoder_t *encoder;
+
+    if (lane->next == lane->inLen)
+    {
+        return 0;
+    }
+
+    encoder = lane->encoder;
+    lane->c = lane->in[lane->next];
+    lane->next++;
+    lane->key = MakeKey(encoder->code, lane->c);
+
+    if (FIRST_CODE == encoder->nextCode)
+    {
+        lane->node = NO_NODE;   /* the tree is empty */
+    }
+    else
+    {
+        lane->node = FIRST_CODE;
+        PREFETCH(&NODE(encoder, FIRST_CODE));
+    }
+
+    return 1;
+}
+
+/***************************************************************************
+*   Function   : StepLane
+*   Description: This routine visits the next node of a lane's dictionary
+*                search.  If the search must continue, the next node is
+*                prefetched and the routine returns so that other lanes may
+*                run while it loads.  If the string was found, or it isn't
+*                in the dictionary, the lane is encoded as LZWEncodeChunk
+*                would and the next search is started.
+*   Parameters : lane - lane to advance
+*   Effects    : lane's dictionary and output may be updated
+*   Returned   : 1 if the lane is still searching, 0 if the lane is out of
+*                input, and -1 on failure.
+***************************************************************************/
+static int StepLane(lane_t *lane)
+{
+    lzw_encoder_t *encoder;
+    const dict_node_t *entry;
+    unsigned int child;
+
+    encoder = lane->encoder;
+
+    if (NO_NODE != lane->node)
+    {
+        entry = &NODE(encoder, lane->node);
+        STATS_PROBE(encoder);
+
+        if (entry->key == lane->key)
+        {
+            /* code + c is in the dictionary, make it's code the new code */
+            STATS_SEARCH(encoder, 1);
+            encoder->code = lane->node;
+            return StartLaneSearch(lane);
+        }
+
+        child = (lane->key < entry->key) ? entry->left : entry->right;
+
+        if (NO_NODE != child)
+        {
+            /* keep searching, but let the other lanes run first */
+            lane->node = child;
+            PREFETCH(&NODE(encoder, child));
+            return 1;
+        }
+    }
+
+    /* code + c is not in the dictionary, add it below node if there's room */
+    STATS_SEARCH(encoder, 0);
+
+    if (encoder->nextCode < MAX_CODES)
+    {
+        AddDictionaryEntry(encoder, lane->node, lane->key);
+    }
+
+    /* write out code for the string before c was added */
+    if (BufferPutString(&lane->bitBuffer, encoder->code,
+        &encoder->codeLen) < 0)
+    {
+        return -1;
+    }
+
+    /* new code is just c */
+    encoder->code = lane->c;
+    return StartLaneSearch(lane);
+}
+
+/***************************************************************************
+*   Function   : MakeKey
+*   Description: This routine creates a simple key from a prefix code and
+*                an appended character.  The key may be used to establish
+*                an order when building/searching a dictionary tree.
+*   Parameters : prefixCode - code for all but the last character of a
+*                             string.
+*                suffixChar - the last character of a string
+*   Effects    : None
+*   Returned   : Key built from string represented as a prefix + char.  Key
+*                format is {ms nibble of c} + prefix + {ls nibble of c}
+***************************************************************************/
+static unsigned int MakeKey(const unsigned int prefixCode,
+    const unsigned char suffixChar)
+{
+    unsigned int key;
+
+    /* position ms nibble */
+    key = suffixChar & 0xF0;
+    key <<= MAX_CODE_LEN;
+
+    /* include prefix code */
+    key |= (prefixCode << 4);
+
+    /* inclulde ls nibble */
+    key |= (suffixChar & 0x0F);
+
+    return key;
+}
+
+/***************************************************************************
+*   Function   : FrozenSlot
+*   Description: This routine finds the hash slot for a string in a frozen
+*                dictionary.  Collisions are resolved by probing the
+*                following slots.
+*   Parameters : dictionary - dictionary to search
+*                prefix - code for all but the last character of the string
+*                suffix - last character of the string
+*   Effects    : None
+*   Returned   : Index of the slot holding the string, or of the empty slot
+*                where it belongs.
+***************************************************************************/
+static unsigned long FrozenSlot(const lzw_dictionary_t *dictionary,
+    const unsigned int prefix, const unsigned char suffix)
+{
+    unsigned long slot;
+    unsigned int code;
+
+    slot = ((unsigned long)prefix << CHAR_BIT) | suffix;
+    slot = ((slot * 2654435761UL) >> 7) & dictionary->hashMask;
+
+    while (0 != (code = dictionary->hash[slot]))
+    {
+        if ((dictionary->prefix[code - FIRST_CODE] == prefix) &&
+            (dictionary->suffix[code - FIRST_CODE] == suffix))
+        {
+            break;
+        }
+
+        slot = (slot + 1) & dictionary->hashMask;
+    }
+
+    return slot;
+}
+
+/***************************************************************************
+*   Function   : Log2
+*   Description: This routine returns the base 2 logarithm of a number
+*                without the math library.  The integer part is counted by
+*                halving, and each of SNIFF_LOG_BITS fraction bits is found
+*                by squaring the mantissa.
+*   Parameters : x - number >= 1
+*   Effects    : None
+*   Returned   : log2(x) to within 2^-SNIFF_LOG_BITS
+***************************************************************************/
+static double Log2(double x)
+{
+    double result, bit;
+    unsigned int i;
+
+    result = 0.0;
+
+    while (x >= 2.0)
+    {
+        x /= 2.0;
+        result += 1.0;
+    }
+
+    for (i = 0, bit = 0.5; i < SNIFF_LOG_BITS; i++, bit /= 2.0)
+    {
+        x *= x;
+
+        if (x >= 2.0)
+        {
+            x /= 2.0;
+            result += bit;
+        }
+    }
+
+    return result;
+}
+
+/***************************************************************************
+*   Function   : SampleId
+*   Description: This routine computes the 32 bit FNV-1a hash of a sample
+*                for use as a dictionary id.
+*   Parameters : sample - sample the dictionary is built from
+*                sampleLen - number of bytes in sample
+*   Effects    : None
+*   Returned   : 32 bit hash of sample
+***************************************************************************/
+static unsigned long SampleId(const unsigned char *sample,
+    const size_t sampleLen)
+{
+    unsigned long hash;
+    size_t i;
+
+    hash = 2166136261UL;
+
+    for (i = 0; i < sampleLen; i++)
+    {
+        hash = ((hash ^ sample[i]) * 16777619UL) & 0xFFFFFFFFUL;
+    }
+
+    return hash;
+}
+
+/***************************************************************************
+*   Function   : FindFrozenEntry
+*   Description: This routine looks up a string in a frozen dictionary.
+*   Parameters : dictionary - dictionary to search
+*                prefix - code for all but the last character of the string
+*                suffix - last character of the string
+*   Effects    : None
+*   Returned   : Code for the string, or NO_NODE if it isn't in the
+*                dictionary.
+***************************************************************************/
+static unsigned int FindFrozenEntry(const lzw_dictionary_t *dictionary,
+    const unsigned int prefix, const unsigned char suffix)
+{
+    return dictionary->hash[FrozenSlot(dictionary, prefix, suffix)];
+}
+
+/***************************************************************************
+*   Function   : FindDictionaryEntry
+*   Description: This routine searches the dictionary tree for an entry
+*                with a matching key (prefix code + suffix character).  If
+*                one isn't found, the parent node for that key is returned.
+*   Parameters : encoder - encoder context containing the dictionary
+*                key - key of the string to find
+*   Effects    : The visit to each node is counted in LZW_STATS builds
+*   Returned   : If string is in dictionary, code of node containing
+*                string, otherwise code of suitable parent node.  NO_NODE
+*                is returned for an empty tree.
+***************************************************************************/
+static unsigned int FindDictionaryEntry(lzw_encoder_t *encoder,
+    const unsigned int key)
+{
+    unsigned int node;
+    const dict_node_t *entry;
+
+    if (FIRST_CODE == encoder->nextCode)
+    {
+        return NO_NODE;
+    }
+
+    node = FIRST_CODE;      /* the first string added is the root */
+
+    while (1)
+    {
+        entry = &NODE(encoder, node);
+        STATS_PROBE(encoder);
+
+        if (entry->key == key)
+        {
+            /* current node contains string */
+            return node;
+        }
+        else if (key < entry->key)
+        {
+            if (NO_NODE == entry->left)
+            {
+                /* string isn't in tree, it can be added as a left child */
+                return node;
+            }
+
+            /* check left branch for string */
+            node = entry->left;
+        }
+        else
+        {
+            if (NO_NODE == entry->right)
+            {
+                /* string isn't in tree, it can be added as a right child */
+                return node;
+            }
+
+            /* check right branch for string */
+            node = entry->right;
+        }
+    }
+}
+
+/***************************************************************************
+*   Function   : AddDictionaryEntry
+*   Description: This routine adds a string to the dictionary using the
+*                next available code and links it into the tree below the
+*                parent returned by FindDictionaryEntry.
+*   Parameters : encoder - encoder context containing the dictionary
+*                parent - code of parent node (NO_NODE for empty tree)
+*                key - key of the string to add
+*   Effects    : New node is added to the dictionary and nextCode is
+*                incremented.  The caller must make sure there is room.
+*   Returned   : None
+***************************************************************************/
+static void AddDictionaryEntry(lzw_encoder_t *encoder,
+    const unsigned int parent, const unsigned int key)
+{
+    dict_node_t *entry;
+
+    entry = &NODE(encoder, encoder->nextCode);
+    entry->key = key;
+    entry->left = NO_NODE;
+    entry->right = NO_NODE;
+
+    if (NO_NODE != parent)
+    {
+        if (key < NODE(encoder, parent).key)
+        {
+            NODE(encoder, parent).left = encoder->nextCode;
+        }
+        else
+        {
+            NODE(encoder, parent).right = encoder->nextCode;
+        }
+    }
+
+    encoder->nextCode++;
+}
+
+/***************************************************************************
+*   Function   : PutCodeWord
+*   Description: This function writes a code word from to an encoded file.
+*                In order to deal with endian issue the code word is
+*                written least significant byte followed by the remaining
+*                bits.
+*   Parameters : bfpOut - bit file containing the encoded data
+*                code - code word to add to the encoded data
+*                codeLen - length of the code word
+*   Effects    : code word is written to the encoded output
+*   Returned   : EOF for failure, ENOTSUP unsupported architecture,
+*                otherwise the number of bits written.  If an error occurs
 *                after a partial write, the partially written bits will not
 *                be unwritten.
 ***************************************************************************/
@@ -430,3 +1481,146 @@ static int PutCodeWord(bit_file_t *bfpOut, int code,
 {
     return BitFilePutBitsNum(bfpOut, &code, codeLen, sizeof(code));
 }
+
+/***************************************************************************
+*   Function   : BufferPutCodeWord
+*   Description: This function writes a code word to an encoded memory
+*                buffer.  Bits are written in the same order as
+*                PutCodeWord; the least significant byte first (ms bit to
+*                ls bit), followed by the next byte and the remaining bits.
+*   Parameters : out - bit buffer containing the encoded data
+*                code - code word to add to the encoded data
+*                codeLen - length of the code word (> CHAR_BIT)
+*   Effects    : code word is written to the encoded output
+*   Returned   : 0 for success, -1 (with errno set to ENOBUFS) if the
+*                buffer is full.
+***************************************************************************/
+static int BufferPutCodeWord(bit_buffer_t *out, const unsigned int code,
+    const unsigned char codeLen)
+{
+    unsigned long value;
+
+    if ((out->count + sizeof(unsigned int)) > out->size)
+    {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    /* reorder code so that it may be written ms bit first */
+    if (codeLen >= (2 * CHAR_BIT))
+    {
+        value = ((unsigned long)(code & 0xFF) << (codeLen - CHAR_BIT)) |
+            ((unsigned long)((code >> CHAR_BIT) & 0xFF) <<
+                (codeLen - (2 * CHAR_BIT))) |
+            (code >> (2 * CHAR_BIT));
+    }
+    else
+    {
+        value = ((unsigned long)(code & 0xFF) << (codeLen - CHAR_BIT)) |
+            (code >> CHAR_BIT);
+    }
+
+    out->bits = (out->bits << codeLen) | value;
+    out->bitCount += codeLen;
+    STATS_CODE(out, codeLen);
+
+    while (out->bitCount >= CHAR_BIT)
+    {
+        out->bitCount -= CHAR_BIT;
+        out->buffer[out->count] =
+            (unsigned char)((out->bits >> out->bitCount) & 0xFF);
+        out->count++;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : BufferPutString
+*   Description: This function writes the code for a string to an encoded
+*                memory buffer.  If the code doesn't fit in the current
+*                code word length, it is preceded by all ones code words
+*                marking each increase in length.
+*   Parameters : out - bit buffer containing the encoded data
+*                code - code of the string to write
+*                codeLen - pointer to the current code word length
+*   Effects    : Code words are written to the encoded output and codeLen
+*                may be increased
+*   Returned   : 0 for success, -1 (with errno set to ENOBUFS) if the
+*                buffer is full.
+***************************************************************************/
+static int BufferPutString(bit_buffer_t *out, const unsigned int code,
+    unsigned char *codeLen)
+{
+    /* are we using enough bits to write out this code word? */
+    while ((code >= (CURRENT_MAX_CODES(*codeLen) - 1)) &&
+        (*codeLen < MAX_CODE_LEN))
+    {
+        /* mark need for bigger code word with all ones */
+        if (BufferPutCodeWord(out, (CURRENT_MAX_CODES(*codeLen) - 1),
+            *codeLen) < 0)
+        {
+            return -1;
+        }
+
+        STATS_ESCAPE(out);
+        (*codeLen)++;
+    }
+
+    return BufferPutCodeWord(out, code, *codeLen);
+}
+
+#ifdef LZW_STATS
+/***************************************************************************
+*   Function   : CountSearch
+*   Description: This routine records the end of a dictionary search.  A
+*                search that misses adds its string below the last node
+*                visited, so the nodes visited are also the new string's
+*                depth in the tree.  Both are counted in power of 2 sized
+*                histogram buckets.
+*   Parameters : encoder - encoder context that made the search
+*                hit - non-zero if the string was found
+*   Effects    : encoder's statistics are updated and its count of nodes
+*                visited is cleared for the next search
+*   Returned   : None
+***************************************************************************/
+static void CountSearch(lzw_encoder_t *encoder, const int hit)
+{
+    lzw_stats_t *stats;
+    unsigned int bucket;
+
+    stats = &encoder->stats;
+
+    /* bucket is the number of bits in the count of nodes visited */
+    for (bucket = 0; (bucket < (LZW_STATS_DEPTHS - 1)) &&
+        ((encoder->probes >> bucket) != 0); bucket++)
+    {
+        /* count bits */
+    }
+
+    stats->bytes++;     /* each search takes one more character */
+    stats->nodes += encoder->probes;
+    stats->probes[bucket]++;
+    encoder->probes = 0;
+
+    if (hit)
+    {
+        stats->hits++;
+    }
+    else
+    {
+        stats->misses++;
+
+        if (encoder->nextCode < MAX_CODES)
+        {
+            stats->depths[bucket]++;
+
+            if ((MAX_CODES - 1) == encoder->nextCode)
+            {
+                /* this string takes the last code */
+                stats->fullAt = stats->bytes;
+            }
+        }
+    }
+}
+#endif
@@ -37,6 +37,7 @@
 ***************************************************************************/
 #include <stdio.h>
 #include <limits.h>
+#include "lzw.h"
 
 /***************************************************************************
 *                                CONSTANTS
@@ -47,6 +48,79 @@
 #define FIRST_CODE      (1 << CHAR_BIT)     /* value of 1st string code */
 #define MAX_CODES       (1 << MAX_CODE_LEN)
 
+/***************************************************************************
+* Block stream format (all multi-byte values are little endian):
+*   header : magic (4 bytes), version (1), flags (1), reserved (2),
+*            nominal block size (4)
+*   block  : uncompressed length (4), encoded length (4), encoded data
+*   end    : a block with an uncompressed length of 0
+* Each block's data is a complete LZW stream encoded with an empty
+* dictionary, so blocks may be encoded and decoded independently.  The
+* second magic byte has its MSB set.  That can never start a single stream
+* file because the 9th bit of its first (character) code is always 0.
+*
+* Blocks that wouldn't get smaller are stored instead of encoded.  A stored
+* block has BLOCK_STORED set in its encoded length, the rest of which is
+* the uncompressed length, and its data is the uncompressed data.
+*
+* If the BLOCK_FLAG_FROZEN flag is set, the header is followed by
+*   sample : uncompressed length (4), encoded length (4), the sample
+*            encoded as a single LZW stream
+* Both sides build the same frozen dictionary from the sample.  Each
+* block's data is then a sequence of fixed length codes from that
+* dictionary, with no code word length increases and no new strings.
+*
+* If the BLOCK_FLAG_SHARED flag is set, the blocks use a frozen dictionary
+* kept in a separate dictionary file, and the header is followed by
+*   id     : dictionary id (4)
+* A dictionary file holds one sample that many streams are encoded with:
+*   header : magic (4 bytes), version (1), reserved (3), dictionary id (4)
+*   sample : uncompressed length (4), encoded length (4), the sample
+*            encoded as a single LZW stream
+* The id is a hash of the sample, so a stream can't be decoded with the
+* wrong dictionary file.
+*
+* Archive format (offsets are from the start of the archive):
+*   header    : magic (4 bytes), version (1), flags (1), reserved (2),
+*               nominal block size (4)
+*   dictionary: a dictionary file, if ARCHIVE_FLAG_SHARED is set
+*   members   : each member's blocks, as in a block stream but with no
+*               header and no end block
+*   directory : for each member, data offset (8), uncompressed length (8),
+*               encoded length (8), name offset (4), name length (4)
+*   hash      : a power of 2 number of slots (4 each), holding a member's
+*               index + 1 or 0 for an empty slot
+*   names     : member names, not NUL terminated
+*   trailer   : directory offset (8), members (4), hash slots (4), names
+*               length (4), magic (4)
+* Members are placed in the hash by the FNV-1a hash of their names, with
+* linear probing, so one member is found and extracted with a few reads
+* starting from the trailer at the end of the file.  If the archive has a
+* dictionary, every member's blocks are encoded with it.
+***************************************************************************/
+#define BLOCK_MAGIC         "L\332WB"      /* 'L', 0xDA, 'W', 'B' */
+#define BLOCK_MAGIC_LEN     4
+#define BLOCK_VERSION       1
+#define BLOCK_HEADER_LEN    12
+#define BLOCK_PREFIX_LEN    8               /* bytes before block data */
+#define BLOCK_MAX_SIZE      (1UL << 30)     /* largest allowed block */
+#define BLOCK_STORED        0x80000000UL    /* encoded length: data is raw */
+
+#define BLOCK_FLAG_FROZEN   0x01            /* blocks use a sample dict. */
+#define BLOCK_FLAG_SHARED   0x02            /* ... from a dictionary file */
+#define BLOCK_FLAGS_KNOWN   (BLOCK_FLAG_FROZEN | BLOCK_FLAG_SHARED)
+
+#define DICT_MAGIC          "L\332WD"      /* 'L', 0xDA, 'W', 'D' */
+#define DICT_VERSION        1
+#define DICT_HEADER_LEN     12
+
+#define ARCHIVE_MAGIC       "L\332WA"      /* 'L', 0xDA, 'W', 'A' */
+#define ARCHIVE_VERSION     1
+#define ARCHIVE_HEADER_LEN  12
+#define ARCHIVE_ENTRY_LEN   32              /* bytes in a directory entry */
+#define ARCHIVE_TRAILER_LEN 24
+#define ARCHIVE_FLAG_SHARED 0x01            /* archive holds a dictionary */
+
 #if (MIN_CODE_LEN <= CHAR_BIT)
 #error Code words must be larger than 1 character
 #endif
@@ -55,9 +129,99 @@
 #error There cannot be more codes than can fit in an integer
 #endif
 
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* frozen dictionary built from a sample.  read-only once it is made. */
+struct lzw_dictionary_t
+{
+    unsigned int numCodes;      /* codes below this are defined */
+    unsigned char codeLen;      /* bits in each code word */
+
+    /* strings, indexed by code - FIRST_CODE */
+    unsigned int *prefix;       /* code for all but the last character */
+    unsigned char *suffix;      /* last character */
+    unsigned int *length;       /* number of characters */
+
+    /* open addressed hash of string codes by prefix + suffix */
+    unsigned int *hash;         /* string code or 0 for an empty slot */
+    unsigned long hashMask;     /* number of slots - 1 */
+
+    unsigned char *sample;      /* copy of the sample or NULL */
+    size_t sampleLen;           /* number of bytes in sample */
+    unsigned long id;           /* hash identifying the sample */
+};
+
+/* what a block from LZWAlloc is used for (see LZWMemoryUsage) */
+typedef enum
+{
+    LZW_MEM_DICTIONARY,         /* dictionary tables */
+    LZW_MEM_IO,                 /* buffers and stacks of data being coded */
+    LZW_MEM_KINDS
+} lzw_mem_kind_t;
+
 /***************************************************************************
 *                                  MACROS
 ***************************************************************************/
 #define CURRENT_MAX_CODES(bits)     ((unsigned int)(1 << (bits)))
 
+/* lock-free loads/stores shared between threads (gcc/clang builtins) */
+#define ATOMIC_LOAD(p)          __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE(p, v)      __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define ATOMIC_ADD(p, v)        __atomic_add_fetch((p), (v), __ATOMIC_ACQ_REL)
+#define ATOMIC_SUB(p, v)        __atomic_sub_fetch((p), (v), __ATOMIC_ACQ_REL)
+#define ATOMIC_CAS(p, e, v)     __atomic_compare_exchange_n((p), (e), (v),   \
+                                    0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+/* hint that data will be read soon (no-op where unsupported) */
+#ifdef __GNUC__
+#define PREFETCH(p)             __builtin_prefetch((p), 0, 3)
+#else
+#define PREFETCH(p)             ((void)(p))
+#endif
+
+/* read/write 32 bit little endian values from/to byte arrays */
+#define GET_LE32(p)     ((unsigned long)(p)[0] |                            \
+                         ((unsigned long)(p)[1] << 8) |                     \
+                         ((unsigned long)(p)[2] << 16) |                    \
+                         ((unsigned long)(p)[3] << 24))
+
+#define PUT_LE32(p, v)  do {                                                \
+                            (p)[0] = (unsigned char)((v) & 0xFF);           \
+                            (p)[1] = (unsigned char)(((v) >> 8) & 0xFF);    \
+                            (p)[2] = (unsigned char)(((v) >> 16) & 0xFF);   \
+                            (p)[3] = (unsigned char)(((v) >> 24) & 0xFF);   \
+                        } while (0)
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* block stream helpers shared by lzwparallel.c and lzwbatch.c */
+int LZWValidateParams(const lzw_params_t *params, lzw_params_t *valid,
+    const size_t inLen);
+int LZWWriteStreamHeader(FILE *fpOut, const size_t blockSize,
+    const unsigned char flags, const lzw_dictionary_t *dictionary);
+int LZWWriteStreamEnd(FILE *fpOut);
+int LZWEncodeBlock(lzw_encoder_t *encoder,
+    const lzw_dictionary_t *dictionary, const unsigned char *in,
+    const size_t inLen, unsigned char *out, size_t *outLen);
+
+/* allocations counted by LZWMemoryUsage.  free them with LZWRelease. */
+void *LZWAlloc(const lzw_mem_kind_t kind, const size_t size);
+void *LZWAllocZeroed(const lzw_mem_kind_t kind, const size_t size);
+void *LZWResize(const lzw_mem_kind_t kind, void *block, const size_t size);
+void LZWRelease(void *block);
+
+/* describing an archive for LZWInspectFile */
+int LZWInspectArchive(FILE *fpIn, lzw_info_t *info);
+
+/* decoding legacy streams in parallel once their dictionary is full */
+int LZWDecodeUntilFrozen(lzw_decoder_t *decoder, const unsigned char *in,
+    const size_t inLen, FILE *fpOut, size_t *bitsUsed);
+lzw_dictionary_t *LZWFreezeDecoder(const lzw_decoder_t *decoder);
+int LZWDecodeFrozenBits(const lzw_dictionary_t *dictionary,
+    const unsigned char *in, const size_t inLen,
+    const unsigned int skipBits, const unsigned long numCodes,
+    unsigned char *out, const size_t outSize, size_t *outLen);
+
 #endif  /* ndef _LZWLOCAL_H_ */
@@ -0,0 +1,307 @@
+/***************************************************************************
+*             Memory Accounting for the Lempel-Ziv-Welch Library
+*
+*   File    : lzwmemory.c
+*   Purpose : Counts the bytes held by the library's large allocations:
+*             dictionaries, and the buffers and decoder stacks holding data
+*             being coded.  The current and peak bytes of each kind are
+*             kept for the whole library, so a process can be given a
+*             memory limit that fits the work it does.
+*   Author  : The lzw library contributors
+*   Date    : October 17, 2026
+*
+****************************************************************************
+*
+* LZW: An ANSI C Lempel-Ziv-Welch Encoding/Decoding Routines
+* Copyright (C) 2026 by
+* The lzw library contributors
+*
+* This file is part of the lzw library.
+*
+* The lzw library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The lzw library is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdlib.h>
+#include <errno.h>
+#include "lzw.h"
+#include "lzwlocal.h"
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* precedes each block so it can be uncounted when it's freed.  the union
+ * keeps the block that follows aligned for any type. */
+typedef union
+{
+    struct
+    {
+        size_t size;            /* bytes requested by the caller */
+        lzw_mem_kind_t kind;    /* what the block is used for */
+    } info;
+
+    long double alignLongDouble;
+    void *alignPointer;
+    long alignLong;
+} block_header_t;
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define TOTAL           LZW_MEM_KINDS   /* counter index for all kinds */
+
+/***************************************************************************
+*                            GLOBAL VARIABLES
+***************************************************************************/
+/* bytes held now and the most held at once, by kind and in total */
+static size_t current[LZW_MEM_KINDS + 1];
+static size_t peak[LZW_MEM_KINDS + 1];
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+static void *Track(block_header_t *header, const lzw_mem_kind_t kind,
+    const size_t size);
+static void Count(const int counter, const size_t size);
+static void Uncount(const int counter, const size_t size);
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : LZWAlloc
+*   Description: This routine allocates a block of memory that is counted
+*                by LZWMemoryUsage until it's freed by LZWRelease.
+*   Parameters : kind - what the block will be used for
+*                size - number of bytes to allocate
+*   Effects    : The library's count of bytes of this kind is increased.
+*   Returned   : Pointer to the block or NULL on error.  errno will be set
+*                on an error.
+***************************************************************************/
+void *LZWAlloc(const lzw_mem_kind_t kind, const size_t size)
+{
+    if (size > ((size_t)-1 - sizeof(block_header_t)))
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return Track(malloc(sizeof(block_header_t) + size), kind, size);
+}
+
+/***************************************************************************
+*   Function   : LZWAllocZeroed
+*   Description: This routine allocates a block of memory filled with 0s
+*                that is counted by LZWMemoryUsage until it's freed by
+*                LZWRelease.  Like calloc, large blocks aren't touched
+*                until they are used.
+*   Parameters : kind - what the block will be used for
+*                size - number of bytes to allocate
+*   Effects    : The library's count of bytes of this kind is increased.
+*   Returned   : Pointer to the block or NULL on error.  errno will be set
+*                on an error.
+***************************************************************************/
+void *LZWAllocZeroed(const lzw_mem_kind_t kind, const size_t size)
+{
+    if (size > ((size_t)-1 - sizeof(block_header_t)))
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return Track(calloc(1, sizeof(block_header_t) + size), kind, size);
+}
+
+/***************************************************************************
+*   Function   : LZWResize
+*   Description: This routine changes the size of a block from LZWAlloc
+*                the way realloc does.
+*   Parameters : kind - what the block is used for
+*                block - block to resize or NULL to allocate a new one
+*                size - number of bytes the block should hold
+*   Effects    : The library's count of bytes of this kind is changed by
+*                the change in size.
+*   Returned   : Pointer to the resized block or NULL on error.  block is
+*                unchanged on an error and errno will be set.
+***************************************************************************/
+void *LZWResize(const lzw_mem_kind_t kind, void *block, const size_t size)
+{
+    block_header_t *header;
+    size_t oldSize;
+
+    if (NULL == block)
+    {
+        return LZWAlloc(kind, size);
+    }
+
+    if (size > ((size_t)-1 - sizeof(block_header_t)))
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    header = (block_header_t *)block - 1;
+    oldSize = header->info.size;
+    header = realloc(header, sizeof(block_header_t) + size);
+
+    if (NULL == header)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    /* realloc may hold both blocks while it copies, so peaks count both */
+    header->info.size = size;
+    Count(kind, size);
+    Count(TOTAL, size);
+    Uncount(kind, oldSize);
+    Uncount(TOTAL, oldSize);
+    return header + 1;
+}
+
+/***************************************************************************
+*   Function   : LZWRelease
+*   Description: This routine frees a block from LZWAlloc, LZWAllocZeroed,
+*                or LZWResize.
+*   Parameters : block - block to free (may be NULL)
+*   Effects    : The block is freed and the library's count of bytes of
+*                its kind is decreased.
+*   Returned   : None
+***************************************************************************/
+void LZWRelease(void *block)
+{
+    block_header_t *header;
+
+    if (NULL != block)
+    {
+        header = (block_header_t *)block - 1;
+        Uncount(header->info.kind, header->info.size);
+        Uncount(TOTAL, header->info.size);
+        free(header);
+    }
+}
+
+/***************************************************************************
+*   Function   : LZWMemoryUsage
+*   Description: This routine reports the bytes of dictionaries, stacks,
+*                and data buffers held by all of the library's contexts and
+*                calls, and the most that were held at once since the
+*                library was loaded or LZWResetMemoryPeaks was called.
+*                Small bookkeeping structures aren't counted.
+*   Parameters : memory - receives the library's memory use
+*   Effects    : None
+*   Returned   : None
+***************************************************************************/
+void LZWMemoryUsage(lzw_memory_t *memory)
+{
+    if (NULL == memory)
+    {
+        return;
+    }
+
+    memory->dictionary.current = ATOMIC_LOAD(&current[LZW_MEM_DICTIONARY]);
+    memory->dictionary.peak = ATOMIC_LOAD(&peak[LZW_MEM_DICTIONARY]);
+    memory->io.current = ATOMIC_LOAD(&current[LZW_MEM_IO]);
+    memory->io.peak = ATOMIC_LOAD(&peak[LZW_MEM_IO]);
+    memory->total.current = ATOMIC_LOAD(&current[TOTAL]);
+    memory->total.peak = ATOMIC_LOAD(&peak[TOTAL]);
+    memory->reserved = memory->total.current;
+}
+
+/***************************************************************************
+*   Function   : LZWResetMemoryPeaks
+*   Description: This routine starts measuring new peaks, so the memory
+*                used by one operation can be told from earlier ones.
+*   Parameters : None
+*   Effects    : Each peak reported by LZWMemoryUsage is set to the bytes
+*                held now.
+*   Returned   : None
+***************************************************************************/
+void LZWResetMemoryPeaks(void)
+{
+    int i;
+
+    for (i = 0; i <= TOTAL; i++)
+    {
+        ATOMIC_STORE(&peak[i], ATOMIC_LOAD(&current[i]));
+    }
+}
+
+/***************************************************************************
+*   Function   : Track
+*   Description: This function fills in the header of a newly allocated
+*                block and counts the block.
+*   Parameters : header - newly allocated header and block or NULL
+*                kind - what the block will be used for
+*                size - number of bytes in the block
+*   Effects    : The library's count of bytes of this kind is increased.
+*   Returned   : Pointer to the block after header or NULL if header is
+*                NULL.  errno will be set if header is NULL.
+***************************************************************************/
+static void *Track(block_header_t *header, const lzw_mem_kind_t kind,
+    const size_t size)
+{
+    if (NULL == header)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    header->info.size = size;
+    header->info.kind = kind;
+    Count(kind, size);
+    Count(TOTAL, size);
+    return header + 1;
+}
+
+/***************************************************************************
+*   Function   : Count
+*   Description: This function adds bytes to a counter and raises its peak
+*                if that's a new high.
+*   Parameters : counter - kind of memory or TOTAL
+*                size - number of bytes added
+*   Effects    : current[counter] and maybe peak[counter] are increased.
+*   Returned   : None
+***************************************************************************/
+static void Count(const int counter, const size_t size)
+{
+    size_t now;
+    size_t high;
+
+    now = ATOMIC_ADD(&current[counter], size);
+    high = ATOMIC_LOAD(&peak[counter]);
+
+    /* a failed exchange reloads high, so retry while now is still higher */
+    while ((now > high) && !ATOMIC_CAS(&peak[counter], &high, now))
+    {
+        continue;
+    }
+}
+
+/***************************************************************************
+*   Function   : Uncount
+*   Description: This function subtracts bytes from a counter.
+*   Parameters : counter - kind of memory or TOTAL
+*                size - number of bytes removed
+*   Effects    : current[counter] is decreased.
+*   Returned   : None
+***************************************************************************/
+static void Uncount(const int counter, const size_t size)
+{
+    (void)ATOMIC_SUB(&current[counter], size);
+}
@@ -0,0 +1,2254 @@
+/***************************************************************************
+*               Block-Parallel Lempel-Ziv-Welch Routines
+*
+*   File    : lzwparallel.c
+*   Purpose : Provides functions that split a file into independent
+*             blocks, encode the blocks on a pool of threads, and write
+*             them out in their original order, as well as functions that
+*             decode such block streams on a pool of threads.
+*   Author  : The lzw library contributors
+*   Date    : October 17, 2026
+*
+****************************************************************************
+*
+* LZW: An ANSI C Lempel-Ziv-Welch Encoding/Decoding Routines
+* Copyright (C) 2026 by
+* The lzw library contributors
+*
+* This file is part of the lzw library.
+*
+* The lzw library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The lzw library is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "lzw.h"
+#include "lzwlocal.h"
+#include "lzwpool.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define DECODE_CHUNK        (1UL << 20)     /* single stream bytes read */
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+typedef enum
+{
+    SLOT_FREE,                  /* slot may be filled with a new block */
+    SLOT_BUSY,                  /* block is waiting for or being coded */
+    SLOT_DONE                   /* coded block is waiting to be written */
+} slot_state_t;
+
+struct parallel_t;
+
+/* one block of data in flight */
+typedef struct
+{
+    lzw_job_t job;              /* job coding this block (must be first) */
+    struct parallel_t *shared;  /* state shared by all slots */
+
+    unsigned char *in;          /* block data to be coded */
+    size_t inLen;               /* number of bytes in in */
+    unsigned char *out;         /* coded block data */
+    size_t outSize;             /* size of out */
+    size_t outLen;              /* number of bytes in out */
+    size_t blockLen;            /* decoded length from the block prefix */
+    int stored;                 /* block data is stored, not encoded */
+    off_t offset;               /* output offset for positional writes */
+
+    slot_state_t state;         /* protected by shared->lock */
+    int error;                  /* errno value if coding failed */
+} block_slot_t;
+
+/* state shared between the reading/writing thread and the workers */
+typedef struct parallel_t
+{
+    pthread_mutex_t lock;       /* protects slot states */
+    pthread_cond_t done;        /* signaled when a slot is coded */
+    block_slot_t *slots;        /* ring of blocks in flight */
+    unsigned int numSlots;      /* number of slots in ring */
+
+    size_t blockSize;           /* nominal uncompressed block size */
+    int fd;                     /* workers pwrite here, -1 to write in order */
+    off_t offset;               /* output offset of the next block read */
+
+    lzw_dictionary_t *dictionary;   /* frozen dictionary or NULL */
+    int borrowed;               /* dictionary belongs to the caller */
+    unsigned char *sample;      /* sample the dictionary was built from */
+    size_t sampleLen;           /* number of bytes in sample */
+    size_t pendingLen;          /* sample bytes not yet read into blocks */
+
+    const unsigned char *map;   /* mapped legacy stream being decoded */
+    size_t mapLen;              /* number of bytes in map */
+    size_t mapPos;              /* byte holding the next chunk's first bit */
+    unsigned int skipBits;      /* bits of map[mapPos] before that bit */
+
+    size_t bytesIn;             /* input coded so far, for progress */
+    size_t bytesOut;            /* output written so far, for progress */
+
+    lzw_sink_t sink;            /* receives blocks in order, or NULL for fpOut */
+    void *sinkArg;              /* passed to sink */
+} parallel_t;
+
+/* reads the next block into a slot.  returns 1 for a block, 0 at the end
+ * of the input, and -1 on error. */
+typedef int (*read_block_t)(parallel_t *shared, block_slot_t *slot,
+    FILE *fpIn);
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+static parallel_t *MakeSlots(const unsigned int numSlots,
+    const size_t inSize, const size_t outSize,
+    void (*run)(lzw_job_t *job, lzw_worker_t *worker));
+static void FreeSlots(parallel_t *shared);
+static void WaitForSlot(block_slot_t *slot);
+static void MarkSlotDone(block_slot_t *slot, const int error);
+static int RunBlocks(parallel_t *shared, const lzw_params_t *params,
+    FILE *fpIn, FILE *fpOut, read_block_t ReadBlock);
+static int WriteBlock(void *arg, const unsigned char *data,
+    const size_t len);
+
+/* encoding */
+static int ReadRawBlock(parallel_t *shared, block_slot_t *slot, FILE *fpIn);
+static void EncodeBlockJob(lzw_job_t *job, lzw_worker_t *worker);
+static int WriteSample(parallel_t *shared, const size_t sampleSize,
+    FILE *fpIn, FILE *fpOut);
+static int WriteCodedSample(FILE *fpOut, const unsigned char *sample,
+    const size_t sampleLen);
+
+/* decoding */
+static int ReadCodedBlock(parallel_t *shared, block_slot_t *slot,
+    FILE *fpIn);
+static int DecodeSingleStream(FILE *fpIn, const unsigned char *start,
+    const size_t startLen, lzw_decoder_t *decoder, lzw_sink_t sink,
+    void *arg);
+static void DecodeBlockJob(lzw_job_t *job, lzw_worker_t *worker);
+static parallel_t *StartBlocks(FILE *fpIn, const size_t blockSize,
+    const unsigned char flags, const lzw_params_t *valid);
+static int ReadStreamHeader(FILE *fpIn, size_t *blockSize,
+    unsigned char *flags);
+static int ParseStreamHeader(const unsigned char *header, size_t *blockSize,
+    unsigned char *flags);
+static int ReadSample(parallel_t *shared, FILE *fpIn);
+static int ReadCodedSample(FILE *fpIn, unsigned char **sample,
+    size_t *sampleLen);
+static int UseSharedDictionary(parallel_t *shared, FILE *fpIn,
+    lzw_dictionary_t *dictionary);
+static int UsePositionalWrites(FILE *fpOut, off_t *offset);
+static size_t InputLength(FILE *fpIn);
+
+/* inspecting */
+static int InspectBlocks(FILE *fpIn, const unsigned char flags,
+    const off_t end, lzw_info_t *info);
+static int SkipBytes(FILE *fpIn, const size_t len, const int seekable);
+
+/* decoding legacy streams */
+static int ReadLegacyChunk(parallel_t *shared, block_slot_t *slot,
+    FILE *fpIn);
+static void DecodeChunkJob(lzw_job_t *job, lzw_worker_t *worker);
+static int DecodeFrozenTail(const unsigned char *map, const size_t mapLen,
+    const size_t bitsUsed, const size_t decodedLen, lzw_decoder_t *decoder,
+    const lzw_params_t *params, FILE *fpOut);
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : LZWDefaultParams
+*   Description: This routine sets block-parallel parameters to their
+*                default values.
+*   Parameters : params - pointer to the parameters to set
+*   Effects    : params is filled in with defaults
+*   Returned   : None
+***************************************************************************/
+void LZWDefaultParams(lzw_params_t *params)
+{
+    if (NULL != params)
+    {
+        params->threads = 0;
+        params->blockSize = 0;          /* automatic */
+        params->maxInFlight = 0;
+        params->sampleSize = 0;
+        params->dictionary = NULL;
+        params->pinThreads = 0;
+        params->progress = NULL;
+        params->progressArg = NULL;
+        params->progressStep = 0;       /* LZW_PROGRESS_STEP */
+    }
+}
+
+/***************************************************************************
+*   Function   : LZWEncodeFileParallel
+*   Description: This routine reads an input file a block at a time and
+*                writes out a block stream where each block is an
+*                independent LZW stream.  Blocks are encoded on a pool of
+*                worker threads, each with its own encoder context, and
+*                written in order.  No more than maxInFlight blocks are
+*                held in memory at a time.  If sampleSize is set, a frozen
+*                dictionary is built from the start of the input and
+*                stored in the stream, and every block is encoded with it.
+*                If a dictionary is given instead, only its id is stored
+*                and the same dictionary must be given to decode.
+*   Parameters : fpIn - pointer to the open binary file to encode
+*                fpOut - pointer to the open binary file to write encoded
+*                       output
+*                params - block-parallel parameters (NULL for defaults)
+*   Effects    : fpIn is encoded and written to fpOut.  Neither file is
+*                closed after exit.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+int LZWEncodeFileParallel(FILE *fpIn, FILE *fpOut,
+    const lzw_params_t *params)
+{
+    lzw_params_t valid;         /* params with defaults filled in */
+    parallel_t *shared;         /* blocks in flight */
+    int result;
+
+    /* validate arguments */
+    if ((NULL == fpIn) || (NULL == fpOut))
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (0 != LZWValidateParams(params, &valid, InputLength(fpIn)))
+    {
+        return -1;
+    }
+
+    shared = MakeSlots(valid.maxInFlight, valid.blockSize,
+        BLOCK_PREFIX_LEN + LZWEncodeBound(valid.blockSize), EncodeBlockJob);
+
+    if (NULL == shared)
+    {
+        return -1;
+    }
+
+    shared->blockSize = valid.blockSize;
+
+    if (NULL != valid.dictionary)
+    {
+        shared->dictionary = valid.dictionary;
+        shared->borrowed = 1;
+        result = LZWWriteStreamHeader(fpOut, valid.blockSize,
+            BLOCK_FLAG_SHARED, valid.dictionary);
+    }
+    else if (0 != valid.sampleSize)
+    {
+        result = WriteSample(shared, valid.sampleSize, fpIn, fpOut);
+    }
+    else
+    {
+        result = LZWWriteStreamHeader(fpOut, valid.blockSize, 0, NULL);
+    }
+
+    if (0 == result)
+    {
+        result = RunBlocks(shared, &valid, fpIn, fpOut,
+            ReadRawBlock);
+    }
+
+    if (0 == result)
+    {
+        result = LZWWriteStreamEnd(fpOut);
+    }
+
+    FreeSlots(shared);
+    return result;
+}
+
+/***************************************************************************
+*   Function   : LZWDecodeFileParallel
+*   Description: This routine decodes a block stream written by
+*                LZWEncodeFileParallel.  Block boundaries are found from
+*                the length prefixes, and blocks are decoded on a pool of
+*                worker threads, each with its own decoder context.  If
+*                fpOut is a regular file, workers write each block directly
+*                to its final position with pwrite, otherwise blocks are
+*                written in order.
+*   Parameters : fpIn - pointer to the open binary file to decode
+*                fpOut - pointer to the open binary file to write decoded
+*                       output
+*                params - block-parallel parameters (NULL for defaults).
+*                         blockSize is taken from the stream.  dictionary
+*                         must be the one the stream was encoded with if
+*                         it was encoded with a shared dictionary.
+*   Effects    : fpIn is decoded and written to fpOut.  Neither file is
+*                closed after exit.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  EILSEQ indicates a bad stream and
+*                EINVAL a missing or different shared dictionary.
+***************************************************************************/
+int LZWDecodeFileParallel(FILE *fpIn, FILE *fpOut,
+    const lzw_params_t *params)
+{
+    lzw_params_t valid;         /* params with defaults filled in */
+    parallel_t *shared;         /* blocks in flight */
+    size_t blockSize;           /* block size from stream header */
+    unsigned char flags;        /* flags from stream header */
+    int result;
+
+    /* validate arguments */
+    if ((NULL == fpIn) || (NULL == fpOut))
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if ((0 != LZWValidateParams(params, &valid, 0)) ||
+        (0 != ReadStreamHeader(fpIn, &blockSize, &flags)))
+    {
+        return -1;
+    }
+
+    shared = StartBlocks(fpIn, blockSize, flags, &valid);
+
+    if (NULL == shared)
+    {
+        return -1;
+    }
+
+    if (UsePositionalWrites(fpOut, &shared->offset))
+    {
+        shared->fd = fileno(fpOut);
+    }
+
+    result = RunBlocks(shared, &valid, fpIn, fpOut, ReadCodedBlock);
+
+    if ((shared->fd >= 0) &&
+        (0 != fseeko(fpOut, shared->offset, SEEK_SET)))
+    {
+        /* leave the stream positioned after the decoded data */
+        result = -1;
+    }
+
+    FreeSlots(shared);
+    return result;
+}
+
+/***************************************************************************
+*   Function   : LZWDecodeFileToSink
+*   Description: This routine decodes a block stream or a single stream,
+*                passing the decoded data to sink in order instead of
+*                writing it to a file.  Block streams are decoded on a pool
+*                of threads and sink receives one whole block at a time.
+*                Single streams are decoded a buffer at a time with
+*                LZWDecodeChunk on the calling thread.
+*   Parameters : fpIn - pointer to the open binary file to decode
+*                sink - function receiving the decoded data.  It returns 0
+*                       to continue or non-zero to stop decoding.
+*                arg - passed to sink
+*                params - block-parallel parameters (NULL for defaults).
+*                         dictionary must be the one the stream was
+*                         encoded with if it used a shared dictionary.
+*   Effects    : fpIn is decoded and passed to sink, always from the
+*                calling thread.  fpIn is not closed.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure, or left as sink set it if sink
+*                stopped decoding.
+***************************************************************************/
+int LZWDecodeFileToSink(FILE *fpIn, lzw_sink_t sink, void *arg,
+    const lzw_params_t *params)
+{
+    lzw_params_t valid;         /* params with defaults filled in */
+    parallel_t *shared;         /* blocks in flight */
+    lzw_decoder_t *decoder;     /* decoder for single streams */
+    unsigned char header[BLOCK_HEADER_LEN];
+    size_t blockSize, len;
+    unsigned char flags;
+    int result;
+
+    /* validate arguments */
+    if ((NULL == fpIn) || (NULL == sink))
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (0 != LZWValidateParams(params, &valid, 0))
+    {
+        return -1;
+    }
+
+    /* the header is read rather than peeked at, so fpIn may be a pipe */
+    len = fread(header, 1, BLOCK_HEADER_LEN, fpIn);
+
+    if (ferror(fpIn))
+    {
+        return -1;
+    }
+
+    if ((BLOCK_HEADER_LEN == len) &&
+        (0 == memcmp(header, BLOCK_MAGIC, BLOCK_MAGIC_LEN)))
+    {
+        if (0 != ParseStreamHeader(header, &blockSize, &flags))
+        {
+            return -1;
+        }
+
+        shared = StartBlocks(fpIn, blockSize, flags, &valid);
+
+        if (NULL == shared)
+        {
+            return -1;
+        }
+
+        shared->sink = sink;
+        shared->sinkArg = arg;
+        result = RunBlocks(shared, &valid, fpIn, NULL, ReadCodedBlock);
+        FreeSlots(shared);
+        return result;
+    }
+
+    /* a single stream, starting with the bytes already read */
+    decoder = LZWMakeDecoder();
+
+    if (NULL == decoder)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    result = DecodeSingleStream(fpIn, header, len, decoder, sink, arg);
+    LZWFreeDecoder(decoder);
+    return result;
+}
+
+/***************************************************************************
+*   Function   : LZWDecodeFileOnWorker
+*   Description: This routine decodes a block stream or a single stream on
+*                the calling pool worker, with the worker's decoder and
+*                one block buffer, for callers such as LZWDecodeBatch
+*                whose pool already keeps every core busy with other
+*                files.  Blocks are decoded and written one at a time.
+*   Parameters : fpIn - pointer to the open binary file to decode
+*                fpOut - pointer to the open binary file to write decoded
+*                       output
+*                worker - worker running the caller's job
+*                params - validated parameters.  dictionary must be the
+*                         one the stream was encoded with if it used a
+*                         shared dictionary.
+*   Effects    : fpIn is decoded and written to fpOut.  Neither file is
+*                closed after exit.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  EILSEQ indicates a bad stream.
+***************************************************************************/
+int LZWDecodeFileOnWorker(FILE *fpIn, FILE *fpOut, lzw_worker_t *worker,
+    const lzw_params_t *params)
+{
+    lzw_params_t single;        /* params with one block in flight */
+    parallel_t *shared;
+    block_slot_t *slot;
+    lzw_decoder_t *decoder;
+    unsigned char header[BLOCK_HEADER_LEN];
+    size_t blockSize, len;
+    unsigned char flags;
+    int result;
+
+    /* the header is read rather than peeked at, as by LZWDecodeFileToSink */
+    len = fread(header, 1, BLOCK_HEADER_LEN, fpIn);
+
+    if (ferror(fpIn))
+    {
+        return -1;
+    }
+
+    if ((BLOCK_HEADER_LEN != len) ||
+        (0 != memcmp(header, BLOCK_MAGIC, BLOCK_MAGIC_LEN)))
+    {
+        decoder = LZWWorkerDecoder(worker);
+
+        if (NULL == decoder)
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+
+        return DecodeSingleStream(fpIn, header, len, decoder, WriteBlock,
+            fpOut);
+    }
+
+    if (0 != ParseStreamHeader(header, &blockSize, &flags))
+    {
+        return -1;
+    }
+
+    single = *params;
+    single.maxInFlight = 1;
+    shared = StartBlocks(fpIn, blockSize, flags, &single);
+
+    if (NULL == shared)
+    {
+        return -1;
+    }
+
+    slot = &shared->slots[0];
+
+    while (1 == (result = ReadCodedBlock(shared, slot, fpIn)))
+    {
+        /* the job is run here instead of being queued */
+        slot->state = SLOT_BUSY;
+        DecodeBlockJob(&slot->job, worker);
+
+        if (0 != slot->error)
+        {
+            errno = slot->error;
+            result = -1;
+            break;
+        }
+
+        if (0 != WriteBlock(fpOut, slot->out, slot->outLen))
+        {
+            result = -1;
+            break;
+        }
+    }
+
+    FreeSlots(shared);
+    return result;
+}
+
+/***************************************************************************
+*   Function   : DecodeSingleStream
+*   Description: This routine decodes a single stream a buffer at a time
+*                with LZWDecodeChunk, starting with bytes that were
+*                already read from its start.
+*   Parameters : fpIn - file holding the rest of the stream
+*                start - bytes already read from the start of the stream
+*                startLen - number of bytes in start
+*                decoder - decoder to use
+*                sink - function receiving the decoded data
+*                arg - passed to sink
+*   Effects    : The stream is decoded and passed to sink
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+static int DecodeSingleStream(FILE *fpIn, const unsigned char *start,
+    const size_t startLen, lzw_decoder_t *decoder, lzw_sink_t sink,
+    void *arg)
+{
+    unsigned char *in;
+    size_t len;
+    int result;
+
+    in = LZWAlloc(LZW_MEM_IO, DECODE_CHUNK);
+
+    if (NULL == in)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    LZWDecodeStart(decoder);
+    memcpy(in, start, startLen);
+    len = startLen + fread(in + startLen, 1, DECODE_CHUNK - startLen, fpIn);
+    result = 0;
+
+    while ((0 == result) && (0 != len))
+    {
+        result = LZWDecodeChunk(decoder, in, len, sink, arg);
+        len = fread(in, 1, DECODE_CHUNK, fpIn);
+    }
+
+    if ((0 == result) && ferror(fpIn))
+    {
+        result = -1;
+    }
+
+    LZWRelease(in);
+    return result;
+}
+
+/***************************************************************************
+*   Function   : LZWDecodeFileSpeculative
+*   Description: This routine decodes a single LZW stream written by
+*                LZWEncodeFile, using a pool of threads for as much of it
+*                as possible.  The stream is decoded in order until the
+*                dictionary is full and code words are MAX_CODE_LEN bits
+*                long.  After that the dictionary never changes and every
+*                code word starts at a known bit, so the rest of the
+*                stream is split into chunks of blockSize bytes, decoded in
+*                parallel against a frozen copy of the dictionary, and
+*                written in order.  Streams that end before the dictionary
+*                fills, and inputs that can't be mapped into memory (pipes
+*                for instance), are decoded by LZWDecodeFile.
+*   Parameters : fpIn - pointer to the open binary file to decode
+*                fpOut - pointer to the open binary file to write decoded
+*                       output
+*                params - block-parallel parameters (NULL for defaults).
+*                         blockSize is the number of encoded bytes in a
+*                         chunk.
+*   Effects    : fpIn is decoded and written to fpOut.  Neither file is
+*                closed after exit.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  EILSEQ indicates a bad stream.
+***************************************************************************/
+int LZWDecodeFileSpeculative(FILE *fpIn, FILE *fpOut,
+    const lzw_params_t *params)
+{
+    lzw_params_t valid;         /* params with defaults filled in */
+    lzw_decoder_t *decoder;
+    struct stat sb;
+    off_t start;                /* offset of the stream in fpIn */
+    off_t outStart, outEnd;     /* output offsets around the freeze */
+    void *base;                 /* mapping of all of fpIn */
+    size_t bitsUsed;            /* bits decoded before the freeze */
+    int result;
+
+    /* validate arguments */
+    if ((NULL == fpIn) || (NULL == fpOut))
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (0 != LZWValidateParams(params, &valid, 0))
+    {
+        return -1;
+    }
+
+    start = ftello(fpIn);
+
+    if ((start < 0) || (0 != fstat(fileno(fpIn), &sb)) ||
+        !S_ISREG(sb.st_mode) || (sb.st_size <= start))
+    {
+        /* nothing to split up */
+        return LZWDecodeFile(fpIn, fpOut);
+    }
+
+    base = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE,
+        fileno(fpIn), 0);
+
+    if (MAP_FAILED == base)
+    {
+        return LZWDecodeFile(fpIn, fpOut);
+    }
+
+    decoder = LZWMakeDecoder();
+
+    if (NULL == decoder)
+    {
+        munmap(base, (size_t)sb.st_size);
+        return -1;
+    }
+
+    outStart = ftello(fpOut);
+    result = LZWDecodeUntilFrozen(decoder, (unsigned char *)base + start,
+        (size_t)(sb.st_size - start), fpOut, &bitsUsed);
+
+    if (1 == result)
+    {
+        /* pipes can't tell, their progress starts from the tail */
+        outEnd = ftello(fpOut);
+        result = DecodeFrozenTail((unsigned char *)base + start,
+            (size_t)(sb.st_size - start), bitsUsed,
+            ((outStart < 0) || (outEnd < outStart)) ? 0 :
+            (size_t)(outEnd - outStart), decoder, &valid, fpOut);
+    }
+    else
+    {
+        LZWFreeDecoder(decoder);
+    }
+
+    munmap(base, (size_t)sb.st_size);
+
+    /* leave fpIn where LZWDecodeFile would */
+    if ((0 == result) && (0 != fseeko(fpIn, 0, SEEK_END)))
+    {
+        result = -1;
+    }
+
+    return result;
+}
+
+/***************************************************************************
+*   Function   : DecodeFrozenTail
+*   Description: This routine decodes the part of a legacy stream that
+*                follows the point where its dictionary was frozen.  The
+*                decoder's dictionary is copied into a frozen dictionary
+*                shared by all workers, and the stream is split into
+*                chunks that hold a whole number of code words.
+*   Parameters : map - legacy stream
+*                mapLen - number of bytes in map
+*                bitsUsed - bits of map decoded by LZWDecodeUntilFrozen
+*                decodedLen - bytes written by LZWDecodeUntilFrozen, for
+*                             progress reports
+*                decoder - decoder used by LZWDecodeUntilFrozen
+*                params - validated block-parallel parameters
+*                fpOut - file receiving the decoded data
+*   Effects    : The rest of map is decoded to fpOut.  decoder is freed.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+static int DecodeFrozenTail(const unsigned char *map, const size_t mapLen,
+    const size_t bitsUsed, const size_t decodedLen, lzw_decoder_t *decoder,
+    const lzw_params_t *params, FILE *fpOut)
+{
+    lzw_dictionary_t *dictionary;
+    parallel_t *shared;         /* chunks in flight */
+    size_t chunkLen;            /* encoded bytes in a chunk */
+    int result;
+
+    dictionary = LZWFreezeDecoder(decoder);
+    LZWFreeDecoder(decoder);
+
+    if (NULL == dictionary)
+    {
+        return -1;
+    }
+
+    /* MAX_CODE_LEN bytes hold 8 whole code words, so every chunk starts
+     * on the same bit of a byte */
+    chunkLen = (params->blockSize < MAX_CODE_LEN) ? MAX_CODE_LEN :
+        params->blockSize;
+    chunkLen -= chunkLen % MAX_CODE_LEN;
+
+    /* a chunk may share its first byte with the one before it */
+    shared = MakeSlots(params->maxInFlight, chunkLen + 1, 4 * chunkLen,
+        DecodeChunkJob);
+
+    if (NULL == shared)
+    {
+        LZWFreeDictionary(dictionary);
+        return -1;
+    }
+
+    shared->blockSize = chunkLen;
+    shared->dictionary = dictionary;
+    shared->map = map;
+    shared->mapLen = mapLen;
+    shared->mapPos = bitsUsed / CHAR_BIT;
+    shared->skipBits = bitsUsed % CHAR_BIT;
+    shared->bytesIn = shared->mapPos;
+    shared->bytesOut = decodedLen;
+
+    result = RunBlocks(shared, params, NULL, fpOut,
+        ReadLegacyChunk);
+
+    FreeSlots(shared);
+    return result;
+}
+
+/***************************************************************************
+*   Function   : LZWInspectFile
+*   Description: This routine describes an encoded file without decoding
+*                it.  A block stream's header and block prefixes are read,
+*                and the encoded data between them is skipped.  An
+*                archive's header, trailer and directory are read.  A
+*                single stream has no header, so only its encoded size is
+*                known.
+*   Parameters : fpIn - encoded file, read from its current position.
+*                       Archives must be seekable; other files may be
+*                       pipes, in which case skipped data is read.
+*                info - receives the description
+*   Effects    : fpIn is read up to the end of the block stream, or to its
+*                end for a single stream
+*   Returned   : 0 for success, -1 for failure.  errno is set to EILSEQ if
+*                the headers are damaged.
+***************************************************************************/
+int LZWInspectFile(FILE *fpIn, lzw_info_t *info)
+{
+    unsigned char header[BLOCK_HEADER_LEN];
+    unsigned char buf[BUFSIZ];
+    unsigned char flags;
+    struct stat sb;
+    off_t start, end;
+    size_t len;
+
+    /* validate arguments */
+    if ((NULL == fpIn) || (NULL == info))
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    memset(info, 0, sizeof(lzw_info_t));
+    start = ftello(fpIn);
+    end = -1;
+
+    if ((start >= 0) && (0 == fstat(fileno(fpIn), &sb)) &&
+        S_ISREG(sb.st_mode))
+    {
+        end = sb.st_size;
+    }
+
+    len = fread(header, 1, BLOCK_HEADER_LEN, fpIn);
+
+    if (ferror(fpIn))
+    {
+        return -1;
+    }
+
+    if ((BLOCK_HEADER_LEN == len) &&
+        (0 == memcmp(header, ARCHIVE_MAGIC, BLOCK_MAGIC_LEN)))
+    {
+        if ((end < 0) || (0 != fseeko(fpIn, start, SEEK_SET)))
+        {
+            errno = ESPIPE;     /* archives are read from the end */
+            return -1;
+        }
+
+        return LZWInspectArchive(fpIn, info);
+    }
+
+    if ((BLOCK_HEADER_LEN == len) &&
+        (0 == memcmp(header, BLOCK_MAGIC, BLOCK_MAGIC_LEN)))
+    {
+        info->format = LZW_FORMAT_BLOCKS;
+
+        if (0 != ParseStreamHeader(header, &info->blockSize, &flags))
+        {
+            return -1;
+        }
+
+        info->codedSize = BLOCK_HEADER_LEN;
+        return InspectBlocks(fpIn, flags, (end < 0) ? end : (end - start),
+            info);
+    }
+
+    /* a single stream ends at the end of the file */
+    info->format = LZW_FORMAT_SINGLE;
+
+    if (end >= 0)
+    {
+        info->codedSize = (size_t)(end - start);
+        return fseeko(fpIn, 0, SEEK_END);
+    }
+
+    info->codedSize = len;
+
+    while (0 != (len = fread(buf, 1, sizeof(buf), fpIn)))
+    {
+        info->codedSize += len;
+    }
+
+    return ferror(fpIn) ? -1 : 0;
+}
+
+/***************************************************************************
+*   Function   : LZWValidateParams
+*   Description: This routine checks block-parallel parameters and replaces
+*                values of 0 with their defaults.  A block size of 0 is
+*                replaced with LZWAutoBlockSize's choice.
+*   Parameters : params - parameters supplied by the caller (may be NULL)
+*                valid - receives the parameters to use
+*                inLen - bytes that will be encoded, 0 if unknown
+*   Effects    : valid is filled in
+*   Returned   : 0 for success, -1 (with errno set to EINVAL) if params
+*                contains an unusable value.
+***************************************************************************/
+int LZWValidateParams(const lzw_params_t *params, lzw_params_t *valid,
+    const size_t inLen)
+{
+    LZWDefaultParams(valid);
+
+    if (NULL != params)
+    {
+        *valid = *params;
+    }
+
+    if (0 == valid->threads)
+    {
+        valid->threads = LZWOnlineCores();
+    }
+
+    if (0 == valid->maxInFlight)
+    {
+        valid->maxInFlight = 2 * valid->threads;
+    }
+
+    if (0 == valid->blockSize)
+    {
+        valid->blockSize = LZWAutoBlockSize(valid->threads, inLen);
+    }
+
+    if (0 == valid->progressStep)
+    {
+        valid->progressStep = LZW_PROGRESS_STEP;
+    }
+
+    if ((valid->blockSize > BLOCK_MAX_SIZE) ||
+        (valid->sampleSize > BLOCK_MAX_SIZE))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : MakeSlots
+*   Description: This routine allocates the ring of blocks in flight and
+*                the buffers used by each block.
+*   Parameters : numSlots - number of blocks in the ring
+*                inSize - size of each block's input buffer
+*                outSize - size of each block's output buffer
+*                run - job function that codes a slot
+*   Effects    : Memory is allocated for all the slots
+*   Returned   : Pointer to the shared state or NULL on error.  errno will
+*                be set on an error.
+***************************************************************************/
+static parallel_t *MakeSlots(const unsigned int numSlots,
+    const size_t inSize, const size_t outSize,
+    void (*run)(lzw_job_t *job, lzw_worker_t *worker))
+{
+    parallel_t *shared;
+    unsigned int i;
+
+    shared = malloc(sizeof(parallel_t));
+
+    if (NULL == shared)
+    {
+        return NULL;
+    }
+
+    shared->slots = calloc(numSlots, sizeof(block_slot_t));
+
+    if (NULL == shared->slots)
+    {
+        free(shared);
+        return NULL;
+    }
+
+    pthread_mutex_init(&shared->lock, NULL);
+    pthread_cond_init(&shared->done, NULL);
+    shared->numSlots = numSlots;
+    shared->blockSize = 0;
+    shared->fd = -1;
+    shared->offset = 0;
+    shared->dictionary = NULL;
+    shared->borrowed = 0;
+    shared->sample = NULL;
+    shared->sampleLen = 0;
+    shared->pendingLen = 0;
+    shared->map = NULL;
+    shared->mapLen = 0;
+    shared->mapPos = 0;
+    shared->skipBits = 0;
+    shared->bytesIn = 0;
+    shared->bytesOut = 0;
+    shared->sink = NULL;
+    shared->sinkArg = NULL;
+
+    for (i = 0; i < numSlots; i++)
+    {
+        block_slot_t *slot = &shared->slots[i];
+
+        slot->job.run = run;
+        slot->shared = shared;
+        slot->state = SLOT_FREE;
+        slot->in = LZWAlloc(LZW_MEM_IO, inSize);
+        slot->out = LZWAlloc(LZW_MEM_IO, outSize);
+        slot->outSize = outSize;
+
+        if ((NULL == slot->in) || (NULL == slot->out))
+        {
+            FreeSlots(shared);
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+
+    return shared;
+}
+
+/***************************************************************************
+*   Function   : FreeSlots
+*   Description: This routine frees the ring of blocks allocated by
+*                MakeSlots.  No slot may be in use by a worker.
+*   Parameters : shared - state returned by MakeSlots
+*   Effects    : All slot memory is freed
+*   Returned   : None
+***************************************************************************/
+static void FreeSlots(parallel_t *shared)
+{
+    unsigned int i;
+
+    for (i = 0; i < shared->numSlots; i++)
+    {
+        LZWRelease(shared->slots[i].in);
+        LZWRelease(shared->slots[i].out);
+    }
+
+    if (!shared->borrowed)
+    {
+        LZWFreeDictionary(shared->dictionary);
+    }
+
+    LZWRelease(shared->sample);
+    pthread_cond_destroy(&shared->done);
+    pthread_mutex_destroy(&shared->lock);
+    free(shared->slots);
+    free(shared);
+}
+
+/***************************************************************************
+*   Function   : WaitForSlot
+*   Description: This routine blocks until a worker has finished coding a
+*                slot.
+*   Parameters : slot - slot to wait on
+*   Effects    : None
+*   Returned   : None
+***************************************************************************/
+static void WaitForSlot(block_slot_t *slot)
+{
+    parallel_t *shared = slot->shared;
+
+    pthread_mutex_lock(&shared->lock);
+
+    while (SLOT_DONE != slot->state)
+    {
+        pthread_cond_wait(&shared->done, &shared->lock);
+    }
+
+    pthread_mutex_unlock(&shared->lock);
+}
+
+/***************************************************************************
+*   Function   : MarkSlotDone
+*   Description: This routine is called by a worker when it has finished
+*                coding a slot.  It wakes the thread waiting to write it.
+*   Parameters : slot - slot that was coded
+*                error - 0 for success, otherwise the errno value
+*   Effects    : slot's state becomes SLOT_DONE
+*   Returned   : None
+***************************************************************************/
+static void MarkSlotDone(block_slot_t *slot, const int error)
+{
+    parallel_t *shared = slot->shared;
+
+    pthread_mutex_lock(&shared->lock);
+    slot->error = error;
+    slot->state = SLOT_DONE;
+    pthread_cond_broadcast(&shared->done);
+    pthread_mutex_unlock(&shared->lock);
+}
+
+/***************************************************************************
+*   Function   : RunBlocks
+*   Description: This routine reads blocks into free slots, hands them to a
+*                pool of workers to be coded, and writes the coded blocks
+*                in the order that they were read.  Once every slot is in
+*                use, the oldest block must be written before another is
+*                read, so memory use is bounded by the number of slots.
+*                params->progress is called each time at least
+*                progressStep more input bytes have been written, and at
+*                the end, so it costs nothing per byte.
+*   Parameters : shared - ring of slots with job functions set
+*                params - validated parameters giving the number of
+*                         worker threads and whether they are pinned
+*                fpIn - file blocks are read from
+*                fpOut - file coded blocks are written to if
+*                        shared->sink isn't set.  Nothing is written here
+*                        if workers use positional writes.
+*                ReadBlock - function that reads the next block into a slot
+*   Effects    : All of fpIn is coded and written.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+static int RunBlocks(parallel_t *shared, const lzw_params_t *params,
+    FILE *fpIn, FILE *fpOut, read_block_t ReadBlock)
+{
+    lzw_pool_t *pool;           /* workers coding blocks */
+    block_slot_t *slot;
+    unsigned long nextRead;     /* sequence number of next block read */
+    unsigned long nextWrite;    /* sequence number of next block written */
+    size_t nextReport;          /* bytesIn of the next progress report */
+    int eof, result, error;
+
+    pool = LZWMakePool(params->threads, params->pinThreads);
+
+    if (NULL == pool)
+    {
+        return -1;
+    }
+
+    if (NULL == shared->sink)
+    {
+        shared->sink = WriteBlock;
+        shared->sinkArg = fpOut;
+    }
+
+    nextRead = 0;
+    nextWrite = 0;
+    nextReport = shared->bytesIn + params->progressStep;
+    eof = 0;
+    result = 0;
+    error = 0;
+
+    while (0 == result)
+    {
+        /* keep every free slot busy with the next block of input */
+        while (!eof && ((nextRead - nextWrite) < shared->numSlots))
+        {
+            slot = &shared->slots[nextRead % shared->numSlots];
+            eof = ReadBlock(shared, slot, fpIn);
+
+            if (1 != eof)
+            {
+                result = eof;
+                error = errno;
+                eof = 1;
+                break;
+            }
+
+            eof = 0;
+            slot->state = SLOT_BUSY;
+            LZWPoolSubmit(pool, &slot->job);
+            nextRead++;
+        }
+
+        if (nextWrite == nextRead)
+        {
+            break;          /* everything read has been written */
+        }
+
+        /* write the oldest block once it's been coded */
+        slot = &shared->slots[nextWrite % shared->numSlots];
+        WaitForSlot(slot);
+
+        if (0 != slot->error)
+        {
+            error = slot->error;
+            result = -1;
+        }
+        else if ((shared->fd < 0) &&
+            (0 != shared->sink(shared->sinkArg, slot->out, slot->outLen)))
+        {
+            error = errno;
+            result = -1;
+        }
+        else
+        {
+            shared->bytesIn += slot->inLen;
+            shared->bytesOut += slot->outLen;
+
+            if ((NULL != params->progress) && (shared->bytesIn >= nextReport))
+            {
+                params->progress(params->progressArg, shared->bytesIn,
+                    shared->bytesOut);
+                nextReport = shared->bytesIn + params->progressStep;
+            }
+        }
+
+        slot->state = SLOT_FREE;
+        nextWrite++;
+    }
+
+    if ((0 == result) && (NULL != params->progress))
+    {
+        params->progress(params->progressArg, shared->bytesIn,
+            shared->bytesOut);
+    }
+
+    /* waits for any blocks still being coded */
+    LZWFreePool(pool);
+
+    if (0 != result)
+    {
+        errno = error;
+    }
+
+    return result;
+}
+
+/***************************************************************************
+*   Function   : WriteBlock
+*   Description: This routine is the sink RunBlocks writes coded blocks to
+*                when no other sink is given.
+*   Parameters : arg - FILE receiving the blocks
+*                data - coded block
+*                len - number of bytes in data
+*   Effects    : data is written to the file
+*   Returned   : 0 for success, -1 for failure with errno set.
+***************************************************************************/
+static int WriteBlock(void *arg, const unsigned char *data,
+    const size_t len)
+{
+    return (fwrite(data, 1, len, (FILE *)arg) == len) ? 0 : -1;
+}
+
+/***************************************************************************
+*   Function   : ReadRawBlock
+*   Description: This routine reads the next block of data to be encoded.
+*                Any part of a sample that hasn't been encoded yet is
+*                used before reading more of fpIn.
+*   Parameters : shared - state shared by all slots
+*                slot - slot receiving the block
+*                fpIn - file being encoded
+*   Effects    : Up to blockSize bytes are read into slot->in
+*   Returned   : 1 if a block was read, 0 at the end of fpIn, and -1 for a
+*                read error.
+***************************************************************************/
+static int ReadRawBlock(parallel_t *shared, block_slot_t *slot, FILE *fpIn)
+{
+    size_t used;
+
+    used = 0;
+
+    if (0 != shared->pendingLen)
+    {
+        /* the sample was read from fpIn, so it is encoded first */
+        used = (shared->pendingLen < shared->blockSize) ?
+            shared->pendingLen : shared->blockSize;
+        memcpy(slot->in,
+            shared->sample + (shared->sampleLen - shared->pendingLen), used);
+        shared->pendingLen -= used;
+    }
+
+    slot->inLen = used +
+        fread(slot->in + used, 1, shared->blockSize - used, fpIn);
+
+    if (0 == slot->inLen)
+    {
+        return ferror(fpIn) ? -1 : 0;
+    }
+
+    return 1;
+}
+
+/***************************************************************************
+*   Function   : EncodeBlockJob
+*   Description: This routine is run by a pool worker.  It encodes a
+*                slot's input as a prefixed block using the worker's
+*                encoder.
+*   Parameters : job - job embedded in a block_slot_t
+*                worker - worker running the job
+*   Effects    : slot's output buffer is filled and the slot is marked done
+*   Returned   : None
+***************************************************************************/
+static void EncodeBlockJob(lzw_job_t *job, lzw_worker_t *worker)
+{
+    block_slot_t *slot;
+    lzw_encoder_t *encoder;
+
+    slot = (block_slot_t *)job;
+    encoder = LZWWorkerEncoder(worker);
+
+    if (NULL == encoder)
+    {
+        MarkSlotDone(slot, ENOMEM);
+        return;
+    }
+
+    if (0 != LZWEncodeBlock(encoder, slot->shared->dictionary, slot->in,
+        slot->inLen, slot->out, &slot->outLen))
+    {
+        MarkSlotDone(slot, errno);
+        return;
+    }
+
+    MarkSlotDone(slot, 0);
+}
+
+/***************************************************************************
+*   Function   : WriteSample
+*   Description: This routine reads a sample from the start of the input,
+*                builds a frozen dictionary from it, and writes a stream
+*                header followed by the encoded sample.  The sample is
+*                kept so that it will also be encoded as the first block
+*                data.
+*   Parameters : shared - state shared by all slots
+*                sampleSize - number of bytes to sample
+*                fpIn - file being encoded
+*                fpOut - file receiving the block stream
+*   Effects    : shared's sample and dictionary are set and the start of
+*                the stream is written to fpOut
+*   Returned   : 0 for success, -1 for failure.
+***************************************************************************/
+static int WriteSample(parallel_t *shared, const size_t sampleSize,
+    FILE *fpIn, FILE *fpOut)
+{
+    shared->sample = LZWAlloc(LZW_MEM_IO, sampleSize);
+
+    if (NULL == shared->sample)
+    {
+        return -1;
+    }
+
+    shared->sampleLen = fread(shared->sample, 1, sampleSize, fpIn);
+    shared->pendingLen = shared->sampleLen;
+
+    if ((shared->sampleLen < sampleSize) && ferror(fpIn))
+    {
+        return -1;
+    }
+
+    shared->dictionary = LZWMakeDictionary(shared->sample,
+        shared->sampleLen);
+
+    if ((NULL == shared->dictionary) ||
+        (0 != LZWWriteStreamHeader(fpOut, shared->blockSize,
+            BLOCK_FLAG_FROZEN, NULL)))
+    {
+        return -1;
+    }
+
+    return WriteCodedSample(fpOut, shared->sample, shared->sampleLen);
+}
+
+/***************************************************************************
+*   Function   : WriteCodedSample
+*   Description: This routine writes a sample's lengths followed by the
+*                sample encoded as an ordinary lzw stream.
+*   Parameters : fpOut - file receiving the sample
+*                sample - sample to write
+*                sampleLen - number of bytes in sample
+*   Effects    : The encoded sample is written to fpOut
+*   Returned   : 0 for success, -1 for failure.
+***************************************************************************/
+static int WriteCodedSample(FILE *fpOut, const unsigned char *sample,
+    const size_t sampleLen)
+{
+    lzw_encoder_t *encoder;
+    unsigned char *coded;
+    unsigned char prefix[BLOCK_PREFIX_LEN];
+    size_t codedLen;
+    int result;
+
+    encoder = LZWMakeEncoder();
+    coded = LZWAlloc(LZW_MEM_IO, LZWEncodeBound(sampleLen));
+    result = -1;
+
+    if ((NULL != encoder) && (NULL != coded) &&
+        (0 == LZWEncodeBuffer(encoder, sample, sampleLen, coded,
+            LZWEncodeBound(sampleLen), &codedLen)))
+    {
+        PUT_LE32(prefix, sampleLen);
+        PUT_LE32(prefix + 4, codedLen);
+
+        if ((fwrite(prefix, 1, BLOCK_PREFIX_LEN, fpOut) ==
+                BLOCK_PREFIX_LEN) &&
+            (fwrite(coded, 1, codedLen, fpOut) == codedLen))
+        {
+            result = 0;
+        }
+    }
+    else if ((NULL == encoder) || (NULL == coded))
+    {
+        errno = ENOMEM;
+    }
+
+    LZWFreeEncoder(encoder);
+    LZWRelease(coded);
+    return result;
+}
+
+/***************************************************************************
+*   Function   : LZWWriteDictionary
+*   Description: This routine writes a frozen dictionary to a dictionary
+*                file.  Only the dictionary's sample is stored, since
+*                LZWMakeDictionary always builds the same dictionary from
+*                it.
+*   Parameters : dictionary - dictionary made by LZWMakeDictionary or
+*                             LZWTrainDictionary
+*                fpOut - file receiving the dictionary
+*   Effects    : The dictionary file is written to fpOut
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+int LZWWriteDictionary(const lzw_dictionary_t *dictionary, FILE *fpOut)
+{
+    unsigned char header[DICT_HEADER_LEN];
+
+    /* validate arguments */
+    if ((NULL == dictionary) || (NULL == dictionary->sample) ||
+        (NULL == fpOut))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memcpy(header, DICT_MAGIC, BLOCK_MAGIC_LEN);
+    header[4] = DICT_VERSION;
+    header[5] = 0;              /* reserved */
+    header[6] = 0;
+    header[7] = 0;
+    PUT_LE32(header + 8, dictionary->id);
+
+    if (fwrite(header, 1, DICT_HEADER_LEN, fpOut) != DICT_HEADER_LEN)
+    {
+        return -1;
+    }
+
+    return WriteCodedSample(fpOut, dictionary->sample,
+        dictionary->sampleLen);
+}
+
+/***************************************************************************
+*   Function   : LZWReadDictionary
+*   Description: This routine reads a dictionary file written by
+*                LZWWriteDictionary and rebuilds the frozen dictionary.
+*   Parameters : fpIn - file containing the dictionary
+*   Effects    : Memory is allocated for the dictionary
+*   Returned   : Pointer to the dictionary or NULL on error.  errno is set
+*                to EILSEQ if fpIn isn't a valid dictionary file.
+***************************************************************************/
+lzw_dictionary_t *LZWReadDictionary(FILE *fpIn)
+{
+    lzw_dictionary_t *dictionary;
+    unsigned char header[DICT_HEADER_LEN];
+    unsigned char *sample;
+    size_t sampleLen;
+
+    if (NULL == fpIn)
+    {
+        errno = ENOENT;
+        return NULL;
+    }
+
+    if (fread(header, 1, DICT_HEADER_LEN, fpIn) != DICT_HEADER_LEN)
+    {
+        if (!ferror(fpIn))
+        {
+            errno = EILSEQ;
+        }
+
+        return NULL;
+    }
+
+    if ((0 != memcmp(header, DICT_MAGIC, BLOCK_MAGIC_LEN)) ||
+        (DICT_VERSION != header[4]))
+    {
+        errno = EILSEQ;
+        return NULL;
+    }
+
+    if (0 != ReadCodedSample(fpIn, &sample, &sampleLen))
+    {
+        return NULL;
+    }
+
+    dictionary = LZWMakeDictionary(sample, sampleLen);
+    LZWRelease(sample);
+
+    if ((NULL != dictionary) && (dictionary->id != GET_LE32(header + 8)))
+    {
+        /* the sample was damaged */
+        LZWFreeDictionary(dictionary);
+        errno = EILSEQ;
+        return NULL;
+    }
+
+    return dictionary;
+}
+
+/***************************************************************************
+*   Function   : LZWWriteStreamHeader
+*   Description: This routine writes the header that starts a block
+*                stream.
+*   Parameters : fpOut - file receiving the block stream
+*                blockSize - nominal number of bytes in each block
+*                flags - BLOCK_FLAG_ values describing the stream
+*                dictionary - shared dictionary whose id follows the
+*                             header if flags has BLOCK_FLAG_SHARED
+*   Effects    : Header is written to fpOut
+*   Returned   : 0 for success, -1 for failure.
+***************************************************************************/
+int LZWWriteStreamHeader(FILE *fpOut, const size_t blockSize,
+    const unsigned char flags, const lzw_dictionary_t *dictionary)
+{
+    unsigned char header[BLOCK_HEADER_LEN + 4];
+    size_t len;
+
+    memcpy(header, BLOCK_MAGIC, BLOCK_MAGIC_LEN);
+    header[4] = BLOCK_VERSION;
+    header[5] = flags;
+    header[6] = 0;              /* reserved */
+    header[7] = 0;
+    PUT_LE32(header + 8, blockSize);
+    len = BLOCK_HEADER_LEN;
+
+    if (flags & BLOCK_FLAG_SHARED)
+    {
+        PUT_LE32(header + BLOCK_HEADER_LEN, dictionary->id);
+        len += 4;
+    }
+
+    if (fwrite(header, 1, len, fpOut) != len)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : LZWEncodeBlock
+*   Description: This routine encodes one block of a block stream and
+*                prefixes it with its lengths.  Data that LZWIsCompressible
+*                says won't shrink, and data that grows when it is
+*                encoded, is stored instead.
+*   Parameters : encoder - encoder context for the block and the sniffing
+*                dictionary - frozen dictionary to encode with, or NULL to
+*                             encode with encoder
+*                in - block data
+*                inLen - number of bytes in in
+*                out - receives the prefixed block.  It must hold
+*                      BLOCK_PREFIX_LEN + LZWEncodeBound(inLen) bytes.
+*                outLen - set to the number of bytes written to out
+*   Effects    : out is filled.  The encoder's dictionary is replaced.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+int LZWEncodeBlock(lzw_encoder_t *encoder,
+    const lzw_dictionary_t *dictionary, const unsigned char *in,
+    const size_t inLen, unsigned char *out, size_t *outLen)
+{
+    size_t codedLen;
+    int result;
+
+    result = LZWIsCompressible(encoder, in, inLen);
+
+    if (result < 0)
+    {
+        return -1;
+    }
+
+    codedLen = inLen;
+
+    if (1 == result)
+    {
+        if (NULL != dictionary)
+        {
+            /* every worker reads the same frozen dictionary */
+            result = LZWEncodeFrozen(dictionary, in, inLen,
+                out + BLOCK_PREFIX_LEN, LZWEncodeBound(inLen), &codedLen);
+        }
+        else
+        {
+            result = LZWEncodeBuffer(encoder, in, inLen,
+                out + BLOCK_PREFIX_LEN, LZWEncodeBound(inLen), &codedLen);
+        }
+
+        if (0 != result)
+        {
+            return -1;
+        }
+    }
+
+    PUT_LE32(out, inLen);
+
+    if (codedLen >= inLen)
+    {
+        memcpy(out + BLOCK_PREFIX_LEN, in, inLen);
+        codedLen = inLen;
+        PUT_LE32(out + 4, BLOCK_STORED | codedLen);
+    }
+    else
+    {
+        PUT_LE32(out + 4, codedLen);
+    }
+
+    *outLen = BLOCK_PREFIX_LEN + codedLen;
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : LZWWriteStreamEnd
+*   Description: This routine writes the empty block that ends a block
+*                stream.
+*   Parameters : fpOut - file receiving the block stream
+*   Effects    : End marker is written to fpOut
+*   Returned   : 0 for success, -1 for failure.
+***************************************************************************/
+int LZWWriteStreamEnd(FILE *fpOut)
+{
+    unsigned char end[BLOCK_PREFIX_LEN];
+
+    memset(end, 0, BLOCK_PREFIX_LEN);
+
+    if (fwrite(end, 1, BLOCK_PREFIX_LEN, fpOut) != BLOCK_PREFIX_LEN)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : StartBlocks
+*   Description: This routine sets up the slots for decoding a block
+*                stream and reads the stream's frozen dictionary sample or
+*                shared dictionary id.
+*   Parameters : fpIn - block stream, positioned after its header
+*                blockSize - nominal block size from the header
+*                flags - BLOCK_FLAG_ values from the header
+*                valid - validated block-parallel parameters
+*   Effects    : Slots are allocated and the dictionary is set up
+*   Returned   : The slots, or NULL for failure with errno set.  EINVAL
+*                indicates a missing or different shared dictionary.
+***************************************************************************/
+static parallel_t *StartBlocks(FILE *fpIn, const size_t blockSize,
+    const unsigned char flags, const lzw_params_t *valid)
+{
+    parallel_t *shared;
+
+    shared = MakeSlots(valid->maxInFlight, LZWEncodeBound(blockSize),
+        blockSize, DecodeBlockJob);
+
+    if (NULL == shared)
+    {
+        return NULL;
+    }
+
+    shared->blockSize = blockSize;
+
+    if (((flags & BLOCK_FLAG_FROZEN) && (0 != ReadSample(shared, fpIn))) ||
+        ((flags & BLOCK_FLAG_SHARED) &&
+        (0 != UseSharedDictionary(shared, fpIn, valid->dictionary))))
+    {
+        FreeSlots(shared);
+        return NULL;
+    }
+
+    return shared;
+}
+
+/***************************************************************************
+*   Function   : ReadStreamHeader
+*   Description: This routine reads and validates the header that starts a
+*                block stream.
+*   Parameters : fpIn - file containing the block stream
+*                blockSize - receives the nominal block size
+*                flags - receives the stream's BLOCK_FLAG_ values
+*   Effects    : Header is read from fpIn
+*   Returned   : 0 for success, -1 for failure.  errno is set to EILSEQ if
+*                fpIn doesn't start with a supported block stream header.
+***************************************************************************/
+static int ReadStreamHeader(FILE *fpIn, size_t *blockSize,
+    unsigned char *flags)
+{
+    unsigned char header[BLOCK_HEADER_LEN];
+
+    if (fread(header, 1, BLOCK_HEADER_LEN, fpIn) != BLOCK_HEADER_LEN)
+    {
+        if (!ferror(fpIn))
+        {
+            errno = EILSEQ;
+        }
+
+        return -1;
+    }
+
+    return ParseStreamHeader(header, blockSize, flags);
+}
+
+/***************************************************************************
+*   Function   : InspectBlocks
+*   Description: This routine reads the rest of a block stream's header
+*                and each block's prefix, skipping the encoded data, and
+*                totals the block lengths.
+*   Parameters : fpIn - block stream, positioned after its header
+*                flags - the stream's BLOCK_FLAG_ values
+*                end - bytes in the stream's file from the header on, or
+*                      -1 if fpIn can't seek
+*                info - receives the totals.  codedSize holds the bytes
+*                       read so far.
+*   Effects    : fpIn is read to the end of the block stream
+*   Returned   : 0 for success, -1 for failure.  errno is set to EILSEQ for
+*                a damaged or truncated stream.
+***************************************************************************/
+static int InspectBlocks(FILE *fpIn, const unsigned char flags,
+    const off_t end, lzw_info_t *info)
+{
+    unsigned char prefix[BLOCK_PREFIX_LEN];
+    size_t rawLen, codedLen;
+    int stored, sample;
+
+    if (flags & BLOCK_FLAG_SHARED)
+    {
+        if (fread(prefix, 1, 4, fpIn) != 4)
+        {
+            errno = ferror(fpIn) ? errno : EILSEQ;
+            return -1;
+        }
+
+        info->needsDictionary = 1;
+        info->dictionaryId = GET_LE32(prefix);
+        info->codedSize += 4;
+    }
+
+    /* a frozen dictionary's sample is prefixed like a block */
+    sample = (0 != (flags & BLOCK_FLAG_FROZEN));
+
+    for (;;)
+    {
+        if (fread(prefix, 1, BLOCK_PREFIX_LEN, fpIn) != BLOCK_PREFIX_LEN)
+        {
+            errno = ferror(fpIn) ? errno : EILSEQ;
+            return -1;
+        }
+
+        rawLen = GET_LE32(prefix);
+        codedLen = GET_LE32(prefix + 4);
+        stored = (0 != (codedLen & BLOCK_STORED));
+        codedLen &= ~BLOCK_STORED;
+        info->codedSize += BLOCK_PREFIX_LEN;
+
+        if (!sample && (0 == rawLen))
+        {
+            return 0;           /* end of the stream */
+        }
+
+        if ((!sample && ((rawLen > info->blockSize) ||
+            (codedLen > LZWEncodeBound(info->blockSize)))) ||
+            (stored && (codedLen != rawLen)) ||
+            ((end >= 0) && ((off_t)(info->codedSize + codedLen) > end)))
+        {
+            errno = EILSEQ;
+            return -1;
+        }
+
+        if (0 != SkipBytes(fpIn, codedLen, (end >= 0)))
+        {
+            return -1;
+        }
+
+        info->codedSize += codedLen;
+
+        if (sample)
+        {
+            info->sampleLen = rawLen;
+            sample = 0;
+            continue;
+        }
+
+        info->rawSize += rawLen;
+        info->blocks++;
+        info->storedBlocks += stored;
+    }
+}
+
+/***************************************************************************
+*   Function   : SkipBytes
+*   Description: This routine skips over data in a file, seeking if it can
+*                and reading the data otherwise.
+*   Parameters : fpIn - file to skip data in
+*                len - number of bytes to skip
+*                seekable - non-zero if fpIn is a regular file
+*   Effects    : fpIn's position moves len bytes forward
+*   Returned   : 0 for success, -1 for failure.  errno is set to EILSEQ if
+*                fpIn ends first.
+***************************************************************************/
+static int SkipBytes(FILE *fpIn, const size_t len, const int seekable)
+{
+    unsigned char buf[BUFSIZ];
+    size_t left, n;
+
+    if (seekable)
+    {
+        return fseeko(fpIn, (off_t)len, SEEK_CUR);
+    }
+
+    for (left = len; left > 0; left -= n)
+    {
+        n = fread(buf, 1, (left < sizeof(buf)) ? left : sizeof(buf), fpIn);
+
+        if (0 == n)
+        {
+            errno = ferror(fpIn) ? errno : EILSEQ;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : ParseStreamHeader
+*   Description: This routine validates a block stream header that has
+*                been read into memory.
+*   Parameters : header - BLOCK_HEADER_LEN bytes of header
+*                blockSize - receives the nominal block size
+*                flags - receives the stream's BLOCK_FLAG_ values
+*   Effects    : None
+*   Returned   : 0 for success, -1 (with errno set to EILSEQ) if header
+*                isn't a supported block stream header.
+***************************************************************************/
+static int ParseStreamHeader(const unsigned char *header, size_t *blockSize,
+    unsigned char *flags)
+{
+    *blockSize = GET_LE32(header + 8);
+    *flags = header[5];
+
+    if ((0 != memcmp(header, BLOCK_MAGIC, BLOCK_MAGIC_LEN)) ||
+        (BLOCK_VERSION != header[4]) || (*flags & ~BLOCK_FLAGS_KNOWN) ||
+        ((*flags & BLOCK_FLAG_FROZEN) && (*flags & BLOCK_FLAG_SHARED)) ||
+        (0 == *blockSize) || (*blockSize > BLOCK_MAX_SIZE))
+    {
+        errno = EILSEQ;
+        return -1;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : ReadSample
+*   Description: This routine reads the encoded sample that follows the
+*                header of a stream with a frozen dictionary, and builds
+*                the same dictionary the encoder used.
+*   Parameters : shared - state shared by all slots
+*                fpIn - file containing the block stream
+*   Effects    : shared's sample and dictionary are set
+*   Returned   : 0 for success, -1 for failure.  errno is set to EILSEQ if
+*                the sample is invalid.
+***************************************************************************/
+static int ReadSample(parallel_t *shared, FILE *fpIn)
+{
+    if (0 != ReadCodedSample(fpIn, &shared->sample, &shared->sampleLen))
+    {
+        return -1;
+    }
+
+    shared->dictionary = LZWMakeDictionary(shared->sample,
+        shared->sampleLen);
+    return (NULL == shared->dictionary) ? -1 : 0;
+}
+
+/***************************************************************************
+*   Function   : ReadCodedSample
+*   Description: This routine reads and decodes a sample written by
+*                WriteCodedSample.
+*   Parameters : fpIn - file containing the sample
+*                sample - receives the allocated sample
+*                sampleLen - receives the number of bytes in sample
+*   Effects    : Memory is allocated for the sample.  It is freed again if
+*                the sample can't be read.
+*   Returned   : 0 for success, -1 for failure.  errno is set to EILSEQ if
+*                the sample is invalid.
+***************************************************************************/
+static int ReadCodedSample(FILE *fpIn, unsigned char **sample,
+    size_t *sampleLen)
+{
+    lzw_decoder_t *decoder;
+    unsigned char *coded;
+    unsigned char prefix[BLOCK_PREFIX_LEN];
+    size_t codedLen, decodedLen;
+    int result;
+
+    *sample = NULL;
+
+    if (fread(prefix, 1, BLOCK_PREFIX_LEN, fpIn) != BLOCK_PREFIX_LEN)
+    {
+        if (!ferror(fpIn))
+        {
+            errno = EILSEQ;
+        }
+
+        return -1;
+    }
+
+    *sampleLen = GET_LE32(prefix);
+    codedLen = GET_LE32(prefix + 4);
+
+    if ((*sampleLen > BLOCK_MAX_SIZE) ||
+        (codedLen > LZWEncodeBound(*sampleLen)))
+    {
+        errno = EILSEQ;
+        return -1;
+    }
+
+    /* one extra byte so a sample that decodes too long is caught */
+    *sample = LZWAlloc(LZW_MEM_IO, *sampleLen + 1);
+    coded = LZWAlloc(LZW_MEM_IO, codedLen + 1);
+    decoder = LZWMakeDecoder();
+    result = -1;
+
+    if ((NULL == *sample) || (NULL == coded) || (NULL == decoder))
+    {
+        errno = ENOMEM;
+    }
+    else if (fread(coded, 1, codedLen, fpIn) != codedLen)
+    {
+        if (!ferror(fpIn))
+        {
+            errno = EILSEQ;
+        }
+    }
+    else if ((0 != LZWDecodeBuffer(decoder, coded, codedLen, *sample,
+            *sampleLen + 1, &decodedLen)) ||
+        (decodedLen != *sampleLen))
+    {
+        errno = EILSEQ;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    if (0 != result)
+    {
+        LZWRelease(*sample);
+        *sample = NULL;
+    }
+
+    LZWFreeDecoder(decoder);
+    LZWRelease(coded);
+    return result;
+}
+
+/***************************************************************************
+*   Function   : UseSharedDictionary
+*   Description: This routine reads the dictionary id that follows the
+*                header of a stream encoded with a shared dictionary, and
+*                makes sure the caller supplied that dictionary.
+*   Parameters : shared - state shared by all slots
+*                fpIn - file containing the block stream
+*                dictionary - dictionary supplied by the caller (may be
+*                             NULL)
+*   Effects    : shared's dictionary is set to the caller's dictionary
+*   Returned   : 0 for success, -1 for failure.  errno is set to EINVAL if
+*                the dictionary is missing or has a different id.
+***************************************************************************/
+static int UseSharedDictionary(parallel_t *shared, FILE *fpIn,
+    lzw_dictionary_t *dictionary)
+{
+    unsigned char id[4];
+
+    if (fread(id, 1, 4, fpIn) != 4)
+    {
+        if (!ferror(fpIn))
+        {
+            errno = EILSEQ;
+        }
+
+        return -1;
+    }
+
+    if ((NULL == dictionary) || (dictionary->id != GET_LE32(id)))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    shared->dictionary = dictionary;
+    shared->borrowed = 1;
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : ReadCodedBlock
+*   Description: This routine reads the length prefix and data of the next
+*                block to be decoded, and assigns the block its position in
+*                the output.
+*   Parameters : shared - state shared by all slots
+*                slot - slot receiving the block
+*                fpIn - file being decoded
+*   Effects    : The block's data is read into slot->in
+*   Returned   : 1 if a block was read, 0 at the end of the stream, and -1
+*                for a read error or a bad block (errno set to EILSEQ).
+***************************************************************************/
+static int ReadCodedBlock(parallel_t *shared, block_slot_t *slot,
+    FILE *fpIn)
+{
+    unsigned char prefix[BLOCK_PREFIX_LEN];
+
+    if (fread(prefix, 1, BLOCK_PREFIX_LEN, fpIn) != BLOCK_PREFIX_LEN)
+    {
+        if (!ferror(fpIn))
+        {
+            errno = EILSEQ;     /* stream ended without an end block */
+        }
+
+        return -1;
+    }
+
+    slot->blockLen = GET_LE32(prefix);
+    slot->inLen = GET_LE32(prefix + 4);
+    slot->stored = (0 != (slot->inLen & BLOCK_STORED));
+    slot->inLen &= ~BLOCK_STORED;
+
+    if (0 == slot->blockLen)
+    {
+        return 0;               /* end of stream */
+    }
+
+    if ((slot->blockLen > shared->blockSize) ||
+        (slot->inLen > LZWEncodeBound(shared->blockSize)) ||
+        (slot->stored && (slot->inLen != slot->blockLen)))
+    {
+        errno = EILSEQ;
+        return -1;
+    }
+
+    if (fread(slot->in, 1, slot->inLen, fpIn) != slot->inLen)
+    {
+        if (!ferror(fpIn))
+        {
+            errno = EILSEQ;
+        }
+
+        return -1;
+    }
+
+    slot->offset = shared->offset;
+    shared->offset += slot->blockLen;
+    return 1;
+}
+
+/***************************************************************************
+*   Function   : DecodeBlockJob
+*   Description: This routine is run by a pool worker.  It decodes a
+*                slot's input using the worker's decoder.  If positional
+*                writes are in use, the decoded block is written to its
+*                place in the output file.
+*   Parameters : job - job embedded in a block_slot_t
+*                worker - worker running the job
+*   Effects    : slot's output buffer is filled and the slot is marked done
+*   Returned   : None
+***************************************************************************/
+static void DecodeBlockJob(lzw_job_t *job, lzw_worker_t *worker)
+{
+    block_slot_t *slot;
+    lzw_decoder_t *decoder;
+    size_t written;
+    ssize_t result;
+
+    slot = (block_slot_t *)job;
+
+    if (slot->stored)
+    {
+        memcpy(slot->out, slot->in, slot->blockLen);
+        slot->outLen = slot->blockLen;
+        result = 0;
+    }
+    else if (NULL != slot->shared->dictionary)
+    {
+        /* every worker reads the same frozen dictionary */
+        result = LZWDecodeFrozen(slot->shared->dictionary, slot->in,
+            slot->inLen, slot->out, slot->blockLen, &slot->outLen);
+    }
+    else
+    {
+        decoder = LZWWorkerDecoder(worker);
+
+        if (NULL == decoder)
+        {
+            MarkSlotDone(slot, ENOMEM);
+            return;
+        }
+
+        result = LZWDecodeBuffer(decoder, slot->in, slot->inLen, slot->out,
+            slot->blockLen, &slot->outLen);
+    }
+
+    if (0 != result)
+    {
+        MarkSlotDone(slot, (ENOBUFS == errno) ? EILSEQ : errno);
+        return;
+    }
+
+    if (slot->outLen != slot->blockLen)
+    {
+        MarkSlotDone(slot, EILSEQ);
+        return;
+    }
+
+    if (slot->shared->fd >= 0)
+    {
+        for (written = 0; written < slot->outLen; written += result)
+        {
+            result = pwrite(slot->shared->fd, slot->out + written,
+                slot->outLen - written, slot->offset + written);
+
+            if (result < 0)
+            {
+                MarkSlotDone(slot, errno);
+                return;
+            }
+        }
+    }
+
+    MarkSlotDone(slot, 0);
+}
+
+/***************************************************************************
+*   Function   : ReadLegacyChunk
+*   Description: This routine copies the next chunk of a mapped legacy
+*                stream into a slot.  Every chunk but the last holds
+*                blockSize * 8 / MAX_CODE_LEN code words, and the last
+*                holds whatever is left.
+*   Parameters : shared - state shared by all slots
+*                slot - slot receiving the chunk
+*                fpIn - unused, the stream is read from shared->map
+*   Effects    : The chunk is copied into slot->in
+*   Returned   : 1 if a chunk was read, 0 at the end of the stream.
+***************************************************************************/
+static int ReadLegacyChunk(parallel_t *shared, block_slot_t *slot,
+    FILE *fpIn)
+{
+    size_t remaining, len;
+
+    (void)fpIn;
+    remaining = shared->mapLen - shared->mapPos;
+
+    if ((remaining * CHAR_BIT) < (shared->skipBits + MAX_CODE_LEN))
+    {
+        return 0;               /* only padding is left */
+    }
+
+    /* a chunk that doesn't start on a byte also uses the next one's first */
+    len = shared->blockSize + ((0 != shared->skipBits) ? 1 : 0);
+
+    if (len < remaining)
+    {
+        slot->blockLen = (shared->blockSize * CHAR_BIT) / MAX_CODE_LEN;
+    }
+    else
+    {
+        len = remaining;
+        slot->blockLen = 0;     /* decode to the end */
+    }
+
+    memcpy(slot->in, shared->map + shared->mapPos, len);
+    slot->inLen = len;
+
+    /* the next chunk starts in the last byte of this one */
+    shared->mapPos += (0 == slot->blockLen) ? remaining : shared->blockSize;
+    return 1;
+}
+
+/***************************************************************************
+*   Function   : DecodeChunkJob
+*   Description: This routine is run by a pool worker.  It decodes a chunk
+*                of a legacy stream with the shared frozen dictionary.  The
+*                decoded length is measured first, so the slot's output
+*                buffer may be grown to fit it.
+*   Parameters : job - job embedded in a block_slot_t
+*                worker - worker running the job (unused)
+*   Effects    : slot's output buffer is filled and the slot is marked done
+*   Returned   : None
+***************************************************************************/
+static void DecodeChunkJob(lzw_job_t *job, lzw_worker_t *worker)
+{
+    block_slot_t *slot;
+    parallel_t *shared;
+    unsigned char *out;
+    size_t needed;
+
+    (void)worker;
+    slot = (block_slot_t *)job;
+    shared = slot->shared;
+
+    if (0 != LZWDecodeFrozenBits(shared->dictionary, slot->in, slot->inLen,
+        shared->skipBits, slot->blockLen, NULL, 0, &needed))
+    {
+        MarkSlotDone(slot, errno);
+        return;
+    }
+
+    if (needed > slot->outSize)
+    {
+        out = LZWResize(LZW_MEM_IO, slot->out, needed);
+
+        if (NULL == out)
+        {
+            MarkSlotDone(slot, ENOMEM);
+            return;
+        }
+
+        slot->out = out;
+        slot->outSize = needed;
+    }
+
+    if (0 != LZWDecodeFrozenBits(shared->dictionary, slot->in, slot->inLen,
+        shared->skipBits, slot->blockLen, slot->out, slot->outSize,
+        &slot->outLen))
+    {
+        MarkSlotDone(slot, errno);
+        return;
+    }
+
+    MarkSlotDone(slot, 0);
+}
+
+/***************************************************************************
+*   Function   : UsePositionalWrites
+*   Description: This routine determines if decoded blocks may be written
+*                directly to their final positions in an output file.  That
+*                requires a regular file that isn't opened for appending.
+*   Parameters : fpOut - file receiving decoded data
+*                offset - receives the current position in fpOut
+*   Effects    : fpOut is flushed
+*   Returned   : Non-zero if positional writes may be used, otherwise 0.
+***************************************************************************/
+static int UsePositionalWrites(FILE *fpOut, off_t *offset)
+{
+    struct stat info;
+    int fd, flags;
+
+    if (0 != fflush(fpOut))
+    {
+        return 0;
+    }
+
+    fd = fileno(fpOut);
+    flags = fcntl(fd, F_GETFL);
+
+    if ((fd < 0) || (flags < 0) || (0 != (flags & O_APPEND)) ||
+        (0 != fstat(fd, &info)) || !S_ISREG(info.st_mode))
+    {
+        return 0;
+    }
+
+    *offset = ftello(fpOut);
+    return (*offset >= 0);
+}
+
+/***************************************************************************
+*   Function   : InputLength
+*   Description: This routine determines how many bytes remain to be read
+*                from an input file, so the block size may be chosen for
+*                it.
+*   Parameters : fpIn - file to be encoded
+*   Effects    : None
+*   Returned   : Bytes from the current position to the end of a regular
+*                file, or 0 if that isn't known.
+***************************************************************************/
+static size_t InputLength(FILE *fpIn)
+{
+    struct stat sb;
+    off_t pos;
+
+    pos = ftello(fpIn);
+
+    if ((pos < 0) || (0 != fstat(fileno(fpIn), &sb)) ||
+        !S_ISREG(sb.st_mode) || (sb.st_size <= pos))
+    {
+        return 0;
+    }
+
+    return (size_t)(sb.st_size - pos);
+}
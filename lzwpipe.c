@@ -0,0 +1,775 @@
+/***************************************************************************
+*               Pipelined Lempel-Ziv-Welch Encoding Functions
+*
+*   File    : lzwpipe.c
+*   Purpose : Provides a function that encodes a single LZW stream using
+*             three threads: one reading the input, one encoding, and one
+*             writing the output.  The threads pass reusable I/O blocks
+*             through lock-free single-producer/single-consumer rings.  A
+*             second function adds a fourth thread that decodes the
+*             stream as it is written and compares it with the input.
+*   Author  : The lzw library contributors
+*   Date    : October 17, 2026
+*
+****************************************************************************
+*
+* LZW: An ANSI C Lempel-Ziv-Welch Encoding/Decoding Routines
+* Copyright (C) 2026 by
+* The lzw library contributors
+*
+* This file is part of the lzw library.
+*
+* The lzw library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The lzw library is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#define _POSIX_C_SOURCE 200112L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include "lzw.h"
+#include "lzwlocal.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define PIPE_BLOCK_SIZE     (1UL << 18)     /* bytes read at a time */
+#define PIPE_RING_SIZE      8               /* blocks in each ring */
+#define PIPE_SPIN_LIMIT     1000            /* spins before yielding */
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* a reusable block of data passed between threads */
+typedef struct
+{
+    unsigned char *data;        /* block data */
+    size_t len;                 /* bytes of data, 0 marks the end */
+} io_block_t;
+
+/***************************************************************************
+* A ring of blocks shared by exactly one producer and one consumer.  Only
+* the producer writes head and only the consumer writes tail, so the ring
+* needs no lock.  Blocks head - tail through head - 1 are full.
+***************************************************************************/
+typedef struct
+{
+    io_block_t blocks[PIPE_RING_SIZE];
+    unsigned long head;         /* number of blocks produced */
+    unsigned long tail;         /* number of blocks consumed */
+} spsc_ring_t;
+
+/* state shared by the pipeline stages */
+typedef struct
+{
+    spsc_ring_t input;          /* reader to encoder */
+    spsc_ring_t output;         /* encoder to writer */
+    spsc_ring_t raw;            /* copies of input, reader to verifier */
+    spsc_ring_t coded;          /* copies of output, writer to verifier */
+    int verify;                 /* non-zero if the raw/coded rings are used */
+    FILE *fpIn;                 /* file being encoded */
+    FILE *fpOut;                /* file receiving encoded data */
+    int failed;                 /* set when any stage fails */
+    int error;                  /* errno value from the failed stage */
+} pipeline_t;
+
+/* position of the verifier in the copies of the input */
+typedef struct
+{
+    pipeline_t *pipeline;
+    io_block_t *block;          /* raw block being compared, NULL if none */
+    size_t pos;                 /* bytes of block already compared */
+} verifier_t;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+static int MakeRing(spsc_ring_t *ring, const size_t blockSize);
+static void FreeRing(spsc_ring_t *ring);
+static io_block_t *RingEmptyBlock(spsc_ring_t *ring, pipeline_t *pipeline);
+static io_block_t *RingFullBlock(spsc_ring_t *ring, pipeline_t *pipeline);
+static void RingPush(spsc_ring_t *ring);
+static void RingPop(spsc_ring_t *ring);
+static void Backoff(unsigned int *spins);
+static void Fail(pipeline_t *pipeline, const int error);
+
+static void *ReaderMain(void *arg);
+static void *WriterMain(void *arg);
+static int EncodeStage(pipeline_t *pipeline, lzw_encoder_t *encoder);
+static void *VerifierMain(void *arg);
+static int CompareDecoded(void *arg, const unsigned char *data,
+    const size_t len);
+static int CopyBlock(spsc_ring_t *ring, pipeline_t *pipeline,
+    const io_block_t *block);
+
+static int EncodePipeline(FILE *fpIn, FILE *fpOut, const int verify);
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : LZWEncodeFilePipelined
+*   Description: This routine encodes a file as a single LZW stream, like
+*                LZWEncodeFile, but overlaps reading, encoding, and writing
+*                on separate threads.  The output is identical to the
+*                output of LZWEncodeFile.
+*   Parameters : fpIn - pointer to the open binary file to encode
+*                fpOut - pointer to the open binary file to write encoded
+*                       output
+*   Effects    : fpIn is encoded and written to fpOut.  Neither file is
+*                closed after exit.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+int LZWEncodeFilePipelined(FILE *fpIn, FILE *fpOut)
+{
+    return EncodePipeline(fpIn, fpOut, 0);
+}
+
+/***************************************************************************
+*   Function   : LZWEncodeFileVerified
+*   Description: This routine encodes a file like LZWEncodeFilePipelined,
+*                and checks the encoded stream while it is being written.
+*                The reader passes a copy of each input block, and the
+*                writer a copy of each block it writes, to a verifier
+*                thread that decodes the stream a block at a time and
+*                compares it with the input.  The verifier runs alongside
+*                the encoder, which is much slower, so the check adds
+*                little to the time taken.
+*   Parameters : fpIn - pointer to the open binary file to encode
+*                fpOut - pointer to the open binary file to write encoded
+*                       output
+*   Effects    : fpIn is encoded and written to fpOut.  Neither file is
+*                closed after exit.
+*   Returned   : 0 if the stream was written and decodes to the input, -1
+*                for failure.  errno will be set in the event of a failure,
+*                EILSEQ if the stream doesn't decode to the input.
+***************************************************************************/
+int LZWEncodeFileVerified(FILE *fpIn, FILE *fpOut)
+{
+    return EncodePipeline(fpIn, fpOut, 1);
+}
+
+/***************************************************************************
+*   Function   : EncodePipeline
+*   Description: This routine runs the pipeline stages for
+*                LZWEncodeFilePipelined and LZWEncodeFileVerified.  The
+*                calling thread is the encoding stage.
+*   Parameters : fpIn - pointer to the open binary file to encode
+*                fpOut - pointer to the open binary file to write encoded
+*                       output
+*                verify - non-zero to run the verifier
+*   Effects    : fpIn is encoded and written to fpOut.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+static int EncodePipeline(FILE *fpIn, FILE *fpOut, const int verify)
+{
+    pipeline_t pipeline;
+    lzw_encoder_t *encoder;
+    pthread_t reader, writer, verifier;
+    int result, verifyResult;
+
+    /* validate arguments */
+    if ((NULL == fpIn) || (NULL == fpOut))
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    pipeline.fpIn = fpIn;
+    pipeline.fpOut = fpOut;
+    pipeline.verify = verify;
+    pipeline.failed = 0;
+    pipeline.error = 0;
+    encoder = LZWMakeEncoder();
+    result = MakeRing(&pipeline.input, PIPE_BLOCK_SIZE);
+    result |= MakeRing(&pipeline.output, LZWEncodeBound(PIPE_BLOCK_SIZE));
+
+    if (verify)
+    {
+        result |= MakeRing(&pipeline.raw, PIPE_BLOCK_SIZE);
+        result |= MakeRing(&pipeline.coded, LZWEncodeBound(PIPE_BLOCK_SIZE));
+    }
+
+    if ((NULL == encoder) || (0 != result))
+    {
+        result = -1;
+        errno = ENOMEM;
+    }
+    else
+    {
+        result = pthread_create(&reader, NULL, ReaderMain, &pipeline);
+
+        if (0 == result)
+        {
+            result = pthread_create(&writer, NULL, WriterMain, &pipeline);
+
+            if (0 == result)
+            {
+                verifyResult = 0;
+
+                if (verify)
+                {
+                    verifyResult = pthread_create(&verifier, NULL,
+                        VerifierMain, &pipeline);
+
+                    if (0 != verifyResult)
+                    {
+                        Fail(&pipeline, verifyResult);
+                    }
+                }
+
+                /* this thread is the encoding stage */
+                EncodeStage(&pipeline, encoder);
+                pthread_join(writer, NULL);
+
+                if (verify && (0 == verifyResult))
+                {
+                    pthread_join(verifier, NULL);
+                }
+            }
+            else
+            {
+                Fail(&pipeline, result);
+            }
+
+            pthread_join(reader, NULL);
+        }
+        else
+        {
+            Fail(&pipeline, result);
+        }
+
+        result = 0;
+
+        if (pipeline.failed)
+        {
+            errno = pipeline.error;
+            result = -1;
+        }
+    }
+
+    LZWFreeEncoder(encoder);
+    FreeRing(&pipeline.input);
+    FreeRing(&pipeline.output);
+
+    if (verify)
+    {
+        FreeRing(&pipeline.raw);
+        FreeRing(&pipeline.coded);
+    }
+
+    return result;
+}
+
+/***************************************************************************
+*   Function   : ReaderMain
+*   Description: This is the thread function for the reading stage.  It
+*                fills empty input blocks from the input file and passes
+*                them to the encoder.  A block with no data marks the end
+*                of the input.
+*   Parameters : arg - pointer to the pipeline_t
+*   Effects    : Input file is read
+*   Returned   : NULL
+***************************************************************************/
+static void *ReaderMain(void *arg)
+{
+    pipeline_t *pipeline;
+    io_block_t *block;
+
+    pipeline = (pipeline_t *)arg;
+
+    do
+    {
+        block = RingEmptyBlock(&pipeline->input, pipeline);
+
+        if (NULL == block)
+        {
+            break;          /* another stage failed */
+        }
+
+        block->len = fread(block->data, 1, PIPE_BLOCK_SIZE, pipeline->fpIn);
+
+        if ((0 == block->len) && ferror(pipeline->fpIn))
+        {
+            Fail(pipeline, errno);
+            break;
+        }
+
+        /* the verifier gets its copy before the encoder gets the block */
+        if (pipeline->verify && (0 != CopyBlock(&pipeline->raw, pipeline,
+            block)))
+        {
+            break;          /* another stage failed */
+        }
+
+        RingPush(&pipeline->input);
+    } while (0 != block->len);
+
+    return NULL;
+}
+
+/***************************************************************************
+*   Function   : EncodeStage
+*   Description: This routine is the encoding stage.  It encodes each
+*                input block into an output block, recycling the input
+*                block once it has been encoded.
+*   Parameters : pipeline - state shared by the stages
+*                encoder - encoder context for this stream
+*   Effects    : Encoded blocks are passed to the writer
+*   Returned   : 0 for success, -1 for failure.
+***************************************************************************/
+static int EncodeStage(pipeline_t *pipeline, lzw_encoder_t *encoder)
+{
+    io_block_t *in, *out;
+    size_t inLen;
+    int result;
+
+    LZWEncodeStart(encoder);
+
+    do
+    {
+        in = RingFullBlock(&pipeline->input, pipeline);
+        out = (NULL == in) ? NULL :
+            RingEmptyBlock(&pipeline->output, pipeline);
+
+        if (NULL == out)
+        {
+            return -1;      /* another stage failed */
+        }
+
+        inLen = in->len;
+
+        if (0 == inLen)
+        {
+            /* end of input, flush the end of the stream */
+            result = LZWEncodeEnd(encoder, out->data,
+                LZWEncodeBound(PIPE_BLOCK_SIZE), &out->len);
+        }
+        else
+        {
+            result = LZWEncodeChunk(encoder, in->data, inLen, out->data,
+                LZWEncodeBound(PIPE_BLOCK_SIZE), &out->len);
+        }
+
+        RingPop(&pipeline->input);
+
+        if (0 != result)
+        {
+            Fail(pipeline, errno);
+            return -1;
+        }
+
+        if ((0 != out->len) || (0 == inLen))
+        {
+            RingPush(&pipeline->output);
+        }
+    } while (0 != inLen);
+
+    if (0 != out->len)
+    {
+        /* the writer stops at an empty block */
+        out = RingEmptyBlock(&pipeline->output, pipeline);
+
+        if (NULL == out)
+        {
+            return -1;
+        }
+
+        out->len = 0;
+        RingPush(&pipeline->output);
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : WriterMain
+*   Description: This is the thread function for the writing stage.  It
+*                writes encoded blocks to the output file in order and
+*                returns them to the encoder for reuse.
+*   Parameters : arg - pointer to the pipeline_t
+*   Effects    : Output file is written
+*   Returned   : NULL
+***************************************************************************/
+static void *WriterMain(void *arg)
+{
+    pipeline_t *pipeline;
+    io_block_t *block;
+    size_t len;
+
+    pipeline = (pipeline_t *)arg;
+
+    do
+    {
+        block = RingFullBlock(&pipeline->output, pipeline);
+
+        if (NULL == block)
+        {
+            break;          /* another stage failed */
+        }
+
+        len = block->len;
+
+        if (fwrite(block->data, 1, len, pipeline->fpOut) != len)
+        {
+            Fail(pipeline, errno);
+            break;
+        }
+
+        if (pipeline->verify && (0 != CopyBlock(&pipeline->coded, pipeline,
+            block)))
+        {
+            break;          /* another stage failed */
+        }
+
+        RingPop(&pipeline->output);
+    } while (0 != len);
+
+    return NULL;
+}
+
+/***************************************************************************
+*   Function   : VerifierMain
+*   Description: This is the thread function for the verifying stage.  It
+*                decodes each block the writer has written and compares
+*                the decoded data with the reader's copies of the input.
+*                The stream must decode to exactly the input.
+*   Parameters : arg - pointer to the pipeline_t
+*   Effects    : The pipeline fails with EILSEQ if the stream and the
+*                input differ
+*   Returned   : NULL
+***************************************************************************/
+static void *VerifierMain(void *arg)
+{
+    pipeline_t *pipeline;
+    verifier_t verifier;
+    lzw_decoder_t *decoder;
+    io_block_t *block;
+    size_t len;
+
+    pipeline = (pipeline_t *)arg;
+    verifier.pipeline = pipeline;
+    verifier.block = NULL;
+    verifier.pos = 0;
+    decoder = LZWMakeDecoder();
+
+    if (NULL == decoder)
+    {
+        Fail(pipeline, ENOMEM);
+        return NULL;
+    }
+
+    do
+    {
+        block = RingFullBlock(&pipeline->coded, pipeline);
+
+        if (NULL == block)
+        {
+            break;          /* another stage failed */
+        }
+
+        len = block->len;
+
+        if (0 != LZWDecodeChunk(decoder, block->data, len, CompareDecoded,
+            &verifier))
+        {
+            Fail(pipeline, errno);
+            break;
+        }
+
+        RingPop(&pipeline->coded);
+    } while (0 != len);
+
+    if ((NULL != block) && (0 == len))
+    {
+        /* everything was compared, so only the end of input may be left */
+        if (NULL == verifier.block)
+        {
+            verifier.block = RingFullBlock(&pipeline->raw, pipeline);
+            verifier.pos = 0;
+        }
+
+        if ((NULL != verifier.block) &&
+            (verifier.pos != verifier.block->len))
+        {
+            Fail(pipeline, EILSEQ);     /* decoded data is short */
+        }
+    }
+
+    LZWFreeDecoder(decoder);
+    return NULL;
+}
+
+/***************************************************************************
+*   Function   : CompareDecoded
+*   Description: This routine is the sink used by the verifier's decoder.
+*                It compares decoded data with the next bytes of the input,
+*                returning each copy of an input block to the reader once
+*                all of it has been compared.
+*   Parameters : arg - pointer to the verifier_t
+*                data - decoded data
+*                len - number of bytes in data
+*   Effects    : The verifier's position in the input advances
+*   Returned   : 0 if data matches the input, otherwise -1 with errno set
+***************************************************************************/
+static int CompareDecoded(void *arg, const unsigned char *data,
+    const size_t len)
+{
+    verifier_t *verifier;
+    size_t compared, n;
+
+    verifier = (verifier_t *)arg;
+
+    for (compared = 0; compared < len; compared += n)
+    {
+        if (NULL == verifier->block)
+        {
+            verifier->block = RingFullBlock(&verifier->pipeline->raw,
+                verifier->pipeline);
+            verifier->pos = 0;
+
+            if (NULL == verifier->block)
+            {
+                errno = verifier->pipeline->error;
+                return -1;      /* another stage failed */
+            }
+        }
+
+        n = verifier->block->len - verifier->pos;
+        n = (n < (len - compared)) ? n : (len - compared);
+
+        /* an empty block ends the input, so decoded data is too long */
+        if ((0 == n) ||
+            (0 != memcmp(data + compared,
+            verifier->block->data + verifier->pos, n)))
+        {
+            errno = EILSEQ;
+            return -1;
+        }
+
+        verifier->pos += n;
+
+        if (verifier->pos == verifier->block->len)
+        {
+            RingPop(&verifier->pipeline->raw);
+            verifier->block = NULL;
+        }
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : CopyBlock
+*   Description: This routine passes a copy of a block to the verifier.
+*   Parameters : ring - ring to the verifier
+*                pipeline - state shared by the stages
+*                block - block to copy
+*   Effects    : The copy is pushed on ring
+*   Returned   : 0 for success, -1 if another stage failed
+***************************************************************************/
+static int CopyBlock(spsc_ring_t *ring, pipeline_t *pipeline,
+    const io_block_t *block)
+{
+    io_block_t *copy;
+
+    copy = RingEmptyBlock(ring, pipeline);
+
+    if (NULL == copy)
+    {
+        return -1;
+    }
+
+    memcpy(copy->data, block->data, block->len);
+    copy->len = block->len;
+    RingPush(ring);
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : MakeRing
+*   Description: This routine allocates the blocks of an empty ring.
+*   Parameters : ring - ring to initialize
+*                blockSize - size of each block's data
+*   Effects    : Memory is allocated for the blocks
+*   Returned   : 0 for success, -1 for failure.
+***************************************************************************/
+static int MakeRing(spsc_ring_t *ring, const size_t blockSize)
+{
+    unsigned int i;
+    int result;
+
+    ring->head = 0;
+    ring->tail = 0;
+    result = 0;
+
+    for (i = 0; i < PIPE_RING_SIZE; i++)
+    {
+        ring->blocks[i].len = 0;
+        ring->blocks[i].data = LZWAlloc(LZW_MEM_IO, blockSize);
+
+        if (NULL == ring->blocks[i].data)
+        {
+            result = -1;
+        }
+    }
+
+    return result;
+}
+
+/***************************************************************************
+*   Function   : FreeRing
+*   Description: This routine frees the blocks of a ring.
+*   Parameters : ring - ring initialized by MakeRing
+*   Effects    : Block memory is freed
+*   Returned   : None
+***************************************************************************/
+static void FreeRing(spsc_ring_t *ring)
+{
+    unsigned int i;
+
+    for (i = 0; i < PIPE_RING_SIZE; i++)
+    {
+        LZWRelease(ring->blocks[i].data);
+        ring->blocks[i].data = NULL;
+    }
+}
+
+/***************************************************************************
+*   Function   : RingEmptyBlock
+*   Description: This routine is used by a ring's producer to get the next
+*                block to fill.  It waits until the consumer has released a
+*                block if the ring is full.
+*   Parameters : ring - ring to get a block from
+*                pipeline - state shared by the stages
+*   Effects    : None
+*   Returned   : Pointer to the block to fill, or NULL if a stage failed
+***************************************************************************/
+static io_block_t *RingEmptyBlock(spsc_ring_t *ring, pipeline_t *pipeline)
+{
+    unsigned int spins = 0;
+
+    while ((ring->head - ATOMIC_LOAD(&ring->tail)) == PIPE_RING_SIZE)
+    {
+        if (ATOMIC_LOAD(&pipeline->failed))
+        {
+            return NULL;
+        }
+
+        Backoff(&spins);
+    }
+
+    return &ring->blocks[ring->head % PIPE_RING_SIZE];
+}
+
+/***************************************************************************
+*   Function   : RingFullBlock
+*   Description: This routine is used by a ring's consumer to get the next
+*                block to process.  It waits until the producer has filled
+*                a block if the ring is empty.
+*   Parameters : ring - ring to get a block from
+*                pipeline - state shared by the stages
+*   Effects    : None
+*   Returned   : Pointer to the block to process, or NULL if a stage failed
+***************************************************************************/
+static io_block_t *RingFullBlock(spsc_ring_t *ring, pipeline_t *pipeline)
+{
+    unsigned int spins = 0;
+
+    while (ATOMIC_LOAD(&ring->head) == ring->tail)
+    {
+        if (ATOMIC_LOAD(&pipeline->failed))
+        {
+            return NULL;
+        }
+
+        Backoff(&spins);
+    }
+
+    return &ring->blocks[ring->tail % PIPE_RING_SIZE];
+}
+
+/***************************************************************************
+*   Function   : RingPush
+*   Description: This routine is used by a ring's producer to pass the
+*                block returned by RingEmptyBlock to the consumer.
+*   Parameters : ring - ring containing the block
+*   Effects    : Block's contents become visible to the consumer
+*   Returned   : None
+***************************************************************************/
+static void RingPush(spsc_ring_t *ring)
+{
+    ATOMIC_STORE(&ring->head, ring->head + 1);
+}
+
+/***************************************************************************
+*   Function   : RingPop
+*   Description: This routine is used by a ring's consumer to return the
+*                block returned by RingFullBlock to the producer.
+*   Parameters : ring - ring containing the block
+*   Effects    : Block may be refilled by the producer
+*   Returned   : None
+***************************************************************************/
+static void RingPop(spsc_ring_t *ring)
+{
+    ATOMIC_STORE(&ring->tail, ring->tail + 1);
+}
+
+/***************************************************************************
+*   Function   : Backoff
+*   Description: This routine is called while a stage waits on a ring.  It
+*                spins briefly, then yields the processor so a waiting
+*                stage doesn't take a core from the stage it waits on.
+*   Parameters : spins - number of times the caller has waited so far
+*   Effects    : spins is incremented
+*   Returned   : None
+***************************************************************************/
+static void Backoff(unsigned int *spins)
+{
+    if (*spins < PIPE_SPIN_LIMIT)
+    {
+        (*spins)++;
+    }
+    else
+    {
+        sched_yield();
+    }
+}
+
+/***************************************************************************
+*   Function   : Fail
+*   Description: This routine records that a stage has failed, so that the
+*                other stages stop waiting on it.
+*   Parameters : pipeline - state shared by the stages
+*                error - errno value describing the failure
+*   Effects    : pipeline is marked as failed
+*   Returned   : None
+***************************************************************************/
+static void Fail(pipeline_t *pipeline, const int error)
+{
+    if (!ATOMIC_LOAD(&pipeline->failed))
+    {
+        pipeline->error = (0 == error) ? EIO : error;
+        ATOMIC_STORE(&pipeline->failed, 1);
+    }
+}
@@ -0,0 +1,557 @@
+/***************************************************************************
+*              Thread Pool Used by the Parallel LZW Routines
+*
+*   File    : lzwpool.c
+*   Purpose : Provides a simple pool of worker threads that run jobs from
+*             a shared queue.  Each worker owns the codec contexts it uses,
+*             so jobs never share a dictionary.  Also provides the core
+*             count and cache size queries used to size the pool and its
+*             blocks.
+*   Author  : The lzw library contributors
+*   Date    : October 17, 2026
+*
+****************************************************************************
+*
+* LZW: An ANSI C Lempel-Ziv-Welch Encoding/Decoding Routines
+* Copyright (C) 2026 by
+* The lzw library contributors
+*
+* This file is part of the lzw library.
+*
+* The lzw library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The lzw library is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#ifdef __linux__
+#define _GNU_SOURCE             /* sched_getaffinity */
+#else
+#define _POSIX_C_SOURCE 200112L
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include "lzw.h"
+#include "lzwpool.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+/* automatic block sizes are powers of 2 in this range */
+#define AUTO_MIN_BLOCK      (1UL << 16)     /* smaller hurts ratio badly */
+#define AUTO_MAX_BLOCK      (1UL << 22)     /* larger gains little ratio */
+
+/* blocks per thread wanted so threads finish at about the same time */
+#define AUTO_BLOCKS_PER_THREAD  4
+
+/* cache sizes assumed when sysfs doesn't report them */
+#define DEFAULT_L2_SIZE     (1UL << 18)
+#define DEFAULT_L3_SIZE     (1UL << 23)
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+struct lzw_pool_t
+{
+    pthread_mutex_t lock;       /* protects everything below */
+    pthread_cond_t ready;       /* signaled when a job is queued */
+    lzw_job_t *head;            /* next job to run */
+    lzw_job_t *tail;            /* last job queued */
+    int shutdown;               /* workers exit once the queue is empty */
+    int pin;                    /* workers pin themselves to cores */
+
+    unsigned int threads;       /* number of workers */
+    lzw_worker_t *workers;      /* array of workers */
+};
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+static void *WorkerMain(void *arg);
+static size_t CacheSize(const unsigned int level);
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : LZWOnlineCores
+*   Description: This routine returns the number of processors this
+*                process may run on.  That is the size of its affinity
+*                mask where available (so taskset and container CPU sets
+*                are honored), otherwise the number of online processors.
+*   Parameters : None
+*   Effects    : None
+*   Returned   : Number of usable processors (at least 1).
+***************************************************************************/
+unsigned int LZWOnlineCores(void)
+{
+    long cores;
+
+#ifdef __linux__
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+
+    if (0 == sched_getaffinity(0, sizeof(set), &set))
+    {
+        cores = CPU_COUNT(&set);
+
+        if (cores > 0)
+        {
+            return (unsigned int)cores;
+        }
+    }
+#endif
+
+    cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (cores < 1)
+    {
+        cores = 1;
+    }
+
+    return (unsigned int)cores;
+}
+
+/***************************************************************************
+*   Function   : LZWAutoBlockSize
+*   Description: This routine picks a block size for block-parallel
+*                encoding.  Larger blocks compress better, because each
+*                block's dictionary fills further, and smaller blocks spread
+*                the work more evenly and keep each thread's block, output
+*                and dictionary strings in cache.  The size starts at each
+*                thread's share of the L3 cache (but no less than the L2
+*                cache), is cut so that every thread gets several blocks of
+*                the input, and is limited to a range where the trade off
+*                is worthwhile.
+*   Parameters : threads - number of encoding threads (0 = one per core)
+*                inLen - number of bytes to encode (0 if unknown)
+*   Effects    : None
+*   Returned   : Block size in bytes (a power of 2).
+***************************************************************************/
+size_t LZWAutoBlockSize(const unsigned int threads, const size_t inLen)
+{
+    unsigned long l2, l3, size, limit, blockSize;
+    unsigned int n;
+
+    n = (0 == threads) ? LZWOnlineCores() : threads;
+    l2 = CacheSize(2);
+    l3 = CacheSize(3);
+
+    if (0 == l2)
+    {
+        l2 = DEFAULT_L2_SIZE;
+    }
+
+    if (0 == l3)
+    {
+        l3 = DEFAULT_L3_SIZE;
+    }
+
+    size = l3 / n;
+
+    if (size < l2)
+    {
+        size = l2;
+    }
+
+    if (0 != inLen)
+    {
+        limit = inLen / ((unsigned long)n * AUTO_BLOCKS_PER_THREAD);
+
+        if (size > limit)
+        {
+            size = limit;
+        }
+    }
+
+    /* largest power of 2 in range that isn't larger than size */
+    for (blockSize = AUTO_MIN_BLOCK; blockSize < AUTO_MAX_BLOCK;
+        blockSize *= 2)
+    {
+        if ((blockSize * 2) > size)
+        {
+            break;
+        }
+    }
+
+    return (size_t)blockSize;
+}
+
+/***************************************************************************
+*   Function   : CacheSize
+*   Description: This routine reads the size of a unified or data cache
+*                level used by the first processor from sysfs.
+*   Parameters : level - cache level (1, 2, 3, ...)
+*   Effects    : None
+*   Returned   : Cache size in bytes, or 0 if it isn't known.
+***************************************************************************/
+static size_t CacheSize(const unsigned int level)
+{
+    char path[80];
+    char type[16];
+    FILE *fp;
+    unsigned int index, found;
+    unsigned long size;
+    char unit;
+    int ok;
+
+    for (index = 0; index < 8; index++)
+    {
+        sprintf(path, "/sys/devices/system/cpu/cpu0/cache/index%u/level",
+            index);
+        fp = fopen(path, "r");
+
+        if (NULL == fp)
+        {
+            break;              /* no more caches */
+        }
+
+        ok = (1 == fscanf(fp, "%u", &found));
+        fclose(fp);
+
+        if (!ok || (found != level))
+        {
+            continue;
+        }
+
+        sprintf(path, "/sys/devices/system/cpu/cpu0/cache/index%u/type",
+            index);
+        fp = fopen(path, "r");
+
+        if (NULL != fp)
+        {
+            ok = (1 == fscanf(fp, "%15s", type));
+            fclose(fp);
+
+            if (ok && ('I' == type[0]))
+            {
+                continue;       /* instruction cache */
+            }
+        }
+
+        sprintf(path, "/sys/devices/system/cpu/cpu0/cache/index%u/size",
+            index);
+        fp = fopen(path, "r");
+
+        if (NULL == fp)
+        {
+            continue;
+        }
+
+        unit = ' ';
+        ok = (1 <= fscanf(fp, "%lu%c", &size, &unit));
+        fclose(fp);
+
+        if (ok)
+        {
+            if (('K' == unit) || ('k' == unit))
+            {
+                size <<= 10;
+            }
+            else if ('M' == unit)
+            {
+                size <<= 20;
+            }
+
+            return (size_t)size;
+        }
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : LZWPinThread
+*   Description: This routine binds the calling thread to a single core, so
+*                that the dictionaries and buffers it touches stay in that
+*                core's private caches.  Cores are numbered in the order
+*                they appear in the thread's current affinity mask, and
+*                index wraps around when there are more threads than
+*                cores.
+*   Parameters : index - selects the core (usually a worker's id)
+*   Effects    : The calling thread's affinity mask is replaced.
+*   Returned   : 0 for success, -1 for failure.  errno is set to ENOSYS
+*                where pinning isn't supported.
+***************************************************************************/
+int LZWPinThread(const unsigned int index)
+{
+#ifdef __linux__
+    cpu_set_t set, pinned;
+    unsigned int cpu, skip;
+
+    if (0 != sched_getaffinity(0, sizeof(set), &set))
+    {
+        return -1;
+    }
+
+    skip = index % (unsigned int)CPU_COUNT(&set);
+
+    for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (CPU_ISSET(cpu, &set) && (0 == skip--))
+        {
+            CPU_ZERO(&pinned);
+            CPU_SET(cpu, &pinned);
+
+            /* 0 is the calling thread, not the whole process */
+            return sched_setaffinity(0, sizeof(pinned), &pinned);
+        }
+    }
+
+    errno = EINVAL;
+    return -1;
+#else
+    (void)index;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/***************************************************************************
+*   Function   : LZWMakePool
+*   Description: This routine starts a pool of worker threads waiting for
+*                jobs.  Pinned workers bind themselves to a core before
+*                running any jobs, so the codec contexts that each worker
+*                makes on first use are first touched, and stay cached, on
+*                that core.
+*   Parameters : threads - number of worker threads to start (> 0)
+*                pin - non-zero to pin worker i to the i-th usable core
+*   Effects    : Worker threads are created.
+*   Returned   : Pointer to the new pool or NULL on error.  errno will be
+*                set on an error.
+***************************************************************************/
+lzw_pool_t *LZWMakePool(const unsigned int threads, const int pin)
+{
+    lzw_pool_t *pool;
+    unsigned int i;
+    int result;
+
+    if (0 == threads)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    pool = malloc(sizeof(lzw_pool_t));
+
+    if (NULL == pool)
+    {
+        return NULL;
+    }
+
+    pool->workers = calloc(threads, sizeof(lzw_worker_t));
+
+    if (NULL == pool->workers)
+    {
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->ready, NULL);
+    pool->head = NULL;
+    pool->tail = NULL;
+    pool->shutdown = 0;
+    pool->pin = pin;
+    pool->threads = 0;
+
+    for (i = 0; i < threads; i++)
+    {
+        pool->workers[i].pool = pool;
+        pool->workers[i].id = i;
+        pool->workers[i].encoder = NULL;
+        pool->workers[i].decoder = NULL;
+
+        result = pthread_create(&pool->workers[i].thread, NULL, WorkerMain,
+            &pool->workers[i]);
+
+        if (0 != result)
+        {
+            /* stop the workers that were started */
+            LZWFreePool(pool);
+            errno = result;
+            return NULL;
+        }
+
+        pool->threads++;
+    }
+
+    return pool;
+}
+
+/***************************************************************************
+*   Function   : LZWFreePool
+*   Description: This routine waits for all queued jobs to complete, stops
+*                the worker threads and frees their codec contexts.
+*   Parameters : pool - pool made by LZWMakePool (may be NULL)
+*   Effects    : Worker threads exit and all pool memory is freed.
+*   Returned   : None
+***************************************************************************/
+void LZWFreePool(lzw_pool_t *pool)
+{
+    unsigned int i;
+
+    if (NULL == pool)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->threads; i++)
+    {
+        pthread_join(pool->workers[i].thread, NULL);
+        LZWFreeEncoder(pool->workers[i].encoder);
+        LZWFreeDecoder(pool->workers[i].decoder);
+    }
+
+    pthread_cond_destroy(&pool->ready);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool);
+}
+
+/***************************************************************************
+*   Function   : LZWPoolSubmit
+*   Description: This routine queues a job.  Jobs are started in the order
+*                that they are submitted, but may complete in any order.
+*   Parameters : pool - pool that will run the job
+*                job - job to run.  It must remain valid until it has run.
+*   Effects    : job is added to the pool's queue.
+*   Returned   : None
+***************************************************************************/
+void LZWPoolSubmit(lzw_pool_t *pool, lzw_job_t *job)
+{
+    job->next = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+
+    if (NULL == pool->tail)
+    {
+        pool->head = job;
+    }
+    else
+    {
+        pool->tail->next = job;
+    }
+
+    pool->tail = job;
+    pthread_cond_signal(&pool->ready);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/***************************************************************************
+*   Function   : LZWWorkerEncoder
+*   Description: This routine returns the encoder context owned by a
+*                worker, making it the first time it is needed.
+*   Parameters : worker - worker running the current job
+*   Effects    : Encoder may be allocated.
+*   Returned   : Pointer to the worker's encoder or NULL on error.  errno
+*                will be set on an error.
+***************************************************************************/
+lzw_encoder_t *LZWWorkerEncoder(lzw_worker_t *worker)
+{
+    if (NULL == worker->encoder)
+    {
+        worker->encoder = LZWMakeEncoder();
+    }
+
+    return worker->encoder;
+}
+
+/***************************************************************************
+*   Function   : LZWWorkerDecoder
+*   Description: This routine returns the decoder context owned by a
+*                worker, making it the first time it is needed.
+*   Parameters : worker - worker running the current job
+*   Effects    : Decoder may be allocated.
+*   Returned   : Pointer to the worker's decoder or NULL on error.  errno
+*                will be set on an error.
+***************************************************************************/
+lzw_decoder_t *LZWWorkerDecoder(lzw_worker_t *worker)
+{
+    if (NULL == worker->decoder)
+    {
+        worker->decoder = LZWMakeDecoder();
+    }
+
+    return worker->decoder;
+}
+
+/***************************************************************************
+*   Function   : WorkerMain
+*   Description: This is the thread function for pool workers.  It runs
+*                queued jobs until the pool is shut down and the queue is
+*                empty.
+*   Parameters : arg - pointer to this thread's lzw_worker_t
+*   Effects    : Runs jobs
+*   Returned   : NULL
+***************************************************************************/
+static void *WorkerMain(void *arg)
+{
+    lzw_worker_t *worker;
+    lzw_pool_t *pool;
+    lzw_job_t *job;
+
+    worker = (lzw_worker_t *)arg;
+    pool = worker->pool;
+
+    if (pool->pin)
+    {
+        /* a hint: workers that can't be pinned still run jobs */
+        LZWPinThread(worker->id);
+    }
+
+    while (1)
+    {
+        pthread_mutex_lock(&pool->lock);
+
+        while ((NULL == pool->head) && !pool->shutdown)
+        {
+            pthread_cond_wait(&pool->ready, &pool->lock);
+        }
+
+        job = pool->head;
+
+        if (NULL == job)
+        {
+            /* shutting down and nothing left to do */
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+
+        pool->head = job->next;
+
+        if (NULL == pool->head)
+        {
+            pool->tail = NULL;
+        }
+
+        pthread_mutex_unlock(&pool->lock);
+
+        job->run(job, worker);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,90 @@
+/***************************************************************************
+*              Thread Pool Used by the Parallel LZW Routines
+*
+*   File    : lzwpool.h
+*   Purpose : Provides definitions and prototypes for a simple pool of
+*             worker threads, each with its own codec context, that run
+*             jobs submitted by the block-parallel LZW routines.
+*   Author  : The lzw library contributors
+*   Date    : October 17, 2026
+*
+****************************************************************************
+*
+* LZW: An ANSI C Lempel-Ziv-Welch Encoding/Decoding Routines
+* Copyright (C) 2026 by
+* The lzw library contributors
+*
+* This file is part of the lzw library.
+*
+* The lzw library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The lzw library is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+#ifndef _LZWPOOL_H_
+#define _LZWPOOL_H_
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <pthread.h>
+#include "lzw.h"
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+typedef struct lzw_pool_t lzw_pool_t;
+typedef struct lzw_worker_t lzw_worker_t;
+
+/* a unit of work.  embed as the first member of a larger structure. */
+typedef struct lzw_job_t
+{
+    void (*run)(struct lzw_job_t *job, lzw_worker_t *worker);
+    struct lzw_job_t *next;     /* next job in queue */
+} lzw_job_t;
+
+/* a worker thread and the codec contexts it owns */
+struct lzw_worker_t
+{
+    lzw_pool_t *pool;           /* pool containing this worker */
+    unsigned int id;            /* 0 .. threads - 1 */
+    pthread_t thread;           /* thread running jobs */
+    lzw_encoder_t *encoder;     /* made by this worker on first use */
+    lzw_decoder_t *decoder;     /* made by this worker on first use */
+};
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* number of cores available for workers */
+unsigned int LZWOnlineCores(void);
+
+/* bind the calling thread to one of the cores it may run on */
+int LZWPinThread(const unsigned int index);
+
+/* start/stop a pool of worker threads, optionally pinned to cores */
+lzw_pool_t *LZWMakePool(const unsigned int threads, const int pin);
+void LZWFreePool(lzw_pool_t *pool);
+
+/* queue a job to be run by the first available worker */
+void LZWPoolSubmit(lzw_pool_t *pool, lzw_job_t *job);
+
+/* per worker codec contexts */
+lzw_encoder_t *LZWWorkerEncoder(lzw_worker_t *worker);
+lzw_decoder_t *LZWWorkerDecoder(lzw_worker_t *worker);
+
+/* decode a file on the calling worker, one block at a time */
+int LZWDecodeFileOnWorker(FILE *fpIn, FILE *fpOut, lzw_worker_t *worker,
+    const lzw_params_t *params);
+
+#endif  /* ndef _LZWPOOL_H_ */
@@ -0,0 +1,498 @@
+/***************************************************************************
+*                 Lempel-Ziv-Welch Compressed Search Functions
+*
+*   File    : lzwsearch.c
+*   Purpose : Provides functions that search encoded files for lines
+*             holding any of a set of patterns.  Files are decoded into
+*             bounded buffers (a block at a time for block streams, which
+*             are decoded on a pool of threads) and scanned with an
+*             Aho-Corasick automaton, so the decoded data is never written
+*             out and each byte is looked at once.
+*   Author  : The lzw library contributors
+*   Date    : October 17, 2026
+*
+****************************************************************************
+*
+* LZW: An ANSI C Lempel-Ziv-Welch Encoding/Decoding Routines
+* Copyright (C) 2026 by
+* The lzw library contributors
+*
+* This file is part of the lzw library.
+*
+* The lzw library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The lzw library is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include "lzw.h"
+#include "lzwlocal.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define MAX_PATTERN_BYTES   4096        /* total length of all patterns */
+#define STAGE_SIZE          (1UL << 16) /* decoded strings gathered */
+#define ALPHABET            (UCHAR_MAX + 1)
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* Aho-Corasick automaton with every transition filled in (a DFA) */
+struct lzw_matcher_t
+{
+    unsigned int *next;         /* next state, indexed by state * 256 + c */
+    unsigned char *accept;      /* non-zero if a pattern ends at a state */
+    unsigned int numStates;
+};
+
+/* state of a search carried from one piece of decoded data to the next */
+typedef struct
+{
+    const lzw_matcher_t *matcher;
+    lzw_match_t match;          /* receives matching lines */
+    void *arg;                  /* passed to match */
+
+    unsigned int state;         /* automaton state in the current line */
+    int matched;                /* the current line holds a pattern */
+    size_t offset;              /* decoded bytes scanned so far */
+    size_t lineStart;           /* offset of the current line */
+
+    unsigned char *line;        /* start of the current line when it spans
+                                 * pieces, up to LZW_MAX_LINE bytes */
+    size_t lineLen;             /* bytes held in line */
+
+    unsigned char *stage;       /* short decoded strings gathered here */
+    size_t stageLen;            /* bytes held in stage */
+    int stopped;                /* match asked to stop the search */
+} search_t;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+static int SearchDecoded(void *arg, const unsigned char *data,
+    const size_t len);
+static int ScanText(search_t *search, const unsigned char *data,
+    const size_t len);
+static int EndLine(search_t *search, const unsigned char *data,
+    const size_t len);
+static void HoldLine(search_t *search, const unsigned char *data,
+    const size_t len);
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : LZWMakeMatcher
+*   Description: This routine builds an Aho-Corasick automaton that finds
+*                every occurrence of any of a set of patterns in one pass.
+*                The trie of the patterns is built first, then its failure
+*                links are followed breadth first to fill in every missing
+*                transition, so scanning takes one table lookup per byte.
+*   Parameters : patterns - NUL terminated patterns, which may not hold
+*                           newlines.  An empty pattern matches every line.
+*                count - number of entries in patterns
+*   Effects    : Memory is allocated for the automaton
+*   Returned   : Pointer to the matcher, or NULL for failure with errno
+*                set.  EINVAL indicates no patterns, a pattern with a
+*                newline, or more than MAX_PATTERN_BYTES in all.
+***************************************************************************/
+lzw_matcher_t *LZWMakeMatcher(const char *const patterns[],
+    const size_t count)
+{
+    lzw_matcher_t *matcher;
+    unsigned int *fail, *queue;
+    const unsigned char *p;
+    unsigned int state, child, head, tail;
+    size_t i, total;
+    int c;
+
+    /* validate arguments */
+    if ((NULL == patterns) || (0 == count))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    for (i = 0, total = 0; i < count; i++)
+    {
+        if ((NULL == patterns[i]) || (NULL != strchr(patterns[i], '\n')))
+        {
+            errno = EINVAL;
+            return NULL;
+        }
+
+        total += strlen(patterns[i]);
+    }
+
+    if (total > MAX_PATTERN_BYTES)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    matcher = malloc(sizeof(lzw_matcher_t));
+
+    if (NULL == matcher)
+    {
+        return NULL;
+    }
+
+    /* a state per pattern byte, plus the root */
+    matcher->next = calloc((total + 1) * ALPHABET, sizeof(unsigned int));
+    matcher->accept = calloc(total + 1, 1);
+    fail = malloc((total + 1) * sizeof(unsigned int));
+    queue = malloc((total + 1) * sizeof(unsigned int));
+
+    if ((NULL == matcher->next) || (NULL == matcher->accept) ||
+        (NULL == fail) || (NULL == queue))
+    {
+        free(fail);
+        free(queue);
+        LZWFreeMatcher(matcher);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    /* build the trie.  0 is the root, so no transition leads to 0 yet. */
+    matcher->numStates = 1;
+
+    for (i = 0; i < count; i++)
+    {
+        state = 0;
+
+        for (p = (const unsigned char *)patterns[i]; '\0' != *p; p++)
+        {
+            if (0 == matcher->next[state * ALPHABET + *p])
+            {
+                matcher->next[state * ALPHABET + *p] = matcher->numStates;
+                matcher->numStates++;
+            }
+
+            state = matcher->next[state * ALPHABET + *p];
+        }
+
+        matcher->accept[state] = 1;
+    }
+
+    /* breadth first, a state's failure state is always complete */
+    head = 0;
+    tail = 0;
+    queue[tail++] = 0;
+    fail[0] = 0;
+
+    while (head < tail)
+    {
+        state = queue[head++];
+
+        for (c = 0; c < ALPHABET; c++)
+        {
+            child = matcher->next[state * ALPHABET + c];
+
+            if (0 != child)
+            {
+                /* a trie edge: the child fails to where its parent's
+                 * failure state goes on c */
+                fail[child] = (0 == state) ? 0 :
+                    matcher->next[fail[state] * ALPHABET + c];
+                matcher->accept[child] |= matcher->accept[fail[child]];
+                queue[tail++] = child;
+            }
+            else if (0 != state)
+            {
+                matcher->next[state * ALPHABET + c] =
+                    matcher->next[fail[state] * ALPHABET + c];
+            }
+        }
+    }
+
+    free(fail);
+    free(queue);
+    return matcher;
+}
+
+/***************************************************************************
+*   Function   : LZWFreeMatcher
+*   Description: This routine frees a matcher made by LZWMakeMatcher.
+*   Parameters : matcher - matcher to free (may be NULL)
+*   Effects    : The matcher's memory is freed
+*   Returned   : None
+***************************************************************************/
+void LZWFreeMatcher(lzw_matcher_t *matcher)
+{
+    if (NULL != matcher)
+    {
+        free(matcher->next);
+        free(matcher->accept);
+        free(matcher);
+    }
+}
+
+/***************************************************************************
+*   Function   : LZWSearchFile
+*   Description: This routine decodes a block stream or single stream with
+*                LZWDecodeFileToSink and passes each decoded line holding
+*                any of the matcher's patterns to match, with the line's
+*                offset in the decoded data.  Only the current line and a
+*                block (or STAGE_SIZE bytes of a single stream) are held in
+*                memory, however large the file.
+*   Parameters : fpIn - pointer to the open binary file to search
+*                matcher - patterns from LZWMakeMatcher
+*                match - function receiving matching lines.  It returns 0
+*                        to continue or non-zero to end the search.
+*                arg - passed to match
+*                params - block-parallel parameters (NULL for defaults),
+*                         as for LZWDecodeFileParallel
+*   Effects    : fpIn is decoded and matching lines are passed to match,
+*                in order and from the calling thread
+*   Returned   : 0 for success (including a search ended by match), -1 for
+*                failure.  errno will be set in the event of a failure.
+***************************************************************************/
+int LZWSearchFile(FILE *fpIn, const lzw_matcher_t *matcher,
+    lzw_match_t match, void *arg, const lzw_params_t *params)
+{
+    search_t search;
+    int result;
+
+    /* validate arguments */
+    if ((NULL == fpIn) || (NULL == matcher) || (NULL == match))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    search.matcher = matcher;
+    search.match = match;
+    search.arg = arg;
+    search.state = 0;
+    search.matched = matcher->accept[0];
+    search.offset = 0;
+    search.lineStart = 0;
+    search.lineLen = 0;
+    search.stageLen = 0;
+    search.stopped = 0;
+    search.line = LZWAlloc(LZW_MEM_IO, LZW_MAX_LINE);
+    search.stage = LZWAlloc(LZW_MEM_IO, STAGE_SIZE);
+
+    if ((NULL == search.line) || (NULL == search.stage))
+    {
+        LZWRelease(search.line);
+        LZWRelease(search.stage);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    result = LZWDecodeFileToSink(fpIn, SearchDecoded, &search, params);
+
+    if (0 == result)
+    {
+        /* scan what's left, then end a last line with no newline */
+        result = ScanText(&search, search.stage, search.stageLen);
+
+        if ((0 == result) && search.matched &&
+            (search.offset != search.lineStart))
+        {
+            result = EndLine(&search, search.stage, 0);
+        }
+    }
+
+    LZWRelease(search.line);
+    LZWRelease(search.stage);
+    return search.stopped ? 0 : result;
+}
+
+/***************************************************************************
+*   Function   : SearchDecoded
+*   Description: This routine is the sink receiving decoded data for
+*                LZWSearchFile.  Large pieces (whole blocks) are scanned
+*                where they are.  Single streams are decoded a string at a
+*                time, so short pieces are gathered into a stage first,
+*                and the stage is scanned when it fills.
+*   Parameters : arg - the search
+*                data - decoded data
+*                len - number of bytes in data
+*   Effects    : data is scanned or staged
+*   Returned   : 0 to continue, -1 to stop decoding
+***************************************************************************/
+static int SearchDecoded(void *arg, const unsigned char *data,
+    const size_t len)
+{
+    search_t *search;
+
+    search = (search_t *)arg;
+
+    if (search->stageLen + len > STAGE_SIZE)
+    {
+        if (0 != ScanText(search, search->stage, search->stageLen))
+        {
+            return -1;
+        }
+
+        search->stageLen = 0;
+    }
+
+    if (len >= STAGE_SIZE)
+    {
+        return ScanText(search, data, len);
+    }
+
+    memcpy(search->stage + search->stageLen, data, len);
+    search->stageLen += len;
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : ScanText
+*   Description: This routine runs the automaton over the next piece of
+*                decoded data and reports each line it finds a pattern in.
+*                Once a line has matched, the rest of it is skipped with
+*                memchr, and the automaton restarts after each newline so
+*                matches never span lines.
+*   Parameters : search - state of the search
+*                data - decoded data following what was already scanned
+*                len - number of bytes in data
+*   Effects    : Matching lines are passed to search->match.  The part of
+*                a line that continues into the next piece is held.
+*   Returned   : 0 to continue, -1 to stop the search
+***************************************************************************/
+static int ScanText(search_t *search, const unsigned char *data,
+    const size_t len)
+{
+    const unsigned int *next;
+    const unsigned char *accept;
+    const unsigned char *nl;
+    unsigned int state;
+    size_t i, start;
+
+    next = search->matcher->next;
+    accept = search->matcher->accept;
+    state = search->state;
+    start = 0;              /* start of the current line in data */
+    i = 0;
+
+    while (i < len)
+    {
+        if (!search->matched)
+        {
+            /* one lookup per byte until a pattern ends or the line does */
+            while ((i < len) && ('\n' != data[i]))
+            {
+                state = next[state * ALPHABET + data[i]];
+                i++;
+
+                if (accept[state])
+                {
+                    search->matched = 1;
+                    break;
+                }
+            }
+        }
+
+        if (search->matched)
+        {
+            nl = memchr(data + i, '\n', len - i);
+            i = (NULL == nl) ? len : (size_t)(nl - data);
+        }
+
+        if (i == len)
+        {
+            break;          /* the line continues in the next piece */
+        }
+
+        /* data[i] ends a line */
+        if (search->matched &&
+            (0 != EndLine(search, data + start, i - start)))
+        {
+            return -1;
+        }
+
+        i++;
+        search->lineStart = search->offset + i;
+        search->lineLen = 0;
+        search->matched = accept[0];
+        state = 0;
+        start = i;
+    }
+
+    HoldLine(search, data + start, len - start);
+    search->state = state;
+    search->offset += len;
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : EndLine
+*   Description: This routine passes a matching line to search->match.  A
+*                line that lies in one piece of data is passed from there.
+*                One that spans pieces is passed from search->line, cut
+*                off at LZW_MAX_LINE bytes.
+*   Parameters : search - state of the search
+*                data - the end of the line in the current piece
+*                len - number of bytes in data, not counting the newline
+*   Effects    : search->match is called
+*   Returned   : 0 to continue, -1 to stop the search
+***************************************************************************/
+static int EndLine(search_t *search, const unsigned char *data,
+    const size_t len)
+{
+    int result;
+
+    if (0 == search->lineLen)
+    {
+        result = search->match(search->arg, search->lineStart, data, len);
+    }
+    else
+    {
+        HoldLine(search, data, len);
+        result = search->match(search->arg, search->lineStart, search->line,
+            search->lineLen);
+    }
+
+    if (0 != result)
+    {
+        search->stopped = 1;
+        errno = 0;
+        return -1;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : HoldLine
+*   Description: This routine appends part of the current line to
+*                search->line, keeping at most LZW_MAX_LINE bytes.
+*   Parameters : search - state of the search
+*                data - next part of the line
+*                len - number of bytes in data
+*   Effects    : Up to len bytes are copied to search->line
+*   Returned   : None
+***************************************************************************/
+static void HoldLine(search_t *search, const unsigned char *data,
+    const size_t len)
+{
+    size_t room;
+
+    room = LZW_MAX_LINE - search->lineLen;
+    room = (len < room) ? len : room;
+    memcpy(search->line + search->lineLen, data, room);
+    search->lineLen += room;
+}
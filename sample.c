@@ -32,16 +32,154 @@
 /***************************************************************************
 *                             INCLUDED FILES
 ***************************************************************************/
+#ifdef __linux__
+#define _GNU_SOURCE             /* F_SETPIPE_SZ */
+#else
+#define _POSIX_C_SOURCE 200112L
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
 #include "optlist/optlist.h"
 #include "lzw.h"
 
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define SUFFIX          ".lzw"      /* added to the names of encoded files */
+#define SUFFIX_LEN      4
+#define DECODED_SUFFIX  ".out"      /* added to decoded names without it */
+#define BENCH_REPEATS   5           /* default timed runs for -b */
+#define JOB_FIELDS      3           /* mode, input and output of a job */
+#define STREAM_BUFFER   (1 << 20)   /* stdio and pipe buffer for streams */
+#define SNIFF_SAMPLE    (1 << 20)   /* bytes checked by WorthEncoding */
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* input files for batch mode and the names of their outputs */
+typedef struct
+{
+    lzw_batch_item_t *items;    /* names are allocated on the heap */
+    size_t count;               /* entries used */
+    size_t size;                /* entries allocated */
+} file_list_t;
+
+/* one input held in memory by the benchmark */
+typedef struct
+{
+    unsigned char *raw;         /* contents of the file */
+    size_t rawLen;
+    unsigned char *coded;       /* encoded contents */
+    size_t codedSize;           /* size of coded */
+    size_t codedLen;
+    unsigned char *decoded;     /* decoded contents, rawLen + 1 bytes */
+} bench_input_t;
+
+/* codec contexts and buffers reused by every job in a manifest */
+typedef struct
+{
+    lzw_encoder_t *encoder;
+    lzw_decoder_t *decoder;
+    unsigned char *in;          /* contents of the input file */
+    size_t inSize;              /* size of in */
+    unsigned char *out;         /* encoded or decoded contents */
+    size_t outSize;             /* size of out */
+} job_context_t;
+
+/* progress display on stderr, and the output counted by its sink */
+typedef struct
+{
+    double start;               /* time the job started */
+    int shown;                  /* a progress line has been drawn */
+    int encode;                 /* output is the encoded data */
+    FILE *fpOut;                /* file decoded data is written to */
+    size_t bytesOut;            /* bytes written to fpOut */
+} progress_display_t;
+
+/* where -g prints matching lines */
+typedef struct
+{
+    FILE *fpOut;                /* file receiving matching lines */
+    const char *name;           /* file name printed first, or NULL */
+    size_t found;               /* number of lines matched */
+} search_output_t;
+
 /***************************************************************************
 *                               PROTOTYPES
 ***************************************************************************/
+static int IsBlockStream(FILE *fp);
+static int TrainDictionary(FILE *fpIn, FILE *fpOut,
+    const lzw_params_t *params);
+
+static int AddInput(file_list_t *list, const char *name, const char encode,
+    const char named);
+static int AddFile(file_list_t *list, const char *name, const char encode);
+static int HasSuffix(const char *name);
+static void FreeFileList(file_list_t *list);
+static int RunBatch(file_list_t *list, FILE *fpOut, const char encode,
+    const char train, const lzw_params_t *params);
+
+static int Benchmark(const file_list_t *list, const unsigned int repeats);
+static unsigned char *ReadAll(FILE *fp, size_t *len);
+static int ReadPooled(FILE *fp, unsigned char **buf, size_t *size,
+    size_t *len);
+static int CodeAll(lzw_encoder_t *encoder, lzw_decoder_t *decoder,
+    bench_input_t *inputs, const size_t count, double *encodeTime,
+    double *decodeTime, lzw_stats_t *stats);
+static void ReportRate(const char *label, const double times[],
+    const unsigned int repeats, const size_t bytes);
+static void AddStats(lzw_stats_t *total, const lzw_stats_t *stats);
+static void ReportStats(const lzw_stats_t *stats);
+static double Now(void);
+
+static int RunManifest(FILE *fpManifest, const char nulSeparated,
+    const char parallel, const lzw_params_t *params);
+static int ReadRecord(FILE *fp, char **buf, size_t *size, const int end,
+    const unsigned int count);
+static int RunJob(job_context_t *context, const char *fields[],
+    const char parallel, const lzw_params_t *params);
+static int GrowBuffer(unsigned char **buf, size_t *size, const size_t len);
+
+static int CreateArchive(const char *archiveName, file_list_t *list,
+    const lzw_params_t *params);
+static int ExtractArchive(const char *archiveName, const char *names[],
+    const size_t count, FILE *fpOut);
+static int ExtractToFile(lzw_archive_t *archive, const size_t index,
+    const char *name);
+static const char *MemberName(const char *path);
+
+static int SearchFiles(const char *patterns[], const size_t numPatterns,
+    const char *names[], const size_t count, FILE *fpOut,
+    const lzw_params_t *params);
+static int PrintMatch(void *arg, const size_t offset,
+    const unsigned char *line, const size_t len);
+
+static int ListFiles(const char *names[], const size_t count, FILE *fpOut);
+static void ListFile(FILE *fpOut, const char *name, const lzw_info_t *info);
+static int ListArchive(const char *archiveName, FILE *fpOut);
+
+static void ShowProgress(void *arg, const size_t bytesIn,
+    const size_t bytesOut);
+static int EncodeShowingProgress(FILE *fpIn, FILE *fpOut,
+    progress_display_t *display);
+static int DecodeShowingProgress(FILE *fpIn, FILE *fpOut,
+    progress_display_t *display);
+static int WriteDecoded(void *arg, const unsigned char *data,
+    const size_t len);
+
+static void SetupStream(FILE *fp);
+static int CloseOutput(FILE *fp);
+static int WorthEncoding(FILE *fp);
 
 /***************************************************************************
 *                                FUNCTIONS
@@ -65,21 +203,84 @@ int main(int argc, char *argv[])
     option_t *thisOpt;
     FILE *fpIn;             /* pointer to open input file */
     FILE *fpOut;            /* pointer to open output file */
+    FILE *fpDict;           /* pointer to open dictionary file */
     char encode;            /* encode/decode */
+    char train;             /* write a dictionary instead of encoding */
+    char parallel;          /* use block-parallel encoding */
+    char pipelined;         /* overlap reads, encoding, and writes */
+    char verify;            /* check the output while it's written */
+    char batch;             /* encode or decode many files at once */
+    char bench;             /* time encoding and decoding in memory */
+    const char *manifest;   /* name of job manifest, "-" for stdin */
+    const char *archive;    /* name of archive to create or extract */
+    char nulSeparated;      /* manifest fields end with NUL characters */
+    char inspect;           /* list what encoded files hold */
+    const char **patterns;  /* patterns searched for in encoded files */
+    size_t numPatterns;     /* number of entries in patterns */
+    char showProgress;      /* display progress on stderr */
+    progress_display_t display;
+    unsigned int repeats;   /* timed runs for the benchmark */
+    const char **inNames;   /* input file and directory names */
+    size_t numInNames;      /* number of entries in inNames */
+    file_list_t list;       /* input files found for batch mode */
+    struct stat info;
+    lzw_params_t params;    /* block-parallel parameters */
+    size_t i;
+    int result;
+    int blockStream;        /* input is a block stream, -1 if unknown */
 
     /* initialize data */
     fpIn = stdin;
     fpOut = stdout;
     encode = 1;
+    train = 0;
+    parallel = 0;
+    pipelined = 0;
+    verify = 0;
+    batch = 0;
+    bench = 0;
+    manifest = NULL;
+    archive = NULL;
+    nulSeparated = 0;
+    inspect = 0;
+    showProgress = 0;
+    repeats = BENCH_REPEATS;
+    numInNames = 0;
+    numPatterns = 0;
+    LZWDefaultParams(&params);
+
+    /* there can't be more input names or patterns than arguments */
+    inNames = malloc(argc * sizeof(char *));
+    patterns = malloc(argc * sizeof(char *));
+
+    if ((NULL == inNames) || (NULL == patterns))
+    {
+        perror("Allocating input list");
+        free(inNames);
+        free(patterns);
+        return -1;
+    }
 
     /* parse command line */
-    optList = GetOptList(argc, argv, "cdi:o:h?");
+    optList = GetOptList(argc, argv, "aA:bcdD:f:g:i:j:lm:o:pPr:s:t:Tvzh?");
     thisOpt = optList;
 
     while (thisOpt != NULL)
     {
         switch(thisOpt->option)
         {
+            case 'a':       /* pin worker threads to cores */
+                params.pinThreads = 1;
+                break;
+
+            case 'A':       /* archive */
+                archive = thisOpt->argument;
+                break;
+
+            case 'b':       /* benchmark mode */
+                bench = 1;
+                break;
+
             case 'c':       /* compression mode */
                 encode = 1;
                 break;
@@ -88,81 +289,195 @@ int main(int argc, char *argv[])
                 encode = 0;
                 break;
 
-            case 'i':       /* input file name */
-                if (fpIn != stdin)
-                {
-                    fprintf(stderr, "Multiple input files not allowed.\n");
-                    fclose(fpIn);
+            case 'g':       /* search for a pattern */
+                patterns[numPatterns] = thisOpt->argument;
+                numPatterns++;
+                break;
 
-                    if (fpOut != stdout)
-                    {
-                        fclose(fpOut);
-                    }
+            case 'i':       /* input file or directory name */
+                inNames[numInNames] = thisOpt->argument;
+                numInNames++;
+                break;
+
+            case 'j':       /* number of files encoded or decoded at once */
+                batch = 1;
+                params.threads = (unsigned int)atoi(thisOpt->argument);
+                break;
+
+            case 'l':       /* list encoded files */
+                inspect = 1;
+                break;
+
+            case 'm':       /* job manifest */
+                manifest = thisOpt->argument;
+                break;
+
+            case 'z':       /* NUL separated manifest */
+                nulSeparated = 1;
+                break;
 
+            case 'o':       /* output file name */
+                if (fpOut != stdout)
+                {
+                    fprintf(stderr, "Multiple output files not allowed.\n");
+                    fclose(fpOut);
+                    free(inNames);
+                    free(patterns);
                     FreeOptList(optList);
-                    errno = EINVAL;
                     return -1;
                 }
 
-                /* open input file as binary */
-                fpIn = fopen(thisOpt->argument, "rb");
-                if (fpIn == NULL)
+                /* open output file as binary */
+                fpOut = fopen(thisOpt->argument, "wb");
+                if (fpOut == NULL)
                 {
-                    perror("Opening input file");
-
-                    if (fpOut != stdout)
-                    {
-                        fclose(fpOut);
-                    }
-
+                    perror("Opening output file");
+                    free(inNames);
+                    free(patterns);
                     FreeOptList(optList);
                     return -1;
                 }
                 break;
 
-            case 'o':       /* output file name */
-                if (fpOut != stdout)
+            case 'f':       /* frozen dictionary sample size */
+                parallel = 1;
+                params.sampleSize = strtoul(thisOpt->argument, NULL, 10);
+                break;
+
+            case 'D':       /* shared dictionary file */
+                fpDict = fopen(thisOpt->argument, "rb");
+                LZWFreeDictionary(params.dictionary);
+                params.dictionary = NULL;
+
+                if (NULL == fpDict)
                 {
-                    fprintf(stderr, "Multiple output files not allowed.\n");
-                    fclose(fpOut);
+                    perror(thisOpt->argument);
+                    free(inNames);
+                    free(patterns);
 
-                    if (fpIn != stdin)
+                    if (fpOut != stdout)
                     {
-                        fclose(fpIn);
+                        fclose(fpOut);
                     }
 
                     FreeOptList(optList);
                     return -1;
                 }
 
-                /* open output file as binary */
-                fpOut = fopen(thisOpt->argument, "wb");
-                if (fpOut == NULL)
+                params.dictionary = LZWReadDictionary(fpDict);
+                fclose(fpDict);
+
+                if (NULL == params.dictionary)
                 {
-                    perror("Opening output file");
+                    perror("Reading dictionary file");
+                    free(inNames);
+                    free(patterns);
 
-                    if (fpIn != stdin)
+                    if (fpOut != stdout)
                     {
-                        fclose(fpIn);
+                        fclose(fpOut);
                     }
 
                     FreeOptList(optList);
                     return -1;
                 }
+
+                parallel = 1;
+                break;
+
+            case 'T':       /* train a shared dictionary */
+                train = 1;
+                break;
+
+            case 'p':       /* pipelined single stream encoding */
+                pipelined = 1;
+                break;
+
+            case 'P':       /* show progress */
+                showProgress = 1;
+                break;
+
+            case 'v':       /* verify single stream encoding */
+                verify = 1;
+                break;
+
+            case 'r':       /* benchmark repeats */
+                repeats = (unsigned int)atoi(thisOpt->argument);
+                break;
+
+            case 's':       /* block size */
+                parallel = 1;
+                params.blockSize = strtoul(thisOpt->argument, NULL, 10);
+                break;
+
+            case 't':       /* number of threads */
+                parallel = 1;
+                params.threads = (unsigned int)atoi(thisOpt->argument);
                 break;
 
             case 'h':
             case '?':
                 printf("Usage: %s <options>\n\n", FindFileName(argv[0]));
                 printf("options:\n");
+                printf("  -a : Pin worker threads to cores.\n");
+                printf("  -A <filename> : Pack the input files into an ");
+                printf("archive (-c) or extract\n");
+                printf("                  the members named by -i, or all ");
+                printf("of them (-d).\n");
+                printf("  -b : Benchmark encoding and decoding the input ");
+                printf("files in memory.\n");
                 printf("  -c : Encode input file to output file.\n");
                 printf("  -d : Decode input file to output file.\n");
-                printf("  -i <filename> : Name of input file.\n");
+                printf("  -g <pattern> : Print the decoded lines holding ");
+                printf("the pattern (may be\n");
+                printf("                 repeated), with their offsets.\n");
+                printf("  -i <filename> : Name of input file or directory ");
+                printf("(may be repeated).\n");
+                printf("  -j <jobs> : Encode or decode each input file to ");
+                printf("its own output file,\n");
+                printf("              <jobs> files at a time ");
+                printf("(0 = all cores).\n");
+                printf("  -l : List the sizes and layout of the encoded ");
+                printf("input files, or the\n");
+                printf("       members of the -A archive, without ");
+                printf("decoding them.\n");
+                printf("  -m <filename> : Run the jobs listed in a ");
+                printf("manifest (- = stdin).\n");
+                printf("  -z : Manifest fields end with NUL instead of ");
+                printf("tab/space and newline.\n");
                 printf("  -o <filename> : Name of output file.\n");
+                printf("  -f <bytes> : Encode blocks with a dictionary ");
+                printf("frozen after <bytes>.\n");
+                printf("  -D <filename> : Encode or decode blocks with a ");
+                printf("shared dictionary file.\n");
+                printf("  -T : Write a dictionary file trained on -f <bytes> ");
+                printf("of input.\n");
+                printf("  -p : Overlap reading, encoding, and writing.\n");
+                printf("  -P : Show bytes in and out, ratio and MB/s ");
+                printf("while coding.\n");
+                printf("  -v : Decode and check the output as it is ");
+                printf("written (like -p).\n");
+                printf("  -r <runs> : Timed runs for -b (default %d).\n",
+                    BENCH_REPEATS);
+                printf("  -s <bytes> : Encode independent blocks of <bytes> ");
+                printf("(default automatic).\n");
+                printf("  -t <threads> : Encode independent blocks using ");
+                printf("threads (0 = all cores).\n");
+                printf("                 Decoding uses threads once a ");
+                printf("stream's dictionary is full.\n");
                 printf("  -h | ?  : Print out command line options.\n\n");
                 printf("Default: %s -c -i stdin -o stdout\n",
                     FindFileName(argv[0]));
 
+                free(inNames);
+                free(patterns);
+                LZWFreeDictionary(params.dictionary);
+
+                if (fpOut != stdout)
+                {
+                    fclose(fpOut);
+                }
+
                 FreeOptList(optList);
                 return 0;
         }
@@ -172,17 +487,2414 @@ int main(int argc, char *argv[])
         thisOpt = optList;
     }
 
+    if (NULL != manifest)
+    {
+        free(inNames);
+        free(patterns);
+        fpIn = (0 == strcmp(manifest, "-")) ? stdin : fopen(manifest, "r");
+
+        if (NULL == fpIn)
+        {
+            perror("Opening manifest");
+            result = -1;
+        }
+        else
+        {
+            result = RunManifest(fpIn, nulSeparated, parallel, &params);
+        }
+
+        LZWFreeDictionary(params.dictionary);
+
+        if ((NULL != fpIn) && (fpIn != stdin))
+        {
+            fclose(fpIn);
+        }
+
+        if (0 != CloseOutput(fpOut))
+        {
+            result = -1;
+        }
+
+        return result;
+    }
+
+    if (0 != numPatterns)
+    {
+        result = SearchFiles(patterns, numPatterns, inNames, numInNames,
+            fpOut, &params);
+
+        free(patterns);
+        free(inNames);
+        LZWFreeDictionary(params.dictionary);
+
+        if (0 != CloseOutput(fpOut))
+        {
+            result = -1;
+        }
+
+        return result;
+    }
+
+    free(patterns);
+
+    if (inspect)
+    {
+        if (NULL != archive)
+        {
+            result = ListArchive(archive, fpOut);
+        }
+        else
+        {
+            result = ListFiles(inNames, numInNames, fpOut);
+        }
+
+        free(inNames);
+        LZWFreeDictionary(params.dictionary);
+
+        if (0 != CloseOutput(fpOut))
+        {
+            result = -1;
+        }
+
+        return result;
+    }
+
+    /* progress is shown for one file or archive at a time */
+    display.start = Now();
+    display.shown = 0;
+    display.encode = encode;
+    display.fpOut = fpOut;
+    display.bytesOut = 0;
+
+    if (showProgress)
+    {
+        params.progress = ShowProgress;
+        params.progressArg = &display;
+    }
+
+    if (NULL != archive)
+    {
+        if (encode)
+        {
+            list.items = NULL;
+            list.count = 0;
+            list.size = 0;
+            result = 0;
+
+            for (i = 0; (i < numInNames) && (0 == result); i++)
+            {
+                result = AddInput(&list, inNames[i], 1, 1);
+            }
+
+            if (0 != result)
+            {
+                perror("Finding input files");
+            }
+            else if (fpOut != stdout)
+            {
+                fprintf(stderr, "-o can't be used when creating an "
+                    "archive.\n");
+                result = -1;
+            }
+            else
+            {
+                result = CreateArchive(archive, &list, &params);
+            }
+
+            if (display.shown)
+            {
+                fputc('\n', stderr);
+            }
+
+            FreeFileList(&list);
+        }
+        else
+        {
+            result = ExtractArchive(archive, inNames, numInNames, fpOut);
+        }
+
+        free(inNames);
+        LZWFreeDictionary(params.dictionary);
+
+        if (0 != CloseOutput(fpOut))
+        {
+            result = -1;
+        }
+
+        return result;
+    }
+
+    /* more than one input or a directory needs batch mode */
+    if ((numInNames > 1) || ((1 == numInNames) &&
+        (0 == stat(inNames[0], &info)) && S_ISDIR(info.st_mode)))
+    {
+        batch = 1;
+    }
+
+    if (batch || bench)
+    {
+        list.items = NULL;
+        list.count = 0;
+        list.size = 0;
+        result = 0;
+
+        /* the benchmark encodes its inputs, then decodes the results */
+        for (i = 0; (i < numInNames) && (0 == result); i++)
+        {
+            result = AddInput(&list, inNames[i], encode || bench, 1);
+        }
+
+        if (0 != result)
+        {
+            perror("Finding input files");
+        }
+        else if (bench)
+        {
+            result = Benchmark(&list, repeats);
+        }
+        else if ((fpOut != stdout) && !train)
+        {
+            fprintf(stderr, "Output files are named after input files, "
+                "-o is only used with -T.\n");
+            result = -1;
+        }
+        else
+        {
+            result = RunBatch(&list, fpOut, encode, train, &params);
+        }
+
+        FreeFileList(&list);
+        free(inNames);
+        LZWFreeDictionary(params.dictionary);
+
+        if (0 != CloseOutput(fpOut))
+        {
+            result = -1;
+        }
+
+        return result;
+    }
+
+    if (1 == numInNames)
+    {
+        /* open input file as binary */
+        fpIn = fopen(inNames[0], "rb");
+
+        if (fpIn == NULL)
+        {
+            perror("Opening input file");
+            free(inNames);
+            LZWFreeDictionary(params.dictionary);
+
+            if (fpOut != stdout)
+            {
+                fclose(fpOut);
+            }
+
+            return -1;
+        }
+    }
+
+    free(inNames);
+
+    /* the codecs move a byte at a time through stdio, keep it buffered */
+    SetupStream(fpIn);
+    SetupStream(fpOut);
+
     /* parsed the parameters.  now encode or decode. */
-    if (encode)
+    if (train)
+    {
+        result = TrainDictionary(fpIn, fpOut, &params);
+    }
+    else if (encode)
     {
-        LZWEncodeFile(fpIn, fpOut);
+        /* data that won't shrink is stored in a block stream */
+        if (!parallel && !pipelined && !verify && !WorthEncoding(fpIn))
+        {
+            parallel = 1;
+        }
+
+        if (verify && parallel)
+        {
+            fprintf(stderr, "-v only verifies single stream encoding.\n");
+            errno = EINVAL;
+            result = -1;
+        }
+        else if (showProgress && (verify || pipelined))
+        {
+            fprintf(stderr, "-P can't be used with -p or -v.\n");
+            errno = EINVAL;
+            result = -1;
+        }
+        else if (verify)
+        {
+            result = LZWEncodeFileVerified(fpIn, fpOut);
+        }
+        else if (parallel)
+        {
+            result = LZWEncodeFileParallel(fpIn, fpOut, &params);
+        }
+        else if (pipelined)
+        {
+            result = LZWEncodeFilePipelined(fpIn, fpOut);
+        }
+        else if (showProgress)
+        {
+            result = EncodeShowingProgress(fpIn, fpOut, &display);
+        }
+        else
+        {
+            result = LZWEncodeFile(fpIn, fpOut);
+        }
     }
     else
     {
-        LZWDecodeFile(fpIn, fpOut);
+        blockStream = IsBlockStream(fpIn);
+
+        /* block streams are always decoded in parallel */
+        if (blockStream < 0)
+        {
+            /* a pipe can't be peeked at, so the library reads the header
+             * and decodes either kind of stream from the bytes it read */
+            result = LZWDecodeFileToSink(fpIn, WriteDecoded, &display,
+                &params);
+        }
+        else if (blockStream)
+        {
+            result = LZWDecodeFileParallel(fpIn, fpOut, &params);
+        }
+        else if (parallel)
+        {
+            result = LZWDecodeFileSpeculative(fpIn, fpOut, &params);
+        }
+        else if (showProgress)
+        {
+            result = DecodeShowingProgress(fpIn, fpOut, &display);
+        }
+        else
+        {
+            result = LZWDecodeFile(fpIn, fpOut);
+        }
     }
 
-    free(fpIn);
-    free(fpOut);
-    return 0;
+    if (display.shown)
+    {
+        fputc('\n', stderr);
+    }
+
+    if (0 != result)
+    {
+        perror(train ? "Training" : (encode ? "Encoding" : "Decoding"));
+    }
+
+    LZWFreeDictionary(params.dictionary);
+
+    if (fpIn != stdin)
+    {
+        fclose(fpIn);
+    }
+
+    if (0 != CloseOutput(fpOut))
+    {
+        result = -1;
+    }
+
+    return result;
+}
+
+/****************************************************************************
+*   Function   : IsBlockStream
+*   Description: This function peeks at the first bytes of a regular file
+*                to see if it is a block stream written by
+*                LZWEncodeFileParallel, then seeks back.  The second byte
+*                is enough to tell, because it has its MSB set in a block
+*                stream header and clear in a single stream.  Other files
+*                can't be read twice, so they aren't read at all.
+*   Parameters : fp - file to be decoded
+*   Effects    : None.  The file position is restored.
+*   Returned   : 1 for a block stream, 0 for a single stream, and -1 if
+*                fp isn't a regular file and can't be peeked at
+****************************************************************************/
+static int IsBlockStream(FILE *fp)
+{
+    struct stat info;
+    unsigned char header[2];
+    size_t len;
+    long start;
+
+    if ((0 != fstat(fileno(fp), &info)) || !S_ISREG(info.st_mode) ||
+        ((start = ftell(fp)) < 0))
+    {
+        return -1;
+    }
+
+    len = fread(header, 1, sizeof(header), fp);
+
+    if (0 != fseek(fp, start, SEEK_SET))
+    {
+        perror("Rewinding input file");
+    }
+
+    return (sizeof(header) == len) && (0 != (header[1] & 0x80));
+}
+
+/****************************************************************************
+*   Function   : TrainDictionary
+*   Description: This function builds a frozen dictionary from the start
+*                of a file and writes it as a dictionary file that other
+*                files may be encoded with (see -D).
+*   Parameters : fpIn - file to sample
+*                fpOut - file receiving the dictionary
+*                params - sampleSize is the number of bytes to sample
+*                         (0 = LZW_DEFAULT_SAMPLE_SIZE)
+*   Effects    : A dictionary file is written to fpOut
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int TrainDictionary(FILE *fpIn, FILE *fpOut,
+    const lzw_params_t *params)
+{
+    lzw_dictionary_t *dictionary;
+    unsigned char *sample;
+    size_t sampleSize, sampleLen;
+    int result;
+
+    sampleSize = (0 == params->sampleSize) ? LZW_DEFAULT_SAMPLE_SIZE :
+        params->sampleSize;
+    sample = malloc(sampleSize);
+
+    if (NULL == sample)
+    {
+        return -1;
+    }
+
+    sampleLen = fread(sample, 1, sampleSize, fpIn);
+
+    if (ferror(fpIn))
+    {
+        free(sample);
+        return -1;
+    }
+
+    dictionary = LZWMakeDictionary(sample, sampleLen);
+    free(sample);
+
+    if (NULL == dictionary)
+    {
+        return -1;
+    }
+
+    result = LZWWriteDictionary(dictionary, fpOut);
+    LZWFreeDictionary(dictionary);
+    return result;
+}
+
+/****************************************************************************
+*   Function   : AddInput
+*   Description: This function adds an input file to a batch, or every
+*                file under an input directory.  Files found in
+*                directories are skipped when they don't need the current
+*                mode: files ending in SUFFIX are skipped when encoding,
+*                and other files are skipped when decoding.  Files named
+*                on the command line are always added.
+*   Parameters : list - list of files receiving the input
+*                name - name of a file or directory
+*                encode - non-zero when encoding
+*                named - non-zero if name is from the command line
+*   Effects    : Entries are added to list
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int AddInput(file_list_t *list, const char *name, const char encode,
+    const char named)
+{
+    struct stat info;
+    DIR *dir;
+    struct dirent *entry;
+    char *path;
+    int result;
+
+    if (0 != stat(name, &info))
+    {
+        /* files that vanish from a directory while walking it are skipped */
+        return named ? -1 : 0;
+    }
+
+    if (!S_ISDIR(info.st_mode))
+    {
+        if (named ||
+            (S_ISREG(info.st_mode) && ((0 != encode) != HasSuffix(name))))
+        {
+            return AddFile(list, name, encode);
+        }
+
+        return 0;
+    }
+
+    dir = opendir(name);
+
+    if (NULL == dir)
+    {
+        return -1;
+    }
+
+    result = 0;
+
+    while ((0 == result) && (NULL != (entry = readdir(dir))))
+    {
+        if ((0 == strcmp(entry->d_name, ".")) ||
+            (0 == strcmp(entry->d_name, "..")))
+        {
+            continue;
+        }
+
+        path = malloc(strlen(name) + strlen(entry->d_name) + 2);
+
+        if (NULL == path)
+        {
+            result = -1;
+            break;
+        }
+
+        sprintf(path, "%s/%s", name, entry->d_name);
+        result = AddInput(list, path, encode, 0);
+        free(path);
+    }
+
+    closedir(dir);
+    return result;
+}
+
+/****************************************************************************
+*   Function   : AddFile
+*   Description: This function adds one input file to a batch.  Encoded
+*                files are named after their input with SUFFIX added.
+*                Decoded files are named after their input with SUFFIX
+*                removed, or with DECODED_SUFFIX added if the input
+*                doesn't end in SUFFIX.
+*   Parameters : list - list of files receiving the input
+*                name - name of the input file
+*                encode - non-zero when encoding
+*   Effects    : An entry is added to list
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int AddFile(file_list_t *list, const char *name, const char encode)
+{
+    lzw_batch_item_t *items;
+    char *inName, *outName;
+    size_t len;
+
+    if (list->count == list->size)
+    {
+        list->size = (0 == list->size) ? 16 : (2 * list->size);
+        items = realloc(list->items, list->size * sizeof(lzw_batch_item_t));
+
+        if (NULL == items)
+        {
+            return -1;
+        }
+
+        list->items = items;
+    }
+
+    len = strlen(name);
+    inName = malloc(len + 1);
+    outName = malloc(len + SUFFIX_LEN + 1);
+
+    if ((NULL == inName) || (NULL == outName))
+    {
+        free(inName);
+        free(outName);
+        return -1;
+    }
+
+    strcpy(inName, name);
+    strcpy(outName, name);
+
+    if (encode)
+    {
+        strcat(outName, SUFFIX);
+    }
+    else if (HasSuffix(name))
+    {
+        outName[len - SUFFIX_LEN] = '\0';
+    }
+    else
+    {
+        strcat(outName, DECODED_SUFFIX);
+    }
+
+    list->items[list->count].inName = inName;
+    list->items[list->count].outName = outName;
+    list->items[list->count].error = 0;
+    list->count++;
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : HasSuffix
+*   Description: This function checks if a file name ends in SUFFIX.
+*   Parameters : name - file name
+*   Effects    : None
+*   Returned   : Non-zero if name ends in SUFFIX, 0 otherwise
+****************************************************************************/
+static int HasSuffix(const char *name)
+{
+    size_t len;
+
+    len = strlen(name);
+    return ((len > SUFFIX_LEN) &&
+        (0 == strcmp(name + len - SUFFIX_LEN, SUFFIX)));
+}
+
+/****************************************************************************
+*   Function   : FreeFileList
+*   Description: This function frees a list of batch files and its names.
+*   Parameters : list - list to free
+*   Effects    : The list's memory is freed and the list is emptied
+*   Returned   : None
+****************************************************************************/
+static void FreeFileList(file_list_t *list)
+{
+    size_t i;
+
+    for (i = 0; i < list->count; i++)
+    {
+        free((char *)list->items[i].inName);
+        free((char *)list->items[i].outName);
+    }
+
+    free(list->items);
+    list->items = NULL;
+    list->count = 0;
+    list->size = 0;
+}
+
+/****************************************************************************
+*   Function   : RunBatch
+*   Description: This function encodes or decodes every file in a batch
+*                into its own output file using a pool of threads, or
+*                trains a dictionary file on samples of every file.  Files
+*                that fail are reported on stderr.
+*   Parameters : list - files in the batch
+*                fpOut - file receiving a trained dictionary
+*                encode - non-zero when encoding
+*                train - non-zero to write a dictionary instead of encoding
+*                params - block-parallel parameters
+*   Effects    : Output files are written
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int RunBatch(file_list_t *list, FILE *fpOut, const char encode,
+    const char train, const lzw_params_t *params)
+{
+    lzw_dictionary_t *dictionary;
+    const char **names;
+    size_t i;
+    int result, error;
+
+    if (train)
+    {
+        names = malloc((list->count + 1) * sizeof(char *));
+
+        if (NULL == names)
+        {
+            perror("Training");
+            return -1;
+        }
+
+        for (i = 0; i < list->count; i++)
+        {
+            names[i] = list->items[i].inName;
+        }
+
+        dictionary = LZWTrainDictionary(names, list->count, params);
+        free(names);
+        result = (NULL == dictionary) ? -1 :
+            LZWWriteDictionary(dictionary, fpOut);
+        LZWFreeDictionary(dictionary);
+
+        if (0 != result)
+        {
+            perror("Training");
+        }
+
+        return result;
+    }
+
+    if (encode)
+    {
+        result = LZWEncodeBatch(list->items, list->count, params);
+    }
+    else
+    {
+        result = LZWDecodeBatch(list->items, list->count, params);
+    }
+
+    if (0 != result)
+    {
+        error = errno;
+        perror(encode ? "Encoding" : "Decoding");
+
+        for (i = 0; i < list->count; i++)
+        {
+            if (0 != list->items[i].error)
+            {
+                fprintf(stderr, "%s: %s\n", list->items[i].inName,
+                    strerror(list->items[i].error));
+            }
+        }
+
+        errno = error;
+    }
+
+    return result;
+}
+
+/****************************************************************************
+*   Function   : Benchmark
+*   Description: This function reads every input file into memory, then
+*                encodes each one with LZWEncodeBuffer and decodes the
+*                result with LZWDecodeBuffer.  One untimed run warms up
+*                the buffers and checks that every file round trips, then
+*                repeats timed runs are made.  The time spent reading is
+*                reported apart from the codec time, along with the mean,
+*                standard deviation and best of the per-run rates, the
+*                compression ratio and the peak resident set size.
+*   Parameters : list - files to benchmark.  stdin is used if it's empty.
+*                repeats - number of timed runs
+*   Effects    : Results are written to stdout
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int Benchmark(const file_list_t *list, const unsigned int repeats)
+{
+    bench_input_t *inputs;
+    lzw_encoder_t *encoder;
+    lzw_decoder_t *decoder;
+    double *times;              /* encode times, then decode times */
+    double start, ioTime;
+    size_t count, i, rawTotal, codedTotal;
+    struct rusage usage;
+    lzw_stats_t stats;          /* codec statistics of the warm up */
+    int haveStats;
+    lzw_memory_t encoded, decoded;  /* codec memory at their peaks */
+    FILE *fp;
+    unsigned int r;
+    int result;
+
+    count = (0 == list->count) ? 1 : list->count;
+    inputs = calloc(count, sizeof(bench_input_t));
+    times = malloc((2 * repeats + 2) * sizeof(double));
+    encoder = LZWMakeEncoder();
+    decoder = LZWMakeDecoder();
+    result = ((NULL == inputs) || (NULL == times) || (NULL == encoder) ||
+        (NULL == decoder)) ? -1 : 0;
+
+    /* I/O: read every input */
+    rawTotal = 0;
+    start = Now();
+
+    for (i = 0; (i < count) && (0 == result); i++)
+    {
+        fp = (0 == list->count) ? stdin : fopen(list->items[i].inName, "rb");
+
+        if (NULL == fp)
+        {
+            perror(list->items[i].inName);
+            result = -1;
+            break;
+        }
+
+        inputs[i].raw = ReadAll(fp, &inputs[i].rawLen);
+
+        if (fp != stdin)
+        {
+            fclose(fp);
+        }
+
+        inputs[i].codedSize = LZWEncodeBound(inputs[i].rawLen);
+        inputs[i].coded = malloc(inputs[i].codedSize);
+        inputs[i].decoded = malloc(inputs[i].rawLen + 1);
+
+        if ((NULL == inputs[i].raw) || (NULL == inputs[i].coded) ||
+            (NULL == inputs[i].decoded))
+        {
+            result = -1;
+        }
+
+        rawTotal += inputs[i].rawLen;
+    }
+
+    ioTime = Now() - start;
+
+    /* warm up and check the results, gathering statistics if the library
+     * was built to keep them */
+    haveStats = (0 == result) && (0 == LZWEncoderStats(encoder, &stats));
+
+    if (0 == result)
+    {
+        result = CodeAll(encoder, decoder, inputs, count, &times[0],
+            &times[1], haveStats ? &stats : NULL);
+    }
+
+    for (r = 0; (r < repeats) && (0 == result); r++)
+    {
+        result = CodeAll(encoder, decoder, inputs, count, &times[r],
+            &times[repeats + r], NULL);
+    }
+
+    if (0 == result)
+    {
+        codedTotal = 0;
+
+        for (i = 0; i < count; i++)
+        {
+            codedTotal += inputs[i].codedLen;
+        }
+
+        printf("%lu file(s), %lu bytes, read in %.3f s\n",
+            (unsigned long)count, (unsigned long)rawTotal, ioTime);
+        printf("encoded to %lu bytes, ratio %.3f\n",
+            (unsigned long)codedTotal,
+            (0 == rawTotal) ? 0.0 : ((double)codedTotal / rawTotal));
+        printf("%u timed run(s)\n", repeats);
+        printf("%-8s %10s %10s %10s %10s\n", "", "mean MB/s", "stddev",
+            "best MB/s", "mean s");
+        ReportRate("encode", times, repeats, rawTotal);
+        ReportRate("decode", times + repeats, repeats, rawTotal);
+
+        if (0 == getrusage(RUSAGE_SELF, &usage))
+        {
+            /* ru_maxrss is in kilobytes on Linux and the BSDs */
+            printf("peak RSS %ld KB\n", usage.ru_maxrss);
+        }
+
+        if ((0 == LZWEncoderMemory(encoder, &encoded)) &&
+            (0 == LZWDecoderMemory(decoder, &decoded)))
+        {
+            printf("peak codec memory: encoder %lu KB, decoder %lu KB "
+                "(stack %lu bytes)\n",
+                (unsigned long)(encoded.total.peak >> 10),
+                (unsigned long)(decoded.total.peak >> 10),
+                (unsigned long)decoded.io.peak);
+        }
+
+        if (haveStats)
+        {
+            ReportStats(&stats);
+        }
+    }
+    else
+    {
+        perror("Benchmarking");
+    }
+
+    for (i = 0; (NULL != inputs) && (i < count); i++)
+    {
+        free(inputs[i].raw);
+        free(inputs[i].coded);
+        free(inputs[i].decoded);
+    }
+
+    free(inputs);
+    free(times);
+    LZWFreeEncoder(encoder);
+    LZWFreeDecoder(decoder);
+    return result;
+}
+
+/****************************************************************************
+*   Function   : ReadAll
+*   Description: This function reads a file into memory.  It works on
+*                pipes as well as regular files.
+*   Parameters : fp - file to read
+*                len - receives the number of bytes read
+*   Effects    : Memory is allocated for the file's contents
+*   Returned   : Pointer to the contents or NULL on error.  errno will be
+*                set in the event of a failure.
+****************************************************************************/
+static unsigned char *ReadAll(FILE *fp, size_t *len)
+{
+    unsigned char *buf;
+    size_t size;
+
+    buf = NULL;
+    size = 0;
+
+    if (0 != ReadPooled(fp, &buf, &size, len))
+    {
+        free(buf);
+        return NULL;
+    }
+
+    return buf;
+}
+
+/****************************************************************************
+*   Function   : ReadPooled
+*   Description: This function reads a file into a buffer that is reused
+*                from file to file, growing the buffer if the file doesn't
+*                fit.  It works on pipes as well as regular files.
+*   Parameters : fp - file to read
+*                buf - pointer to the buffer (NULL for none yet)
+*                size - pointer to the size of the buffer
+*                len - receives the number of bytes read
+*   Effects    : buf and size are updated if the buffer grows
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int ReadPooled(FILE *fp, unsigned char **buf, size_t *size,
+    size_t *len)
+{
+    unsigned char *bigger;
+
+    *len = 0;
+
+    for (;;)
+    {
+        if (*len == *size)
+        {
+            bigger = realloc(*buf, (0 == *size) ? (1 << 16) : (2 * *size));
+
+            if (NULL == bigger)
+            {
+                return -1;
+            }
+
+            *size = (0 == *size) ? (1 << 16) : (2 * *size);
+            *buf = bigger;
+        }
+
+        *len += fread(*buf + *len, 1, *size - *len, fp);
+
+        if (*len < *size)
+        {
+            break;
+        }
+    }
+
+    if (ferror(fp))
+    {
+        errno = EIO;
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : CodeAll
+*   Description: This function encodes every benchmark input, then decodes
+*                every result and checks that it matches its input.  Only
+*                the encoding and decoding are timed.
+*   Parameters : encoder - encoder context
+*                decoder - decoder context
+*                inputs - inputs in memory
+*                count - number of entries in inputs
+*                encodeTime - receives the seconds spent encoding
+*                decodeTime - receives the seconds spent decoding
+*                stats - receives the totals of the encoder's statistics
+*                        and the decoder's KwKwK count, or NULL
+*   Effects    : Each input's coded and decoded buffers are filled
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int CodeAll(lzw_encoder_t *encoder, lzw_decoder_t *decoder,
+    bench_input_t *inputs, const size_t count, double *encodeTime,
+    double *decodeTime, lzw_stats_t *stats)
+{
+    lzw_stats_t streamStats;
+    double start;
+    size_t i, decodedLen;
+    int lengthsMatch;
+
+    start = Now();
+    lengthsMatch = 1;
+
+    for (i = 0; i < count; i++)
+    {
+        if (0 != LZWEncodeBuffer(encoder, inputs[i].raw, inputs[i].rawLen,
+            inputs[i].coded, inputs[i].codedSize, &inputs[i].codedLen))
+        {
+            return -1;
+        }
+
+        if ((NULL != stats) && (0 == LZWEncoderStats(encoder, &streamStats)))
+        {
+            AddStats(stats, &streamStats);
+        }
+    }
+
+    *encodeTime = Now() - start;
+    start = Now();
+
+    for (i = 0; i < count; i++)
+    {
+        if (0 != LZWDecodeBuffer(decoder, inputs[i].coded,
+            inputs[i].codedLen, inputs[i].decoded, inputs[i].rawLen + 1,
+            &decodedLen))
+        {
+            return -1;
+        }
+
+        if (decodedLen != inputs[i].rawLen)
+        {
+            lengthsMatch = 0;
+        }
+
+        if ((NULL != stats) && (0 == LZWDecoderStats(decoder, &streamStats)))
+        {
+            stats->kwkwk += streamStats.kwkwk;
+        }
+    }
+
+    *decodeTime = Now() - start;
+
+    for (i = 0; (i < count) && lengthsMatch; i++)
+    {
+        if (0 != memcmp(inputs[i].raw, inputs[i].decoded, inputs[i].rawLen))
+        {
+            lengthsMatch = 0;
+        }
+    }
+
+    if (!lengthsMatch)
+    {
+        errno = EILSEQ;
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : ReportRate
+*   Description: This function prints the mean, standard deviation and
+*                best of the rates of a set of timed runs.
+*   Parameters : label - name of the timed operation
+*                times - seconds taken by each run
+*                repeats - number of entries in times
+*                bytes - bytes processed by each run
+*   Effects    : A line is written to stdout
+*   Returned   : None
+****************************************************************************/
+static void ReportRate(const char *label, const double times[],
+    const unsigned int repeats, const size_t bytes)
+{
+    double rate, sum, sumSquares, best, mean, variance, seconds;
+    unsigned int r;
+
+    sum = 0.0;
+    sumSquares = 0.0;
+    best = 0.0;
+    seconds = 0.0;
+
+    for (r = 0; r < repeats; r++)
+    {
+        rate = (times[r] > 0.0) ? ((bytes / 1048576.0) / times[r]) : 0.0;
+        sum += rate;
+        sumSquares += rate * rate;
+        seconds += times[r];
+
+        if (rate > best)
+        {
+            best = rate;
+        }
+    }
+
+    mean = (0 == repeats) ? 0.0 : (sum / repeats);
+    variance = (repeats < 2) ? 0.0 :
+        ((sumSquares - (sum * mean)) / (repeats - 1));
+
+    printf("%-8s %10.1f %10.2f %10.1f %10.4f\n", label, mean,
+        (variance > 0.0) ? sqrt(variance) : 0.0, best,
+        (0 == repeats) ? 0.0 : (seconds / repeats));
+}
+
+/****************************************************************************
+*   Function   : AddStats
+*   Description: This function adds one stream's codec statistics to a
+*                total.  The total's fullAt is the earliest point at which
+*                any stream's dictionary filled.
+*   Parameters : total - running totals
+*                stats - statistics of one stream
+*   Effects    : total is updated
+*   Returned   : None
+****************************************************************************/
+static void AddStats(lzw_stats_t *total, const lzw_stats_t *stats)
+{
+    unsigned int i;
+
+    total->bytes += stats->bytes;
+
+    if ((0 != stats->fullAt) &&
+        ((0 == total->fullAt) || (stats->fullAt < total->fullAt)))
+    {
+        total->fullAt = stats->fullAt;
+    }
+
+    total->codes += stats->codes;
+    total->escapes += stats->escapes;
+
+    for (i = 0; i < LZW_STATS_WIDTHS; i++)
+    {
+        total->widths[i] += stats->widths[i];
+    }
+
+    total->hits += stats->hits;
+    total->misses += stats->misses;
+    total->nodes += stats->nodes;
+
+    for (i = 0; i < LZW_STATS_DEPTHS; i++)
+    {
+        total->probes[i] += stats->probes[i];
+        total->depths[i] += stats->depths[i];
+    }
+
+    total->kwkwk += stats->kwkwk;
+}
+
+/****************************************************************************
+*   Function   : ReportStats
+*   Description: This function prints the codec statistics gathered by a
+*                benchmark: dictionary search hit rates and lengths, the
+*                code words written at each width, and histograms of the
+*                nodes visited per search and the depth of strings added
+*                to the dictionary tree.  Empty rows are left out.
+*   Parameters : stats - totals from every input
+*   Effects    : Lines are written to stdout
+*   Returned   : None
+****************************************************************************/
+static void ReportStats(const lzw_stats_t *stats)
+{
+    unsigned long searches;
+    unsigned int i;
+
+    searches = stats->hits + stats->misses;
+
+    printf("\ncodec statistics\n");
+    printf("dictionary searches %lu, hits %.1f%%, nodes per search %.2f\n",
+        searches, (0 == searches) ? 0.0 : ((100.0 * stats->hits) / searches),
+        (0 == searches) ? 0.0 : ((double)stats->nodes / searches));
+
+    if (0 == stats->fullAt)
+    {
+        printf("dictionary never filled\n");
+    }
+    else
+    {
+        printf("dictionary first filled after %lu bytes\n",
+            (unsigned long)stats->fullAt);
+    }
+
+    printf("code words %lu, width escapes %lu, KwKwK codes %lu\n",
+        stats->codes, stats->escapes, stats->kwkwk);
+    printf("%6s %12s\n", "width", "code words");
+
+    for (i = 0; i < LZW_STATS_WIDTHS; i++)
+    {
+        if (0 != stats->widths[i])
+        {
+            printf("%6u %12lu\n", i, stats->widths[i]);
+        }
+    }
+
+    printf("%13s %12s %12s\n", "nodes", "searches", "added here");
+
+    for (i = 0; i < LZW_STATS_DEPTHS; i++)
+    {
+        if ((0 == stats->probes[i]) && (0 == stats->depths[i]))
+        {
+            continue;
+        }
+
+        if (0 == i)
+        {
+            printf("%13s", "0");
+        }
+        else
+        {
+            /* bucket i holds 2^(i - 1) through 2^i - 1 */
+            printf("%6lu-%6lu", 1UL << (i - 1), (1UL << i) - 1);
+        }
+
+        printf(" %12lu %12lu\n", stats->probes[i], stats->depths[i]);
+    }
+}
+
+/****************************************************************************
+*   Function   : Now
+*   Description: This function returns a monotonic time in seconds.
+*   Parameters : None
+*   Effects    : None
+*   Returned   : Current time in seconds
+****************************************************************************/
+static double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+/****************************************************************************
+*   Function   : RunManifest
+*   Description: This function runs every job listed in a manifest in this
+*                process, reusing one encoder, one decoder and the same
+*                buffers for every job.  Each job is a mode (c to encode,
+*                d to decode), an input file name and an output file name.
+*                In a line manifest each job is one line with its fields
+*                separated by tabs, or by spaces if the line has no tabs;
+*                blank lines and lines starting with # are skipped.  In a
+*                NUL separated manifest every field ends with a NUL.  Jobs
+*                that fail are reported and the remaining jobs still run.
+*   Parameters : fpManifest - manifest to read
+*                nulSeparated - non-zero for a NUL separated manifest
+*                parallel - non-zero to encode block streams
+*                params - block-parallel parameters
+*   Effects    : Each job's output file is written
+*   Returned   : 0 if every job succeeded, -1 otherwise.  errno will be set
+*                in the event of a failure.
+****************************************************************************/
+static int RunManifest(FILE *fpManifest, const char nulSeparated,
+    const char parallel, const lzw_params_t *params)
+{
+    job_context_t context;
+    char *record, *field;
+    const char *fields[JOB_FIELDS];
+    const char *separator;      /* separates fields of a line manifest */
+    size_t recordSize;
+    unsigned long jobs, failures, line;
+    unsigned int n;
+    int result, error;
+
+    context.encoder = LZWMakeEncoder();
+    context.decoder = LZWMakeDecoder();
+    context.in = NULL;
+    context.inSize = 0;
+    context.out = NULL;
+    context.outSize = 0;
+    record = NULL;
+    recordSize = 0;
+    jobs = 0;
+    failures = 0;
+    line = 0;
+    error = 0;
+
+    if ((NULL == context.encoder) || (NULL == context.decoder))
+    {
+        perror("Making codec contexts");
+        LZWFreeEncoder(context.encoder);
+        LZWFreeDecoder(context.decoder);
+        return -1;
+    }
+
+    while (0 < (result = ReadRecord(fpManifest, &record, &recordSize,
+        nulSeparated ? '\0' : '\n', nulSeparated ? JOB_FIELDS : 1)))
+    {
+        line++;
+        n = 0;
+
+        if (nulSeparated)
+        {
+            for (field = record; n < JOB_FIELDS; n++)
+            {
+                fields[n] = field;
+                field += strlen(field) + 1;
+            }
+        }
+        else
+        {
+            field = record + strlen(record);
+
+            if ((field != record) && ('\r' == field[-1]))
+            {
+                field[-1] = '\0';
+            }
+
+            if (('\0' == record[0]) || ('#' == record[0]))
+            {
+                continue;
+            }
+
+            separator = (NULL == strchr(record, '\t')) ? " " : "\t";
+            field = strtok(record, separator);
+
+            while ((NULL != field) && (n < JOB_FIELDS))
+            {
+                fields[n] = field;
+                n++;
+
+                /* after the last field, anything left over is an error */
+                field = strtok(NULL, (n < JOB_FIELDS) ? separator : "");
+            }
+
+            if ((NULL != field) && ('\0' != field[0]))
+            {
+                n = JOB_FIELDS + 1;     /* extra fields */
+            }
+        }
+
+        jobs++;
+
+        if ((JOB_FIELDS != n) || ('\0' == fields[0][0]) ||
+            ('\0' != fields[0][1]) ||
+            (('c' != fields[0][0]) && ('d' != fields[0][0])))
+        {
+            fprintf(stderr, "Manifest record %lu: expected c or d, an input "
+                "and an output.\n", line);
+            failures++;
+            error = EINVAL;
+            continue;
+        }
+
+        if (0 != RunJob(&context, fields, parallel, params))
+        {
+            error = errno;
+            fprintf(stderr, "%s: %s\n", fields[1], strerror(error));
+            failures++;
+        }
+    }
+
+    if (result < 0)
+    {
+        error = errno;
+        perror("Reading manifest");
+        failures++;
+    }
+
+    if (0 != failures)
+    {
+        fprintf(stderr, "%lu of %lu jobs failed.\n", failures, jobs);
+    }
+
+    free(record);
+    free(context.in);
+    free(context.out);
+    LZWFreeEncoder(context.encoder);
+    LZWFreeDecoder(context.decoder);
+
+    if (0 != failures)
+    {
+        errno = error;
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : ReadRecord
+*   Description: This function reads the next manifest record into a
+*                buffer that is reused for every record.  A record ends
+*                after count end characters, and each end character is
+*                replaced by a NUL.  A record cut short by the end of the
+*                file is ended as if the missing end characters were there.
+*   Parameters : fp - manifest to read
+*                buf - pointer to the buffer (NULL for none yet)
+*                size - pointer to the size of the buffer
+*                end - character ending each field
+*                count - number of fields in a record
+*   Effects    : buf and size are updated if the buffer grows
+*   Returned   : 1 if a record was read, 0 at the end of the file, -1 on
+*                failure.  errno will be set in the event of a failure.
+****************************************************************************/
+static int ReadRecord(FILE *fp, char **buf, size_t *size, const int end,
+    const unsigned int count)
+{
+    char *bigger;
+    size_t len;
+    unsigned int found;
+    int c;
+
+    len = 0;
+    found = 0;
+
+    while (found < count)
+    {
+        /* room for this character and any missing NULs */
+        if (len + count + 1 >= *size)
+        {
+            bigger = realloc(*buf, 2 * *size + 256);
+
+            if (NULL == bigger)
+            {
+                return -1;
+            }
+
+            *size = 2 * *size + 256;
+            *buf = bigger;
+        }
+
+        c = getc(fp);
+
+        if (EOF == c)
+        {
+            if (ferror(fp))
+            {
+                errno = EIO;
+                return -1;
+            }
+
+            if (0 == len)
+            {
+                return 0;
+            }
+
+            break;
+        }
+
+        if (end == c)
+        {
+            c = '\0';
+            found++;
+        }
+
+        (*buf)[len] = (char)c;
+        len++;
+    }
+
+    for (; found < count; found++)
+    {
+        (*buf)[len] = '\0';
+        len++;
+    }
+
+    return 1;
+}
+
+/****************************************************************************
+*   Function   : RunJob
+*   Description: This function encodes or decodes one manifest job.  The
+*                input is read into the context's buffer and coded with
+*                the context's encoder or decoder, so no memory is
+*                allocated once the buffers are big enough.  Encoding with
+*                parallel set or input that won't shrink, and decoding a
+*                block stream, use the block-parallel engine instead.
+*                Input that isn't a regular file is decoded by
+*                LZWDecodeFileToSink, which tells the kind of stream from
+*                the header it reads.
+*   Parameters : context - codec contexts and buffers shared by all jobs
+*                fields - mode ("c" or "d"), input name and output name
+*                parallel - non-zero to encode a block stream
+*                params - block-parallel parameters
+*   Effects    : The output file is written
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int RunJob(job_context_t *context, const char *fields[],
+    const char parallel, const lzw_params_t *params)
+{
+    FILE *fpIn, *fpOut;
+    progress_display_t display; /* sink for input that can't be peeked at */
+    size_t inLen, outLen;
+    int result, blockStream;
+
+    fpIn = fopen(fields[1], "rb");
+
+    if (NULL == fpIn)
+    {
+        return -1;
+    }
+
+    fpOut = fopen(fields[2], "wb");
+
+    if (NULL == fpOut)
+    {
+        fclose(fpIn);
+        return -1;
+    }
+
+    blockStream = ('d' == fields[0][0]) ? IsBlockStream(fpIn) : 0;
+
+    if (('c' == fields[0][0]) && parallel)
+    {
+        result = LZWEncodeFileParallel(fpIn, fpOut, params);
+    }
+    else if (blockStream < 0)
+    {
+        /* a pipe's header is read, not peeked at, by the library */
+        display.fpOut = fpOut;
+        display.bytesOut = 0;
+        result = LZWDecodeFileToSink(fpIn, WriteDecoded, &display, params);
+    }
+    else if (blockStream)
+    {
+        result = LZWDecodeFileParallel(fpIn, fpOut, params);
+    }
+    else
+    {
+        result = ReadPooled(fpIn, &context->in, &context->inSize, &inLen);
+        outLen = 0;
+
+        if ((0 == result) && ('c' == fields[0][0]) &&
+            (0 == LZWIsCompressible(context->encoder, context->in, inLen)) &&
+            (0 == fseek(fpIn, 0, SEEK_SET)))
+        {
+            /* store data that won't shrink in a block stream */
+            result = LZWEncodeFileParallel(fpIn, fpOut, params);
+        }
+        else if ((0 == result) && ('c' == fields[0][0]))
+        {
+            result = GrowBuffer(&context->out, &context->outSize,
+                LZWEncodeBound(inLen));
+
+            if (0 == result)
+            {
+                result = LZWEncodeBuffer(context->encoder, context->in,
+                    inLen, context->out, context->outSize, &outLen);
+            }
+        }
+        else if (0 == result)
+        {
+            /* the decoded size isn't known, grow until it fits */
+            result = GrowBuffer(&context->out, &context->outSize,
+                2 * inLen + 1);
+
+            while ((0 == result) &&
+                (0 != LZWDecodeBuffer(context->decoder, context->in, inLen,
+                context->out, context->outSize, &outLen)))
+            {
+                result = (ENOBUFS == errno) ? GrowBuffer(&context->out,
+                    &context->outSize, 2 * context->outSize) : -1;
+            }
+        }
+
+        if ((0 == result) &&
+            (outLen != fwrite(context->out, 1, outLen, fpOut)))
+        {
+            result = -1;
+        }
+    }
+
+    fclose(fpIn);
+
+    if ((0 != fclose(fpOut)) && (0 == result))
+    {
+        result = -1;
+    }
+
+    return result;
+}
+
+/****************************************************************************
+*   Function   : GrowBuffer
+*   Description: This function makes sure a reused buffer holds at least
+*                len bytes.
+*   Parameters : buf - pointer to the buffer (NULL for none yet)
+*                size - pointer to the size of the buffer
+*                len - bytes needed
+*   Effects    : buf and size are updated if the buffer grows
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int GrowBuffer(unsigned char **buf, size_t *size, const size_t len)
+{
+    unsigned char *bigger;
+
+    if (len <= *size)
+    {
+        return 0;
+    }
+
+    bigger = realloc(*buf, len);
+
+    if (NULL == bigger)
+    {
+        return -1;
+    }
+
+    *buf = bigger;
+    *size = len;
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : SetupStream
+*   Description: This function gives a file STREAM_BUFFER bytes of stdio
+*                buffering, so the byte at a time codecs make one system
+*                call per STREAM_BUFFER bytes instead of one per page.  If
+*                the file is a pipe, the pipe is also grown to
+*                STREAM_BUFFER bytes where the system allows it, so the
+*                process at the other end can run ahead of this one.  It
+*                must be called before the file is read or written.
+*   Parameters : fp - stdin, stdout or a newly opened file
+*   Effects    : The buffering of fp and the size of its pipe may change
+*   Returned   : None.  Failures leave the default buffering in place.
+****************************************************************************/
+static void SetupStream(FILE *fp)
+{
+    struct stat info;
+
+    if ((0 == fstat(fileno(fp), &info)) && S_ISFIFO(info.st_mode))
+    {
+#ifdef F_SETPIPE_SZ
+        /* fails above /proc/sys/fs/pipe-max-size, the default size stays */
+        (void)fcntl(fileno(fp), F_SETPIPE_SZ, STREAM_BUFFER);
+#endif
+    }
+
+    (void)setvbuf(fp, NULL, _IOFBF, STREAM_BUFFER);
+}
+
+/****************************************************************************
+*   Function   : CreateArchive
+*   Description: This function packs a list of files into an archive with
+*                LZWWriteArchive.  Each member is named after its file,
+*                without any leading / or ./ so that it extracts inside
+*                the current directory.
+*   Parameters : archiveName - name of the archive to write
+*                list - files to pack
+*                params - block-parallel parameters.  dictionary or
+*                         sampleSize give the members a dictionary that is
+*                         stored in the archive.
+*   Effects    : The archive is written and failed files are reported
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int CreateArchive(const char *archiveName, file_list_t *list,
+    const lzw_params_t *params)
+{
+    lzw_batch_item_t *items;
+    FILE *fpArchive;
+    size_t i;
+    int result, error;
+
+    items = malloc(((0 == list->count) ? 1 : list->count) *
+        sizeof(lzw_batch_item_t));
+    fpArchive = fopen(archiveName, "wb");
+
+    if ((NULL == items) || (NULL == fpArchive))
+    {
+        perror((NULL == items) ? "Allocating archive list" :
+            "Opening archive");
+        free(items);
+
+        if (NULL != fpArchive)
+        {
+            fclose(fpArchive);
+        }
+
+        return -1;
+    }
+
+    for (i = 0; i < list->count; i++)
+    {
+        items[i].inName = list->items[i].inName;
+        items[i].outName = MemberName(list->items[i].inName);
+        items[i].error = 0;
+    }
+
+    SetupStream(fpArchive);
+    result = LZWWriteArchive(fpArchive, items, list->count, params);
+    error = errno;
+
+    if ((0 != fclose(fpArchive)) && (0 == result))
+    {
+        error = errno;
+        result = -1;
+    }
+
+    if (0 != result)
+    {
+        perror("Creating archive");
+
+        for (i = 0; i < list->count; i++)
+        {
+            if (0 != items[i].error)
+            {
+                fprintf(stderr, "%s: %s\n", items[i].inName,
+                    strerror(items[i].error));
+            }
+        }
+    }
+
+    free(items);
+    errno = error;
+    return result;
+}
+
+/****************************************************************************
+*   Function   : ExtractArchive
+*   Description: This function extracts members of an archive.  A single
+*                named member is written to fpOut.  Otherwise each named
+*                member, or every member if none are named, is written to
+*                a file named after it, creating directories as needed.
+*                Failures are reported and the remaining members are still
+*                extracted.
+*   Parameters : archiveName - name of the archive to read
+*                names - names of the members to extract
+*                count - number of entries in names, 0 for every member
+*                fpOut - file receiving a single named member
+*   Effects    : Members are decoded and written
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int ExtractArchive(const char *archiveName, const char *names[],
+    const size_t count, FILE *fpOut)
+{
+    lzw_archive_t *archive;
+    lzw_member_t member;
+    FILE *fpArchive;
+    size_t i, index, total;
+    int result, error;
+
+    if ((1 != count) && (fpOut != stdout))
+    {
+        fprintf(stderr, "Members are extracted to files named after them, "
+            "-o is only used with one -i.\n");
+        errno = EINVAL;
+        return -1;
+    }
+
+    fpArchive = fopen(archiveName, "rb");
+    archive = LZWOpenArchive(fpArchive);
+
+    if (NULL == archive)
+    {
+        perror("Opening archive");
+
+        if (NULL != fpArchive)
+        {
+            fclose(fpArchive);
+        }
+
+        return -1;
+    }
+
+    total = (0 == count) ? LZWArchiveCount(archive) : count;
+    error = 0;
+
+    for (i = 0; i < total; i++)
+    {
+        if (0 == count)
+        {
+            index = i;
+            result = LZWArchiveMember(archive, index, &member);
+
+            if (0 == result)
+            {
+                result = ExtractToFile(archive, index, member.name);
+            }
+        }
+        else if (0 != (result = LZWFindMember(archive, names[i], &index)))
+        {
+            fprintf(stderr, "%s: %s\n", names[i], strerror(errno));
+        }
+        else if (1 == count)
+        {
+            if (0 != (result = LZWExtractMember(archive, index, fpOut)))
+            {
+                error = errno;
+                perror("Extracting");
+            }
+        }
+        else
+        {
+            result = ExtractToFile(archive, index, names[i]);
+        }
+
+        if ((0 != result) && (0 == error))
+        {
+            error = errno;
+        }
+    }
+
+    LZWCloseArchive(archive);
+    fclose(fpArchive);
+
+    if (0 != error)
+    {
+        errno = error;
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : ExtractToFile
+*   Description: This function extracts one member of an archive to a file
+*                named after it, creating any missing directories.  Names
+*                that are absolute or contain a .. component are refused,
+*                so an archive can't write outside the current directory.
+*   Parameters : archive - open archive
+*                index - index of the member
+*                name - the member's name
+*   Effects    : The member is written and failures are reported
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int ExtractToFile(lzw_archive_t *archive, const size_t index,
+    const char *name)
+{
+    FILE *fp;
+    char *path, *slash;
+    const char *part;
+    int result;
+
+    /* check each component of the name */
+    for (part = name; NULL != part; part = strchr(part, '/'))
+    {
+        part += ('/' == *part) ? 1 : 0;
+
+        if ((0 == strncmp(part, "..", 2)) &&
+            (('/' == part[2]) || ('\0' == part[2])))
+        {
+            break;
+        }
+    }
+
+    if (('/' == name[0]) || ('\0' == name[0]) || (NULL != part))
+    {
+        fprintf(stderr, "%s: unsafe member name skipped\n", name);
+        errno = EINVAL;
+        return -1;
+    }
+
+    path = malloc(strlen(name) + 1);
+
+    if (NULL == path)
+    {
+        perror(name);
+        return -1;
+    }
+
+    strcpy(path, name);
+
+    /* make the member's directories, ignoring ones that exist */
+    for (slash = strchr(path, '/'); NULL != slash;
+        slash = strchr(slash + 1, '/'))
+    {
+        *slash = '\0';
+
+        if ((slash != path) && (0 != mkdir(path, 0777)) && (EEXIST != errno))
+        {
+            break;
+        }
+
+        *slash = '/';
+    }
+
+    fp = (NULL == slash) ? fopen(path, "wb") : NULL;
+    result = (NULL == fp) ? -1 : LZWExtractMember(archive, index, fp);
+
+    if ((NULL != fp) && (0 != fclose(fp)))
+    {
+        result = -1;
+    }
+
+    if (0 != result)
+    {
+        perror(path);
+    }
+
+    free(path);
+    return result;
+}
+
+/****************************************************************************
+*   Function   : MemberName
+*   Description: This function returns the archive member name for a file
+*                path, which is the path without leading / and ./
+*                components.
+*   Parameters : path - path of a file being archived
+*   Effects    : None
+*   Returned   : Pointer into path
+****************************************************************************/
+static const char *MemberName(const char *path)
+{
+    while (('/' == path[0]) || (('.' == path[0]) && ('/' == path[1])))
+    {
+        path += ('/' == path[0]) ? 1 : 2;
+    }
+
+    return path;
+}
+
+/****************************************************************************
+*   Function   : SearchFiles
+*   Description: This function searches encoded files for lines holding
+*                any of the patterns with LZWSearchFile, which decodes into
+*                bounded buffers instead of writing the decoded data out.
+*                Each matching line is printed with its offset in the
+*                decoded data, after its file's name if more than one file
+*                is searched.  Directories are searched for files ending
+*                in SUFFIX, as when decoding them.
+*   Parameters : patterns - patterns to search for
+*                numPatterns - number of entries in patterns
+*                names - names of encoded files and directories
+*                count - number of entries in names, 0 for stdin
+*                fpOut - file receiving the matching lines
+*                params - block-parallel parameters
+*   Effects    : Matching lines are written and failures are reported
+*   Returned   : 0 if any line matched, 1 if none did and -1 for failure
+*                (like grep).  errno will be set in the event of a failure.
+****************************************************************************/
+static int SearchFiles(const char *patterns[], const size_t numPatterns,
+    const char *names[], const size_t count, FILE *fpOut,
+    const lzw_params_t *params)
+{
+    lzw_matcher_t *matcher;
+    search_output_t output;
+    file_list_t list;
+    FILE *fpIn;
+    size_t i;
+    int result, error;
+
+    matcher = LZWMakeMatcher(patterns, numPatterns);
+
+    if (NULL == matcher)
+    {
+        perror("Patterns");
+        return -1;
+    }
+
+    list.items = NULL;
+    list.count = 0;
+    list.size = 0;
+    result = 0;
+
+    for (i = 0; (i < count) && (0 == result); i++)
+    {
+        result = AddInput(&list, names[i], 0, 1);
+    }
+
+    if (0 != result)
+    {
+        perror("Finding input files");
+        FreeFileList(&list);
+        LZWFreeMatcher(matcher);
+        return -1;
+    }
+
+    output.fpOut = fpOut;
+    output.found = 0;
+    error = 0;
+
+    for (i = 0; (i < list.count) || ((0 == count) && (0 == i)); i++)
+    {
+        output.name = (list.count > 1) ? list.items[i].inName : NULL;
+        fpIn = (0 == count) ? stdin : fopen(list.items[i].inName, "rb");
+
+        if (NULL != fpIn)
+        {
+            SetupStream(fpIn);
+        }
+
+        if ((NULL == fpIn) ||
+            (0 != LZWSearchFile(fpIn, matcher, PrintMatch, &output, params)))
+        {
+            error = errno;
+            fprintf(stderr, "%s: %s\n",
+                (0 == count) ? "-" : list.items[i].inName, strerror(errno));
+        }
+
+        if ((NULL != fpIn) && (fpIn != stdin))
+        {
+            fclose(fpIn);
+        }
+    }
+
+    FreeFileList(&list);
+    LZWFreeMatcher(matcher);
+
+    if ((0 == error) && ferror(fpOut))
+    {
+        error = EIO;
+        perror("Writing matches");
+    }
+
+    if (0 != error)
+    {
+        errno = error;
+        return -1;
+    }
+
+    return (0 == output.found) ? 1 : 0;
+}
+
+/****************************************************************************
+*   Function   : PrintMatch
+*   Description: This function is the LZWSearchFile callback for -g.  It
+*                prints a matching line as [name:]offset:line.
+*   Parameters : arg - the search_output_t for the search
+*                offset - offset of the line in the decoded data
+*                line - the line, without its newline
+*                len - number of bytes in line
+*   Effects    : The line is written to the output file
+*   Returned   : 0 to continue, -1 if the line couldn't be written
+****************************************************************************/
+static int PrintMatch(void *arg, const size_t offset,
+    const unsigned char *line, const size_t len)
+{
+    search_output_t *output;
+
+    output = (search_output_t *)arg;
+    output->found++;
+
+    if (NULL != output->name)
+    {
+        fprintf(output->fpOut, "%s:", output->name);
+    }
+
+    fprintf(output->fpOut, "%lu:", (unsigned long)offset);
+
+    if ((fwrite(line, 1, len, output->fpOut) != len) ||
+        (EOF == fputc('\n', output->fpOut)))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : ListFiles
+*   Description: This function describes each encoded input file using
+*                LZWInspectFile, which reads stream headers and block
+*                prefixes but decodes nothing.
+*   Parameters : names - names of the encoded files
+*                count - number of entries in names, 0 for stdin
+*                fpOut - file receiving the listing
+*   Effects    : A line is written for each file and failures are reported
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int ListFiles(const char *names[], const size_t count, FILE *fpOut)
+{
+    lzw_info_t info;
+    FILE *fpIn;
+    const char *name;
+    size_t i;
+    int error;
+
+    fprintf(fpOut, "%12s %12s %7s %8s %8s %10s %-7s %s\n", "original",
+        "compressed", "ratio", "blocks", "stored", "block size", "format",
+        "file");
+    error = 0;
+
+    for (i = 0; (i < count) || ((0 == count) && (0 == i)); i++)
+    {
+        name = (0 == count) ? "-" : names[i];
+        fpIn = (0 == count) ? stdin : fopen(name, "rb");
+
+        if ((NULL == fpIn) || (0 != LZWInspectFile(fpIn, &info)))
+        {
+            error = errno;
+            fprintf(stderr, "%s: %s\n", name, strerror(errno));
+        }
+        else
+        {
+            ListFile(fpOut, name, &info);
+        }
+
+        if ((NULL != fpIn) && (fpIn != stdin))
+        {
+            fclose(fpIn);
+        }
+    }
+
+    if (0 != error)
+    {
+        errno = error;
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : ListFile
+*   Description: This function writes one line of a -l listing, followed
+*                by notes about the stream's dictionary or members.  Sizes
+*                that a format doesn't record are shown as -.
+*   Parameters : fpOut - file receiving the listing
+*                name - name of the encoded file
+*                info - the file's description from LZWInspectFile
+*   Effects    : The description is written to fpOut
+*   Returned   : None
+****************************************************************************/
+static void ListFile(FILE *fpOut, const char *name, const lzw_info_t *info)
+{
+    static const char *formats[] = {"single", "blocks", "archive"};
+
+    if (LZW_FORMAT_SINGLE == info->format)
+    {
+        fprintf(fpOut, "%12s %12lu %7s %8s %8s %10s", "-",
+            (unsigned long)info->codedSize, "-", "-", "-", "-");
+    }
+    else
+    {
+        fprintf(fpOut, "%12lu %12lu %6.1f%%", (unsigned long)info->rawSize,
+            (unsigned long)info->codedSize, (0 == info->rawSize) ? 0.0 :
+                (100.0 * info->codedSize / info->rawSize));
+
+        /* an archive's directory doesn't count its members' blocks */
+        if (LZW_FORMAT_ARCHIVE == info->format)
+        {
+            fprintf(fpOut, " %8s %8s", "-", "-");
+        }
+        else
+        {
+            fprintf(fpOut, " %8lu %8lu", (unsigned long)info->blocks,
+                (unsigned long)info->storedBlocks);
+        }
+
+        fprintf(fpOut, " %10lu", (unsigned long)info->blockSize);
+    }
+
+    fprintf(fpOut, " %-7s %s\n", formats[info->format], name);
+
+    if (LZW_FORMAT_ARCHIVE == info->format)
+    {
+        fprintf(fpOut, "%12s %lu members\n", "",
+            (unsigned long)info->members);
+    }
+
+    if (info->needsDictionary)
+    {
+        fprintf(fpOut, "%12s needs dictionary id %08lx\n", "",
+            info->dictionaryId);
+    }
+    else if (0 != info->sampleLen)
+    {
+        fprintf(fpOut, "%12s %s dictionary from a %lu byte sample\n", "",
+            (LZW_FORMAT_ARCHIVE == info->format) ? "shared" : "frozen",
+            (unsigned long)info->sampleLen);
+    }
+}
+
+/****************************************************************************
+*   Function   : ListArchive
+*   Description: This function lists the members of an archive from its
+*                directory, without decoding them.
+*   Parameters : archiveName - name of the archive
+*                fpOut - file receiving the listing
+*   Effects    : A line is written for each member
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int ListArchive(const char *archiveName, FILE *fpOut)
+{
+    lzw_archive_t *archive;
+    lzw_member_t member;
+    FILE *fpArchive;
+    size_t i, count;
+    int result;
+
+    fpArchive = fopen(archiveName, "rb");
+    archive = LZWOpenArchive(fpArchive);
+
+    if (NULL == archive)
+    {
+        perror("Opening archive");
+
+        if (NULL != fpArchive)
+        {
+            fclose(fpArchive);
+        }
+
+        return -1;
+    }
+
+    fprintf(fpOut, "%12s %12s %7s %s\n", "original", "compressed", "ratio",
+        "member");
+    count = LZWArchiveCount(archive);
+    result = 0;
+
+    for (i = 0; (i < count) && (0 == result); i++)
+    {
+        result = LZWArchiveMember(archive, i, &member);
+
+        if (0 == result)
+        {
+            fprintf(fpOut, "%12lu %12lu %6.1f%% %s\n",
+                (unsigned long)member.size, (unsigned long)member.codedSize,
+                (0 == member.size) ? 0.0 :
+                    (100.0 * member.codedSize / member.size), member.name);
+        }
+        else
+        {
+            perror("Reading archive directory");
+        }
+    }
+
+    LZWCloseArchive(archive);
+    fclose(fpArchive);
+    return result;
+}
+
+/****************************************************************************
+*   Function   : ShowProgress
+*   Description: This function is a progress callback.  It redraws a line
+*                on stderr with the bytes read and written so far, the
+*                current ratio of encoded to decoded size and the input
+*                rate since the job started.
+*   Parameters : arg - the progress_display_t for the job
+*                bytesIn - bytes of input coded so far
+*                bytesOut - bytes of output written so far
+*   Effects    : A progress line is written to stderr
+*   Returned   : None
+****************************************************************************/
+static void ShowProgress(void *arg, const size_t bytesIn,
+    const size_t bytesOut)
+{
+    progress_display_t *display;
+    size_t coded, raw;
+    double elapsed;
+
+    display = (progress_display_t *)arg;
+    elapsed = Now() - display->start;
+    coded = display->encode ? bytesOut : bytesIn;
+    raw = display->encode ? bytesIn : bytesOut;
+
+    fprintf(stderr, "\r%10.1f MB in %10.1f MB out %6.1f%% %8.1f MB/s",
+        bytesIn / 1048576.0, bytesOut / 1048576.0,
+        (0 == raw) ? 0.0 : (100.0 * coded / raw),
+        (elapsed <= 0.0) ? 0.0 : ((bytesIn / 1048576.0) / elapsed));
+    fflush(stderr);
+    display->shown = 1;
+}
+
+/****************************************************************************
+*   Function   : EncodeShowingProgress
+*   Description: This function encodes a single stream like LZWEncodeFile,
+*                but a buffer at a time with LZWEncodeChunk, so progress
+*                can be shown every LZW_PROGRESS_STEP bytes by checking a
+*                counter once per buffer.  The stream is identical to the
+*                one LZWEncodeFile writes.
+*   Parameters : fpIn - file to encode
+*                fpOut - file receiving the encoded stream
+*                display - progress display for the job
+*   Effects    : fpIn is encoded to fpOut and progress is shown
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int EncodeShowingProgress(FILE *fpIn, FILE *fpOut,
+    progress_display_t *display)
+{
+    lzw_encoder_t *encoder;
+    unsigned char *in, *out;
+    size_t len, outSize, outLen, bytesIn, bytesOut, nextReport;
+    int result;
+
+    encoder = LZWMakeEncoder();
+    outSize = LZWEncodeBound(STREAM_BUFFER);
+    in = malloc(STREAM_BUFFER);
+    out = malloc(outSize);
+    result = 0;
+
+    if ((NULL == encoder) || (NULL == in) || (NULL == out))
+    {
+        errno = ENOMEM;
+        result = -1;
+    }
+    else
+    {
+        LZWEncodeStart(encoder);
+    }
+
+    bytesIn = 0;
+    bytesOut = 0;
+    nextReport = LZW_PROGRESS_STEP;
+
+    while ((0 == result) && (0 != (len = fread(in, 1, STREAM_BUFFER, fpIn))))
+    {
+        result = LZWEncodeChunk(encoder, in, len, out, outSize, &outLen);
+
+        if ((0 == result) && (fwrite(out, 1, outLen, fpOut) != outLen))
+        {
+            result = -1;
+        }
+
+        bytesIn += len;
+        bytesOut += outLen;
+
+        if (bytesIn >= nextReport)
+        {
+            ShowProgress(display, bytesIn, bytesOut);
+            nextReport = bytesIn + LZW_PROGRESS_STEP;
+        }
+    }
+
+    if ((0 == result) && ferror(fpIn))
+    {
+        result = -1;
+    }
+
+    if (0 == result)
+    {
+        result = LZWEncodeEnd(encoder, out, outSize, &outLen);
+
+        if ((0 == result) && (fwrite(out, 1, outLen, fpOut) != outLen))
+        {
+            result = -1;
+        }
+
+        ShowProgress(display, bytesIn, bytesOut + outLen);
+    }
+
+    LZWFreeEncoder(encoder);
+    free(in);
+    free(out);
+    return result;
+}
+
+/****************************************************************************
+*   Function   : DecodeShowingProgress
+*   Description: This function decodes a single stream like LZWDecodeFile,
+*                but a buffer at a time with LZWDecodeChunk, so progress
+*                can be shown every LZW_PROGRESS_STEP encoded bytes by
+*                checking a counter once per buffer.
+*   Parameters : fpIn - file to decode
+*                fpOut - file receiving the decoded data
+*                display - progress display for the job
+*   Effects    : fpIn is decoded to fpOut and progress is shown
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int DecodeShowingProgress(FILE *fpIn, FILE *fpOut,
+    progress_display_t *display)
+{
+    lzw_decoder_t *decoder;
+    unsigned char *in;
+    size_t len, bytesIn, nextReport;
+    int result;
+
+    decoder = LZWMakeDecoder();
+    in = malloc(STREAM_BUFFER);
+    result = 0;
+
+    if ((NULL == decoder) || (NULL == in))
+    {
+        errno = ENOMEM;
+        result = -1;
+    }
+
+    display->fpOut = fpOut;
+    display->bytesOut = 0;
+    bytesIn = 0;
+    nextReport = LZW_PROGRESS_STEP;
+
+    while ((0 == result) && (0 != (len = fread(in, 1, STREAM_BUFFER, fpIn))))
+    {
+        result = LZWDecodeChunk(decoder, in, len, WriteDecoded, display);
+        bytesIn += len;
+
+        if (bytesIn >= nextReport)
+        {
+            ShowProgress(display, bytesIn, display->bytesOut);
+            nextReport = bytesIn + LZW_PROGRESS_STEP;
+        }
+    }
+
+    if ((0 == result) && ferror(fpIn))
+    {
+        result = -1;
+    }
+
+    if (0 == result)
+    {
+        ShowProgress(display, bytesIn, display->bytesOut);
+    }
+
+    LZWFreeDecoder(decoder);
+    free(in);
+    return result;
+}
+
+/****************************************************************************
+*   Function   : WriteDecoded
+*   Description: This function is the LZWDecodeChunk sink used when showing
+*                progress, and the LZWDecodeFileToSink sink for input that
+*                can't be peeked at.  It writes decoded data and counts it.
+*   Parameters : arg - the progress_display_t for the job
+*                data - decoded data
+*                len - bytes in data
+*   Effects    : data is written to the display's output file
+*   Returned   : 0 to continue decoding, -1 if the write failed
+****************************************************************************/
+static int WriteDecoded(void *arg, const unsigned char *data,
+    const size_t len)
+{
+    progress_display_t *display;
+
+    display = (progress_display_t *)arg;
+    display->bytesOut += len;
+    return (fwrite(data, 1, len, display->fpOut) == len) ? 0 : -1;
+}
+
+/****************************************************************************
+*   Function   : CloseOutput
+*   Description: This function closes the output file, or flushes stdout,
+*                and reports output that couldn't be written.  A full disk
+*                may not show up until the last buffer is written here.
+*   Parameters : fp - output file
+*   Effects    : fp is closed unless it's stdout
+*   Returned   : 0 for success, -1 for failure
+****************************************************************************/
+static int CloseOutput(FILE *fp)
+{
+    int failed;
+
+    failed = ferror(fp);
+    failed |= (stdout == fp) ? fflush(fp) : fclose(fp);
+
+    if (0 != failed)
+    {
+        perror("Writing output file");
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : WorthEncoding
+*   Description: This function checks whether the start of a regular file
+*                is worth encoding as a single stream, using
+*                LZWIsCompressible on up to SNIFF_SAMPLE bytes, then seeks
+*                back.  Other files can't be read twice and are assumed to
+*                be worth encoding.
+*   Parameters : fp - file about to be encoded
+*   Effects    : None.  The file position is restored.
+*   Returned   : 0 if the file should be stored, non-zero otherwise
+****************************************************************************/
+static int WorthEncoding(FILE *fp)
+{
+    struct stat info;
+    lzw_encoder_t *encoder;
+    unsigned char *sample;
+    size_t len;
+    long start;
+    int result;
+
+    if ((0 != fstat(fileno(fp), &info)) || !S_ISREG(info.st_mode) ||
+        ((start = ftell(fp)) < 0))
+    {
+        return 1;
+    }
+
+    sample = malloc(SNIFF_SAMPLE);
+    encoder = LZWMakeEncoder();
+    result = 1;
+
+    if ((NULL != sample) && (NULL != encoder))
+    {
+        len = fread(sample, 1, SNIFF_SAMPLE, fp);
+        result = (0 != LZWIsCompressible(encoder, sample, len));
+    }
+
+    free(sample);
+    LZWFreeEncoder(encoder);
+
+    if (0 != fseek(fp, start, SEEK_SET))
+    {
+        perror("Rewinding input file");
+    }
+
+    return result;
 }